@@ -0,0 +1,81 @@
+#!/bin/python3
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+"""Times the command line duplicate finder on a generated image corpus.
+
+Usage: dupes-benchmark.py <geeqie executable> [image count]
+
+The corpus is written to a temporary folder. A quarter of the images get a
+byte-identical copy, another quarter a slightly brightened copy, so that the
+checksum and the similarity checks both find groups.
+"""
+
+import os
+import pathlib
+import random
+import subprocess
+import sys
+import tempfile
+import time
+
+IMAGE_SIZE = 128
+DEFAULT_IMAGE_COUNT = 2000
+MAX_RUN_TIME_S = 600
+
+
+def write_ppm(path: pathlib.Path, pixels: bytes) -> None:
+    path.write_bytes(b"P6\n%d %d\n255\n" % (IMAGE_SIZE, IMAGE_SIZE) + pixels)
+
+
+def make_pixels(rng: random.Random) -> bytes:
+    """A few random colour blocks, which the similarity check can tell apart."""
+    blocks = [bytes(rng.randrange(256) for _ in range(3)) for _ in range(16)]
+    rows = []
+    for y in range(IMAGE_SIZE):
+        row = b"".join(blocks[(y * 4 // IMAGE_SIZE) * 4 + x * 4 // IMAGE_SIZE] for x in range(IMAGE_SIZE))
+        rows.append(row)
+    return b"".join(rows)
+
+
+def make_corpus(folder: pathlib.Path, count: int) -> None:
+    rng = random.Random(count)
+    for i in range(count):
+        pixels = make_pixels(rng)
+        write_ppm(folder / f"image-{i:06d}.ppm", pixels)
+
+        if i % 4 == 0:
+            write_ppm(folder / f"image-{i:06d}-copy.ppm", pixels)
+        elif i % 4 == 1:
+            write_ppm(folder / f"image-{i:06d}-bright.ppm", bytes(min(255, p + 4) for p in pixels))
+
+
+def run(geeqie_exe: str, folder: pathlib.Path, match: str) -> None:
+    env = dict(os.environ, GQ_DUPES="y")
+    start = time.monotonic()
+    result = subprocess.run(args=[geeqie_exe, f"--match={match}", "--recurse", str(folder)],
+                            env=env, capture_output=True, text=True, timeout=MAX_RUN_TIME_S, check=True)
+    elapsed = time.monotonic() - start
+
+    groups = {line.split(",")[0] for line in result.stdout.splitlines()[1:]}
+    print(f"{match}: {elapsed:.2f} s, {len(groups)} groups")
+
+
+def main(argv) -> int:
+    geeqie_exe = argv[1]
+    count = int(argv[2]) if len(argv) > 2 else DEFAULT_IMAGE_COUNT
+
+    with tempfile.TemporaryDirectory() as corpus_dir:
+        folder = pathlib.Path(corpus_dir)
+
+        start = time.monotonic()
+        make_corpus(folder, count)
+        print(f"corpus: {count} images and copies in {time.monotonic() - start:.2f} s")
+
+        for match in ["checksum", "size,dimensions", "similarity-high"]:
+            run(geeqie_exe, folder, match)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,70 @@
+#!/bin/python3
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+"""Times image loading for each file format in the test image folder.
+
+Usage: load-benchmark.py <geeqie executable> <test image folder> [copies]
+
+The images of each format are copied a number of times to a temporary folder,
+which the command line duplicate finder then checks for similarity. That
+decodes every file through the image loader, so the run time is dominated by
+the loader of the format.
+"""
+
+import os
+import pathlib
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+DEFAULT_COPIES = 20
+MAX_RUN_TIME_S = 600
+
+
+def images_by_format(image_dir: pathlib.Path) -> dict:
+    formats = {}
+    for path in sorted(image_dir.iterdir()):
+        if path.is_file() and path.suffix and not path.name.startswith("fail"):
+            formats.setdefault(path.suffix.lower(), []).append(path)
+    return formats
+
+
+def run(geeqie_exe: str, folder: pathlib.Path) -> float:
+    env = dict(os.environ, GQ_DUPES="y")
+    start = time.monotonic()
+    subprocess.run(args=[geeqie_exe, "--match=similarity-high", str(folder)],
+                   env=env, capture_output=True, text=True, timeout=MAX_RUN_TIME_S, check=True)
+    return time.monotonic() - start
+
+
+def main(argv) -> int:
+    geeqie_exe = argv[1]
+    image_dir = pathlib.Path(argv[2])
+    copies = int(argv[3]) if len(argv) > 3 else DEFAULT_COPIES
+
+    for suffix, paths in images_by_format(image_dir).items():
+        with tempfile.TemporaryDirectory() as corpus_dir:
+            folder = pathlib.Path(corpus_dir)
+            size = 0
+            for path in paths:
+                size += path.stat().st_size * copies
+                for i in range(copies):
+                    shutil.copyfile(path, folder / f"{path.stem}-{i:04d}{path.suffix}")
+
+            try:
+                elapsed = run(geeqie_exe, folder)
+            except subprocess.SubprocessError as e:
+                print(f"{suffix}: failed: {e}")
+                continue
+
+            count = len(paths) * copies
+            print(f"{suffix}: {count} files, {size / 1048576:.1f} MiB, "
+                  f"{elapsed:.2f} s, {elapsed * 1000 / count:.1f} ms per file")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,740 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "cache-db.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "cache.h"
+#include "debug.h"
+#include "md5-util.h"
+#include "similar.h"
+#include "ui-fileops.h"
+
+/**
+ * @file
+ *-------------------------------------------------------------------
+ * Similarity database file format:
+ *-------------------------------------------------------------------
+ *
+ * A #CacheDatabaseHeader, followed by any number of records. Each record
+ * is a #CacheDatabaseRecord, the file name (not terminated), and if
+ * CACHE_DB_SIMILARITY is set the 32 x 32 similarity grid as 1024 red,
+ * 1024 green and 1024 blue bytes. Records are padded to a multiple of
+ * 8 bytes. All numbers are in host byte order, a database written on a
+ * machine with another byte order is replaced on the first save.
+ *
+ * A record with CACHE_DB_REMOVED drops the earlier records of its name,
+ * for images that were deleted or moved away.
+ */
+
+namespace
+{
+
+constexpr gchar CACHE_DB_MAGIC[8] = {'G', 'Q', 'S', 'I', 'M', 'D', 'B', '\0'};
+constexpr guint32 CACHE_DB_VERSION = 1;
+constexpr guint32 CACHE_DB_BYTE_ORDER = 0x01020304;
+
+struct CacheDatabaseHeader
+{
+	gchar magic[8];
+	guint32 version;
+	guint32 byte_order;
+};
+
+enum CacheDatabaseFlags : guint8 {
+	CACHE_DB_DIMENSIONS = 1 << 0,
+	CACHE_DB_DATE       = 1 << 1,
+	CACHE_DB_MD5SUM     = 1 << 2,
+	CACHE_DB_SIMILARITY = 1 << 3,
+	CACHE_DB_REMOVED    = 1 << 4  /**< the name has no record, set alone */
+};
+
+struct CacheDatabaseRecord
+{
+	guint32 length; /**< of the whole record, including name, grid and padding */
+	guint32 checksum; /**< of the bytes following this field */
+	gint64 mtime; /**< of the image */
+	gint64 size; /**< of the image */
+	gint64 date;
+	gint32 width;
+	gint32 height;
+	guint8 md5sum[MD5_SIZE];
+	guint16 name_length;
+	guint8 flags; /**< #CacheDatabaseFlags */
+	guint8 reserved[5];
+};
+
+static_assert(sizeof(CacheDatabaseHeader) == 16);
+static_assert(sizeof(CacheDatabaseRecord) == 64);
+
+constexpr gsize CACHE_DB_CHECKSUM_START = offsetof(CacheDatabaseRecord, checksum) + sizeof(guint32);
+constexpr gsize CACHE_DB_CHANNEL_SIZE = std::tuple_size_v<ImageSimilarityData::Avg>;
+
+/* Superseded records are tolerated up to this count, or the count of live records if larger */
+constexpr gsize CACHE_DB_COMPACT_MIN = 64;
+
+/* A duplicates or search run usually goes through the folders one after the other */
+constexpr gsize CACHE_DB_OPEN_MAX = 8;
+
+/* FNV-1a */
+guint32 cache_database_checksum(const guint8 *data, gsize length)
+{
+	guint32 hash = 2166136261U;
+
+	for (gsize i = 0; i < length; i++)
+		{
+		hash ^= data[i];
+		hash *= 16777619U;
+		}
+
+	return hash;
+}
+
+void cache_database_header_append(GString *buffer)
+{
+	CacheDatabaseHeader header{};
+
+	memcpy(header.magic, CACHE_DB_MAGIC, sizeof(header.magic));
+	header.version = CACHE_DB_VERSION;
+	header.byte_order = CACHE_DB_BYTE_ORDER;
+
+	g_string_append_len(buffer, reinterpret_cast<const gchar *>(&header), sizeof(header));
+}
+
+gboolean cache_database_header_valid(const guint8 *data, gsize length)
+{
+	if (length < sizeof(CacheDatabaseHeader)) return FALSE;
+
+	CacheDatabaseHeader header;
+	memcpy(&header, data, sizeof(header));
+
+	return memcmp(header.magic, CACHE_DB_MAGIC, sizeof(header.magic)) == 0 &&
+	       header.version == CACHE_DB_VERSION &&
+	       header.byte_order == CACHE_DB_BYTE_ORDER;
+}
+
+void cache_database_record_append(GString *buffer, const gchar *name, gint64 mtime, gint64 size, const CacheData &cd)
+{
+	const gsize name_length = strlen(name);
+	const gboolean has_similarity = image_sim_filled(cd.similarity.get());
+	const gsize unpadded = sizeof(CacheDatabaseRecord) + name_length + (has_similarity ? 3 * CACHE_DB_CHANNEL_SIZE : 0);
+
+	CacheDatabaseRecord record{};
+	record.length = (unpadded + 7) & ~static_cast<gsize>(7);
+	record.mtime = mtime;
+	record.size = size;
+	record.name_length = name_length;
+
+	if (cd.dimensions)
+		{
+		record.flags |= CACHE_DB_DIMENSIONS;
+		record.width = cd.dimensions->width;
+		record.height = cd.dimensions->height;
+		}
+	if (cd.date)
+		{
+		record.flags |= CACHE_DB_DATE;
+		record.date = *cd.date;
+		}
+	if (cd.md5sum)
+		{
+		record.flags |= CACHE_DB_MD5SUM;
+		memcpy(record.md5sum, cd.md5sum->data(), MD5_SIZE);
+		}
+	if (has_similarity)
+		{
+		record.flags |= CACHE_DB_SIMILARITY;
+		}
+
+	const gsize start = buffer->len;
+
+	g_string_append_len(buffer, reinterpret_cast<const gchar *>(&record), sizeof(record));
+	g_string_append_len(buffer, name, name_length);
+	if (has_similarity)
+		{
+		for (const ImageSimilarityData::Avg *avg : {&cd.similarity->avg_r, &cd.similarity->avg_g, &cd.similarity->avg_b})
+			{
+			g_string_append_len(buffer, reinterpret_cast<const gchar *>(avg->data()), avg->size());
+			}
+		}
+	while (buffer->len < start + record.length) g_string_append_c(buffer, '\0');
+
+	auto *data = reinterpret_cast<guint8 *>(buffer->str + start);
+	const guint32 checksum = cache_database_checksum(data + CACHE_DB_CHECKSUM_START, record.length - CACHE_DB_CHECKSUM_START);
+	memcpy(data + offsetof(CacheDatabaseRecord, checksum), &checksum, sizeof(checksum));
+}
+
+void cache_database_removed_append(GString *buffer, const gchar *name)
+{
+	const gsize name_length = strlen(name);
+
+	CacheDatabaseRecord record{};
+	record.length = (sizeof(CacheDatabaseRecord) + name_length + 7) & ~static_cast<gsize>(7);
+	record.name_length = name_length;
+	record.flags = CACHE_DB_REMOVED;
+
+	const gsize start = buffer->len;
+
+	g_string_append_len(buffer, reinterpret_cast<const gchar *>(&record), sizeof(record));
+	g_string_append_len(buffer, name, name_length);
+	while (buffer->len < start + record.length) g_string_append_c(buffer, '\0');
+
+	auto *data = reinterpret_cast<guint8 *>(buffer->str + start);
+	const guint32 checksum = cache_database_checksum(data + CACHE_DB_CHECKSUM_START, record.length - CACHE_DB_CHECKSUM_START);
+	memcpy(data + offsetof(CacheDatabaseRecord, checksum), &checksum, sizeof(checksum));
+}
+
+/**
+ * @brief Opens the database file \a path, creating it if needed, and takes an exclusive lock
+ * @returns The file descriptor, or -1 on failure
+ *
+ * If another process replaced the file while this one waited for the lock,
+ * the new file is opened and locked instead. Closing the descriptor unlocks.
+ */
+gint cache_database_open_locked(const gchar *path)
+{
+	while (true)
+		{
+		const gint fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+		if (fd < 0) return -1;
+
+		if (flock(fd, LOCK_EX) != 0)
+			{
+			const gint error = errno;
+			::close(fd);
+			if (error == EINTR) continue;
+
+			errno = error;
+			return -1;
+			}
+
+		struct stat fd_st;
+		struct stat path_st;
+		if (fstat(fd, &fd_st) == 0 && stat(path, &path_st) == 0 &&
+		    fd_st.st_dev == path_st.st_dev && fd_st.st_ino == path_st.st_ino) return fd;
+
+		::close(fd);
+		}
+}
+
+std::mutex cache_database_mutex;
+std::list<std::unique_ptr<CacheDatabase>> cache_database_list; /**< most recently used first */
+
+/**
+ * @brief Returns the database of the cache folder \a dir, opening it if needed
+ *
+ * The caller must hold #cache_database_mutex.
+ */
+CacheDatabase *cache_database_get(const gchar *dir)
+{
+	g_autofree gchar *path = g_build_filename(dir, GQ_CACHE_SIM_DB, nullptr);
+	g_autofree gchar *pathl = path_from_utf8(path);
+
+	const auto it = std::find_if(cache_database_list.begin(), cache_database_list.end(),
+	                             [pathl](const std::unique_ptr<CacheDatabase> &db){ return db->get_path() == pathl; });
+	if (it != cache_database_list.end())
+		{
+		cache_database_list.splice(cache_database_list.begin(), cache_database_list, it);
+		return cache_database_list.front().get();
+		}
+
+	cache_database_list.push_front(std::make_unique<CacheDatabase>(path));
+	if (cache_database_list.size() > CACHE_DB_OPEN_MAX) cache_database_list.pop_back();
+
+	return cache_database_list.front().get();
+}
+
+} // namespace
+
+/*
+ *-------------------------------------------------------------------
+ * database file
+ *-------------------------------------------------------------------
+ */
+
+/**
+ * @param path UTF-8 path of the database file, which need not exist yet
+ */
+CacheDatabase::CacheDatabase(const gchar *path)
+{
+	g_autofree gchar *pathl = path_from_utf8(path);
+	this->path = pathl;
+
+	refresh();
+}
+
+CacheDatabase::~CacheDatabase()
+{
+	close();
+}
+
+void CacheDatabase::close()
+{
+	g_clear_pointer(&mapped, g_mapped_file_unref);
+}
+
+/**
+ * @brief Indexes the records appended since the last call
+ * @returns TRUE if new records may have been found
+ *
+ * If the file was replaced, by compact() in this or another process,
+ * it is indexed from the start.
+ */
+bool CacheDatabase::refresh()
+{
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0)
+		{
+		close();
+		entries.clear();
+		record_count = 0;
+		parsed_size = 0;
+		valid = TRUE;
+		return false;
+		}
+
+	const gsize old_length = mapped ? g_mapped_file_get_length(mapped) : 0;
+	if (mapped && static_cast<gsize>(st.st_size) == old_length && st.st_ino == inode) return false;
+
+	g_autoptr(GError) error = nullptr;
+	GMappedFile *new_mapped = g_mapped_file_new(path.c_str(), FALSE, &error);
+	if (!new_mapped)
+		{
+		DEBUG_1("Failed to map %s: %s", path.c_str(), error->message);
+		return false;
+		}
+
+	if (st.st_ino != inode || static_cast<gsize>(st.st_size) < parsed_size)
+		{
+		entries.clear();
+		record_count = 0;
+		parsed_size = 0;
+		}
+
+	close();
+	mapped = new_mapped;
+	inode = st.st_ino;
+
+	const auto *data = reinterpret_cast<const guint8 *>(g_mapped_file_get_contents(mapped));
+	const gsize length = g_mapped_file_get_length(mapped);
+
+	if (parsed_size == 0)
+		{
+		valid = (length == 0) || cache_database_header_valid(data, length);
+		if (!valid || length < sizeof(CacheDatabaseHeader)) return false;
+
+		parsed_size = sizeof(CacheDatabaseHeader);
+		}
+
+	gsize offset = parsed_size;
+	while (offset + sizeof(CacheDatabaseRecord) <= length)
+		{
+		CacheDatabaseRecord record;
+		memcpy(&record, data + offset, sizeof(record));
+
+		/* Stop at a record cut short */
+		if (record.length % 8 != 0 ||
+		    record.length < sizeof(record) + record.name_length ||
+		    record.length > length - offset) break;
+
+		std::string name(reinterpret_cast<const gchar *>(data + offset + sizeof(record)), record.name_length);
+		if (record.flags & CACHE_DB_REMOVED)
+			{
+			entries.erase(name);
+			}
+		else
+			{
+			entries[std::move(name)] = offset;
+			}
+		record_count++;
+		offset += record.length;
+		}
+
+	parsed_size = offset;
+
+	return true;
+}
+
+/**
+ * @brief Reads the record of \a name into \a cd
+ * @param name File name of the image, without folder
+ * @param mtime Current modification time of the image
+ * @param size Current size of the image
+ * @param cd
+ * @returns true if a valid record for this version of the image exists
+ *
+ * A record of another version of the image is dropped.
+ */
+bool CacheDatabase::load(const gchar *name, gint64 mtime, gint64 size, CacheData &cd)
+{
+	auto it = entries.find(name);
+	if (it == entries.end())
+		{
+		if (!refresh()) return false;
+
+		it = entries.find(name);
+		if (it == entries.end()) return false;
+		}
+
+	const auto *data = reinterpret_cast<const guint8 *>(g_mapped_file_get_contents(mapped)) + it->second;
+
+	CacheDatabaseRecord record;
+	memcpy(&record, data, sizeof(record));
+
+	if (record.mtime != mtime || record.size != size)
+		{
+		/* Another process may have saved the current version meanwhile */
+		if (refresh()) return load(name, mtime, size, cd);
+
+		DEBUG_1("Stale record of %s in %s", name, path.c_str());
+		remove(name);
+		return false;
+		}
+
+	const gsize grid_size = (record.flags & CACHE_DB_SIMILARITY) ? 3 * CACHE_DB_CHANNEL_SIZE : 0;
+	if (record.length < sizeof(record) + record.name_length + grid_size ||
+	    cache_database_checksum(data + CACHE_DB_CHECKSUM_START, record.length - CACHE_DB_CHECKSUM_START) != record.checksum)
+		{
+		DEBUG_1("Corrupt record of %s in %s", name, path.c_str());
+		return false;
+		}
+
+	if (record.flags & CACHE_DB_DIMENSIONS)
+		{
+		cd.set_dimensions({record.width, record.height});
+		}
+	if (record.flags & CACHE_DB_DATE)
+		{
+		cd.date = record.date;
+		}
+	if (record.flags & CACHE_DB_MD5SUM)
+		{
+		Md5Digest digest;
+		memcpy(digest.data(), record.md5sum, MD5_SIZE);
+		cd.set_md5sum(digest);
+		}
+	if (record.flags & CACHE_DB_SIMILARITY)
+		{
+		const guint8 *grid = data + sizeof(record) + record.name_length;
+		ImageSimilarityData sd;
+
+		for (ImageSimilarityData::Avg *avg : {&sd.avg_r, &sd.avg_g, &sd.avg_b})
+			{
+			memcpy(avg->data(), grid, avg->size());
+			grid += avg->size();
+			}
+		sd.filled = true;
+
+		cd.set_similarity(sd);
+		}
+
+	return true;
+}
+
+/**
+ * @brief Appends a record of \a cd for \a name, replacing any earlier one
+ * @param name File name of the image, without folder
+ * @param mtime Current modification time of the image
+ * @param size Current size of the image
+ * @param cd
+ * @returns true on success
+ */
+bool CacheDatabase::save(const gchar *name, gint64 mtime, gint64 size, const CacheData &cd)
+{
+	if (strlen(name) > G_MAXUINT16) return false;
+
+	g_autoptr(GString) buffer = g_string_new(nullptr);
+	cache_database_record_append(buffer, name, mtime, size, cd);
+
+	return append(name, buffer);
+}
+
+/**
+ * @brief Drops the record of \a name
+ * @param name File name of the image, without folder
+ * @returns true on success, or if there is no record of \a name
+ */
+bool CacheDatabase::remove(const gchar *name)
+{
+	refresh();
+
+	if (!entries.count(name)) return true;
+
+	g_autoptr(GString) buffer = g_string_new(nullptr);
+	cache_database_removed_append(buffer, name);
+
+	return append(name, buffer);
+}
+
+/**
+ * @brief Drops the records of the images that are no longer in \a source_dir,
+ * and the superseded records
+ * @param source_dir UTF-8 path of the folder of the images
+ * @returns true on success
+ */
+bool CacheDatabase::prune(const gchar *source_dir)
+{
+	refresh();
+
+	if (!mapped) return true;
+
+	const auto exists = [source_dir](const std::string &name)
+	{
+		g_autofree gchar *source = g_build_filename(source_dir, name.c_str(), nullptr);
+
+		return isfile(source) != FALSE;
+	};
+
+	const bool missing = std::any_of(entries.cbegin(), entries.cend(), [&exists](const auto &entry){ return !exists(entry.first); });
+	if (!missing && superseded_count() == 0) return true;
+
+	g_autoptr(GString) none = g_string_new(nullptr);
+
+	return replace(nullptr, none, exists);
+}
+
+/**
+ * @brief Appends \a records, or rewrites the file with them when it needs compacting
+ * @param name The name in \a buffer
+ * @param buffer Records to append
+ * @returns true on success
+ */
+bool CacheDatabase::append(const gchar *name, const GString *buffer)
+{
+	const gint fd = cache_database_open_locked(path.c_str());
+	if (fd < 0)
+		{
+		DEBUG_1("Failed to open %s: %s", path.c_str(), strerror(errno));
+		return false;
+		}
+
+	refresh();
+
+	/* A foreign file, a record cut short, or too many superseded records */
+	const gsize length = mapped ? g_mapped_file_get_length(mapped) : 0;
+	const gsize superseded = superseded_count() + (entries.count(name) ? 1 : 0);
+	if (!valid || (length > 0 && parsed_size != length) || superseded > std::max(CACHE_DB_COMPACT_MIN, entries.size()))
+		{
+		::close(fd);
+		return replace(name, buffer);
+		}
+
+	g_autoptr(GString) data = g_string_new(nullptr);
+	if (length == 0) cache_database_header_append(data);
+	g_string_append_len(data, buffer->str, buffer->len);
+
+	/* One write, so that a crash leaves at most one record cut short */
+	const bool success = write(fd, data->str, data->len) == static_cast<gssize>(data->len);
+	::close(fd);
+
+	refresh();
+
+	return success;
+}
+
+/**
+ * @brief Rewrites the file with only the latest record of each name
+ * @returns true on success
+ */
+bool CacheDatabase::compact()
+{
+	refresh();
+
+	if (!mapped) return true;
+
+	g_autoptr(GString) none = g_string_new(nullptr);
+
+	return replace(nullptr, none);
+}
+
+/**
+ * @brief Replaces the file with the live records and \a records
+ * @param name The name in \a records, its current record is dropped
+ * @param records Records to append
+ * @param keep If set, only the live records of the names it accepts are kept
+ *
+ * The file is locked while it is read and written, so that records other
+ * processes append meanwhile are kept.
+ */
+bool CacheDatabase::replace(const gchar *name, const GString *records, const std::function<bool(const std::string &)> &keep)
+{
+	const gint fd = cache_database_open_locked(path.c_str());
+	if (fd < 0)
+		{
+		DEBUG_1("Failed to open %s: %s", path.c_str(), strerror(errno));
+		return false;
+		}
+
+	refresh();
+
+	g_autoptr(GString) buffer = g_string_new(nullptr);
+	cache_database_header_append(buffer);
+
+	if (mapped && valid)
+		{
+		const gchar *data = g_mapped_file_get_contents(mapped);
+		std::vector<gsize> offsets;
+
+		for (const auto &entry : entries)
+			{
+			if (name && entry.first == name) continue;
+			if (keep && !keep(entry.first)) continue;
+
+			offsets.push_back(entry.second);
+			}
+		std::sort(offsets.begin(), offsets.end());
+
+		for (const gsize offset : offsets)
+			{
+			CacheDatabaseRecord record;
+			memcpy(&record, data + offset, sizeof(record));
+			g_string_append_len(buffer, data + offset, record.length);
+			}
+		}
+
+	g_string_append_len(buffer, records->str, records->len);
+
+	const gboolean success = secure_save(path.c_str(), buffer->str, buffer->len);
+	::close(fd);
+
+	close();
+	entries.clear();
+	record_count = 0;
+	parsed_size = 0;
+	inode = 0;
+	refresh();
+
+	return success;
+}
+
+/*
+ *-------------------------------------------------------------------
+ * CacheData access
+ *-------------------------------------------------------------------
+ */
+
+/**
+ * @brief Reads the cache data of the image \a source from the database of its folder
+ * @returns true if the database holds data for the current version of the image
+ */
+bool cache_database_load(const gchar *source, CacheData &cd)
+{
+	struct stat st;
+	if (!source || !stat_utf8(source, &st)) return false;
+
+	g_autofree gchar *sim_path = cache_get_location(CacheType::SIM, source);
+	if (!sim_path) return false;
+
+	g_autofree gchar *dir = remove_level_from_path(sim_path);
+
+	std::lock_guard<std::mutex> lock(cache_database_mutex);
+
+	return cache_database_get(dir)->load(filename_from_path(source), st.st_mtime, st.st_size, cd);
+}
+
+/**
+ * @brief Stores the cache data of the image \a source in the database of its folder
+ * @returns true on success
+ */
+bool cache_database_save(const gchar *source, const CacheData &cd)
+{
+	struct stat st;
+	if (!source || !stat_utf8(source, &st)) return false;
+
+	g_autofree gchar *dir = cache_create_location(CacheType::SIM, source);
+	if (!dir) return false;
+
+	std::lock_guard<std::mutex> lock(cache_database_mutex);
+
+	return cache_database_get(dir)->save(filename_from_path(source), st.st_mtime, st.st_size, cd);
+}
+
+/**
+ * @brief Drops the cache data of the image \a source, which was deleted
+ * @returns true on success
+ */
+bool cache_database_remove(const gchar *source)
+{
+	if (!source) return false;
+
+	g_autofree gchar *sim_path = cache_get_location(CacheType::SIM, source);
+	if (!sim_path) return false;
+
+	g_autofree gchar *dir = remove_level_from_path(sim_path);
+
+	std::lock_guard<std::mutex> lock(cache_database_mutex);
+
+	return cache_database_get(dir)->remove(filename_from_path(source));
+}
+
+/**
+ * @brief Moves the cache data of the image \a source, which was moved or renamed to \a dest
+ * @returns true on success
+ */
+bool cache_database_move(const gchar *source, const gchar *dest)
+{
+	struct stat st;
+	if (!source || !dest || !stat_utf8(dest, &st)) return false;
+
+	g_autofree gchar *sim_path = cache_get_location(CacheType::SIM, source);
+	if (!sim_path) return false;
+
+	g_autofree gchar *dir = remove_level_from_path(sim_path);
+
+	std::lock_guard<std::mutex> lock(cache_database_mutex);
+
+	/* the image keeps its modification time and size */
+	CacheData cd;
+	CacheDatabase *db = cache_database_get(dir);
+	const bool found = db->load(filename_from_path(source), st.st_mtime, st.st_size, cd);
+	if (!db->remove(filename_from_path(source))) return false;
+	if (!found) return true;
+
+	g_autofree gchar *dest_dir = cache_create_location(CacheType::SIM, dest);
+	if (!dest_dir) return false;
+
+	return cache_database_get(dest_dir)->save(filename_from_path(dest), st.st_mtime, st.st_size, cd);
+}
+
+/**
+ * @brief Drops the records of images that no longer exist from a database
+ * @param dir UTF-8 path of the cache folder holding the database
+ * @param source_dir UTF-8 path of the folder of the images
+ * @returns true on success
+ */
+bool cache_database_prune(const gchar *dir, const gchar *source_dir)
+{
+	std::lock_guard<std::mutex> lock(cache_database_mutex);
+
+	return cache_database_get(dir)->prune(source_dir);
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
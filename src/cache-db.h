@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CACHE_DB_H
+#define CACHE_DB_H
+
+#include <sys/types.h>
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+#include <glib.h>
+
+struct CacheData;
+
+#define GQ_CACHE_SIM_DB "similarity.gqdb"
+
+/**
+ * @brief Binary file holding the #CacheData of all images of one folder
+ *
+ * Used instead of one .sim file per image when
+ * options->thumbnails.similarity_database is set.
+ *
+ * Records are appended with a single write(), the latest record of a name
+ * wins. A record is only used if the modification time and size of the
+ * image still match, a stale record is dropped when it is found. A record
+ * cut short by a crash is ignored, the ones before it stay valid. When
+ * superseded records outnumber the live ones the file is rewritten, via a
+ * temporary file and rename(). Appends and rewrites hold an exclusive
+ * flock() of the file, so that a rewrite keeps the records other processes
+ * appended.
+ *
+ * The file is memory-mapped and indexed once; records appended by other
+ * processes are picked up when a lookup fails and the file has grown.
+ *
+ * Deleted and moved images are dropped by appending a record that marks
+ * the name as removed. Cache maintenance prunes the records of images
+ * that are gone.
+ */
+class CacheDatabase
+{
+public:
+	explicit CacheDatabase(const gchar *path);
+	~CacheDatabase();
+
+	// Not copyable.
+	CacheDatabase(const CacheDatabase &) = delete;
+	CacheDatabase &operator=(const CacheDatabase &) = delete;
+
+	bool load(const gchar *name, gint64 mtime, gint64 size, CacheData &cd);
+	bool save(const gchar *name, gint64 mtime, gint64 size, const CacheData &cd);
+	bool remove(const gchar *name);
+	bool prune(const gchar *source_dir);
+	bool compact();
+
+	const std::string &get_path() const { return path; }
+	gsize size() const { return entries.size(); }
+	gsize superseded_count() const { return record_count - entries.size(); }
+
+private:
+	void close();
+	bool refresh();
+	bool append(const gchar *name, const GString *buffer);
+	bool replace(const gchar *name, const GString *records, const std::function<bool(const std::string &)> &keep = nullptr);
+
+	std::string path; /**< in locale encoding */
+	GMappedFile *mapped = nullptr;
+	gsize parsed_size = 0; /**< the records up to here are in \a entries */
+	ino_t inode = 0; /**< of the mapped file */
+	gboolean valid = TRUE; /**< FALSE if the file exists but has a foreign header */
+	std::unordered_map<std::string, gsize> entries; /**< name -> offset of its latest record */
+	gsize record_count = 0;
+};
+
+bool cache_database_load(const gchar *source, CacheData &cd);
+bool cache_database_save(const gchar *source, const CacheData &cd);
+bool cache_database_remove(const gchar *source);
+bool cache_database_move(const gchar *source, const gchar *dest);
+bool cache_database_prune(const gchar *dir, const gchar *source_dir);
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
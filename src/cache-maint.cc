@@ -27,6 +27,7 @@
 #include <glib-object.h>
 #include <gtk/gtk.h>
 
+#include "cache-db.h"
 #include "cache-loader.h"
 #include "cache.h"
 #include "compat.h"
@@ -286,6 +287,30 @@ static gboolean cache_maintain_home_cb(gpointer data)
 			while (work)
 				{
 				auto fd_list = static_cast<FileData *>(work->data);
+
+				/* The similarity database belongs to the folder it is in */
+				if (strcmp(fd_list->name, GQ_CACHE_SIM_DB) == 0)
+					{
+					g_autofree gchar *dir = remove_level_from_path(fd_list->path);
+
+					if ((!cm->metadata && cm->clear) ||
+					    (strlen(dir) > base_length && !isdir(dir + base_length)))
+						{
+						if (!unlink_file(fd_list->path)) log_printf("failed to delete:%s\n", fd_list->path);
+						}
+					else
+						{
+						if (strlen(dir) > base_length && !cm->metadata)
+							{
+							cache_database_prune(dir, dir + base_length);
+							}
+						still_have_a_file = TRUE;
+						}
+
+					work = work->next;
+					continue;
+					}
+
 				g_autofree gchar *path_buf = g_strdup(fd_list->path);
 
 				gchar *dot = strrchr(path_buf, '.');
@@ -475,6 +500,7 @@ static void cache_maint_moved(FileData *fd)
 	cache_move(CacheType::THUMB);
 	cache_move(CacheType::SIM);
 	cache_move(CacheType::METADATA);
+	cache_database_move(src, dest);
 
 	if (options->thumbnails.enable_caching && options->thumbnails.spec_standard)
 		thumb_std_maint_moved(src, dest);
@@ -496,6 +522,7 @@ static void cache_maint_removed(FileData *fd)
 	cache_remove(CacheType::THUMB);
 	cache_remove(CacheType::SIM);
 	cache_remove(CacheType::METADATA);
+	cache_database_remove(fd->path);
 
 	if (options->thumbnails.enable_caching && options->thumbnails.spec_standard)
 		thumb_std_maint_removed(fd->path);
@@ -32,6 +32,7 @@
 
 #include <config.h>
 
+#include "cache-db.h"
 #include "main-defines.h"
 #include "md5-util.h"
 #include "options.h"
@@ -213,6 +214,12 @@ bool CacheData::write_similarity(GString *gstring) const
 
 void CacheData::save(const gchar *source) const
 {
+	if (options->thumbnails.similarity_database)
+		{
+		cache_database_save(source, *this);
+		return;
+		}
+
 	g_autofree gchar *base = cache_create_location(CacheType::SIM, source);
 	if (!base) return;
 
@@ -377,6 +384,24 @@ bool CacheData::read_similarity(FILE *f, const gchar *buffer, gint s)
 }
 
 bool CacheData::load(const gchar *source)
+{
+	if (!options->thumbnails.similarity_database) return load_file(source);
+
+	if (cache_database_load(source, *this)) return true;
+
+	if (!load_file(source)) return false;
+
+	/* Migrate the .sim file into the database */
+	if (options->thumbnails.enable_caching && cache_database_save(source, *this))
+		{
+		g_autofree gchar *path = cache_find_location(CacheType::SIM, source);
+		if (path) unlink_file(path);
+		}
+
+	return true;
+}
+
+bool CacheData::load_file(const gchar *source)
 {
 	g_autofree gchar *path = cache_find_location(CacheType::SIM, source);
 	if (!path) return false;
@@ -71,6 +71,8 @@ struct CacheData
 	std::unique_ptr<ImageSimilarityData> similarity;
 
 private:
+	bool load_file(const gchar *source);
+
 	bool write_dimensions(GString *gstring) const;
 	bool write_date(GString *gstring) const;
 	bool write_md5sum(GString *gstring) const;
@@ -424,6 +424,20 @@ void file_load_no_raise(const gchar *text, GApplicationCommandLine *app_command_
 		}
 }
 
+/**
+ * @brief Returns the window of --dupes-session, NULL if not given
+ */
+DupeWindow *dupes_session_window(GApplicationCommandLine *app_command_line, GVariantDict *command_line_options_dict)
+{
+	gchar *path;
+	if (!g_variant_dict_lookup(command_line_options_dict, "dupes-session", "&s", &path)) return nullptr;
+
+	g_autofree gchar *tilde_path = expand_tilde(path);
+	g_autofree gchar *session_path = set_cwd(tilde_path, app_command_line);
+
+	return dupe_window_session(session_path);
+}
+
 template<gboolean recurse>
 void gq_dupes(GtkApplication *app, GApplicationCommandLine *app_command_line, GVariantDict *command_line_options_dict, GList *)
 {
@@ -440,7 +454,7 @@ void gq_dupes(GtkApplication *app, GApplicationCommandLine *app_command_line, GV
 		exit(EXIT_FAILURE);
 		}
 
-	dupe_window_add_folder(folder_path, recurse);
+	dupe_window_add_folder(dupes_session_window(app_command_line, command_line_options_dict), folder_path, recurse);
 }
 
 void gq_dupes_export(GtkApplication *, GApplicationCommandLine *app_command_line, GVariantDict *, GList *)
@@ -450,6 +464,15 @@ void gq_dupes_export(GtkApplication *, GApplicationCommandLine *app_command_line
 	g_application_command_line_print(app_command_line, "%s\n", output_string->str);
 }
 
+void gq_dupes_session(GtkApplication *, GApplicationCommandLine *app_command_line, GVariantDict *command_line_options_dict, GList *)
+{
+	/* Used by --dupes and --dupes-recurse */
+	if (g_variant_dict_contains(command_line_options_dict, "dupes") ||
+	    g_variant_dict_contains(command_line_options_dict, "dupes-recurse")) return;
+
+	dupes_session_window(app_command_line, command_line_options_dict);
+}
+
 void gq_file(GtkApplication *, GApplicationCommandLine *app_command_line, GVariantDict *command_line_options_dict, GList *)
 {
 
@@ -934,7 +957,7 @@ void gq_pixel_info(GtkApplication *, GApplicationCommandLine *app_command_line,
 	if (const auto color = pixbuf_renderer_get_pixel_colors(pr, pixel);
 	    color.has_value())
 		{
-		if (gdk_pixbuf_get_has_alpha(pr->pixbuf))
+		if (pr->pixbuf && gdk_pixbuf_get_has_alpha(pr->pixbuf))
 			{
 			pixel_info = g_strdup_printf(_("[%d,%d]: RGBA(%3d,%3d,%3d,%3d)"),
 			                             pixel.x, pixel.y,
@@ -1380,6 +1403,7 @@ CommandLineOptionEntry command_line_options[] =
 	{ "dupes",                       gq_dupes<FALSE>,                PRIMARY_REMOTE, GUI  },
 	{ "dupes-export",                gq_dupes_export,                PRIMARY_REMOTE, TEXT },
 	{ "dupes-recurse",               gq_dupes<TRUE>,                 PRIMARY_REMOTE, GUI  },
+	{ "dupes-session",               gq_dupes_session,               PRIMARY_REMOTE, GUI  },
 	{ "File",                        gq_File,                        PRIMARY_REMOTE, GUI  },
 	{ "file-extensions",             gq_file_extensions,             PRIMARY_REMOTE, TEXT },
 	{ "first",                       gq_first,                       PRIMARY_REMOTE, GUI  },
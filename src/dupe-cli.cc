@@ -0,0 +1,368 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "dupe-cli.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "dupe-engine.h"
+#include "filedata.h"
+#include "intl.h"
+#include "options.h"
+#include "ui-fileops.h"
+
+/**
+ * @file
+ *-------------------------------------------------------------------
+ * Command line duplicate finder
+ *-------------------------------------------------------------------
+ *
+ * GQ_DUPES=y geeqie [OPTION…] PATH…
+ *
+ * Runs the checks of the Find duplicates window without a display, using
+ * a #DupeEngine, and writes the groups found to stdout. The groups of an
+ * exact checksum match (the default) are written as soon as the checksums
+ * of all files of the same size are read. The groups of other matches are
+ * written when every file has been compared: until the last comparison a
+ * group may still gain files or merge with another. The first file of a
+ * group is the one the others matched, its rank is empty.
+ *
+ * csv: group,rank,size,date,width,height,checksum,path\n
+ * json: an array of {"group": n, "files": [{"path": …, "rank": …, …}]}
+ *
+ * Dates are in seconds since the Epoch. The checksum and the dimensions are
+ * only known if the check needed them.
+ */
+
+namespace
+{
+
+struct DupeCliMatch
+{
+	const gchar *name;
+	DupeMatchType type;
+};
+
+constexpr DupeCliMatch dupe_cli_matches[] = {
+	{ "name",              DUPE_MATCH_NAME },
+	{ "name-ci",           DUPE_MATCH_NAME_CI },
+	{ "size",              DUPE_MATCH_SIZE },
+	{ "date",              DUPE_MATCH_DATE },
+	{ "dimensions",        DUPE_MATCH_DIM },
+	{ "checksum",          DUPE_MATCH_SUM },
+	{ "path",              DUPE_MATCH_PATH },
+	{ "similarity-high",   DUPE_MATCH_SIM_HIGH },
+	{ "similarity-medium", DUPE_MATCH_SIM_MED },
+	{ "similarity-low",    DUPE_MATCH_SIM_LOW },
+	{ "similarity-custom", DUPE_MATCH_SIM_CUSTOM },
+	{ "name-content",      DUPE_MATCH_NAME_CONTENT },
+	{ "name-ci-content",   DUPE_MATCH_NAME_CI_CONTENT },
+};
+
+enum DupeCliFormat {
+	DUPE_CLI_CSV,
+	DUPE_CLI_JSON
+};
+
+struct DupeCli
+{
+	GMainLoop *loop;
+	DupeCliFormat format;
+	gint group_count;
+};
+
+/**
+ * @brief Parses a comma separated list of #dupe_cli_matches names
+ * @param text
+ * @param[out] mask
+ * @returns FALSE if a name is not known
+ */
+gboolean dupe_cli_parse_match(const gchar *text, DupeMatchType &mask)
+{
+	g_auto(GStrv) names = g_strsplit(text, ",", -1);
+	guint value = DUPE_MATCH_NONE;
+
+	for (gint i = 0; names[i]; i++)
+		{
+		const gchar *name = g_strstrip(names[i]);
+		gboolean found = FALSE;
+
+		for (const DupeCliMatch &match : dupe_cli_matches)
+			{
+			if (g_strcmp0(name, match.name) == 0)
+				{
+				value |= match.type;
+				found = TRUE;
+				break;
+				}
+			}
+
+		if (!found)
+			{
+			g_printerr(_("Unknown match type: %s\n"), name);
+			return FALSE;
+			}
+		}
+
+	if (value == DUPE_MATCH_NONE) return FALSE;
+
+	mask = static_cast<DupeMatchType>(value);
+	return TRUE;
+}
+
+/**
+ * @brief Quotes \a text as a CSV field if needed (RFC 4180)
+ */
+void dupe_cli_print_csv_field(const gchar *text)
+{
+	if (!strpbrk(text, ",\"\r\n"))
+		{
+		g_print("%s", text);
+		return;
+		}
+
+	GString *field = g_string_new("\"");
+	for (const gchar *p = text; *p; p++)
+		{
+		if (*p == '"') g_string_append_c(field, '"');
+		g_string_append_c(field, *p);
+		}
+	g_string_append_c(field, '"');
+
+	g_print("%s", field->str);
+	g_string_free(field, TRUE);
+}
+
+void dupe_cli_print_json_string(const gchar *text)
+{
+	GString *string = g_string_new("\"");
+	for (const gchar *p = text; *p; p++)
+		{
+		switch (*p)
+			{
+			case '"':
+				g_string_append(string, "\\\"");
+				break;
+			case '\\':
+				g_string_append(string, "\\\\");
+				break;
+			case '\n':
+				g_string_append(string, "\\n");
+				break;
+			case '\t':
+				g_string_append(string, "\\t");
+				break;
+			default:
+				if (static_cast<guchar>(*p) < 0x20)
+					{
+					g_string_append_printf(string, "\\u%04x", static_cast<guchar>(*p));
+					}
+				else
+					{
+					g_string_append_c(string, *p);
+					}
+				break;
+			}
+		}
+	g_string_append_c(string, '"');
+
+	g_print("%s", string->str);
+	g_string_free(string, TRUE);
+}
+
+/**
+ * @brief Writes one file of a group
+ * @param cli
+ * @param di
+ * @param rank Of the match with the first file
+ * @param first TRUE for the first file of the group
+ */
+void dupe_cli_print_item(DupeCli *cli, const DupeItem *di, gdouble rank, gboolean first)
+{
+	const gchar *checksum = di->md5sum ? di->md5sum->c_str() : "";
+
+	if (cli->format == DUPE_CLI_CSV)
+		{
+		g_print("%d,", cli->group_count);
+		if (!first) g_print("%.0f", rank);
+		g_print(",%" PRId64 ",%" PRId64 ",%d,%d,%s,", di->fd->size, static_cast<gint64>(di->fd->date),
+		        di->dimensions.width, di->dimensions.height, checksum);
+		dupe_cli_print_csv_field(di->fd->path);
+		g_print("\n");
+		return;
+		}
+
+	g_print("%s\n    {\"path\": ", first ? "" : ",");
+	dupe_cli_print_json_string(di->fd->path);
+	if (!first) g_print(", \"rank\": %.0f", rank);
+	g_print(", \"size\": %" PRId64 ", \"date\": %" PRId64 ", \"width\": %d, \"height\": %d, \"checksum\": \"%s\"}",
+	        di->fd->size, static_cast<gint64>(di->fd->date), di->dimensions.width, di->dimensions.height, checksum);
+}
+
+/**
+ * @brief Writes one group of duplicates
+ * @param cli
+ * @param parent The item the others in its #DupeItem->group matched
+ */
+void dupe_cli_print_group(DupeCli *cli, const DupeItem *parent)
+{
+	cli->group_count++;
+
+	if (cli->format == DUPE_CLI_JSON)
+		{
+		g_print("%s\n  {\"group\": %d, \"files\": [", cli->group_count > 1 ? "," : "", cli->group_count);
+		}
+
+	dupe_cli_print_item(cli, parent, -1.0, TRUE);
+	for (GList *work = parent->group; work; work = work->next)
+		{
+		auto dm = static_cast<const DupeMatch *>(work->data);
+
+		dupe_cli_print_item(cli, dm->di, dm->rank, FALSE);
+		}
+
+	if (cli->format == DUPE_CLI_JSON) g_print("\n  ]}");
+
+	fflush(stdout);
+}
+
+} // namespace
+
+/**
+ * @brief Runs the command line duplicate finder
+ * @param argc
+ * @param argv
+ * @returns The exit status
+ *
+ * The options and the file filters must be set up, no display is needed.
+ */
+gint dupe_cli_main(gint argc, gchar *argv[])
+{
+	g_autofree gchar *match = nullptr;
+	g_autofree gchar *format = nullptr;
+	gboolean recurse = FALSE;
+	gint threads = 0;
+	gint threshold = 0;
+	g_auto(GStrv) paths = nullptr;
+
+	GOptionEntry entries[] =
+	{
+		{ "match"    , 'm', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING        , &match    , _("comma separated things to match, default checksum: name, name-ci, size, date, dimensions, checksum, path, similarity-high, similarity-medium, similarity-low, similarity-custom, name-content, name-ci-content"), "<TYPE,…>" },
+		{ "format"   , 'f', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING        , &format   , _("output format, default csv"), "csv|json" },
+		{ "recurse"  , 'r', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE          , &recurse  , _("search folders recursively"), nullptr },
+		{ "threads"  , 't', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT           , &threads  , _("max. threads, default all cores"), "<N>" },
+		{ "threshold",   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_INT           , &threshold, _("custom similarity threshold"), "1…100" },
+		{ G_OPTION_REMAINING, 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME_ARRAY, &paths, nullptr, nullptr },
+		{ nullptr    ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE          , nullptr   , nullptr, nullptr },
+	};
+
+	g_autoptr(GOptionContext) context = g_option_context_new(_("PATH… - find duplicates without a display"));
+	g_option_context_add_main_entries(context, entries, nullptr);
+	g_option_context_set_summary(context, _("Geeqie duplicate finder.\nWrites the groups of duplicates found in the files and folders to stdout.\nChecksum groups are written as soon as they are complete, the groups of\nother matches when every file has been compared."));
+
+	g_autoptr(GError) error = nullptr;
+	if (!g_option_context_parse(context, &argc, &argv, &error))
+		{
+		g_printerr("%s\n", error->message);
+		return EXIT_FAILURE;
+		}
+
+	DupeMatchType mask = DUPE_MATCH_SUM;
+	if (match && !dupe_cli_parse_match(match, mask)) return EXIT_FAILURE;
+
+	DupeCli cli{};
+	if (!format || g_strcmp0(format, "csv") == 0)
+		{
+		cli.format = DUPE_CLI_CSV;
+		}
+	else if (g_strcmp0(format, "json") == 0)
+		{
+		cli.format = DUPE_CLI_JSON;
+		}
+	else
+		{
+		g_printerr(_("Unknown output format: %s\n"), format);
+		return EXIT_FAILURE;
+		}
+
+	if (!paths || !paths[0])
+		{
+		g_printerr(_("No files or folders given\n"));
+		return EXIT_FAILURE;
+		}
+
+	/* Use all cores unless told otherwise */
+	options->threads.duplicates = threads > 0 ? threads : -1;
+	options->threads.duplicates_read = threads > 0 ? threads : -1;
+	if (threshold > 0) options->duplicates_similarity_threshold = std::min(threshold, 100);
+
+	GList *list = nullptr;
+	for (gint i = 0; paths[i]; i++)
+		{
+		g_autofree gchar *path = g_canonicalize_filename(paths[i], nullptr);
+
+		if (!isfile(path) && !isdir(path))
+			{
+			g_printerr(_("Not a file or folder: %s\n"), paths[i]);
+			file_data_list_free(list);
+			return EXIT_FAILURE;
+			}
+
+		list = g_list_prepend(list, file_data_new_simple(path));
+		}
+	list = g_list_reverse(list);
+
+	cli.loop = g_main_loop_new(nullptr, FALSE);
+
+	DupeEngine *de = dupe_engine_new(mask);
+	de->group_func = [&cli](DupeEngine *, DupeItem *parent)
+		{
+		dupe_cli_print_group(&cli, parent);
+		};
+	de->done_func = [&cli](DupeEngine *)
+		{
+		g_main_loop_quit(cli.loop);
+		};
+
+	dupe_engine_add_files(de, list, recurse);
+	file_data_list_free(list);
+
+	if (cli.format == DUPE_CLI_CSV)
+		{
+		g_print("group,rank,size,date,width,height,checksum,path\n");
+		}
+	else
+		{
+		g_print("[");
+		}
+
+	g_main_loop_run(cli.loop);
+
+	if (cli.format == DUPE_CLI_JSON) g_print("%s]\n", cli.group_count > 0 ? "\n" : "");
+
+	dupe_engine_free(de);
+	g_main_loop_unref(cli.loop);
+
+	return EXIT_SUCCESS;
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
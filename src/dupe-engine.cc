@@ -0,0 +1,3494 @@
+/*
+ * Copyright (C) 2005 John Ellis
+ * Copyright (C) 2008 - 2016 The Geeqie Team
+ *
+ * Author: John Ellis
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "dupe-engine.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cache.h"
+#include "collect.h"
+#include "dupe-session.h"
+#include "filedata.h"
+#include "hash-util.h"
+#include "image-load.h"
+#include "intl.h"
+#include "md5-util.h"
+#include "misc.h"
+#include "options.h"
+#include "similar-index.h"
+#include "similar.h"
+#include "ui-fileops.h"
+
+namespace {
+
+enum DUPE_CHECK_RESULT {
+	DUPE_MATCH = 0,
+	DUPE_NO_MATCH,
+	DUPE_NAME_MATCH
+};
+
+/** Used for similarity checks thread. One for each pair match found.
+ */
+struct DupeSearchMatch
+{
+	DupeItem *a; /**< \a a / \a b matched pair found */
+	DupeItem *b; /**< \a a / \a b matched pair found */
+	gdouble rank;
+};
+
+/** Needles and haystack items per side of a comparison tile.
+ * The similarity data of one side is 192 KiB, so a tile stays in the L2 cache.
+ */
+constexpr gint DUPE_COMPARISON_TILE_SIZE = 64;
+
+/** Matches linked per idle call once the comparison is done */
+constexpr gsize DUPE_COMPARISON_LINK_BATCH = 256;
+
+/** Results a checksum worker collects before handing them to the main loop */
+constexpr gsize DUPE_PREPASS_BATCH = 16;
+
+/** Bytes hashed at the beginning and at the end of a file before its full checksum */
+constexpr gsize DUPE_PREPASS_PARTIAL_SIZE = 64 * 1024;
+DupeMatchType param_match_mask;
+
+} // namespace
+
+
+/**
+ * @brief Similarity index of one comparison run
+ *
+ * Used only for similarity checks when options->duplicates_similarity_index is set.
+ * Built over set 1, or over set 2 when two sets are compared, i.e. over the
+ * items the comparison threads would otherwise walk through.
+ */
+struct DupeSimilarityIndex
+{
+	std::vector<DupeItem *> items; /**< same order as #DupeComparison->haystack */
+	std::unique_ptr<ImageSimilarityIndex> index;
+};
+
+/**
+ * @brief Similarity comparison run by the thread pool
+ *
+ * The comparison matrix, needles (set 1) x haystack (set 1 or set 2), is
+ * split into tiles of #DUPE_COMPARISON_TILE_SIZE x #DUPE_COMPARISON_TILE_SIZE
+ * items. When only set 1 is checked, just the tiles on and below the diagonal
+ * exist. With a similarity index a tile is a block of needles, each searched
+ * in the whole index.
+ *
+ * Items compared by the previous check come first on both sides. Their pairs
+ * are not compared again, so only the tiles of the new items are made.
+ *
+ * Every worker starts with a contiguous range of tiles in its own queue and,
+ * once that is empty, steals tiles from the back of the other queues. Matches
+ * are kept in the worker until all workers are done, then added to
+ * #DupeEngine->sim_links.
+ */
+struct DupeComparison
+{
+	struct Tile
+	{
+		gint needle_begin;
+		gint needle_end;
+		gint haystack_begin;
+		gint haystack_end;
+	};
+
+	struct Worker
+	{
+		gint id;
+		std::mutex mutex; /**< protects \a tiles */
+		std::deque<gint> tiles; /**< indices into #DupeComparison->tiles */
+		std::vector<DupeSearchMatch> matches;
+	};
+
+	std::vector<DupeItem *> needles; /**< \a de->list */
+	std::vector<DupeItem *> haystack; /**< \a de->list, or \a de->second_list */
+	std::vector<Tile> tiles;
+	std::vector<Worker> workers;
+	std::atomic<gint> tiles_done{0};
+	std::atomic<gint> workers_running{0};
+};
+
+/**
+ * @brief Similarity matches kept from one check to the next
+ *
+ * Trimming the groups drops links, so the groups of a check which only
+ * compares the new items cannot be built on the trimmed groups of the
+ * previous check. Instead all matches are linked again, in the order a
+ * check of all items finds them, and then trimmed.
+ *
+ * Matches with an item which is not #DupeItem->compared are dropped when a
+ * check starts, that check finds them again.
+ */
+struct DupeSimilarityLinks
+{
+	std::vector<DupeSearchMatch> matches;
+	gboolean sorted = FALSE; /**< \a matches are in check order, set once per check */
+	gsize linked = 0; /**< matches already passed to dupe_match_link() */
+};
+
+/**
+ * @brief Checksum and cache pre-pass run by the thread pool
+ *
+ * Before the comparison the workers read the cached data of every item that
+ * still lacks something, and compute the missing MD5 sums. Each job is
+ * claimed by exactly one worker; the results are handed to the main loop in
+ * batches, and only there are the #DupeItem-s updated.
+ *
+ * For checksum matches the MD5 sums are computed in stages: files with a
+ * size no other file has cannot be duplicates and are skipped, the files of
+ * the other sizes first get a hash of their first and last
+ * #DUPE_PREPASS_PARTIAL_SIZE bytes, and only files whose partial hash
+ * collides get a full checksum.
+ *
+ * Dimensions not in the cache are read afterwards in the main loop, as the
+ * image loaders must be set up there.
+ *
+ * When the groups are streamed, a size group of the FULL stage is closed
+ * once the last of its checksums is applied: no other file can join the
+ * groups of its files any more.
+ */
+struct DupePrepass
+{
+	enum Stage {
+		CACHE,   /**< read the cache, compute MD5 sums unless staged */
+		PARTIAL, /**< hash both ends of files of a shared size */
+		FULL     /**< compute the MD5 sums of the remaining candidates */
+	};
+
+	struct Job
+	{
+		DupeItem *di;
+		std::string path; /**< copy of \a di->fd->path, which the main loop may change */
+		gboolean md5sum;
+	};
+
+	struct Result
+	{
+		DupeItem *di;
+		std::optional<std::string> md5sum;
+		std::optional<GqSize> dimensions;
+		std::unique_ptr<ImageSimilarityData> similarity;
+		std::optional<std::string> partial;
+	};
+
+	struct SizeGroup
+	{
+		std::vector<DupeItem *> items;
+		gint pending; /**< jobs of \a items not applied yet */
+	};
+
+	Stage stage;
+	std::vector<Job> jobs;
+	std::atomic<gint> next_job{0};
+	std::atomic<gint> workers_running{0};
+	std::atomic<gboolean> abort{FALSE};
+
+	std::mutex mutex; /**< protects \a results, and the end of a worker */
+	std::condition_variable finished; /**< signalled when a worker ends */
+	std::vector<Result> results; /**< done by the workers, not yet applied */
+	gsize applied = 0;
+
+	std::unordered_map<DupeItem *, std::string> partials; /**< applied partial hashes */
+
+	std::vector<SizeGroup> size_groups; /**< only kept when the groups are streamed */
+	std::unordered_map<DupeItem *, gsize> item_size_groups; /**< index into \a size_groups of the item of a job */
+};
+
+/**
+ * @brief Reads the similarity data of one item not in the cache
+ *
+ * Up to one loader per comparison thread runs at a time, each decoding in a
+ * thread of the image loader. The results are applied in the main loop.
+ */
+struct DupeSimilarityLoader
+{
+	DupeEngine *de;
+	DupeItem *di;
+	ImageLoader *il;
+};
+
+/*
+ * Well, after adding the 'compare two sets' option things got a little sloppy in here
+ * because we have to account for two 'modes' everywhere. (be careful).
+ */
+
+static void dupe_match_unlink(DupeItem *a, DupeItem *b);
+
+static gint dupe_match(DupeEngine *de, DupeItem *a, DupeItem *b, DupeMatchType mask, gdouble *rank, gint fast, const ImageSimilarityReference *reference = nullptr);
+
+static gint dupe_check_cb(gpointer data);
+
+static void dupe_init_list_cache(DupeEngine *de);
+static void dupe_destroy_list_cache(DupeEngine *de);
+static gboolean dupe_insert_in_list_cache(DupeEngine *de, FileData *fd);
+
+static void dupe_match_link(DupeItem *a, DupeItem *b, gdouble rank);
+static gint dupe_match_link_exists(DupeItem *child, DupeItem *parent);
+
+static void dupe_setup_reset(DupeEngine *de);
+
+static void dupe_engine_session_save(DupeEngine *de);
+
+static gdouble dupe_match_sim_threshold(DupeMatchType mask);
+
+/**
+ * @brief Similarity check of one needle using the similarity index
+ * @param de
+ * @param position Position of the needle in #DupeComparison->needles
+ * @param reference The prepared needle, or NULL
+ * @param matches Receives the #DupeSearchMatch found
+ *
+ * Produces the same matches as walking the haystack.
+ * Only the candidates returned by the index are passed to dupe_match().
+ */
+static void dupe_comparison_index_search(DupeEngine *de, const DupeComparison::Tile &tile, gint position, const ImageSimilarityReference *reference, std::vector<DupeSearchMatch> &matches)
+{
+	const DupeComparison *dc = de->comparison;
+	const DupeSimilarityIndex *si = de->sim_index;
+	DupeItem *needle = dc->needles[position];
+	gdouble rank = 0;
+
+	const std::vector<gint> candidates = si->index->find(dupe_engine_item_simd(de, needle),
+	                                                     dupe_match_sim_threshold(de->match_mask),
+	                                                     image_sim_transform_count());
+
+	for (const gint candidate : candidates)
+		{
+		/* simple compare only looks back from the needle */
+		if (!de->second_set && candidate >= position) break;
+		if (candidate < tile.haystack_begin) continue;
+
+		DupeItem *di = si->items[candidate];
+
+		if (dupe_match(de, di, needle, de->match_mask, &rank, TRUE, reference))
+			{
+			matches.push_back({di, needle, rank});
+			}
+
+		if (de->abort)
+			{
+			break;
+			}
+		}
+}
+
+/**
+ * @brief Similarity check of one tile of the comparison matrix
+ * @param de
+ * @param tile
+ * @param matches Receives the #DupeSearchMatch found
+ */
+static void dupe_comparison_tile(DupeEngine *de, const DupeComparison::Tile &tile, std::vector<DupeSearchMatch> &matches)
+{
+	const DupeComparison *dc = de->comparison;
+	const gboolean prepare = (de->match_mask & DUPE_MATCH_SIM) && !options->alternate_similarity_algorithm.enabled;
+	gdouble rank = 0;
+
+	for (gint position = tile.needle_begin; position < tile.needle_end && !de->abort; position++)
+		{
+		DupeItem *needle = dc->needles[position];
+
+		/* The needle is compared with many items, so prepare it once */
+		std::unique_ptr<ImageSimilarityReference> reference;
+		if (prepare)
+			{
+			reference = std::make_unique<ImageSimilarityReference>(dupe_engine_item_simd(de, needle), image_sim_transform_count());
+			}
+
+		if (de->sim_index)
+			{
+			dupe_comparison_index_search(de, tile, position, reference.get(), matches);
+			continue;
+			}
+
+		/* all of set 2, or the items before the needle in set 1 */
+		const gint end = de->second_set ? tile.haystack_end : std::min(tile.haystack_end, position);
+
+		for (gint i = tile.haystack_begin; i < end; i++)
+			{
+			DupeItem *di = dc->haystack[i];
+
+			if (dupe_match(de, di, needle, de->match_mask, &rank, TRUE, reference.get()))
+				{
+				matches.push_back({di, needle, rank});
+				}
+			}
+		}
+}
+
+/**
+ * @brief Takes the next tile for \a worker, stealing one if its queue is empty
+ * @returns FALSE when no tiles are left
+ */
+static gboolean dupe_comparison_next_tile(DupeComparison *dc, DupeComparison::Worker &worker, gint &tile)
+{
+	{
+	std::lock_guard<std::mutex> lock(worker.mutex);
+	if (!worker.tiles.empty())
+		{
+		tile = worker.tiles.front();
+		worker.tiles.pop_front();
+		return TRUE;
+		}
+	}
+
+	/* Steal from the back, away from the tiles the owner is working on */
+	for (gsize i = 1; i < dc->workers.size(); i++)
+		{
+		DupeComparison::Worker &victim = dc->workers[(worker.id + i) % dc->workers.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+
+		if (!victim.tiles.empty())
+			{
+			tile = victim.tiles.back();
+			victim.tiles.pop_back();
+			return TRUE;
+			}
+		}
+
+	return FALSE;
+}
+
+/**
+ * @brief The function run in threads for similarity checks
+ * @param d1 #DupeComparison::Worker
+ * @param d2 #DupeEngine
+ *
+ * Used only for similarity checks.\n
+ * Processes tiles of \a de->comparison until none are left, or until
+ * \a de->abort is set, collecting the matches in the worker.
+ */
+static void dupe_comparison_func(gpointer d1, gpointer d2)
+{
+	auto worker = static_cast<DupeComparison::Worker *>(d1);
+	auto de = static_cast<DupeEngine *>(d2);
+	DupeComparison *dc = de->comparison;
+	gint tile;
+
+	while (!de->abort && dupe_comparison_next_tile(dc, *worker, tile))
+		{
+		dupe_comparison_tile(de, dc->tiles[tile], worker->matches);
+		dc->tiles_done++;
+		}
+
+	dc->workers_running--;
+}
+
+/**
+ * @brief Does one job of the checksum pre-pass
+ * @param stage
+ * @param job
+ * @returns What the main loop applies to \a job.di
+ *
+ * Run in the pre-pass threads.
+ */
+static DupePrepass::Result dupe_prepass_job(DupePrepass::Stage stage, const DupePrepass::Job &job)
+{
+	DupePrepass::Result result{job.di, std::nullopt, std::nullopt, nullptr, std::nullopt};
+
+	if (stage == DupePrepass::PARTIAL)
+		{
+		g_autofree gchar *pathl = path_from_utf8(job.path.c_str());
+		result.partial = hash_get_string_from_file_ends(HashType::FAST, pathl, DUPE_PREPASS_PARTIAL_SIZE);
+		return result;
+		}
+
+	CacheData cd{};
+	if (options->thumbnails.enable_caching && cd.load(job.path.c_str()))
+		{
+		if (cd.md5sum) result.md5sum = md5_digest_to_text(cd.md5sum.value());
+		result.dimensions = cd.dimensions;
+		if (image_sim_filled(cd.similarity.get())) result.similarity = std::move(cd.similarity);
+		}
+	else
+		{
+		cd = CacheData{};
+		}
+
+	if (job.md5sum && !result.md5sum)
+		{
+		result.md5sum = md5_text_from_file_utf8(job.path.c_str());
+
+		Md5Digest digest;
+		if (options->thumbnails.enable_caching && md5_digest_from_text(result.md5sum->c_str(), digest))
+			{
+			cd.set_md5sum(digest);
+			if (result.similarity) cd.set_similarity(*result.similarity);
+			cd.save(job.path.c_str());
+			}
+		}
+
+	return result;
+}
+
+/**
+ * @brief The function run in threads for the checksum pre-pass
+ * @param d1 #DupePrepass
+ * @param d2 #DupeEngine, unused
+ *
+ * Claims jobs of \a d1 until none are left or the pre-pass is aborted.
+ * Does not touch the #DupeItem-s, the main loop applies the results.
+ */
+static void dupe_prepass_func(gpointer d1, gpointer)
+{
+	auto dp = static_cast<DupePrepass *>(d1);
+	std::vector<DupePrepass::Result> batch;
+	gint n;
+
+	while (!dp->abort && (n = dp->next_job++) < static_cast<gint>(dp->jobs.size()))
+		{
+		batch.push_back(dupe_prepass_job(dp->stage, dp->jobs[n]));
+
+		if (batch.size() >= DUPE_PREPASS_BATCH || dp->next_job >= static_cast<gint>(dp->jobs.size()))
+			{
+			std::lock_guard<std::mutex> lock(dp->mutex);
+			std::move(batch.begin(), batch.end(), std::back_inserter(dp->results));
+			batch.clear();
+			}
+		}
+
+	std::lock_guard<std::mutex> lock(dp->mutex);
+	std::move(batch.begin(), batch.end(), std::back_inserter(dp->results));
+
+	/* under the lock, dupe_prepass_free() may delete dp once it is released */
+	dp->workers_running--;
+	dp->finished.notify_all();
+}
+
+/**
+ * @brief Returns time in µsec since Epoch
+ * @returns
+ *
+ *
+ */
+static guint64 msec_time()
+{
+	const auto duration = std::chrono::system_clock::now().time_since_epoch();
+
+	return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+static gint dupe_iterations(gint n)
+{
+	return (n * ((n + 1) / 2));
+}
+
+/**
+ * @brief Reports the progress of the check to #DupeEngine->progress_func
+ * @param de
+ * @param status
+ * @param value
+ * @param force
+ *
+ * If \a status is blank, clear status bar text and set progress to zero. \n
+ * If \a force is not set, after 2 secs has elapsed, update time-to-go every 250 ms.
+ */
+static void dupe_engine_update_progress(DupeEngine *de, const gchar *status, gdouble value, gboolean force)
+{
+	if (!de->progress_func) return;
+
+	if (!status)
+		{
+		de->progress_func(de, nullptr, 0.0);
+		return;
+		}
+
+	guint64 new_time = 0;
+
+	if (de->setup_n % 10 == 0)
+		{
+		new_time = msec_time() - de->setup_time;
+		}
+
+	if (!force &&
+	    value != 0.0 &&
+	    de->setup_count > 0 &&
+	    new_time > 2000000)
+		{
+		gint t;
+		gint d;
+		guint32 rem;
+
+		if (new_time - de->setup_time_count < 250000) return;
+		de->setup_time_count = new_time;
+
+		if (de->setup_done)
+			{
+			if (de->second_set)
+				{
+				t = de->setup_count;
+				d = de->setup_count - de->setup_n;
+				}
+			else
+				{
+				t = dupe_iterations(de->setup_count);
+				d = dupe_iterations(de->setup_count - de->setup_n);
+				}
+			}
+		else
+			{
+			t = de->setup_count;
+			d = de->setup_count - de->setup_n;
+			}
+
+		rem = (t - d) ? (static_cast<gdouble>(de->setup_time_count / 1000000.0) / (t - d)) * d : 0;
+
+		g_autofree gchar *buf = g_strdup_printf("%s %d:%02d ", status, rem / 60, rem % 60);
+		de->progress_func(de, buf, value);
+
+		return;
+		}
+
+	if (force ||
+	    value == 0.0 ||
+	    de->setup_count == 0 ||
+	    de->setup_time_count == 0 ||
+	    (new_time > 0 && new_time - de->setup_time_count >= 250000))
+		{
+		if (de->setup_time_count == 0) de->setup_time_count = 1;
+		if (new_time > 0) de->setup_time_count = new_time;
+		de->progress_func(de, status, value);
+		}
+}
+
+/*
+ * ------------------------------------------------------------------
+ * Dupe item utils
+ * ------------------------------------------------------------------
+ */
+
+static DupeItem *dupe_item_new(FileData *fd)
+{
+	auto *di = new DupeItem();
+
+	di->fd = file_data_ref(fd);
+	di->simd = -1;
+	di->group_rank = 0.0;
+
+	return di;
+}
+
+static void dupe_item_free(DupeItem *di)
+{
+	file_data_unref(di->fd);
+	if (di->pixbuf) g_object_unref(di->pixbuf);
+
+	delete di;
+}
+
+/**
+ * @brief Returns the similarity data of \a di, NULL if not generated
+ */
+ImageSimilarityData *dupe_engine_item_simd(DupeEngine *de, const DupeItem *di)
+{
+	return de->simd_arena->get(di->simd);
+}
+
+/**
+ * @brief Returns the similarity data of \a di, adding it to the arena if not done yet
+ */
+static ImageSimilarityData *dupe_item_simd_ensure(DupeEngine *de, DupeItem *di)
+{
+	if (di->simd < 0) di->simd = de->simd_arena->add();
+
+	return dupe_engine_item_simd(de, di);
+}
+
+/**
+ * @brief Frees the similarity data of the items of \a list for reuse
+ */
+static void dupe_items_simd_release(DupeEngine *de, GList *list)
+{
+	for (GList *work = list; work; work = work->next)
+		{
+		auto *di = static_cast<DupeItem *>(work->data);
+
+		de->simd_arena->remove(di->simd);
+		di->simd = -1;
+		}
+}
+
+static void dupe_items_set_compared(GList *list, gboolean compared)
+{
+	for (GList *work = list; work; work = work->next)
+		{
+		static_cast<DupeItem *>(work->data)->compared = compared;
+		}
+}
+
+/*
+ * ------------------------------------------------------------------
+ * Image property cache
+ * ------------------------------------------------------------------
+ */
+
+static void dupe_item_read_cache(DupeEngine *de, DupeItem *di)
+{
+	if (!di) return;
+
+	CacheData cd{};
+	if (!cd.load(di->fd->path)) return;
+
+	if (di->simd < 0 && cd.similarity)
+		{
+		ImageSimilarityData *sd = dupe_item_simd_ensure(de, di);
+		if (sd) *sd = *cd.similarity;
+		}
+
+	if (di->dimensions.empty() && cd.dimensions)
+		{
+		di->dimensions = cd.dimensions.value();
+		di->dimensions_sum = (di->dimensions.width << 16) + di->dimensions.height;
+		}
+
+	if (!di->md5sum && cd.md5sum)
+		{
+		di->md5sum = md5_digest_to_text(cd.md5sum.value());
+		}
+}
+
+static void dupe_item_write_cache(DupeEngine *de, DupeItem *di)
+{
+	if (!di) return;
+
+	CacheData cd{};
+
+	if (!di->dimensions.empty()) cd.set_dimensions(di->dimensions);
+	if (di->md5sum)
+		{
+		Md5Digest digest;
+		if (md5_digest_from_text(di->md5sum->c_str(), digest)) cd.set_md5sum(digest);
+		}
+	const ImageSimilarityData *sd = dupe_engine_item_simd(de, di);
+	if (sd) cd.set_similarity(*sd);
+
+	cd.save(di->fd->path);
+}
+
+/*
+ * ------------------------------------------------------------------
+ * Match group manipulation
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * @brief Search \a parent->group for \a child (#DupeItem)
+ * @param child
+ * @param parent
+ * @returns
+ *
+ */
+static DupeMatch *dupe_match_find_match(DupeItem *child, DupeItem *parent)
+{
+	GList *work;
+
+	work = parent->group;
+	while (work)
+		{
+		auto dm = static_cast<DupeMatch *>(work->data);
+		if (dm->di == child) return dm;
+		work = work->next;
+		}
+	return nullptr;
+}
+
+/**
+ * @brief Create #DupeMatch structure for \a child, and insert into \a parent->group list.
+ * @param child
+ * @param parent
+ * @param rank
+ *
+ */
+static void dupe_match_link_child(DupeItem *child, DupeItem *parent, gdouble rank)
+{
+	DupeMatch *dm;
+
+	dm = g_new0(DupeMatch, 1);
+	dm->di = child;
+	dm->rank = rank;
+	parent->group = g_list_append(parent->group, dm);
+}
+
+/**
+ * @brief Link \a a & \a b as both parent and child
+ * @param a
+ * @param b
+ * @param rank
+ *
+ * Link \a a as child of \a b, and \a b as child of \a a
+ */
+static void dupe_match_link(DupeItem *a, DupeItem *b, gdouble rank)
+{
+	dupe_match_link_child(a, b, rank);
+	dupe_match_link_child(b, a, rank);
+}
+
+/**
+ * @brief Remove \a child #DupeMatch from \a parent->group list.
+ * @param child
+ * @param parent
+ *
+ */
+static void dupe_match_unlink_child(DupeItem *child, DupeItem *parent)
+{
+	DupeMatch *dm;
+
+	dm = dupe_match_find_match(child, parent);
+	if (dm)
+		{
+		parent->group = g_list_remove(parent->group, dm);
+		g_free(dm);
+		}
+}
+
+/**
+ * @brief  Unlink \a a from \a b, and \a b from \a a
+ * @param a
+ * @param b
+ *
+ * Free the relevant #DupeMatch items from the #DupeItem group lists
+ */
+static void dupe_match_unlink(DupeItem *a, DupeItem *b)
+{
+	dupe_match_unlink_child(a, b);
+	dupe_match_unlink_child(b, a);
+}
+
+/**
+ * @brief
+ * @param parent
+ * @param unlink_children
+ *
+ * If \a unlink_children is set, unlink all entries in \a parent->group list. \n
+ * Free the \a parent->group list and set group_rank to zero;
+ */
+static void dupe_match_link_clear(DupeItem *parent, gboolean unlink_children)
+{
+	if (unlink_children)
+		{
+		GList *work;
+
+		work = parent->group;
+		while (work)
+			{
+			auto dm = static_cast<DupeMatch *>(work->data);
+			work = work->next;
+
+			dupe_match_unlink_child(parent, dm->di);
+			}
+		}
+
+	g_list_free_full(parent->group, g_free);
+	parent->group = nullptr;
+	parent->group_rank = 0.0;
+}
+
+/**
+ * @brief Search \a parent->group list for \a child
+ * @param child
+ * @param parent
+ * @returns boolean TRUE/FALSE found/not found
+ *
+ */
+static gint dupe_match_link_exists(DupeItem *child, DupeItem *parent)
+{
+	return (dupe_match_find_match(child, parent) != nullptr);
+}
+
+/**
+ * @brief  Search \a parent->group for \a child, and return \a child->rank
+ * @param child
+ * @param parent
+ * @returns \a dm->di->rank
+ *
+ */
+static gdouble dupe_match_link_rank(DupeItem *child, DupeItem *parent)
+{
+	DupeMatch *dm;
+
+	dm = dupe_match_find_match(child, parent);
+	if (dm) return dm->rank;
+
+	return 0.0;
+}
+
+/**
+ * @brief Find highest rank in \a child->group
+ * @param child
+ * @returns
+ *
+ * Search the #DupeMatch entries in the \a child->group list.
+ * Return the #DupeItem with the highest rank. If more than one have
+ * the same rank, the first encountered is used.
+ */
+static DupeItem *dupe_match_highest_rank(DupeItem *child)
+{
+	DupeMatch *dr;
+	GList *work;
+
+	dr = nullptr;
+	work = child->group;
+	while (work)
+		{
+		auto dm = static_cast<DupeMatch *>(work->data);
+		if (!dr || dm->rank > dr->rank)
+			{
+			dr = dm;
+			}
+		work = work->next;
+		}
+
+	return (dr) ? dr->di : nullptr;
+}
+
+/**
+ * @brief Compute and store \a parent->group_rank
+ * @param parent
+ *
+ * Group_rank = (sum of all child ranks) / n
+ */
+static void dupe_match_rank_update(DupeItem *parent)
+{
+	GList *work;
+	gdouble rank = 0.0;
+	gint c = 0;
+
+	work = parent->group;
+	while (work)
+		{
+		auto dm = static_cast<DupeMatch *>(work->data);
+		work = work->next;
+		rank += dm->rank;
+		c++;
+		}
+
+	if (c > 0)
+		{
+		parent->group_rank = rank / c;
+		}
+	else
+		{
+		parent->group_rank = 0.0;
+		}
+}
+
+/**
+ * @brief Returns the parent of the group \a child is in, NULL if none
+ */
+DupeItem *dupe_engine_find_parent(DupeEngine *de, DupeItem *child)
+{
+	GList *work;
+
+	if (g_list_find(de->dupes, child)) return child;
+
+	work = child->group;
+	while (work)
+		{
+		auto dm = static_cast<DupeMatch *>(work->data);
+		if (g_list_find(de->dupes, dm->di)) return dm->di;
+		work = work->next;
+		}
+
+	return nullptr;
+}
+
+/**
+ * @brief
+ * @param work (#DupeItem) de->list or de->second_list
+ *
+ * Unlink all #DupeItem-s in \a work.
+ * Do not unlink children.
+ */
+static void dupe_match_reset_list(GList *work)
+{
+	while (work)
+		{
+		auto di = static_cast<DupeItem *>(work->data);
+		work = work->next;
+
+		dupe_match_link_clear(di, FALSE);
+		}
+}
+
+static void dupe_match_reparent(DupeEngine *de, DupeItem *old_parent, DupeItem *new_parent)
+{
+	GList *work;
+
+	if (!old_parent || !new_parent || !dupe_match_link_exists(old_parent, new_parent)) return;
+
+	dupe_match_link_clear(new_parent, TRUE);
+	work = old_parent->group;
+	while (work)
+		{
+		auto dm = static_cast<DupeMatch *>(work->data);
+		dupe_match_unlink_child(old_parent, dm->di);
+		dupe_match_link_child(new_parent, dm->di, dm->rank);
+		work = work->next;
+		}
+
+	new_parent->group = old_parent->group;
+	old_parent->group = nullptr;
+
+	work = g_list_find(de->dupes, old_parent);
+	if (work) work->data = new_parent;
+}
+
+static void dupe_match_print_group(DupeItem *di)
+{
+	GList *work;
+
+	log_printf("+ %f %s\n", di->group_rank, di->fd->name);
+
+	work = di->group;
+	while (work)
+		{
+		auto dm = static_cast<DupeMatch *>(work->data);
+		work = work->next;
+
+		log_printf("  %f %s\n", dm->rank, dm->di->fd->name);
+		}
+
+	log_printf("\n");
+}
+
+static void dupe_match_print_list(GList *list)
+{
+	GList *work;
+
+	work = list;
+	while (work)
+		{
+		auto di = static_cast<DupeItem *>(work->data);
+		dupe_match_print_group(di);
+		work = work->next;
+		}
+}
+
+/* level 3, unlinking and orphan handling */
+/**
+ * @brief
+ * @param child
+ * @param parent \a di from \a child->group
+ * @param[inout] list \a de->list sorted by rank (#DupeItem)
+ * @param de
+ * @returns modified \a list
+ *
+ * Called for each entry in \a child->group (#DupeMatch) with \a parent set to \a dm->di. \n
+ * Find the highest rank #DupeItem of the \a parent's children. \n
+ * If that is == \a child OR
+ * highest rank #DupeItem of \a child == \a parent then FIXME:
+ *
+ */
+static GList *dupe_match_unlink_by_rank(DupeItem *child, DupeItem *parent, GList *list, DupeEngine *de)
+{
+	DupeItem *best = nullptr;
+
+	best = dupe_match_highest_rank(parent); // highest rank in parent->group
+	if (best == child || dupe_match_highest_rank(child) == parent)
+		{
+		GList *work;
+		gdouble rank;
+
+		DEBUG_2("link found %s to %s [%d]", child->fd->name, parent->fd->name, g_list_length(parent->group));
+
+		work = parent->group;
+		while (work)
+			{
+			auto dm = static_cast<DupeMatch *>(work->data);
+			DupeItem *orphan;
+
+			work = work->next;
+			orphan = dm->di;
+			if (orphan != child && g_list_length(orphan->group) < 2)
+				{
+				dupe_match_link_clear(orphan, TRUE);
+				if (!de->second_set || orphan->second)
+					{
+					dupe_match(de, orphan, child, de->match_mask, &rank, FALSE);
+					dupe_match_link(orphan, child, rank);
+					}
+				list = g_list_remove(list, orphan);
+				}
+			}
+
+		rank = dupe_match_link_rank(child, parent); // child->rank
+		dupe_match_link_clear(parent, TRUE);
+		dupe_match_link(child, parent, rank);
+		list = g_list_remove(list, parent);
+		}
+	else
+		{
+		DEBUG_2("unlinking %s and %s", child->fd->name, parent->fd->name);
+
+		dupe_match_unlink(child, parent);
+		}
+
+	return list;
+}
+
+/* level 2 */
+/**
+ * @brief
+ * @param[inout] list \a de->list sorted by rank (#DupeItem)
+ * @param di
+ * @param de
+ * @returns modified \a list
+ *
+ * Called for each entry in \a list.
+ * Call unlink for each child in \a di->group
+ */
+static GList *dupe_match_group_filter(GList *list, DupeItem *di, DupeEngine *de)
+{
+	GList *work;
+
+	work = g_list_last(di->group);
+	while (work)
+		{
+		auto dm = static_cast<DupeMatch *>(work->data);
+		work = work->prev;
+		list = dupe_match_unlink_by_rank(di, dm->di, list, de);
+		}
+
+	return list;
+}
+
+/* level 1 (top) */
+/**
+ * @brief
+ * @param[inout] list \a de->list sorted by rank (#DupeItem)
+ * @param de
+ * @returns Filtered \a list
+ *
+ * Called once.
+ * Call group filter for each \a di in \a list
+ */
+static GList *dupe_match_group_trim(GList *list, DupeEngine *de)
+{
+	GList *work;
+
+	work = list;
+	while (work)
+		{
+		auto di = static_cast<DupeItem *>(work->data);
+		if (!di->second) list = dupe_match_group_filter(list, di, de);
+		work = work->next;
+		if (di->second) list = g_list_remove(list, di);
+		}
+
+	return list;
+}
+
+static gint dupe_match_sort_groups_cb(gconstpointer a, gconstpointer b)
+{
+	auto da = static_cast<const DupeMatch *>(a);
+	auto db = static_cast<const DupeMatch *>(b);
+
+	if (da->rank > db->rank) return -1;
+	if (da->rank < db->rank) return 1;
+	return 0;
+}
+
+/**
+ * @brief Sorts the children of each #DupeItem in \a list
+ * @param list #DupeItem
+ *
+ * Sorts the #DupeItem->group children on rank
+ */
+static void dupe_match_sort_groups(GList *list)
+{
+	GList *work;
+
+	work = list;
+	while (work)
+		{
+		auto di = static_cast<DupeItem *>(work->data);
+		di->group = g_list_sort(di->group, dupe_match_sort_groups_cb);
+		work = work->next;
+		}
+}
+
+static gint dupe_match_totals_sort_cb(gconstpointer a, gconstpointer b)
+{
+	auto da = static_cast<const DupeItem *>(a);
+	auto db = static_cast<const DupeItem *>(b);
+
+	if (g_list_length(da->group) > g_list_length(db->group)) return -1;
+	if (g_list_length(da->group) < g_list_length(db->group)) return 1;
+
+	if (da->group_rank < db->group_rank) return -1;
+	if (da->group_rank > db->group_rank) return 1;
+
+	return 0;
+}
+
+/**
+ * @brief Callback for group_rank sort
+ * @param a
+ * @param b
+ * @returns
+ *
+ *
+ */
+static gint dupe_match_rank_sort_cb(gconstpointer a, gconstpointer b)
+{
+	auto da = static_cast<const DupeItem *>(a);
+	auto db = static_cast<const DupeItem *>(b);
+
+	if (da->group_rank > db->group_rank) return -1;
+	if (da->group_rank < db->group_rank) return 1;
+	return 0;
+}
+
+/**
+ * @brief Sorts \a source_list by group-rank
+ * @param source_list #DupeItem
+ * @returns
+ *
+ * Computes group_rank for each #DupeItem. \n
+ * Items with no group list are ignored.
+ * Returns allocated GList of #DupeItem-s sorted by group_rank
+ */
+static GList *dupe_match_rank_sort(GList *source_list)
+{
+	GList *list = nullptr;
+	GList *work;
+
+	work = source_list;
+	while (work)
+		{
+		auto di = static_cast<DupeItem *>(work->data);
+
+		if (di->group)
+			{
+			dupe_match_rank_update(di); // Compute and store group_rank for di
+			list = g_list_prepend(list, di);
+			}
+
+		work = work->next;
+		}
+
+	return g_list_sort(list, dupe_match_rank_sort_cb);
+}
+
+/**
+ * @brief Returns allocated GList of dupes sorted by totals
+ * @param source_list
+ * @returns
+ *
+ *
+ */
+static GList *dupe_match_totals_sort(GList *source_list)
+{
+	source_list = g_list_sort(source_list, dupe_match_totals_sort_cb);
+
+	source_list = g_list_first(source_list);
+	return g_list_reverse(source_list);
+}
+
+/**
+ * @brief
+ * @param de
+ *
+ * Called once.
+ */
+static void dupe_match_rank(DupeEngine *de)
+{
+	GList *list;
+
+	list = dupe_match_rank_sort(de->list); // sorted by group_rank, no-matches filtered out
+
+	if (required_debug_level(2)) dupe_match_print_list(list);
+
+	DEBUG_1("Similar items: %u", g_list_length(list));
+	list = dupe_match_group_trim(list, de);
+	DEBUG_1("Unique groups: %u", g_list_length(list));
+
+	dupe_match_sort_groups(list);
+
+	if (required_debug_level(2)) dupe_match_print_list(list);
+
+	list = dupe_match_rank_sort(list);
+	if (options->sort_totals)
+		{
+		list = dupe_match_totals_sort(list);
+		}
+	if (required_debug_level(2)) dupe_match_print_list(list);
+
+	g_list_free(de->dupes);
+	de->dupes = list;
+}
+
+/*
+ * ------------------------------------------------------------------
+ * Match group tests
+ * ------------------------------------------------------------------
+ */
+
+static gboolean dupe_match_md5sum(DupeItem *a, DupeItem *b)
+{
+	if (!a->md5sum) a->md5sum = md5_text_from_file_utf8(a->fd->path);
+	if (!b->md5sum) b->md5sum = md5_text_from_file_utf8(b->fd->path);
+
+	return !a->md5sum->empty()
+	    && !b->md5sum->empty()
+	    && a->md5sum == b->md5sum;
+}
+
+/**
+ * @brief Minimum similarity for a match
+ * @param mask
+ * @returns 0.0 to 1.0
+ */
+static gdouble dupe_match_sim_threshold(DupeMatchType mask)
+{
+	if (mask & DUPE_MATCH_SIM_HIGH) return 0.95;
+	if (mask & DUPE_MATCH_SIM_MED) return 0.90;
+	if (mask & DUPE_MATCH_SIM_CUSTOM) return static_cast<gdouble>(options->duplicates_similarity_threshold) / 100.0;
+
+	return 0.85;
+}
+
+/**
+ * @brief
+ * @param[in] de
+ * @param[in] a
+ * @param[in] b
+ * @param[in] mask
+ * @param[out] rank
+ * @param[in] fast
+ * @param[in] reference Similarity data of \a b prepared for many comparisons, or NULL
+ * @returns
+ *
+ * For similarity checks, compute rank - (similarity factor between a and b). \n
+ * If rank < user-set sim value, returns FALSE.
+ */
+static gboolean dupe_match(DupeEngine *de, DupeItem *a, DupeItem *b, DupeMatchType mask, gdouble *rank, gint fast, const ImageSimilarityReference *reference)
+{
+	*rank = 0.0;
+
+	if (a->fd->path == b->fd->path) return FALSE;
+
+	if (mask & DUPE_MATCH_ALL)
+		{
+		return TRUE;
+		}
+	if (mask & DUPE_MATCH_PATH)
+		{
+		if (utf8_compare(a->fd->path, b->fd->path, TRUE) != 0) return FALSE;
+		}
+	if (mask & DUPE_MATCH_NAME)
+		{
+		if (strcmp(a->fd->collate_key_name, b->fd->collate_key_name) != 0) return FALSE;
+		}
+	if (mask & DUPE_MATCH_NAME_CI)
+		{
+		if (strcmp(a->fd->collate_key_name_nocase, b->fd->collate_key_name_nocase) != 0) return FALSE;
+		}
+	if (mask & DUPE_MATCH_NAME_CONTENT)
+		{
+		if (strcmp(a->fd->collate_key_name, b->fd->collate_key_name) != 0) return FALSE;
+
+		return !dupe_match_md5sum(a, b);
+		}
+	if (mask & DUPE_MATCH_NAME_CI_CONTENT)
+		{
+		if (strcmp(a->fd->collate_key_name_nocase, b->fd->collate_key_name_nocase) != 0) return FALSE;
+
+		return !dupe_match_md5sum(a, b);
+		}
+	if (mask & DUPE_MATCH_SIZE)
+		{
+		if (a->fd->size != b->fd->size) return FALSE;
+		}
+	if (mask & DUPE_MATCH_DATE)
+		{
+		if (a->fd->date != b->fd->date) return FALSE;
+		}
+	if (mask & DUPE_MATCH_SUM)
+		{
+		if (!dupe_match_md5sum(a, b)) return FALSE;
+		}
+	if (mask & DUPE_MATCH_DIM)
+		{
+		if (a->dimensions.empty()) image_load_dimensions(a->fd, a->dimensions);
+		if (b->dimensions.empty()) image_load_dimensions(b->fd, b->dimensions);
+		if (a->dimensions != b->dimensions) return FALSE;
+		}
+	if (mask & DUPE_MATCH_SIM)
+		{
+		gdouble f;
+		const gdouble m = dupe_match_sim_threshold(mask);
+
+		if (fast && reference)
+			{
+			f = reference->compare_fast(dupe_engine_item_simd(de, a), m);
+			}
+		else if (fast)
+			{
+			f = image_sim_compare_fast(dupe_engine_item_simd(de, a), dupe_engine_item_simd(de, b), m);
+			}
+		else
+			{
+			f = image_sim_compare(dupe_engine_item_simd(de, a), dupe_engine_item_simd(de, b));
+			}
+
+		*rank = f * 100.0;
+
+		if (f < m) return FALSE;
+
+		DEBUG_3("similar: %32s %32s = %f", a->fd->name, b->fd->name, f);
+		}
+
+	return TRUE;
+}
+
+/**
+ * @brief  Determine if there is a match
+ * @param di1
+ * @param di2
+ * @param data
+ * @returns DUPE_MATCH/DUPE_NO_MATCH/DUPE_NAME_MATCH
+ * 			DUPE_NAME_MATCH is used for name != contents searches:
+ * 							the name and content match i.e.
+ * 							no match, but keep searching
+ *
+ * Called when stepping down the array looking for adjacent matches,
+ * and from the 2nd set search.
+ *
+ * Is not used for similarity checks.
+ */
+static DUPE_CHECK_RESULT dupe_match_check(DupeItem *di1, DupeItem *di2, gpointer data)
+{
+	auto de = static_cast<DupeEngine *>(data);
+	DupeMatchType mask = de->match_mask;
+
+	if (mask & DUPE_MATCH_ALL)
+		{
+		return DUPE_MATCH;
+		}
+	if (mask & DUPE_MATCH_PATH)
+		{
+		if (utf8_compare(di1->fd->path, di2->fd->path, TRUE) != 0)
+			{
+			return DUPE_NO_MATCH;
+			}
+		}
+	if (mask & DUPE_MATCH_NAME)
+		{
+		if (g_strcmp0(di1->fd->collate_key_name, di2->fd->collate_key_name) != 0)
+			{
+			return DUPE_NO_MATCH;
+			}
+		}
+	if (mask & DUPE_MATCH_NAME_CI)
+		{
+		if (g_strcmp0(di1->fd->collate_key_name_nocase, di2->fd->collate_key_name_nocase) != 0 )
+			{
+			return DUPE_NO_MATCH;
+			}
+		}
+	if (mask & DUPE_MATCH_NAME_CONTENT)
+		{
+		if (g_strcmp0(di1->fd->collate_key_name, di2->fd->collate_key_name) != 0)
+			{
+			return DUPE_NO_MATCH;
+			}
+
+		if (di1->md5sum == di2->md5sum)
+			{
+			return DUPE_NAME_MATCH;
+			}
+		}
+	if (mask & DUPE_MATCH_NAME_CI_CONTENT)
+		{
+		if (strcmp(di1->fd->collate_key_name_nocase, di2->fd->collate_key_name_nocase) != 0)
+			{
+			return DUPE_NO_MATCH;
+			}
+
+		if (di1->md5sum == di2->md5sum)
+			{
+			return DUPE_NAME_MATCH;
+			}
+		}
+	if (mask & DUPE_MATCH_SIZE)
+		{
+		if (di1->fd->size != di2->fd->size)
+			{
+			return DUPE_NO_MATCH;
+			}
+		}
+	if (mask & DUPE_MATCH_DATE)
+		{
+		if (di1->fd->date != di2->fd->date)
+			{
+			return DUPE_NO_MATCH;
+			}
+		}
+	if (mask & DUPE_MATCH_SUM)
+		{
+		/* Files skipped by the staged checksum pre-pass have none */
+		if (!di1->md5sum || di1->md5sum->empty() || di1->md5sum != di2->md5sum)
+			{
+			return DUPE_NO_MATCH;
+			}
+		}
+	if (mask & DUPE_MATCH_DIM)
+		{
+		if (di1->dimensions_sum != di2->dimensions_sum)
+			{
+			return DUPE_NO_MATCH;
+			}
+		}
+
+	return DUPE_MATCH;
+}
+
+/**
+ * @brief The callback for the binary search
+ * @param a
+ * @param b
+ * @param param_match_mask
+ * @returns negative/0/positive
+ *
+ * Is not used for similarity checks.
+ *
+ * Used only when two file sets are used.
+ * Requires use of a global for param_match_mask because there is no
+ * g_array_binary_search_with_data() function in glib.
+ */
+static gint dupe_match_binary_search_cb(gconstpointer a, gconstpointer b)
+{
+	auto di1 = *(static_cast<const DupeItem *const *>(a));
+	auto di2 = static_cast<const DupeItem *>(b);
+	DupeMatchType mask = param_match_mask;
+
+	if (mask & DUPE_MATCH_ALL)
+		{
+		return 0;
+		}
+	if (mask & DUPE_MATCH_PATH)
+		{
+		return utf8_compare(di1->fd->path, di2->fd->path, TRUE);
+		}
+	if (mask & DUPE_MATCH_NAME)
+		{
+		return g_strcmp0(di1->fd->collate_key_name, di2->fd->collate_key_name);
+		}
+	if (mask & DUPE_MATCH_NAME_CI)
+		{
+		return strcmp(di1->fd->collate_key_name_nocase, di2->fd->collate_key_name_nocase);
+		}
+	if (mask & DUPE_MATCH_NAME_CONTENT)
+		{
+		return g_strcmp0(di1->fd->collate_key_name, di2->fd->collate_key_name);
+		}
+	if (mask & DUPE_MATCH_NAME_CI_CONTENT)
+		{
+		return strcmp(di1->fd->collate_key_name_nocase, di2->fd->collate_key_name_nocase);
+		}
+	if (mask & DUPE_MATCH_SIZE)
+		{
+		return (di1->fd->size - di2->fd->size);
+		}
+	if (mask & DUPE_MATCH_DATE)
+		{
+		return (di1->fd->date - di2->fd->date);
+		}
+	if (mask & DUPE_MATCH_SUM)
+		{
+		if (di1->md5sum < di2->md5sum) return -1;
+		if (di1->md5sum > di2->md5sum) return 1;
+		return 0;
+		}
+	if (mask & DUPE_MATCH_DIM)
+		{
+		return (di1->dimensions_sum - di2->dimensions_sum);
+		}
+
+	return 0;
+}
+
+/**
+ * @brief The callback for the array sort
+ * @param a
+ * @param b
+ * @param data
+ * @returns negative/0/positive
+ *
+ * Is not used for similarity checks.
+*/
+static gint dupe_match_sort_cb(gconstpointer a, gconstpointer b, gpointer data)
+{
+	auto di1 = *(static_cast<const DupeItem *const *>(a));
+	auto di2 = *(static_cast<const DupeItem *const *>(b));
+	auto de = static_cast<DupeEngine *>(data);
+	DupeMatchType mask = de->match_mask;
+
+	if (mask & DUPE_MATCH_ALL)
+		{
+		return 0;
+		}
+	if (mask & DUPE_MATCH_PATH)
+		{
+		return utf8_compare(di1->fd->path, di2->fd->path, TRUE);
+		}
+	if (mask & DUPE_MATCH_NAME)
+		{
+		return g_strcmp0(di1->fd->collate_key_name, di2->fd->collate_key_name);
+		}
+	if (mask & DUPE_MATCH_NAME_CI)
+		{
+		return strcmp(di1->fd->collate_key_name_nocase, di2->fd->collate_key_name_nocase);
+		}
+	if (mask & DUPE_MATCH_NAME_CONTENT)
+		{
+		return g_strcmp0(di1->fd->collate_key_name, di2->fd->collate_key_name);
+		}
+	if (mask & DUPE_MATCH_NAME_CI_CONTENT)
+		{
+		return strcmp(di1->fd->collate_key_name_nocase, di2->fd->collate_key_name_nocase);
+		}
+	if (mask & DUPE_MATCH_SIZE)
+		{
+		return (di1->fd->size - di2->fd->size);
+		}
+	if (mask & DUPE_MATCH_DATE)
+		{
+		return (di1->fd->date - di2->fd->date);
+		}
+	if (mask & DUPE_MATCH_SUM)
+		{
+		/* Items without checksum first, they never match */
+		if (di1->md5sum < di2->md5sum) return -1;
+		if (di1->md5sum > di2->md5sum) return 1;
+		return 0;
+		}
+	if (mask & DUPE_MATCH_DIM)
+		{
+		if (!di1 || !di2 || !di1->dimensions.width || !di1->dimensions.height || !di2->dimensions.width || !di2->dimensions.height)
+			{
+			return -1;
+			}
+		return (di1->dimensions_sum - di2->dimensions_sum);
+		}
+
+	return 0; // should not execute
+}
+
+/**
+ * @brief Check for duplicate matches
+ * @param de
+ *
+ * Is not used for similarity checks.
+ *
+ * Loads the file sets into an array and sorts on the searched
+ * for parameter.
+ *
+ * If one file set, steps down the array looking for adjacent equal values.
+ *
+ * If two file sets, steps down the first set and for each value
+ * does a binary search for matches in the second set.
+ */
+static void dupe_array_check(DupeEngine *de)
+{
+	DUPE_CHECK_RESULT check_result;
+	param_match_mask = de->match_mask;
+	guint out_match_index;
+
+	if (!de->list) return;
+
+	dupe_match_reset_list(de->list);
+
+	const auto list_to_sorted_array = [de](GList *list)
+	{
+		GArray *array_set = g_array_new(TRUE, TRUE, sizeof(gpointer));
+
+		for (GList *work = list; work; work = work->next)
+			{
+			g_array_append_val(array_set, work->data);
+			}
+
+		g_array_sort_with_data(array_set, dupe_match_sort_cb, de);
+		return array_set;
+	};
+
+	GArray *array_set1 = list_to_sorted_array(de->list);
+
+	if (de->second_set)
+		{
+		/* Two sets - nothing can be done until a second set is loaded */
+		if (de->second_list)
+			{
+			GArray *array_set2 = list_to_sorted_array(de->second_list);
+
+			for (gint i_set1 = 0; i_set1 <= static_cast<gint>(array_set1->len) - 1; i_set1++)
+				{
+				auto di1 = static_cast<DupeItem *>(g_array_index(array_set1, gpointer, i_set1));
+				DupeItem *di2 = nullptr;
+				/* If multiple identical entries in set 1, use the last one */
+				if (i_set1 < static_cast<gint>(array_set1->len) - 2)
+					{
+					di2 = static_cast<DupeItem *>(g_array_index(array_set1, gpointer, i_set1 + 1));
+					check_result = dupe_match_check(di1, di2, de);
+					if (check_result == DUPE_MATCH || check_result == DUPE_NAME_MATCH)
+						{
+						continue;
+						}
+					}
+
+				if (g_array_binary_search(array_set2, di1, dupe_match_binary_search_cb, &out_match_index))
+					{
+					di2 = static_cast<DupeItem *>(g_array_index(array_set2, gpointer, out_match_index));
+
+					check_result = dupe_match_check(di1, di2, de);
+					if (check_result == DUPE_MATCH || check_result == DUPE_NAME_MATCH)
+						{
+						if (check_result == DUPE_MATCH)
+							{
+							dupe_match_link(di2, di1, 0.0);
+							}
+
+						gint i_set2 = out_match_index + 1;
+						if (i_set2 > static_cast<gint>(array_set2->len) - 1)
+							{
+							break;
+							}
+						/* Look for multiple matches in set 2 for item di1 */
+						di2 = static_cast<DupeItem *>(g_array_index(array_set2, gpointer, i_set2));
+						check_result = dupe_match_check(di1, di2, de);
+						while (check_result == DUPE_MATCH || check_result == DUPE_NAME_MATCH)
+							{
+							if (check_result == DUPE_MATCH)
+								{
+								dupe_match_link(di2, di1, 0.0);
+								}
+							i_set2++;
+							if (i_set2 > static_cast<gint>(array_set2->len) - 1)
+								{
+								break;
+								}
+							di2 = static_cast<DupeItem *>(g_array_index(array_set2, gpointer, i_set2));
+							check_result = dupe_match_check(di1, di2, de);
+							}
+						}
+					}
+				}
+
+			g_array_free(array_set2, TRUE);
+			}
+		}
+	else
+		{
+		/* File set 1 only */
+		g_clear_pointer(&de->dupes, g_list_free);
+
+		for (gint i_set1 = 0; i_set1 <= static_cast<gint>(array_set1->len) - 2; i_set1++)
+			{
+			auto *di1 = static_cast<DupeItem *>(g_array_index(array_set1, gpointer, i_set1));
+
+			/* Look for multiple matches for item di1 */
+			auto *di2 = static_cast<DupeItem *>(g_array_index(array_set1, gpointer, i_set1 + 1));
+			check_result = dupe_match_check(di1, di2, de);
+			while (check_result == DUPE_MATCH || check_result == DUPE_NAME_MATCH)
+				{
+				if (check_result == DUPE_MATCH)
+					{
+					dupe_match_link(di2, di1, 0.0);
+					}
+
+				i_set1++;
+				if (i_set1 + 1 > static_cast<gint>(array_set1->len) - 1) break;
+
+				di2 = static_cast<DupeItem *>(g_array_index(array_set1, gpointer, i_set1 + 1));
+				check_result = dupe_match_check(di1, di2, de);
+				}
+			}
+		}
+
+	g_array_free(array_set1, TRUE);
+}
+
+/**
+ * @brief Puts the items of \a list in comparison order
+ * @param list (#DupeItem)
+ * @param[out] compared_count Number of items compared by the previous check, which come first
+ * @returns The items
+ */
+static std::vector<DupeItem *> dupe_comparison_items(GList *list, gint &compared_count)
+{
+	std::vector<DupeItem *> items;
+
+	for (GList *work = list; work; work = work->next)
+		{
+		items.push_back(static_cast<DupeItem *>(work->data));
+		}
+
+	const auto first_new = std::stable_partition(items.begin(), items.end(), [](const DupeItem *di){ return di->compared; });
+	compared_count = first_new - items.begin();
+
+	return items;
+}
+
+/**
+ * @brief Adds the tiles of the needles \a needle_begin to \a needle_end
+ * @param de
+ * @param dc
+ * @param needle_begin
+ * @param needle_end
+ * @param haystack_begin First haystack item these needles are compared with
+ */
+static void dupe_comparison_add_tiles(DupeEngine *de, DupeComparison *dc, gint needle_begin, gint needle_end, gint haystack_begin)
+{
+	const gint haystack_count = dc->haystack.size();
+
+	for (gint n = needle_begin; n < needle_end; n += DUPE_COMPARISON_TILE_SIZE)
+		{
+		const gint tile_end = std::min(n + DUPE_COMPARISON_TILE_SIZE, needle_end);
+
+		if (de->sim_index)
+			{
+			if (haystack_begin < haystack_count) dc->tiles.push_back({n, tile_end, haystack_begin, haystack_count});
+			continue;
+			}
+
+		/* set 1 only needs the tiles on and below the diagonal */
+		const gint haystack_end = de->second_set ? haystack_count : tile_end;
+
+		for (gint h = haystack_begin; h < haystack_end; h += DUPE_COMPARISON_TILE_SIZE)
+			{
+			dc->tiles.push_back({n, tile_end, h, std::min(h + DUPE_COMPARISON_TILE_SIZE, haystack_end)});
+			}
+		}
+}
+
+/**
+ * @brief Splits the similarity check into tiles and starts the workers
+ * @param de
+ *
+ * Only used for similarity checks.\n
+ * Called from dupe_check_cb once the setup is done.
+ */
+static void dupe_comparison_start(DupeEngine *de)
+{
+	auto *dc = new DupeComparison();
+	gint needles_compared;
+	gint haystack_compared;
+
+	dc->needles = dupe_comparison_items(de->list, needles_compared);
+	if (de->second_set)
+		{
+		dc->haystack = dupe_comparison_items(de->second_list, haystack_compared);
+		}
+	else
+		{
+		dc->haystack = dc->needles;
+		haystack_compared = needles_compared;
+		}
+
+	const gint needle_count = dc->needles.size();
+
+	/* Pairs of two compared items were checked by the previous check */
+	if (de->second_set)
+		{
+		dupe_comparison_add_tiles(de, dc, 0, needles_compared, haystack_compared);
+		}
+	dupe_comparison_add_tiles(de, dc, needles_compared, needle_count, 0);
+
+	gint worker_count = options->threads.duplicates > 0 ? options->threads.duplicates : get_cpu_cores();
+	worker_count = std::clamp(worker_count, 1, std::max(1, static_cast<gint>(dc->tiles.size())));
+
+	/* Contiguous ranges keep neighbouring tiles, which share needles, on one worker */
+	dc->workers = std::vector<DupeComparison::Worker>(worker_count);
+	for (gint i = 0; i < worker_count; i++)
+		{
+		DupeComparison::Worker &worker = dc->workers[i];
+		const gsize begin = dc->tiles.size() * i / worker_count;
+		const gsize end = dc->tiles.size() * (i + 1) / worker_count;
+
+		worker.id = i;
+		for (gsize tile = begin; tile < end; tile++) worker.tiles.push_back(tile);
+		}
+
+	de->comparison = dc;
+
+	dc->workers_running = worker_count;
+	for (DupeComparison::Worker &worker : dc->workers)
+		{
+		g_thread_pool_push(de->dupe_comparison_thread_pool, &worker, nullptr);
+		}
+}
+
+/**
+ * @brief Adds the matches of all workers to \a de->sim_links
+ * @param de
+ * @param dc
+ *
+ * Must only be called once all workers are done.
+ */
+static void dupe_comparison_merge(DupeEngine *de, DupeComparison *dc)
+{
+	std::vector<DupeSearchMatch> &matches = de->sim_links->matches;
+
+	gsize count = matches.size();
+	for (const DupeComparison::Worker &worker : dc->workers) count += worker.matches.size();
+
+	matches.reserve(count);
+	for (DupeComparison::Worker &worker : dc->workers)
+		{
+		matches.insert(matches.end(), worker.matches.cbegin(), worker.matches.cend());
+		std::vector<DupeSearchMatch>().swap(worker.matches);
+		}
+}
+
+/**
+ * @brief Waits for the workers and frees \a de->comparison
+ * @param de
+ *
+ * Set \a de->abort first to stop the workers early.
+ */
+static void dupe_comparison_free(DupeEngine *de)
+{
+	if (!de->comparison) return;
+
+	while (de->comparison->workers_running > 0) // Wait for the workers to finish
+		{
+		g_thread_yield();
+		}
+
+	delete de->comparison;
+	de->comparison = nullptr;
+}
+
+/**
+ * @brief Drops the kept similarity matches \a remove returns TRUE for
+ * @param de
+ * @param remove
+ */
+template<typename Remove>
+static void dupe_similarity_links_remove_if(DupeEngine *de, Remove remove)
+{
+	std::vector<DupeSearchMatch> &matches = de->sim_links->matches;
+
+	matches.erase(std::remove_if(matches.begin(), matches.end(), remove), matches.end());
+
+	/* Linked again from the start */
+	de->sim_links->sorted = FALSE;
+}
+
+/**
+ * @brief Sorts \a de->sim_links into the order a check of all items finds the matches
+ * @param de
+ *
+ * That is needle by needle from the end of \a de->list, and for each needle
+ * the items before it from the nearest one, or the items of set 2 from the
+ * first one. The needle of a match becomes its \a b.
+ */
+static void dupe_similarity_links_sort(DupeEngine *de)
+{
+	std::unordered_map<const DupeItem *, gint> positions;
+
+	for (GList *list : {de->list, de->second_list})
+		{
+		gint position = 0;
+		for (GList *work = list; work; work = work->next)
+			{
+			positions[static_cast<const DupeItem *>(work->data)] = position++;
+			}
+		}
+
+	std::vector<DupeSearchMatch> &matches = de->sim_links->matches;
+	for (DupeSearchMatch &match : matches)
+		{
+		const gboolean turn = de->second_set ? match.b->second : positions[match.a] > positions[match.b];
+		if (turn) std::swap(match.a, match.b);
+		}
+
+	std::sort(matches.begin(), matches.end(), [de, &positions](const DupeSearchMatch &a, const DupeSearchMatch &b)
+		{
+		const gint needle_a = positions[a.b];
+		const gint needle_b = positions[b.b];
+		if (needle_a != needle_b) return needle_a > needle_b;
+
+		const gint order_a = de->second_set ? positions[a.a] : needle_a - positions[a.a];
+		const gint order_b = de->second_set ? positions[b.a] : needle_b - positions[b.a];
+		return order_a < order_b;
+		});
+
+	de->sim_links->sorted = TRUE;
+	de->sim_links->linked = 0;
+}
+
+/**
+ * @brief Links the next batch of \a de->sim_links
+ * @param de
+ * @returns TRUE if matches are left
+ *
+ * The first call drops the links of the previous check and sorts the matches.
+ */
+static gboolean dupe_similarity_links_step(DupeEngine *de)
+{
+	DupeSimilarityLinks *links = de->sim_links;
+
+	if (!links->sorted)
+		{
+		dupe_match_reset_list(de->list);
+		dupe_match_reset_list(de->second_list);
+		dupe_similarity_links_sort(de);
+		dupe_setup_reset(de);
+		}
+
+	const gsize end = std::min(links->linked + DUPE_COMPARISON_LINK_BATCH, links->matches.size());
+
+	de->setup_n++;
+	dupe_engine_update_progress(de, _("Sorting…"), 0.0, FALSE);
+
+	for (; links->linked < end; links->linked++)
+		{
+		const DupeSearchMatch &match = links->matches[links->linked];
+
+		if (!dupe_match_link_exists(match.a, match.b))
+			{
+			dupe_match_link(match.a, match.b, match.rank);
+			}
+		}
+
+	return links->linked < links->matches.size();
+}
+
+/**
+ * @brief Check if the similarity index can replace the list walk
+ * @param de
+ * @returns TRUE if the index gives exactly the same matches
+ */
+static gboolean dupe_similarity_index_usable(DupeEngine *de)
+{
+	if (!options->duplicates_similarity_index) return FALSE;
+	if (!(de->match_mask & DUPE_MATCH_SIM)) return FALSE;
+
+	/* These return from dupe_match() before the similarity test */
+	if (de->match_mask & (DUPE_MATCH_ALL | DUPE_MATCH_NAME_CONTENT | DUPE_MATCH_NAME_CI_CONTENT)) return FALSE;
+
+	/* The alternate algorithm does not use a distance metric */
+	return !options->alternate_similarity_algorithm.enabled;
+}
+
+/**
+ * @brief Moves the similarity data into comparison order, set 1 then set 2
+ * @param de
+ *
+ * The comparison workers then read the data of consecutive items from
+ * consecutive memory, and the slots of removed items are given back.
+ * Must not be called while the workers run.
+ */
+static void dupe_similarity_data_compact(DupeEngine *de)
+{
+	std::vector<DupeItem *> items;
+	gint compared_count;
+
+	/* Set 2 keeps its data while it is disabled */
+	items = dupe_comparison_items(de->list, compared_count);
+	const std::vector<DupeItem *> second = dupe_comparison_items(de->second_list, compared_count);
+	items.insert(items.end(), second.cbegin(), second.cend());
+
+	std::vector<gint> indices;
+	indices.reserve(items.size());
+	for (const DupeItem *di : items) indices.push_back(di->simd);
+
+	de->simd_arena->compact(indices);
+
+	for (gsize i = 0; i < items.size(); i++) items[i]->simd = indices[i];
+}
+
+static DupeSimilarityIndex *dupe_similarity_index_new(DupeEngine *de, GList *list)
+{
+	auto *si = new DupeSimilarityIndex();
+	std::vector<const ImageSimilarityData *> data;
+	gint compared_count;
+
+	si->items = dupe_comparison_items(list, compared_count);
+	for (const DupeItem *di : si->items)
+		{
+		data.push_back(dupe_engine_item_simd(de, di));
+		}
+
+	si->index = std::make_unique<ImageSimilarityIndex>(data);
+
+	return si;
+}
+
+static void dupe_similarity_index_free(DupeEngine *de)
+{
+	delete de->sim_index;
+	de->sim_index = nullptr;
+}
+
+/*
+ * ------------------------------------------------------------------
+ * Dupe checking loop
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * @brief Check if the groups are reported while the checksums are read
+ * @param de
+ * @returns TRUE if #DupeEngine->group_func gets each group as soon as it is final
+ *
+ * Only a checksum match of one set can close a group before the check is
+ * complete. Otherwise #DupeEngine->group_func gets the groups of
+ * #DupeEngine->dupes when the check is complete.
+ */
+gboolean dupe_engine_streams(const DupeEngine *de)
+{
+	return de->group_func && de->match_mask == DUPE_MATCH_SUM && !de->second_set;
+}
+
+/**
+ * @brief Links and reports the items of \a items with the same checksum
+ * @param de
+ * @param items
+ *
+ * Only used when the groups are streamed. Items already in a reported
+ * group are skipped. The first item of a group in \a items is its parent.
+ */
+static void dupe_stream_groups(DupeEngine *de, const std::vector<DupeItem *> &items)
+{
+	std::unordered_map<std::string, std::vector<DupeItem *>> sums;
+	std::vector<const std::string *> order;
+
+	for (DupeItem *di : items)
+		{
+		if (di->group || !di->md5sum || di->md5sum->empty()) continue;
+
+		std::vector<DupeItem *> &sum = sums[di->md5sum.value()];
+		if (sum.empty()) order.push_back(&di->md5sum.value());
+		sum.push_back(di);
+		}
+
+	for (const std::string *md5sum : order)
+		{
+		const std::vector<DupeItem *> &group = sums[*md5sum];
+		if (group.size() < 2) continue;
+
+		for (gsize i = 1; i < group.size(); i++)
+			{
+			dupe_match_link(group[i], group.front(), 0.0);
+			}
+
+		de->group_func(de, group.front());
+		}
+}
+
+/**
+ * @brief Applies the pre-pass results the workers handed over so far
+ * @param de
+ *
+ * Called in the main loop only.
+ */
+static void dupe_prepass_apply(DupeEngine *de)
+{
+	DupePrepass *dp = de->prepass;
+	std::vector<DupePrepass::Result> results;
+
+	{
+	std::lock_guard<std::mutex> lock(dp->mutex);
+	results.swap(dp->results);
+	}
+
+	for (DupePrepass::Result &result : results)
+		{
+		DupeItem *di = result.di;
+
+		if (!di->md5sum && result.md5sum)
+			{
+			di->md5sum = std::move(result.md5sum);
+			}
+
+		if (di->dimensions.empty() && result.dimensions)
+			{
+			di->dimensions = result.dimensions.value();
+			di->dimensions_sum = (di->dimensions.width << 16) + di->dimensions.height;
+			}
+
+		if (di->simd < 0 && result.similarity)
+			{
+			ImageSimilarityData *sd = dupe_item_simd_ensure(de, di);
+			if (sd)
+				{
+				*sd = *result.similarity;
+				sd->alternate_processing();
+				}
+			}
+
+		if (result.partial)
+			{
+			dp->partials[di] = std::move(result.partial.value());
+			}
+
+		const auto size_group = dp->item_size_groups.find(di);
+		if (size_group != dp->item_size_groups.end() && --dp->size_groups[size_group->second].pending == 0)
+			{
+			dupe_stream_groups(de, dp->size_groups[size_group->second].items);
+			}
+		}
+
+	dp->applied += results.size();
+}
+
+/**
+ * @brief Stops the workers, applies what they have done and frees \a de->prepass
+ * @param de
+ */
+static void dupe_prepass_free(DupeEngine *de)
+{
+	if (!de->prepass) return;
+
+	DupePrepass *dp = de->prepass;
+
+	dp->abort = TRUE;
+
+	std::unique_lock<std::mutex> lock(dp->mutex);
+	dp->finished.wait(lock, [dp]{ return dp->workers_running == 0; }); // Wait for the current files to finish
+	lock.unlock();
+
+	dupe_prepass_apply(de);
+
+	delete de->prepass;
+	de->prepass = nullptr;
+}
+
+/**
+ * @brief Check if checksums are computed in stages
+ * @param de
+ * @returns TRUE if only items with a checksum match are looked for
+ *
+ * A search for the same name with different content needs all checksums.
+ */
+static gboolean dupe_prepass_staged(const DupeEngine *de)
+{
+	return (de->match_mask & DUPE_MATCH_SUM) &&
+	       !(de->match_mask & (DUPE_MATCH_NAME_CONTENT | DUPE_MATCH_NAME_CI_CONTENT));
+}
+
+/**
+ * @brief Groups the items of both sets by file size
+ * @param de
+ * @returns The groups of at least two items, of which at least one lacks a checksum
+ */
+static std::vector<std::vector<DupeItem *>> dupe_prepass_size_groups(const DupeEngine *de)
+{
+	std::unordered_map<gint64, std::vector<DupeItem *>> sizes;
+
+	for (GList *list : {de->list, de->second_set ? de->second_list : nullptr})
+		{
+		for (GList *work = list; work; work = work->next)
+			{
+			auto di = static_cast<DupeItem *>(work->data);
+
+			sizes[di->fd->size].push_back(di);
+			}
+		}
+
+	std::vector<std::vector<DupeItem *>> groups;
+	for (auto &size : sizes)
+		{
+		std::vector<DupeItem *> &items = size.second;
+
+		if (items.size() < 2) continue;
+		if (std::all_of(items.cbegin(), items.cend(), [](const DupeItem *di){ return di->md5sum.has_value(); })) continue;
+
+		groups.push_back(std::move(items));
+		}
+
+	return groups;
+}
+
+/**
+ * @brief Adds the jobs of the stage of \a dp
+ * @param de
+ * @param dp
+ * @param partials The partial hashes of the previous stage
+ */
+static void dupe_prepass_add_jobs(DupeEngine *de, DupePrepass *dp, const std::unordered_map<DupeItem *, std::string> &partials)
+{
+	const gboolean staged = dupe_prepass_staged(de);
+	constexpr gint64 small_size = 2 * DUPE_PREPASS_PARTIAL_SIZE;
+
+	if (dp->stage == DupePrepass::CACHE)
+		{
+		const gboolean md5sum = !staged && (de->match_mask & (DUPE_MATCH_SUM | DUPE_MATCH_NAME_CONTENT | DUPE_MATCH_NAME_CI_CONTENT));
+		const gboolean cached = options->thumbnails.enable_caching;
+
+		for (GList *list : {de->list, de->second_set ? de->second_list : nullptr})
+			{
+			for (GList *work = list; work; work = work->next)
+				{
+				auto di = static_cast<DupeItem *>(work->data);
+				const gboolean need_md5sum = md5sum && !di->md5sum;
+				const gboolean need_dimensions = (de->match_mask & DUPE_MATCH_DIM) && di->dimensions.empty();
+				const gboolean need_similarity = (de->match_mask & DUPE_MATCH_SIM) && de->new_count > 0 && di->simd < 0;
+
+				if (need_md5sum || (cached && ((staged && !di->md5sum) || need_dimensions || need_similarity)))
+					{
+					dp->jobs.push_back({di, di->fd->path, need_md5sum});
+					}
+				}
+			}
+		return;
+		}
+
+	if (!staged) return;
+
+	for (const std::vector<DupeItem *> &group : dupe_prepass_size_groups(de))
+		{
+		const gboolean small = group.front()->fd->size <= small_size;
+
+		if (dp->stage == DupePrepass::PARTIAL)
+			{
+			/* Small files are read only once, by the next stage */
+			if (small) continue;
+
+			for (DupeItem *di : group)
+				{
+				dp->jobs.push_back({di, di->fd->path, FALSE});
+				}
+			continue;
+			}
+
+		std::unordered_map<std::string, gint> collisions;
+		if (!small)
+			{
+			for (DupeItem *di : group)
+				{
+				const auto partial = partials.find(di);
+				if (partial != partials.end() && !partial->second.empty()) collisions[partial->second]++;
+				}
+			}
+
+		const gsize first_job = dp->jobs.size();
+
+		for (DupeItem *di : group)
+			{
+			if (di->md5sum) continue;
+
+			if (!small)
+				{
+				const auto partial = partials.find(di);
+				if (partial == partials.end() || partial->second.empty() || collisions[partial->second] < 2) continue;
+				}
+
+			dp->jobs.push_back({di, di->fd->path, TRUE});
+			}
+
+		if (!dupe_engine_streams(de)) continue;
+
+		/* Without jobs the checksums of the group are final already */
+		if (dp->jobs.size() == first_job)
+			{
+			dupe_stream_groups(de, group);
+			continue;
+			}
+
+		for (gsize job = first_job; job < dp->jobs.size(); job++)
+			{
+			dp->item_size_groups[dp->jobs[job].di] = dp->size_groups.size();
+			}
+		dp->size_groups.push_back({group, static_cast<gint>(dp->jobs.size() - first_job)});
+		}
+}
+
+/**
+ * @brief Starts the next stage of the pre-pass that has something to do
+ * @param de
+ * @returns FALSE if the pre-pass is done
+ *
+ * The current stage in \a de->prepass must be finished.
+ */
+static gboolean dupe_prepass_next(DupeEngine *de)
+{
+	gint stage = DupePrepass::CACHE;
+	std::unordered_map<DupeItem *, std::string> partials;
+
+	if (de->prepass)
+		{
+		dupe_prepass_apply(de);
+		stage = de->prepass->stage + 1;
+		partials = std::move(de->prepass->partials);
+		dupe_prepass_free(de);
+		}
+
+	for (; stage <= DupePrepass::FULL; stage++)
+		{
+		auto *dp = new DupePrepass();
+		dp->stage = static_cast<DupePrepass::Stage>(stage);
+
+		dupe_prepass_add_jobs(de, dp, partials);
+		if (dp->jobs.empty())
+			{
+			delete dp;
+			continue;
+			}
+
+		gint worker_count = options->threads.duplicates_read > 0 ? options->threads.duplicates_read : get_cpu_cores();
+		worker_count = std::clamp(worker_count, 1, static_cast<gint>(dp->jobs.size()));
+
+		de->prepass = dp;
+
+		dp->workers_running = worker_count;
+		for (gint i = 0; i < worker_count; i++)
+			{
+			g_thread_pool_push(de->dupe_prepass_thread_pool, dp, nullptr);
+			}
+
+		return TRUE;
+		}
+
+	return FALSE;
+}
+
+static void dupe_similarity_loader_free(gpointer data)
+{
+	auto sl = static_cast<DupeSimilarityLoader *>(data);
+
+	image_loader_free(sl->il);
+	delete sl;
+}
+
+/**
+ * @brief Stops and frees all of \a de->sim_loaders
+ * @param de
+ */
+static void dupe_similarity_loaders_free(DupeEngine *de)
+{
+	g_list_free_full(de->sim_loaders, dupe_similarity_loader_free);
+	de->sim_loaders = nullptr;
+}
+
+/**
+ * @brief Stops the check and the adding of files
+ * @param de
+ *
+ * The items added and the matches found so far are kept.
+ */
+void dupe_engine_check_stop(DupeEngine *de)
+{
+	g_clear_handle_id(&de->idle_id, g_source_remove);
+
+	de->abort = TRUE;
+
+	dupe_prepass_free(de);
+	dupe_comparison_free(de);
+	dupe_similarity_index_free(de);
+
+	if (de->add_files_queue_id)
+		{
+		g_clear_handle_id(&de->add_files_queue_id, g_source_remove);
+		dupe_destroy_list_cache(de);
+		if (g_list_length(de->add_files_queue) > 0)
+			{
+			file_data_list_free(de->add_files_queue);
+			}
+		de->add_files_queue = nullptr;
+		if (de->files_func) de->files_func(de, FALSE);
+		}
+
+	dupe_similarity_loaders_free(de);
+}
+
+static void dupe_loader_done_cb(ImageLoader *il, gpointer data)
+{
+	auto sl = static_cast<DupeSimilarityLoader *>(data);
+	DupeEngine *de = sl->de;
+	DupeItem *di = sl->di;
+	GdkPixbuf *pixbuf;
+
+	pixbuf = image_loader_get_pixbuf(il);
+
+	ImageSimilarityData *sd = dupe_item_simd_ensure(de, di);
+
+	if (sd) sd->fill_data(pixbuf);
+
+	if (di->dimensions.empty() && pixbuf)
+		{
+		di->dimensions.width = gdk_pixbuf_get_width(pixbuf);
+		di->dimensions.height = gdk_pixbuf_get_height(pixbuf);
+		}
+	if (options->thumbnails.enable_caching)
+		{
+		dupe_item_write_cache(de, di);
+		}
+
+	if (sd) sd->alternate_processing();
+
+	de->sim_loaders = g_list_remove(de->sim_loaders, sl);
+	dupe_similarity_loader_free(sl);
+
+	if (!de->idle_id) de->idle_id = g_idle_add(dupe_check_cb, de);
+}
+
+/**
+ * @brief Starts reading the similarity data of \a di
+ * @param de
+ * @param di
+ *
+ * Items which cannot be loaded get empty data.
+ */
+static void dupe_similarity_loader_start(DupeEngine *de, DupeItem *di)
+{
+	auto *sl = new DupeSimilarityLoader{de, di, image_loader_new(di->fd)};
+
+	image_loader_set_buffer_size(sl->il, 8);
+	g_signal_connect(G_OBJECT(sl->il), "error", (GCallback)dupe_loader_done_cb, sl);
+	g_signal_connect(G_OBJECT(sl->il), "done", (GCallback)dupe_loader_done_cb, sl);
+
+	if (!image_loader_start(sl->il))
+		{
+		dupe_item_simd_ensure(de, di);
+		dupe_similarity_loader_free(sl);
+		return;
+		}
+
+	de->sim_loaders = g_list_prepend(de->sim_loaders, sl);
+}
+
+static void dupe_setup_reset(DupeEngine *de)
+{
+	de->setup_point = nullptr;
+	de->setup_n = 0;
+	de->setup_time = msec_time();
+	de->setup_time_count = 0;
+}
+
+static GList *dupe_setup_point_step(DupeEngine *de, GList *p)
+{
+	if (!p) return nullptr;
+
+	if (p->next) return p->next;
+
+	if (de->second_set && g_list_first(p) == de->list) return de->second_list;
+
+	return nullptr;
+}
+
+/**
+ * @brief Generates the sumcheck or dimensions_sum
+ * @param de
+ * @returns TRUE/FALSE = not completed/completed
+ *
+ * Ensures that the DIs of both sets contain the MD5SUM or dimensions_sum.
+ * The checksums and cached data are read by the pre-pass workers, whose
+ * results are applied here as they come in. Dimensions not found in the
+ * cache are then read one item at a time. Re-enters if not completed.
+ */
+static gboolean create_checksums_dimensions(DupeEngine *de)
+{
+	static const auto setup_progress = [](const DupeEngine *de)
+	{
+		return (de->setup_count == 0) ? 0.0 : static_cast<gdouble>(de->setup_n - 1) / de->setup_count;
+	};
+
+	/* DUPE_MATCH_SUM in setup_mask marks the pre-pass as done */
+	if (!(de->setup_mask & DUPE_MATCH_SUM))
+		{
+		DupePrepass *dp = de->prepass;
+
+		if (dp)
+			{
+			dupe_prepass_apply(de);
+
+			if (dp->workers_running > 0)
+				{
+				const gboolean md5sum = dp->stage != DupePrepass::CACHE || (!dp->jobs.empty() && dp->jobs.front().md5sum);
+
+				dupe_engine_update_progress(de, md5sum ? _("Reading checksums…") : _("Reading cache…"),
+				                            static_cast<gdouble>(dp->applied) / dp->jobs.size(), FALSE);
+				return TRUE;
+				}
+			}
+
+		if (dupe_prepass_next(de)) return TRUE;
+
+		/* The groups not closed by a size group, e.g. of cached checksums */
+		if (de->streamed)
+			{
+			std::vector<DupeItem *> items;
+			for (GList *work = de->list; work; work = work->next)
+				{
+				items.push_back(static_cast<DupeItem *>(work->data));
+				}
+			dupe_stream_groups(de, items);
+			}
+
+		de->setup_mask = static_cast<DupeMatchType>(de->setup_mask | DUPE_MATCH_SUM);
+		}
+
+	/* DUPE_MATCH_DIM in setup_mask marks the dimensions as read */
+	if ((de->match_mask & DUPE_MATCH_DIM) && !(de->setup_mask & DUPE_MATCH_DIM))
+		{
+		/* Dimensions only */
+		if (!de->setup_point) de->setup_point = de->list;
+
+		while (de->setup_point)
+			{
+			auto di = static_cast<DupeItem *>(de->setup_point->data);
+
+			de->setup_point = dupe_setup_point_step(de, de->setup_point);
+			de->setup_n++;
+			if (di->dimensions.empty())
+				{
+				dupe_engine_update_progress(de, _("Reading dimensions…"), setup_progress(de), FALSE);
+
+				/* The cache was already read by the pre-pass */
+				image_load_dimensions(di->fd, di->dimensions);
+				di->dimensions_sum = (di->dimensions.width << 16) + di->dimensions.height;
+				if (options->thumbnails.enable_caching)
+					{
+					dupe_item_write_cache(de, di);
+					}
+				return TRUE;
+				}
+			}
+		de->setup_mask = static_cast<DupeMatchType>(de->setup_mask | DUPE_MATCH_DIM);
+		dupe_setup_reset(de);
+		}
+
+	return FALSE;
+}
+
+/**
+ * @brief Compare func. for sorting search matches
+ * @param a #DupeSearchMatch
+ * @param b #DupeSearchMatch
+ * @returns
+ *
+ * Used only for similarity checks\n
+ * Sorts search matches on order they were inserted into the pool queue
+ */
+/**
+ * @brief Check set 1 (and set 2) for matches
+ * @param data DupeEngine
+ * @returns TRUE/FALSE = not completed/completed
+ *
+ * Initiated from start, loader done and item remove
+ *
+ * On first entry generates di->MD5SUM, di->dimensions and sim data,
+ * and updates the cache.
+ */
+static gboolean dupe_check_cb(gpointer data)
+{
+	auto de = static_cast<DupeEngine *>(data);
+
+	if (!de->idle_id)
+		{
+		return G_SOURCE_REMOVE;
+		}
+
+	if (!de->setup_done) /* Clear on 1st entry */
+		{
+		if (create_checksums_dimensions(de))
+			{
+			return G_SOURCE_CONTINUE;
+			}
+		/* Without new items there is nothing to compare the similarity of */
+		if ((de->match_mask & DUPE_MATCH_SIM) && de->new_count > 0 &&
+		    !(de->setup_mask & DUPE_MATCH_SIM_MED) )
+			{
+			/* Similarity only */
+			const gint loader_count = options->threads.duplicates > 0 ? options->threads.duplicates : get_cpu_cores();
+
+			if (de->setup_n == 0) de->setup_point = de->list;
+
+			while (de->setup_point && static_cast<gint>(g_list_length(de->sim_loaders)) < loader_count)
+				{
+				auto di = static_cast<DupeItem *>(de->setup_point->data);
+
+				de->setup_point = dupe_setup_point_step(de, de->setup_point);
+				de->setup_n++;
+
+				if (di->simd < 0)
+					{
+					dupe_engine_update_progress(de, _("Reading similarity data…"),
+						de->setup_count == 0 ? 0.0 : static_cast<gdouble>(de->setup_n) / de->setup_count, FALSE);
+
+					/* Cached data was already read by the pre-pass */
+					dupe_similarity_loader_start(de, di);
+					}
+				}
+
+			if (de->setup_point || de->sim_loaders)
+				{
+				/* Continued by dupe_loader_done_cb() */
+				de->idle_id = 0;
+				return G_SOURCE_REMOVE;
+				}
+			de->setup_mask = static_cast<DupeMatchType>(de->setup_mask | DUPE_MATCH_SIM_MED);
+			dupe_setup_reset(de);
+			}
+
+		/* End of setup not done */
+		dupe_engine_update_progress(de, _("Comparing…"), 0.0, FALSE);
+		de->setup_done = TRUE;
+		dupe_setup_reset(de);
+		de->setup_count = g_list_length(de->list);
+
+		if ((de->match_mask & DUPE_MATCH_SIM) && de->new_count > 0) dupe_similarity_data_compact(de);
+
+		if (de->new_count > 0 && dupe_similarity_index_usable(de))
+			{
+			dupe_engine_update_progress(de, _("Building similarity index…"), 0.0, TRUE);
+			de->sim_index = dupe_similarity_index_new(de, de->second_set ? de->second_list : de->list);
+			}
+		}
+
+	/* Setup done - de->working set to NULL below
+	 * Set before 1st entry: de->working = g_list_last(de->list)
+	 * Set before 1st entry: de->setup_count = g_list_length(de->list)
+	 */
+	if (!de->working)
+		{
+		/* Similarity check threads may still be running */
+		if (de->comparison)
+			{
+			DupeComparison *dc = de->comparison;
+
+			if (dc->workers_running > 0)
+				{
+				const gint tiles_done = dc->tiles_done;
+				const gint tile_count = dc->tiles.size();
+				g_autofree gchar *progress_text = g_strdup_printf("%s %d/%d", _("Comparing"), tiles_done, tile_count);
+
+				dupe_engine_update_progress(de, progress_text, static_cast<gdouble>(tiles_done) / tile_count, TRUE);
+
+				return G_SOURCE_CONTINUE;
+				}
+
+			dupe_similarity_index_free(de);
+			dupe_comparison_merge(de, dc);
+			dupe_comparison_free(de);
+			}
+
+		if (de->match_mask & DUPE_MATCH_SIM)
+			{
+			if (dupe_similarity_links_step(de)) return G_SOURCE_CONTINUE;
+
+			de->setup_count = 0;
+			}
+		else if (de->setup_count > 0)
+			{
+			de->setup_count = 0;
+			dupe_engine_update_progress(de, _("Sorting…"), 1.0, TRUE);
+			return G_SOURCE_CONTINUE;
+			}
+
+		de->idle_id = 0;
+		dupe_engine_update_progress(de, nullptr, 0.0, FALSE);
+
+		dupe_match_rank(de);
+
+		dupe_items_set_compared(de->list, TRUE);
+		dupe_items_set_compared(de->second_list, TRUE);
+		if (de->session_path) dupe_engine_session_save(de);
+
+		if (de->group_func && !de->streamed)
+			{
+			for (GList *work = de->dupes; work; work = work->next)
+				{
+				de->group_func(de, static_cast<DupeItem *>(work->data));
+				}
+			}
+
+		if (de->done_func) de->done_func(de);
+
+		return G_SOURCE_REMOVE;
+		/* The end */
+		}
+
+	/* Setup done - working */
+	if (de->match_mask & DUPE_MATCH_SIM)
+		{
+		/* This is the similarity comparison, done by the thread pool */
+		de->working = nullptr;
+		if (de->new_count > 0) dupe_comparison_start(de);
+		}
+	else
+		{
+		/* This is the comparison for all other parameters.
+		 * dupe_array_check() processes the entire list in one go
+		*/
+		de->working = nullptr;
+		dupe_engine_update_progress(de, _("Comparing…"), 0.0, FALSE);
+		dupe_array_check(de);
+		}
+
+	return G_SOURCE_CONTINUE;
+}
+
+/**
+ * @brief Starts the check, or restarts it if one is running
+ * @param de
+ */
+void dupe_engine_check_start(DupeEngine *de)
+{
+	dupe_prepass_free(de);
+	dupe_similarity_loaders_free(de);
+
+	/* Otherwise all pairs are compared again */
+	if (!options->duplicates_incremental && !de->session_path)
+		{
+		dupe_items_set_compared(de->list, FALSE);
+		dupe_items_set_compared(de->second_list, FALSE);
+		}
+
+	dupe_similarity_links_remove_if(de, [](const DupeSearchMatch &match){ return !match.a->compared || !match.b->compared; });
+
+	de->new_count = 0;
+	for (GList *list : {de->list, de->second_set ? de->second_list : nullptr})
+		{
+		for (GList *work = list; work; work = work->next)
+			{
+			if (!static_cast<DupeItem *>(work->data)->compared) de->new_count++;
+			}
+		}
+
+	de->setup_done = FALSE;
+
+	de->setup_count = g_list_length(de->list);
+	if (de->second_set) de->setup_count += g_list_length(de->second_list);
+
+	de->setup_mask = DUPE_MATCH_NONE;
+	dupe_setup_reset(de);
+
+	de->working = g_list_last(de->list);
+
+	/* The groups are reported as they close, so they are all made again */
+	de->streamed = dupe_engine_streams(de);
+	if (de->streamed)
+		{
+		g_clear_pointer(&de->dupes, g_list_free);
+		dupe_match_reset_list(de->list);
+		}
+
+	if (de->start_func) de->start_func(de);
+	de->abort = FALSE;
+
+	if (de->idle_id) return;
+
+	de->idle_id = g_idle_add(dupe_check_cb, de);
+}
+
+static gboolean dupe_check_start_cb(gpointer data)
+{
+	dupe_engine_check_start(static_cast<DupeEngine *>(data));
+
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * ------------------------------------------------------------------
+ * Item addition, removal
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * @brief Removes \a di from its set and from the groups, and frees it
+ * @param de
+ * @param di
+ */
+void dupe_engine_item_remove(DupeEngine *de, DupeItem *di)
+{
+	if (!di) return;
+
+	const auto ungrouped = [de](DupeItem *item)
+	{
+		if (de->ungrouped_func) de->ungrouped_func(de, item);
+	};
+
+	/* The similarity workers may still compare \a di, restarted below */
+	const gboolean comparing = (de->comparison != nullptr);
+	if (comparing)
+		{
+		de->abort = TRUE;
+		dupe_comparison_free(de);
+		dupe_similarity_index_free(de);
+		}
+
+	dupe_similarity_links_remove_if(de, [di](const DupeSearchMatch &match){ return match.a == di || match.b == di; });
+
+	/* handle things that may be in progress… */
+	if (de->working && de->working->data == di)
+		{
+		de->working = de->working->prev;
+		}
+	if (de->prepass)
+		{
+		/* Restarted without \a di on the next check step */
+		dupe_prepass_free(de);
+		}
+	if (de->setup_point && de->setup_point->data == di)
+		{
+		de->setup_point = dupe_setup_point_step(de, de->setup_point);
+		}
+	for (GList *work = de->sim_loaders; work; work = work->next)
+		{
+		auto sl = static_cast<DupeSimilarityLoader *>(work->data);
+
+		if (sl->di == di)
+			{
+			de->sim_loaders = g_list_delete_link(de->sim_loaders, work);
+			dupe_similarity_loader_free(sl);
+			if (!de->idle_id) de->idle_id = g_idle_add(dupe_check_cb, de);
+			break;
+			}
+		}
+
+	if (di->group && de->dupes)
+		{
+		/* is a dupe, must remove from group/reset children if a parent */
+		DupeItem *parent;
+
+		parent = dupe_engine_find_parent(de, di);
+		if (di == parent)
+			{
+			if (g_list_length(parent->group) < 2)
+				{
+				DupeItem *child;
+
+				child = dupe_match_highest_rank(parent);
+				dupe_match_link_clear(child, TRUE);
+				ungrouped(child);
+
+				dupe_match_link_clear(parent, TRUE);
+				ungrouped(parent);
+				de->dupes = g_list_remove(de->dupes, parent);
+				}
+			else
+				{
+				DupeItem *new_parent;
+				DupeMatch *dm;
+
+				dm = static_cast<DupeMatch *>(parent->group->data);
+				new_parent = dm->di;
+				dupe_match_reparent(de, parent, new_parent);
+				ungrouped(parent);
+				}
+			}
+		else
+			{
+			if (g_list_length(parent->group) < 2)
+				{
+				dupe_match_link_clear(parent, TRUE);
+				ungrouped(parent);
+				de->dupes = g_list_remove(de->dupes, parent);
+				}
+			dupe_match_link_clear(di, TRUE);
+			ungrouped(di);
+			}
+		}
+	else
+		{
+		/* not a dupe, or not sorted yet, simply reset */
+		dupe_match_link_clear(di, TRUE);
+		}
+
+	if (de->second_list && g_list_find(de->second_list, di))
+		{
+		de->second_list = g_list_remove(de->second_list, di);
+		}
+	else
+		{
+		de->list = g_list_remove(de->list, di);
+		}
+
+	if (de->removed_func) de->removed_func(de, di);
+	de->simd_arena->remove(di->simd);
+	dupe_item_free(di);
+
+	if (comparing) dupe_engine_check_start(de);
+}
+
+static void dupe_second_add(DupeEngine *de, DupeItem *di)
+{
+	if (!di) return;
+
+	di->second = TRUE;
+	de->second_list = g_list_prepend(de->second_list, di);
+
+	if (de->added_func) de->added_func(de, di);
+}
+
+static gboolean dupe_files_add_queue_cb(gpointer data)
+{
+	auto *de = static_cast<DupeEngine *>(data);
+
+	if (de->progress_func) de->progress_func(de, _("Loading file list"), -1.0);
+
+	if (de->add_files_queue != nullptr)
+		{
+		DupeItem *di = nullptr;
+
+		auto *fd = static_cast<FileData *>(de->add_files_queue->data);
+		if (fd)
+			{
+			if (isfile(fd->path))
+				{
+				di = dupe_item_new(fd);
+				}
+			else if (isdir(fd->path))
+				{
+				GList *f;
+				GList *d;
+				de->add_files_queue = g_list_remove(de->add_files_queue, g_list_first(de->add_files_queue)->data);
+
+				if (filelist_read(fd, &f, &d))
+					{
+					f = filelist_filter(f, FALSE);
+					d = filelist_filter(d, TRUE);
+
+					de->add_files_queue = g_list_concat(f, de->add_files_queue);
+					de->add_files_queue = g_list_concat(d, de->add_files_queue);
+					}
+				}
+			else
+				{
+				/* Not a file and not a dir */
+				de->add_files_queue = g_list_remove(de->add_files_queue, g_list_first(de->add_files_queue)->data);
+				}
+			}
+
+		if (!di)
+			{
+			/* A dir was found. Process the contents on next entry */
+			return G_SOURCE_CONTINUE;
+			}
+
+		de->add_files_queue = g_list_remove(de->add_files_queue, g_list_first(de->add_files_queue)->data);
+
+		/* Ensure images in the lists have unique FileDatas */
+		if (!dupe_insert_in_list_cache(de, di->fd))
+			{
+			dupe_item_free(di);
+			return G_SOURCE_CONTINUE;
+			}
+
+		dupe_item_read_cache(de, di);
+
+		if (de->second_drop)
+			{
+			dupe_second_add(de, di);
+			}
+		else
+			{
+			de->list = g_list_prepend(de->list, di);
+			}
+
+		if (de->add_files_queue != nullptr)
+			{
+			return G_SOURCE_CONTINUE;
+			}
+		}
+
+	de->add_files_queue_id = 0;
+	dupe_destroy_list_cache(de);
+	g_idle_add(dupe_check_start_cb, de);
+	if (de->files_func) de->files_func(de, FALSE);
+	return G_SOURCE_REMOVE;
+}
+
+static void dupe_files_add(DupeEngine *de, CollectInfo *info,
+                           FileData *fd, gboolean recurse)
+{
+	DupeItem *di = nullptr;
+
+	if (info)
+		{
+		di = dupe_item_new(info->fd);
+		}
+	else if (fd)
+		{
+		if (isfile(fd->path) && !g_file_test(fd->path, G_FILE_TEST_IS_SYMLINK))
+			{
+			di = dupe_item_new(fd);
+			}
+		else if (isdir(fd->path) && recurse)
+			{
+			GList *f;
+			GList *d;
+			if (filelist_read(fd, &f, &d))
+				{
+				GList *work;
+
+				f = filelist_filter(f, FALSE);
+				d = filelist_filter(d, TRUE);
+
+				work = f;
+				while (work)
+					{
+					dupe_files_add(de, nullptr, static_cast<FileData *>(work->data), TRUE);
+					work = work->next;
+					}
+				file_data_list_free(f);
+				work = d;
+				while (work)
+					{
+					dupe_files_add(de, nullptr, static_cast<FileData *>(work->data), TRUE);
+					work = work->next;
+					}
+				file_data_list_free(d);
+				}
+			}
+		}
+
+	if (!di) return;
+
+	dupe_item_read_cache(de, di);
+
+	/* Ensure images in the lists have unique FileDatas */
+	GList *work;
+	DupeItem *di_list;
+	work = g_list_first(de->list);
+	while (work)
+		{
+		di_list = static_cast<DupeItem *>(work->data);
+		if (di_list->fd == di->fd)
+			{
+			return;
+			}
+
+		work = work->next;
+		}
+
+	if (de->second_list)
+		{
+		work = g_list_first(de->second_list);
+		while (work)
+			{
+			di_list = static_cast<DupeItem *>(work->data);
+			if (di_list->fd == di->fd)
+				{
+				return;
+				}
+
+			work = work->next;
+			}
+		}
+
+	if (de->second_drop)
+		{
+		dupe_second_add(de, di);
+		}
+	else
+		{
+		de->list = g_list_prepend(de->list, di);
+		}
+}
+
+static void dupe_init_list_cache(DupeEngine *de)
+{
+	de->list_cache = g_hash_table_new(g_direct_hash, g_direct_equal);
+	de->second_list_cache = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	for (GList *i = de->list; i != nullptr; i = i->next)
+		{
+			auto di = static_cast<DupeItem *>(i->data);
+
+			g_hash_table_add(de->list_cache, di->fd);
+		}
+
+	for (GList *i = de->second_list; i != nullptr; i = i->next)
+		{
+			auto di = static_cast<DupeItem *>(i->data);
+
+			g_hash_table_add(de->second_list_cache, di->fd);
+		}
+}
+
+static void dupe_destroy_list_cache(DupeEngine *de)
+{
+	g_hash_table_destroy(de->list_cache);
+	g_hash_table_destroy(de->second_list_cache);
+}
+
+/**
+ * @brief Return true if the fd was not in the cache
+ * @param de
+ * @param fd
+ * @returns
+ *
+ *
+ */
+static gboolean dupe_insert_in_list_cache(DupeEngine *de, FileData *fd)
+{
+	GHashTable *table =
+		de->second_drop ? de->second_list_cache : de->list_cache;
+	/* We do this as a lookup + add as we don't want to overwrite
+	   items as that would leak the old value. */
+	if (g_hash_table_lookup(table, fd) != nullptr)
+		return FALSE;
+	return g_hash_table_add(table, fd);
+}
+
+/**
+ * @brief Adds the items of \a collection and starts the check
+ * @param de
+ * @param collection
+ */
+void dupe_engine_add_collection(DupeEngine *de, CollectionData *collection)
+{
+	CollectInfo *info;
+
+	info = collection_get_first(collection);
+	while (info)
+		{
+		dupe_files_add(de, info, nullptr, FALSE);
+		info = collection_next_by_info(collection, info);
+		}
+
+	dupe_engine_check_start(de);
+}
+
+/**
+ * @brief Queues the files and folders of \a list
+ * @param de
+ * @param list (#FileData)
+ * @param recurse
+ *
+ * The files are added in idle calls, to \a second_list if \a second_drop
+ * is set. The check starts once all of them are added.
+ */
+void dupe_engine_add_files(DupeEngine *de, GList *list, gboolean recurse)
+{
+	GList *work;
+
+	work = list;
+	while (work)
+		{
+		auto fd = static_cast<FileData *>(work->data);
+		work = work->next;
+		if (isdir(fd->path) && !recurse)
+			{
+			GList *f;
+			GList *d;
+
+			if (filelist_read(fd, &f, &d))
+				{
+				GList *work_file;
+				work_file = f;
+
+				while (work_file)
+					{
+					/* Add only the files, ignore the dirs when no recurse */
+					de->add_files_queue = g_list_prepend(de->add_files_queue, work_file->data);
+					file_data_ref((FileData *)work_file->data);
+					work_file = work_file->next;
+					}
+				g_list_free(f);
+				g_list_free(d);
+				}
+			}
+		else
+			{
+			de->add_files_queue = g_list_prepend(de->add_files_queue, fd);
+			file_data_ref(fd);
+			}
+		}
+	if (de->add_files_queue_id == 0)
+		{
+		if (de->progress_func) de->progress_func(de, _("Loading file list"), -1.0);
+
+		dupe_init_list_cache(de);
+		de->add_files_queue_id = g_idle_add(dupe_files_add_queue_cb, de);
+		if (de->files_func) de->files_func(de, TRUE);
+		}
+}
+
+/*
+ * ------------------------------------------------------------------
+ * Session file
+ * ------------------------------------------------------------------
+ */
+
+static DupeSession::Settings dupe_engine_session_settings(const DupeEngine *de)
+{
+	return {de->match_mask, options->duplicates_similarity_threshold,
+	        options->rot_invariant_sim, options->alternate_similarity_algorithm.enabled};
+}
+
+/**
+ * @brief Writes the items and matches of \a de to \a de->session_path
+ * @param de
+ *
+ * Called when a check is complete.
+ */
+static void dupe_engine_session_save(DupeEngine *de)
+{
+	DupeSession session;
+	std::vector<const DupeItem *> items;
+	std::unordered_map<const DupeItem *, gint> indices;
+
+	session.settings = dupe_engine_session_settings(de);
+	session.second_set = de->second_set;
+
+	for (GList *list : {de->list, de->second_list})
+		{
+		for (GList *work = list; work; work = work->next)
+			{
+			auto di = static_cast<const DupeItem *>(work->data);
+
+			indices[di] = items.size();
+			items.push_back(di);
+			session.items.push_back({di->fd->path, di->second, di->fd->size, di->fd->date,
+			                         di->md5sum, di->dimensions, di->compared});
+			}
+		}
+
+	/* The groups of similarity checks are made again from all matches */
+	if (de->match_mask & DUPE_MATCH_SIM)
+		{
+		for (const DupeSearchMatch &match : de->sim_links->matches)
+			{
+			session.links.push_back({indices.at(match.a), indices.at(match.b), match.rank});
+			}
+
+		session.save(de->session_path);
+		return;
+		}
+
+	/* Links are made in both directions, keep one */
+	for (gsize i = 0; i < items.size(); i++)
+		{
+		for (GList *work = items[i]->group; work; work = work->next)
+			{
+			auto dm = static_cast<const DupeMatch *>(work->data);
+			const auto match = indices.find(dm->di);
+
+			if (match != indices.end() && match->second < static_cast<gint>(i))
+				{
+				session.links.push_back({match->second, static_cast<gint>(i), dm->rank});
+				}
+			}
+		}
+
+	session.save(de->session_path);
+}
+
+/**
+ * @brief Restores the items and matches of \a de->session_path
+ * @param de A new engine
+ *
+ * Files which changed since are compared again, files which are gone are
+ * dropped. The matches are only restored if the settings did not change.
+ * A session of two sets turns on \a de->second_set.
+ */
+void dupe_engine_session_load(DupeEngine *de)
+{
+	DupeSession session;
+	if (!session.load(de->session_path)) return;
+
+	if (session.second_set) de->second_set = TRUE;
+
+	const gboolean settings_match = session.settings == dupe_engine_session_settings(de);
+	std::vector<DupeItem *> items(session.items.size(), nullptr);
+
+	for (gsize i = 0; i < session.items.size(); i++)
+		{
+		const DupeSession::Item &item = session.items[i];
+
+		if (item.second && !de->second_set) continue;
+		if (!isfile(item.path.c_str())) continue;
+
+		FileData *fd = file_data_new_no_grouping(item.path.c_str());
+		DupeItem *di = dupe_item_new(fd);
+		file_data_unref(fd);
+
+		if (di->fd->size == item.size && di->fd->date == item.date)
+			{
+			di->md5sum = item.md5sum;
+			di->dimensions = item.dimensions;
+			di->dimensions_sum = (di->dimensions.width << 16) + di->dimensions.height;
+			di->compared = settings_match && item.compared;
+			items[i] = di;
+			}
+
+		if (item.second)
+			{
+			dupe_second_add(de, di);
+			}
+		else
+			{
+			de->list = g_list_prepend(de->list, di);
+			}
+		}
+
+	de->list = g_list_reverse(de->list);
+	de->second_list = g_list_reverse(de->second_list);
+
+	if (!settings_match) return;
+
+	for (const DupeSession::Link &link : session.links)
+		{
+		DupeItem *a = items[link.a];
+		DupeItem *b = items[link.b];
+
+		if (!a || !b) continue;
+
+		if (de->match_mask & DUPE_MATCH_SIM)
+			{
+			de->sim_links->matches.push_back({a, b, link.rank});
+			}
+		else if (!dupe_match_link_exists(a, b))
+			{
+			dupe_match_link(a, b, link.rank);
+			}
+		}
+}
+
+/*
+ * ------------------------------------------------------------------
+ * Engine
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * @brief Removes all items of set 1
+ * @param de
+ *
+ * The check must be stopped.
+ */
+void dupe_engine_clear(DupeEngine *de)
+{
+	g_list_free(de->dupes);
+	de->dupes = nullptr;
+
+	dupe_items_simd_release(de, de->list);
+	g_list_free_full(de->list, reinterpret_cast<GDestroyNotify>(dupe_item_free));
+	de->list = nullptr;
+	de->sim_links->matches.clear();
+
+	/* The items of the second set still use the arena */
+	if (!de->second_list) de->simd_arena->clear();
+
+	dupe_match_reset_list(de->second_list);
+}
+
+/**
+ * @brief Removes all items of set 2
+ * @param de
+ *
+ * The check must be stopped.
+ */
+void dupe_engine_second_clear(DupeEngine *de)
+{
+	g_list_free(de->dupes);
+	de->dupes = nullptr;
+
+	dupe_similarity_links_remove_if(de, [](const DupeSearchMatch &match){ return match.a->second || match.b->second; });
+	dupe_items_simd_release(de, de->second_list);
+	g_list_free_full(de->second_list, reinterpret_cast<GDestroyNotify>(dupe_item_free));
+	de->second_list = nullptr;
+
+	if (!de->list) de->simd_arena->clear();
+
+	dupe_match_reset_list(de->list);
+}
+
+/**
+ * @brief Drops all matches and compares all items again
+ * @param de
+ */
+void dupe_engine_recompare(DupeEngine *de)
+{
+	dupe_engine_check_stop(de);
+
+	g_list_free(de->dupes);
+	de->dupes = nullptr;
+
+	dupe_match_reset_list(de->list);
+	dupe_match_reset_list(de->second_list);
+	dupe_items_set_compared(de->list, FALSE);
+	dupe_items_set_compared(de->second_list, FALSE);
+
+	dupe_engine_check_start(de);
+}
+
+/**
+ * @brief Creates an engine without items
+ * @param match_mask The things to check for a match
+ * @returns
+ *
+ * Set the callbacks before adding files. Free it with dupe_engine_free().
+ */
+DupeEngine *dupe_engine_new(DupeMatchType match_mask)
+{
+	auto *de = new DupeEngine();
+
+	de->match_mask = match_mask;
+
+	de->simd_arena = new ImageSimilarityArena();
+	de->sim_links = new DupeSimilarityLinks();
+
+	de->dupe_comparison_thread_pool = g_thread_pool_new(dupe_comparison_func, de, options->threads.duplicates, FALSE, nullptr);
+	de->dupe_prepass_thread_pool = g_thread_pool_new(dupe_prepass_func, de, options->threads.duplicates_read, FALSE, nullptr);
+
+	return de;
+}
+
+/**
+ * @brief Stops the check and frees \a de with all its items
+ * @param de
+ *
+ * No callback is called.
+ */
+void dupe_engine_free(DupeEngine *de)
+{
+	if (!de) return;
+
+	de->files_func = nullptr;
+	dupe_engine_check_stop(de);
+
+	g_list_free(de->dupes);
+	g_list_free_full(de->list, reinterpret_cast<GDestroyNotify>(dupe_item_free));
+	g_list_free_full(de->second_list, reinterpret_cast<GDestroyNotify>(dupe_item_free));
+
+	g_thread_pool_free(de->dupe_comparison_thread_pool, TRUE, TRUE);
+	g_thread_pool_free(de->dupe_prepass_thread_pool, TRUE, TRUE);
+
+	delete de->simd_arena;
+	delete de->sim_links;
+
+	g_free(de->session_path);
+	delete de;
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2004 John Ellis
+ * Copyright (C) 2008 - 2016 The Geeqie Team
+ *
+ * Author: John Ellis
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DUPE_ENGINE_H
+#define DUPE_ENGINE_H
+
+#include <functional>
+#include <optional>
+#include <string>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib.h>
+
+#include "geometry.h"
+
+struct CollectInfo;
+struct CollectionData;
+struct DupeComparison;
+struct DupePrepass;
+struct DupeSimilarityIndex;
+struct DupeSimilarityLinks;
+class FileData;
+class ImageSimilarityArena;
+struct ImageSimilarityData;
+
+/** @enum DupeMatchType
+ *  match methods
+ */
+enum DupeMatchType
+{
+	DUPE_MATCH_NONE = 0,
+	DUPE_MATCH_NAME = 1 << 0,
+	DUPE_MATCH_SIZE = 1 << 1,
+	DUPE_MATCH_DATE = 1 << 2,
+	DUPE_MATCH_DIM  = 1 << 3,	/**< image dimensions */
+	DUPE_MATCH_SUM  = 1 << 4,	/**< MD5sum */
+	DUPE_MATCH_PATH = 1 << 5,
+	DUPE_MATCH_SIM_HIGH = 1 << 6,	/**< similarity */
+	DUPE_MATCH_SIM_MED  = 1 << 7,
+	DUPE_MATCH_SIM_LOW  = 1 << 8,
+	DUPE_MATCH_SIM_CUSTOM = 1 << 9,
+	DUPE_MATCH_SIM = DUPE_MATCH_SIM_HIGH | DUPE_MATCH_SIM_MED | DUPE_MATCH_SIM_LOW | DUPE_MATCH_SIM_CUSTOM,
+	DUPE_MATCH_NAME_CI = 1 << 10,	/**< same as name, but case insensitive */
+	DUPE_MATCH_NAME_CONTENT = 1 << 11,	/**< same name, but different content */
+	DUPE_MATCH_NAME_CI_CONTENT = 1 << 12,	/**< same name - case insensitive, but different content */
+	DUPE_MATCH_ALL = 1 << 13 /**< N.B. this is used as a clamp value in rcfile.cc */
+};
+
+struct DupeItem
+{
+	CollectionData *collection;	/**< NULL if from #DupeEngine->files */
+	CollectInfo *info;
+
+	FileData *fd;
+
+	std::optional<std::string> md5sum;
+	GqSize dimensions;
+	gint dimensions_sum; /**< Computed as (#DupeItem->dimensions.width << 16) + #DupeItem->dimensions.height */
+
+	gint simd; /**< Index of the similarity data in #DupeEngine->simd_arena, -1 if not generated */
+
+	GdkPixbuf *pixbuf; /**< thumb */
+
+	GList *group;		/**< List of match data (#DupeMatch) */
+	gdouble group_rank;	/**< (sum of all child ranks) / n */
+
+	gint second;
+
+	gboolean compared; /**< Compared with all other items by the last complete check */
+};
+
+struct DupeMatch
+{
+	DupeItem *di;
+	gdouble rank;
+};
+
+/**
+ * @brief The file sets, the checks and their results, without any widgets
+ *
+ * Used by the Find duplicates window and by the command line duplicate
+ * finder. The check runs in idle callbacks of the main loop and in the
+ * thread pools; the owner follows it through the callbacks, all of which
+ * may be empty.
+ */
+struct DupeEngine
+{
+	using Func = std::function<void(DupeEngine *)>;
+	using ItemFunc = std::function<void(DupeEngine *, DupeItem *)>;
+	using FilesFunc = std::function<void(DupeEngine *, gboolean adding)>;
+	using ProgressFunc = std::function<void(DupeEngine *, const gchar *text, gdouble fraction)>;
+
+	GList *list = nullptr;	/**< one entry for each dropped file in 1st set window (#DupeItem) */
+	GList *dupes = nullptr;			/**< list of dupes (#DupeItem, grouping the #DupeMatch-es) */
+	DupeMatchType match_mask = DUPE_MATCH_NAME;	/**< mask of things to check for match */
+
+	GList *add_files_queue = nullptr;
+	guint add_files_queue_id = 0;
+	GHashTable *list_cache = nullptr; /**< Caches the #DupeItem-s of all items in list. Used when ensuring #FileData-s are unique */
+	GHashTable *second_list_cache = nullptr; /**< Caches the #DupeItem-s of all items in second_list. Used when ensuring #FileData-s are unique */
+
+	guint idle_id = 0; /**< event source id */
+	GList *working = nullptr;
+	gint setup_done = FALSE; /**< Boolean. Set TRUE when all checksums/dimensions/similarity data have been read or created */
+	gint setup_count = 0; /**< length of set1 or if 2 sets, total length of both */
+	gint setup_n = 0;			/**< Set to zero on start/reset. These are merely for speed optimization */
+	GList *setup_point = nullptr;		/**< these are merely for speed optimization */
+	DupeMatchType setup_mask = DUPE_MATCH_NONE;	/**< these are merely for speed optimization */
+	guint64 setup_time = 0; /**< Time in µsec since Epoch, restored at each phase of operation */
+	guint64 setup_time_count = 0; /**< Time in µsec since time-to-go status display was updated */
+
+	GList *sim_loaders = nullptr; /**< #DupeSimilarityLoader-s reading similarity data, one per thread */
+
+	gint new_count = 0; /**< Items not #DupeItem->compared at the start of the check */
+	gchar *session_path = nullptr; /**< Session file the results are kept in, NULL if none */
+	gboolean streamed = FALSE; /**< The groups of the current check are reported while the checksums are read */
+
+	/* second set comparison stuff */
+
+	gboolean second_set = FALSE;		/**< second set enabled ? */
+	GList *second_list = nullptr;		/**< second set dropped files */
+	gboolean second_drop = FALSE;		/**< drop is on second set */
+
+	/* required for checksum threads */
+	GThreadPool *dupe_prepass_thread_pool = nullptr;
+	DupePrepass *prepass = nullptr; /**< Checksum and cache pre-pass run by the thread pool, NULL if none */
+
+	/* required for similarity threads */
+	GThreadPool *dupe_comparison_thread_pool = nullptr;
+	DupeComparison *comparison = nullptr; /**< Similarity check run by the thread pool, NULL if none */
+	gboolean abort = FALSE; /**< Stop the similarity check workers */
+	DupeSimilarityIndex *sim_index = nullptr; /**< Candidates for similarity checks, NULL if not used */
+	ImageSimilarityArena *simd_arena = nullptr; /**< Similarity data of all items in \a list and \a second_list */
+	DupeSimilarityLinks *sim_links = nullptr; /**< Similarity matches found by the checks, before the groups are trimmed */
+
+	/* callbacks of the owner */
+
+	ProgressFunc progress_func; /**< \a text NULL clears the progress, \a fraction < 0 pulses */
+	FilesFunc files_func; /**< Adding the queued files starts or ends */
+	Func start_func; /**< A check starts */
+	ItemFunc added_func; /**< An item was added to the second set */
+	ItemFunc ungrouped_func; /**< An item left #DupeEngine->dupes or a group of it */
+	ItemFunc removed_func; /**< An item is removed from its set, it is freed afterwards */
+	ItemFunc group_func; /**< A group of duplicates is final, see dupe_engine_streams() */
+	Func done_func; /**< A check is complete, \a dupes holds the groups */
+};
+
+DupeEngine *dupe_engine_new(DupeMatchType match_mask);
+void dupe_engine_free(DupeEngine *de);
+
+void dupe_engine_add_collection(DupeEngine *de, CollectionData *collection);
+void dupe_engine_add_files(DupeEngine *de, GList *list, gboolean recurse);
+
+void dupe_engine_check_start(DupeEngine *de);
+void dupe_engine_check_stop(DupeEngine *de);
+gboolean dupe_engine_streams(const DupeEngine *de);
+
+void dupe_engine_item_remove(DupeEngine *de, DupeItem *di);
+void dupe_engine_clear(DupeEngine *de);
+void dupe_engine_second_clear(DupeEngine *de);
+void dupe_engine_recompare(DupeEngine *de);
+
+void dupe_engine_session_load(DupeEngine *de);
+
+DupeItem *dupe_engine_find_parent(DupeEngine *de, DupeItem *child);
+ImageSimilarityData *dupe_engine_item_simd(DupeEngine *de, const DupeItem *di);
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
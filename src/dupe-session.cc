@@ -0,0 +1,244 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "dupe-session.h"
+
+#include <cstring>
+
+#include "debug.h"
+#include "main-defines.h"
+#include "ui-fileops.h"
+
+/**
+ * @file
+ *-------------------------------------------------------------------
+ * Duplicates session file format:
+ *-------------------------------------------------------------------
+ *
+ * A text file, one entry per line:
+ *
+ * #Geeqie duplicates session 1\n
+ * settings <match mask> <threshold> <rotation invariant> <alternate>\n
+ * second_set <0|1>\n
+ * item <set 1|2> <size> <date> <md5sum|-> <width> <height> <compared 0|1> <path>\n
+ * link <item> <item> <rank>\n
+ *
+ * Items are numbered from 0 in the order of the file, a link refers to
+ * items before it. The path is the rest of the line, escaped with
+ * g_strescape(). Unknown lines are ignored.
+ */
+
+namespace
+{
+
+constexpr gchar DUPE_SESSION_MARKER[] = "#" GQ_APPNAME " duplicates session";
+constexpr gint DUPE_SESSION_VERSION = 1;
+
+/**
+ * @brief Reads the next field of a line
+ * @param[in,out] p Moved behind the field and the following space
+ * @returns The field, or an empty string at the end of the line
+ */
+std::string dupe_session_field(const gchar *&p)
+{
+	const gchar *end = strchr(p, ' ');
+	if (!end) end = p + strlen(p);
+
+	std::string field(p, end - p);
+	p = *end ? end + 1 : end;
+
+	return field;
+}
+
+gint64 dupe_session_int(const gchar *&p, gboolean &valid)
+{
+	const std::string field = dupe_session_field(p);
+	gchar *end;
+
+	const gint64 value = g_ascii_strtoll(field.c_str(), &end, 10);
+	if (field.empty() || *end) valid = FALSE;
+
+	return value;
+}
+
+gboolean dupe_session_parse_item(const gchar *p, DupeSession::Item &item)
+{
+	gboolean valid = TRUE;
+
+	item.second = dupe_session_int(p, valid) == 2;
+	item.size = dupe_session_int(p, valid);
+	item.date = dupe_session_int(p, valid);
+
+	const std::string md5sum = dupe_session_field(p);
+	if (md5sum != "-") item.md5sum = md5sum;
+
+	item.dimensions.width = dupe_session_int(p, valid);
+	item.dimensions.height = dupe_session_int(p, valid);
+	item.compared = dupe_session_int(p, valid) != 0;
+
+	if (!valid || !*p) return FALSE;
+
+	g_autofree gchar *path = g_strcompress(p);
+	item.path = path;
+
+	return TRUE;
+}
+
+gboolean dupe_session_parse_link(const gchar *p, gint item_count, DupeSession::Link &link)
+{
+	gboolean valid = TRUE;
+
+	link.a = dupe_session_int(p, valid);
+	link.b = dupe_session_int(p, valid);
+
+	gchar *end;
+	link.rank = g_ascii_strtod(p, &end);
+
+	return valid && end != p
+	    && link.a >= 0 && link.a < item_count
+	    && link.b >= 0 && link.b < item_count
+	    && link.a != link.b;
+}
+
+} // namespace
+
+/**
+ * @brief Reads a session file
+ * @param path In UTF-8
+ * @returns FALSE if the file cannot be read or is not a session file
+ */
+gboolean DupeSession::load(const gchar *path)
+{
+	g_autofree gchar *pathl = path_from_utf8(path);
+	g_autofree gchar *contents = nullptr;
+	gsize length;
+
+	if (!g_file_get_contents(pathl, &contents, &length, nullptr)) return FALSE;
+
+	g_autofree gchar *marker = g_strdup_printf("%s %d\n", DUPE_SESSION_MARKER, DUPE_SESSION_VERSION);
+	if (!g_str_has_prefix(contents, marker))
+		{
+		log_printf("Not a duplicates session file: \"%s\"\n", path);
+		return FALSE;
+		}
+
+	items.clear();
+	links.clear();
+
+	gchar *line = contents + strlen(marker);
+	while (*line)
+		{
+		gchar *next = strchr(line, '\n');
+		if (next)
+			{
+			*next = '\0';
+			next++;
+			}
+		else
+			{
+			next = line + strlen(line);
+			}
+
+		const gchar *p = line;
+		const std::string keyword = dupe_session_field(p);
+		gboolean valid = TRUE;
+
+		if (keyword == "item")
+			{
+			Item item{};
+			if (dupe_session_parse_item(p, item))
+				{
+				items.push_back(std::move(item));
+				}
+			else
+				{
+				/* Keep the numbering of the following items */
+				log_printf("Invalid item in duplicates session file: \"%s\"\n", path);
+				return FALSE;
+				}
+			}
+		else if (keyword == "link")
+			{
+			Link link;
+			if (dupe_session_parse_link(p, items.size(), link)) links.push_back(link);
+			}
+		else if (keyword == "settings")
+			{
+			settings.match_mask = dupe_session_int(p, valid);
+			settings.threshold = dupe_session_int(p, valid);
+			settings.rotation_invariant = dupe_session_int(p, valid) != 0;
+			settings.alternate = dupe_session_int(p, valid) != 0;
+
+			/* No window uses DUPE_MATCH_NONE, so the matches are not used */
+			if (!valid) settings = {};
+			}
+		else if (keyword == "second_set")
+			{
+			second_set = dupe_session_int(p, valid) == 1;
+			}
+
+		line = next;
+		}
+
+	DEBUG_1("duplicates session %s: %zu items, %zu links", path, items.size(), links.size());
+
+	return TRUE;
+}
+
+/**
+ * @brief Writes the session file, replacing it atomically
+ * @param path In UTF-8
+ * @returns TRUE on success
+ */
+gboolean DupeSession::save(const gchar *path) const
+{
+	g_autoptr(GString) text = g_string_new(nullptr);
+
+	g_string_append_printf(text, "%s %d\n", DUPE_SESSION_MARKER, DUPE_SESSION_VERSION);
+	g_string_append_printf(text, "settings %u %u %d %d\n", settings.match_mask, settings.threshold,
+	                       settings.rotation_invariant ? 1 : 0, settings.alternate ? 1 : 0);
+	g_string_append_printf(text, "second_set %d\n", second_set ? 1 : 0);
+
+	for (const Item &item : items)
+		{
+		g_autofree gchar *escaped = g_strescape(item.path.c_str(), nullptr);
+
+		g_string_append_printf(text, "item %d %" G_GINT64_FORMAT " %" G_GINT64_FORMAT " %s %d %d %d %s\n",
+		                       item.second ? 2 : 1, item.size, static_cast<gint64>(item.date),
+		                       (item.md5sum && !item.md5sum->empty()) ? item.md5sum->c_str() : "-",
+		                       item.dimensions.width, item.dimensions.height,
+		                       item.compared ? 1 : 0, escaped);
+		}
+
+	for (const Link &link : links)
+		{
+		gchar rank[G_ASCII_DTOSTR_BUF_SIZE];
+
+		g_string_append_printf(text, "link %d %d %s\n", link.a, link.b, g_ascii_dtostr(rank, sizeof(rank), link.rank));
+		}
+
+	g_autofree gchar *pathl = path_from_utf8(path);
+	if (!secure_save(pathl, text->str, text->len))
+		{
+		log_printf("Failed to save duplicates session file: \"%s\"\n", path);
+		return FALSE;
+		}
+
+	return TRUE;
+}
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DUPE_SESSION_H
+#define DUPE_SESSION_H
+
+#include <ctime>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <glib.h>
+
+#include "geometry.h"
+
+/**
+ * @brief State of a Find duplicates window, kept in a session file
+ *
+ * Holds the files of both sets with the data read for them, and the matches
+ * found. A window restored from it only compares the files added since.
+ */
+struct DupeSession
+{
+	/** Settings the matches depend on */
+	struct Settings
+	{
+		guint match_mask;
+		guint threshold; /**< options->duplicates_similarity_threshold */
+		gboolean rotation_invariant;
+		gboolean alternate; /**< options->alternate_similarity_algorithm.enabled */
+
+		bool operator==(const Settings &other) const
+		{
+			return match_mask == other.match_mask
+			    && threshold == other.threshold
+			    && rotation_invariant == other.rotation_invariant
+			    && alternate == other.alternate;
+		}
+	};
+
+	struct Item
+	{
+		std::string path; /**< UTF-8 */
+		gboolean second; /**< in set 2 */
+		gint64 size;
+		time_t date;
+		std::optional<std::string> md5sum;
+		GqSize dimensions;
+		gboolean compared; /**< see #DupeItem->compared */
+	};
+
+	/** Match between two #DupeSession->items */
+	struct Link
+	{
+		gint a;
+		gint b;
+		gdouble rank;
+	};
+
+	Settings settings{};
+	gboolean second_set = FALSE;
+	std::vector<Item> items;
+	std::vector<Link> links;
+
+	gboolean load(const gchar *path);
+	gboolean save(const gchar *path) const;
+};
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -21,12 +21,12 @@
 
 #include "dupe.h"
 
+#include <algorithm>
 #include <array>
-#include <chrono>
 #include <cinttypes>
 #include <cmath>
 #include <cstdlib>
-#include <cstring>
+#include <string>
 
 #include <gdk/gdk.h>
 #include <gio/gio.h>
@@ -39,14 +39,12 @@
 #include "dnd.h"
 #include "filedata.h"
 #include "history-list.h"
-#include "image-load.h"
 #include "img-view.h"
 #include "intl.h"
 #include "layout-image.h"
 #include "layout-util.h"
 #include "layout.h"
 #include "main-defines.h"
-#include "md5-util.h"
 #include "menu.h"
 #include "misc.h"
 #include "options.h"
@@ -83,33 +81,6 @@ enum {
 	DUPE_COLUMN_COUNT	/**< total columns */
 };
 
-enum DUPE_CHECK_RESULT {
-	DUPE_MATCH = 0,
-	DUPE_NO_MATCH,
-	DUPE_NAME_MATCH
-};
-
-/** Used for similarity checks. One for each item pushed
- * onto the thread pool.
- */
-struct DupeQueueItem
-{
-	DupeItem *needle;
-	DupeWindow *dw;
-	GList *work; /**< pointer into \a dw->list or \a dw->second_list (#DupeItem) */
-	gint index; /**< The order items pushed onto thread pool. Used to sort returned matches */
-};
-
-/** Used for similarity checks thread. One for each pair match found.
- */
-struct DupeSearchMatch
-{
-	DupeItem *a; /**< \a a / \a b matched pair found */
-	DupeItem *b; /**< \a a / \a b matched pair found */
-	gdouble rank;
-	gint index; /**< The order items pushed onto thread pool. Used to sort returned matches */
-};
-
 constexpr gint DUPE_DEF_WIDTH = 800;
 constexpr gint DUPE_DEF_HEIGHT = 400;
 
@@ -127,26 +98,16 @@ constexpr std::array<GtkTargetEntry, 2> dupe_drop_types{{
 }};
 #endif
 
-DupeMatchType param_match_mask;
 GList *dupe_window_list = nullptr;	/**< list of open DupeWindow *s */
 
 } // namespace
 
-/*
- * Well, after adding the 'compare two sets' option things got a little sloppy in here
- * because we have to account for two 'modes' everywhere. (be careful).
- */
-
-static void dupe_match_unlink(DupeItem *a, DupeItem *b);
-static DupeItem *dupe_match_find_parent(DupeWindow *dw, DupeItem *child);
+static void dupe_thumb_step(DupeWindow *dw);
 
-static gint dupe_match(DupeItem *a, DupeItem *b, DupeMatchType mask, gdouble *rank, gint fast);
+static void dupe_second_update_status(DupeWindow *dw);
 
-static void dupe_thumb_step(DupeWindow *dw);
-static gint dupe_check_cb(gpointer data);
+static void dupe_second_set_toggle_cb(GtkWidget *widget, gpointer data);
 
-static void dupe_second_add(DupeWindow *dw, DupeItem *di);
-static void dupe_second_remove(DupeWindow *dw, DupeItem *di);
 static GtkWidget *dupe_menu_popup_second(DupeWindow *dw, DupeItem *di);
 
 static void dupe_dnd_init(DupeWindow *dw);
@@ -155,13 +116,6 @@ static void dupe_notify_cb(FileData *fd, NotifyType type, gpointer data);
 
 static void submenu_add_export(GtkWidget *menu, gboolean sensitive, gpointer data);
 
-static void dupe_init_list_cache(DupeWindow *dw);
-static void dupe_destroy_list_cache(DupeWindow *dw);
-static gboolean dupe_insert_in_list_cache(DupeWindow *dw, FileData *fd);
-
-static void dupe_match_link(DupeItem *a, DupeItem *b, gdouble rank);
-static gint dupe_match_link_exists(DupeItem *child, DupeItem *parent);
-
 /**
  * This array must be kept in sync with the contents of:\n
  *  @link dupe_window_keypress_cb() @endlink \n
@@ -190,70 +144,6 @@ static HardcodedWindowKeyList dupe_window_keys{
 	{static_cast<GdkModifierType>(0), '2', N_("Select group 2 duplicates")},
 };
 
-/**
- * @brief The function run in threads for similarity checks
- * @param d1 #DupeQueueItem
- * @param d2 #DupeWindow
- *
- * Used only for similarity checks.\n
- * Search \a dqi->list for \a dqi->needle and if a match is
- * found, create a #DupeSearchMatch and add to \a dw->search_matches list\n
- * If \a dw->abort is set, just increment \a dw->thread_count
- */
-static void dupe_comparison_func(gpointer d1, gpointer d2)
-{
-	auto dqi = static_cast<DupeQueueItem *>(d1);
-	auto dw = static_cast<DupeWindow *>(d2);
-	DupeSearchMatch *dsm;
-	DupeItem *di;
-	GList *matches = nullptr;
-	gdouble rank = 0;
-
-	if (!dw->abort)
-		{
-		GList *work = dqi->work;
-		while (work)
-			{
-			di = static_cast<DupeItem *>(work->data);
-
-			/* forward for second set, back for simple compare */
-			if (dw->second_set)
-				{
-				work = work->next;
-				}
-			else
-				{
-				work = work->prev;
-				}
-
-			if (dupe_match(di, dqi->needle, dqi->dw->match_mask, &rank, TRUE))
-				{
-				dsm = g_new0(DupeSearchMatch, 1);
-				dsm->a = di;
-				dsm->b = dqi->needle;
-				dsm->rank = rank;
-				matches = g_list_prepend(matches, dsm);
-				dsm->index = dqi->index;
-				}
-
-			if (dw->abort)
-				{
-				break;
-				}
-			}
-
-		matches = g_list_reverse(matches);
-		g_mutex_lock(&dw->search_matches_mutex);
-		dw->search_matches = g_list_concat(dw->search_matches, matches);
-		g_mutex_unlock(&dw->search_matches_mutex);
-		}
-
-	g_mutex_lock(&dw->thread_count_mutex);
-	dw->thread_count++;
-	g_mutex_unlock(&dw->thread_count_mutex);
-	g_free(dqi);
-}
-
 /*
  * ------------------------------------------------------------------
  * Window updates
@@ -271,20 +161,20 @@ static void dupe_window_update_count(DupeWindow *dw, gboolean count_only)
 {
 	g_autofree gchar *text = nullptr;
 
-	if (!dw->list)
+	if (!dw->engine->list)
 		{
 		text = g_strdup(_("Drop files to compare them."));
 		}
 	else if (count_only)
 		{
-		text = g_strdup_printf(_("%d files"), g_list_length(dw->list));
+		text = g_strdup_printf(_("%d files"), g_list_length(dw->engine->list));
 		}
 	else
 		{
-		text = g_strdup_printf(_("%d matches found in %d files"), g_list_length(dw->dupes), g_list_length(dw->list));
+		text = g_strdup_printf(_("%d matches found in %d files"), g_list_length(dw->engine->dupes), g_list_length(dw->engine->list));
 		}
 
-	if (dw->second_set)
+	if (dw->engine->second_set)
 		{
 		g_autofree gchar *buf = g_strconcat(text, " ", _("[set 1]"), NULL);
 		std::swap(text, buf);
@@ -294,112 +184,34 @@ static void dupe_window_update_count(DupeWindow *dw, gboolean count_only)
 }
 
 /**
- * @brief Returns time in µsec since Epoch
- * @returns
- *
- *
- */
-static guint64 msec_time()
-{
-	const auto duration = std::chrono::system_clock::now().time_since_epoch();
-
-	return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
-}
-
-static gint dupe_iterations(gint n)
-{
-	return (n * ((n + 1) / 2));
-}
-
-/**
- * @brief
+ * @brief Update display of the progress bar
  * @param dw
- * @param status
- * @param value
- * @param force
+ * @param status NULL clears the progress
+ * @param value < 0 pulses the progress bar
+ *
  *
- * If \a status is blank, clear status bar text and set progress to zero. \n
- * If \a force is not set, after 2 secs has elapsed, update time-to-go every 250 ms.
  */
-static void dupe_window_update_progress(DupeWindow *dw, const gchar *status, gdouble value, gboolean force)
+static void dupe_window_update_progress(DupeWindow *dw, const gchar *status, gdouble value)
 {
-	const gchar *status_text;
-
-	if (status)
+	if (!status)
 		{
-		guint64 new_time = 0;
-
-		if (dw->setup_n % 10 == 0)
-			{
-			new_time = msec_time() - dw->setup_time;
-			}
-
-		if (!force &&
-		    value != 0.0 &&
-		    dw->setup_count > 0 &&
-		    new_time > 2000000)
-			{
-			gint t;
-			gint d;
-			guint32 rem;
-
-			if (new_time - dw->setup_time_count < 250000) return;
-			dw->setup_time_count = new_time;
-
-			if (dw->setup_done)
-				{
-				if (dw->second_set)
-					{
-					t = dw->setup_count;
-					d = dw->setup_count - dw->setup_n;
-					}
-				else
-					{
-					t = dupe_iterations(dw->setup_count);
-					d = dupe_iterations(dw->setup_count - dw->setup_n);
-					}
-				}
-			else
-				{
-				t = dw->setup_count;
-				d = dw->setup_count - dw->setup_n;
-				}
-
-			rem = (t - d) ? (static_cast<gdouble>(dw->setup_time_count / 1000000.0) / (t - d)) * d : 0;
-
-			gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(dw->extra_label), value);
-
-			g_autofree gchar *buf = g_strdup_printf("%s %d:%02d ", status, rem / 60, rem % 60);
-			gtk_progress_bar_set_text(GTK_PROGRESS_BAR(dw->extra_label), buf);
-
-			return;
-			}
+		gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(dw->extra_label), 0.0);
+		gtk_progress_bar_set_text(GTK_PROGRESS_BAR(dw->extra_label), " ");
+		return;
+		}
 
-		if (force ||
-			 value == 0.0 ||
-			 dw->setup_count == 0 ||
-			 dw->setup_time_count == 0 ||
-			 (new_time > 0 && new_time - dw->setup_time_count >= 250000))
-			{
-			if (dw->setup_time_count == 0) dw->setup_time_count = 1;
-			if (new_time > 0) dw->setup_time_count = new_time;
-			gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(dw->extra_label), value);
-			status_text = status;
-			}
-		else
-			{
-			status_text = nullptr;
-			}
+	if (value < 0.0)
+		{
+		gtk_progress_bar_pulse(GTK_PROGRESS_BAR(dw->extra_label));
 		}
 	else
 		{
-		gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(dw->extra_label), 0.0);
-		status_text = " ";
+		gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(dw->extra_label), value);
 		}
-
-	if (status_text) gtk_progress_bar_set_text(GTK_PROGRESS_BAR(dw->extra_label), status_text);
+	gtk_progress_bar_set_text(GTK_PROGRESS_BAR(dw->extra_label), status);
 }
 
+
 /*
  * ------------------------------------------------------------------
  * row color utils
@@ -422,7 +234,7 @@ static void dupe_listview_realign_colors(DupeWindow *dw)
 		DupeItem *child_parent;
 
 		gtk_tree_model_get(store, &iter, DUPE_COLUMN_POINTER, &child, -1);
-		child_parent = dupe_match_find_parent(dw, child);
+		child_parent = dupe_engine_find_parent(dw->engine, child);
 		if (!parent || parent != child_parent)
 			{
 			if (!parent)
@@ -434,7 +246,7 @@ static void dupe_listview_realign_colors(DupeWindow *dw)
 				{
 				color_set = !color_set;
 				}
-			parent = dupe_match_find_parent(dw, child);
+			parent = dupe_engine_find_parent(dw->engine, child);
 			}
 		gtk_list_store_set(GTK_LIST_STORE(store), &iter, DUPE_COLUMN_COLOR, color_set, -1);
 
@@ -442,77 +254,6 @@ static void dupe_listview_realign_colors(DupeWindow *dw)
 		}
 }
 
-/*
- * ------------------------------------------------------------------
- * Dupe item utils
- * ------------------------------------------------------------------
- */
-
-static DupeItem *dupe_item_new(FileData *fd)
-{
-	auto *di = new DupeItem();
-
-	di->fd = file_data_ref(fd);
-	di->group_rank = 0.0;
-
-	return di;
-}
-
-static void dupe_item_free(DupeItem *di)
-{
-	file_data_unref(di->fd);
-	if (di->pixbuf) g_object_unref(di->pixbuf);
-
-	delete di;
-}
-
-/*
- * ------------------------------------------------------------------
- * Image property cache
- * ------------------------------------------------------------------
- */
-
-static void dupe_item_read_cache(DupeItem *di)
-{
-	if (!di) return;
-
-	CacheData cd{};
-	if (!cd.load(di->fd->path)) return;
-
-	if (!di->simd && cd.similarity)
-		{
-		di->simd.swap(cd.similarity);
-		}
-
-	if (di->dimensions.empty() && cd.dimensions)
-		{
-		di->dimensions = cd.dimensions.value();
-		di->dimensions_sum = (di->dimensions.width << 16) + di->dimensions.height;
-		}
-
-	if (!di->md5sum && cd.md5sum)
-		{
-		di->md5sum = md5_digest_to_text(cd.md5sum.value());
-		}
-}
-
-static void dupe_item_write_cache(DupeItem *di)
-{
-	if (!di) return;
-
-	CacheData cd{};
-
-	if (!di->dimensions.empty()) cd.set_dimensions(di->dimensions);
-	if (di->md5sum)
-		{
-		Md5Digest digest;
-		if (md5_digest_from_text(di->md5sum->c_str(), digest)) cd.set_md5sum(digest);
-		}
-	if (di->simd) cd.set_similarity(*di->simd);
-
-	cd.save(di->fd->path);
-}
-
 /*
  * ------------------------------------------------------------------
  * Window list utils
@@ -590,7 +331,7 @@ static void dupe_listview_add(DupeWindow *dw, DupeItem *parent, DupeItem *child)
 	di = (child) ? child : parent;
 
 	g_autofree gchar *rank_text = nullptr;
-	if (!child && dw->second_set)
+	if (!child && dw->engine->second_set)
 		{
 		rank_text = g_strdup("[1]");
 		}
@@ -637,7 +378,7 @@ static void dupe_listview_populate(DupeWindow *dw)
 	GtkListStore *store = GTK_LIST_STORE(gtk_tree_view_get_model(GTK_TREE_VIEW(dw->listview)));
 	gtk_list_store_clear(store);
 
-	for (GList *work = g_list_last(dw->dupes); work; work = work->prev)
+	for (GList *work = g_list_last(dw->engine->dupes); work; work = work->prev)
 		{
 		auto parent = static_cast<DupeItem *>(work->data);
 
@@ -675,7 +416,7 @@ static void dupe_listview_remove(DupeWindow *dw, DupeItem *di)
 	tree_view_move_cursor_away(GTK_TREE_VIEW(dw->listview), &iter, TRUE);
 	gtk_list_store_remove(store, &iter);
 
-	if (g_list_find(dw->dupes, di) != nullptr)
+	if (g_list_find(dw->engine->dupes, di) != nullptr)
 		{
 		if (!dw->color_frozen) dupe_listview_realign_colors(dw);
 		}
@@ -744,2024 +485,226 @@ static void dupe_listview_select_dupes(DupeWindow *dw, DupeSelectType parents)
 	valid = gtk_tree_model_get_iter_first(store, &iter);
 	while (valid)
 		{
-		DupeItem *di;
-
-		gtk_tree_model_get(store, &iter, DUPE_COLUMN_POINTER, &di, DUPE_COLUMN_SET, &set_count, -1);
-		if (set_count != set_count_last)
-			{
-			set_count_last = set_count;
-			if (parents == DUPE_SELECT_GROUP1)
-				{
-				gtk_tree_selection_select_iter(selection, &iter);
-				}
-			}
-		else
-			{
-			if (parents == DUPE_SELECT_GROUP2)
-				{
-				gtk_tree_selection_select_iter(selection, &iter);
-				}
-			}
-		valid = gtk_tree_model_iter_next(store, &iter);
-		}
-}
-
-/*
- * ------------------------------------------------------------------
- * Match group manipulation
- * ------------------------------------------------------------------
- */
-
-/**
- * @brief Search \a parent->group for \a child (#DupeItem)
- * @param child
- * @param parent
- * @returns
- *
- */
-static DupeMatch *dupe_match_find_match(DupeItem *child, DupeItem *parent)
-{
-	GList *work;
-
-	work = parent->group;
-	while (work)
-		{
-		auto dm = static_cast<DupeMatch *>(work->data);
-		if (dm->di == child) return dm;
-		work = work->next;
-		}
-	return nullptr;
-}
-
-/**
- * @brief Create #DupeMatch structure for \a child, and insert into \a parent->group list.
- * @param child
- * @param parent
- * @param rank
- *
- */
-static void dupe_match_link_child(DupeItem *child, DupeItem *parent, gdouble rank)
-{
-	DupeMatch *dm;
-
-	dm = g_new0(DupeMatch, 1);
-	dm->di = child;
-	dm->rank = rank;
-	parent->group = g_list_append(parent->group, dm);
-}
-
-/**
- * @brief Link \a a & \a b as both parent and child
- * @param a
- * @param b
- * @param rank
- *
- * Link \a a as child of \a b, and \a b as child of \a a
- */
-static void dupe_match_link(DupeItem *a, DupeItem *b, gdouble rank)
-{
-	dupe_match_link_child(a, b, rank);
-	dupe_match_link_child(b, a, rank);
-}
-
-/**
- * @brief Remove \a child #DupeMatch from \a parent->group list.
- * @param child
- * @param parent
- *
- */
-static void dupe_match_unlink_child(DupeItem *child, DupeItem *parent)
-{
-	DupeMatch *dm;
-
-	dm = dupe_match_find_match(child, parent);
-	if (dm)
-		{
-		parent->group = g_list_remove(parent->group, dm);
-		g_free(dm);
-		}
-}
-
-/**
- * @brief  Unlink \a a from \a b, and \a b from \a a
- * @param a
- * @param b
- *
- * Free the relevant #DupeMatch items from the #DupeItem group lists
- */
-static void dupe_match_unlink(DupeItem *a, DupeItem *b)
-{
-	dupe_match_unlink_child(a, b);
-	dupe_match_unlink_child(b, a);
-}
-
-/**
- * @brief
- * @param parent
- * @param unlink_children
- *
- * If \a unlink_children is set, unlink all entries in \a parent->group list. \n
- * Free the \a parent->group list and set group_rank to zero;
- */
-static void dupe_match_link_clear(DupeItem *parent, gboolean unlink_children)
-{
-	if (unlink_children)
-		{
-		GList *work;
-
-		work = parent->group;
-		while (work)
-			{
-			auto dm = static_cast<DupeMatch *>(work->data);
-			work = work->next;
-
-			dupe_match_unlink_child(parent, dm->di);
-			}
-		}
-
-	g_list_free_full(parent->group, g_free);
-	parent->group = nullptr;
-	parent->group_rank = 0.0;
-}
-
-/**
- * @brief Search \a parent->group list for \a child
- * @param child
- * @param parent
- * @returns boolean TRUE/FALSE found/not found
- *
- */
-static gint dupe_match_link_exists(DupeItem *child, DupeItem *parent)
-{
-	return (dupe_match_find_match(child, parent) != nullptr);
-}
-
-/**
- * @brief  Search \a parent->group for \a child, and return \a child->rank
- * @param child
- * @param parent
- * @returns \a dm->di->rank
- *
- */
-static gdouble dupe_match_link_rank(DupeItem *child, DupeItem *parent)
-{
-	DupeMatch *dm;
-
-	dm = dupe_match_find_match(child, parent);
-	if (dm) return dm->rank;
-
-	return 0.0;
-}
-
-/**
- * @brief Find highest rank in \a child->group
- * @param child
- * @returns
- *
- * Search the #DupeMatch entries in the \a child->group list.
- * Return the #DupeItem with the highest rank. If more than one have
- * the same rank, the first encountered is used.
- */
-static DupeItem *dupe_match_highest_rank(DupeItem *child)
-{
-	DupeMatch *dr;
-	GList *work;
-
-	dr = nullptr;
-	work = child->group;
-	while (work)
-		{
-		auto dm = static_cast<DupeMatch *>(work->data);
-		if (!dr || dm->rank > dr->rank)
-			{
-			dr = dm;
-			}
-		work = work->next;
-		}
-
-	return (dr) ? dr->di : nullptr;
-}
-
-/**
- * @brief Compute and store \a parent->group_rank
- * @param parent
- *
- * Group_rank = (sum of all child ranks) / n
- */
-static void dupe_match_rank_update(DupeItem *parent)
-{
-	GList *work;
-	gdouble rank = 0.0;
-	gint c = 0;
-
-	work = parent->group;
-	while (work)
-		{
-		auto dm = static_cast<DupeMatch *>(work->data);
-		work = work->next;
-		rank += dm->rank;
-		c++;
-		}
-
-	if (c > 0)
-		{
-		parent->group_rank = rank / c;
-		}
-	else
-		{
-		parent->group_rank = 0.0;
-		}
-}
-
-static DupeItem *dupe_match_find_parent(DupeWindow *dw, DupeItem *child)
-{
-	GList *work;
-
-	if (g_list_find(dw->dupes, child)) return child;
-
-	work = child->group;
-	while (work)
-		{
-		auto dm = static_cast<DupeMatch *>(work->data);
-		if (g_list_find(dw->dupes, dm->di)) return dm->di;
-		work = work->next;
-		}
-
-	return nullptr;
-}
-
-/**
- * @brief
- * @param work (#DupeItem) dw->list or dw->second_list
- *
- * Unlink all #DupeItem-s in \a work.
- * Do not unlink children.
- */
-static void dupe_match_reset_list(GList *work)
-{
-	while (work)
-		{
-		auto di = static_cast<DupeItem *>(work->data);
-		work = work->next;
-
-		dupe_match_link_clear(di, FALSE);
-		}
-}
-
-static void dupe_match_reparent(DupeWindow *dw, DupeItem *old_parent, DupeItem *new_parent)
-{
-	GList *work;
-
-	if (!old_parent || !new_parent || !dupe_match_link_exists(old_parent, new_parent)) return;
-
-	dupe_match_link_clear(new_parent, TRUE);
-	work = old_parent->group;
-	while (work)
-		{
-		auto dm = static_cast<DupeMatch *>(work->data);
-		dupe_match_unlink_child(old_parent, dm->di);
-		dupe_match_link_child(new_parent, dm->di, dm->rank);
-		work = work->next;
-		}
-
-	new_parent->group = old_parent->group;
-	old_parent->group = nullptr;
-
-	work = g_list_find(dw->dupes, old_parent);
-	if (work) work->data = new_parent;
-}
-
-static void dupe_match_print_group(DupeItem *di)
-{
-	GList *work;
-
-	log_printf("+ %f %s\n", di->group_rank, di->fd->name);
-
-	work = di->group;
-	while (work)
-		{
-		auto dm = static_cast<DupeMatch *>(work->data);
-		work = work->next;
-
-		log_printf("  %f %s\n", dm->rank, dm->di->fd->name);
-		}
-
-	log_printf("\n");
-}
-
-static void dupe_match_print_list(GList *list)
-{
-	GList *work;
-
-	work = list;
-	while (work)
-		{
-		auto di = static_cast<DupeItem *>(work->data);
-		dupe_match_print_group(di);
-		work = work->next;
-		}
-}
-
-/* level 3, unlinking and orphan handling */
-/**
- * @brief
- * @param child
- * @param parent \a di from \a child->group
- * @param[inout] list \a dw->list sorted by rank (#DupeItem)
- * @param dw
- * @returns modified \a list
- *
- * Called for each entry in \a child->group (#DupeMatch) with \a parent set to \a dm->di. \n
- * Find the highest rank #DupeItem of the \a parent's children. \n
- * If that is == \a child OR
- * highest rank #DupeItem of \a child == \a parent then FIXME:
- *
- */
-static GList *dupe_match_unlink_by_rank(DupeItem *child, DupeItem *parent, GList *list, DupeWindow *dw)
-{
-	DupeItem *best = nullptr;
-
-	best = dupe_match_highest_rank(parent); // highest rank in parent->group
-	if (best == child || dupe_match_highest_rank(child) == parent)
-		{
-		GList *work;
-		gdouble rank;
-
-		DEBUG_2("link found %s to %s [%d]", child->fd->name, parent->fd->name, g_list_length(parent->group));
-
-		work = parent->group;
-		while (work)
-			{
-			auto dm = static_cast<DupeMatch *>(work->data);
-			DupeItem *orphan;
-
-			work = work->next;
-			orphan = dm->di;
-			if (orphan != child && g_list_length(orphan->group) < 2)
-				{
-				dupe_match_link_clear(orphan, TRUE);
-				if (!dw->second_set || orphan->second)
-					{
-					dupe_match(orphan, child, dw->match_mask, &rank, FALSE);
-					dupe_match_link(orphan, child, rank);
-					}
-				list = g_list_remove(list, orphan);
-				}
-			}
-
-		rank = dupe_match_link_rank(child, parent); // child->rank
-		dupe_match_link_clear(parent, TRUE);
-		dupe_match_link(child, parent, rank);
-		list = g_list_remove(list, parent);
-		}
-	else
-		{
-		DEBUG_2("unlinking %s and %s", child->fd->name, parent->fd->name);
-
-		dupe_match_unlink(child, parent);
-		}
-
-	return list;
-}
-
-/* level 2 */
-/**
- * @brief
- * @param[inout] list \a dw->list sorted by rank (#DupeItem)
- * @param di
- * @param dw
- * @returns modified \a list
- *
- * Called for each entry in \a list.
- * Call unlink for each child in \a di->group
- */
-static GList *dupe_match_group_filter(GList *list, DupeItem *di, DupeWindow *dw)
-{
-	GList *work;
-
-	work = g_list_last(di->group);
-	while (work)
-		{
-		auto dm = static_cast<DupeMatch *>(work->data);
-		work = work->prev;
-		list = dupe_match_unlink_by_rank(di, dm->di, list, dw);
-		}
-
-	return list;
-}
-
-/* level 1 (top) */
-/**
- * @brief
- * @param[inout] list \a dw->list sorted by rank (#DupeItem)
- * @param dw
- * @returns Filtered \a list
- *
- * Called once.
- * Call group filter for each \a di in \a list
- */
-static GList *dupe_match_group_trim(GList *list, DupeWindow *dw)
-{
-	GList *work;
-
-	work = list;
-	while (work)
-		{
-		auto di = static_cast<DupeItem *>(work->data);
-		if (!di->second) list = dupe_match_group_filter(list, di, dw);
-		work = work->next;
-		if (di->second) list = g_list_remove(list, di);
-		}
-
-	return list;
-}
-
-static gint dupe_match_sort_groups_cb(gconstpointer a, gconstpointer b)
-{
-	auto da = static_cast<const DupeMatch *>(a);
-	auto db = static_cast<const DupeMatch *>(b);
-
-	if (da->rank > db->rank) return -1;
-	if (da->rank < db->rank) return 1;
-	return 0;
-}
-
-/**
- * @brief Sorts the children of each #DupeItem in \a list
- * @param list #DupeItem
- *
- * Sorts the #DupeItem->group children on rank
- */
-static void dupe_match_sort_groups(GList *list)
-{
-	GList *work;
-
-	work = list;
-	while (work)
-		{
-		auto di = static_cast<DupeItem *>(work->data);
-		di->group = g_list_sort(di->group, dupe_match_sort_groups_cb);
-		work = work->next;
-		}
-}
-
-static gint dupe_match_totals_sort_cb(gconstpointer a, gconstpointer b)
-{
-	auto da = static_cast<const DupeItem *>(a);
-	auto db = static_cast<const DupeItem *>(b);
-
-	if (g_list_length(da->group) > g_list_length(db->group)) return -1;
-	if (g_list_length(da->group) < g_list_length(db->group)) return 1;
-
-	if (da->group_rank < db->group_rank) return -1;
-	if (da->group_rank > db->group_rank) return 1;
-
-	return 0;
-}
-
-/**
- * @brief Callback for group_rank sort
- * @param a
- * @param b
- * @returns
- *
- *
- */
-static gint dupe_match_rank_sort_cb(gconstpointer a, gconstpointer b)
-{
-	auto da = static_cast<const DupeItem *>(a);
-	auto db = static_cast<const DupeItem *>(b);
-
-	if (da->group_rank > db->group_rank) return -1;
-	if (da->group_rank < db->group_rank) return 1;
-	return 0;
-}
-
-/**
- * @brief Sorts \a source_list by group-rank
- * @param source_list #DupeItem
- * @returns
- *
- * Computes group_rank for each #DupeItem. \n
- * Items with no group list are ignored.
- * Returns allocated GList of #DupeItem-s sorted by group_rank
- */
-static GList *dupe_match_rank_sort(GList *source_list)
-{
-	GList *list = nullptr;
-	GList *work;
-
-	work = source_list;
-	while (work)
-		{
-		auto di = static_cast<DupeItem *>(work->data);
-
-		if (di->group)
-			{
-			dupe_match_rank_update(di); // Compute and store group_rank for di
-			list = g_list_prepend(list, di);
-			}
-
-		work = work->next;
-		}
-
-	return g_list_sort(list, dupe_match_rank_sort_cb);
-}
-
-/**
- * @brief Returns allocated GList of dupes sorted by totals
- * @param source_list
- * @returns
- *
- *
- */
-static GList *dupe_match_totals_sort(GList *source_list)
-{
-	source_list = g_list_sort(source_list, dupe_match_totals_sort_cb);
-
-	source_list = g_list_first(source_list);
-	return g_list_reverse(source_list);
-}
-
-/**
- * @brief
- * @param dw
- *
- * Called once.
- */
-static void dupe_match_rank(DupeWindow *dw)
-{
-	GList *list;
-
-	list = dupe_match_rank_sort(dw->list); // sorted by group_rank, no-matches filtered out
-
-	if (required_debug_level(2)) dupe_match_print_list(list);
-
-	DEBUG_1("Similar items: %u", g_list_length(list));
-	list = dupe_match_group_trim(list, dw);
-	DEBUG_1("Unique groups: %u", g_list_length(list));
-
-	dupe_match_sort_groups(list);
-
-	if (required_debug_level(2)) dupe_match_print_list(list);
-
-	list = dupe_match_rank_sort(list);
-	if (options->sort_totals)
-		{
-		list = dupe_match_totals_sort(list);
-		}
-	if (required_debug_level(2)) dupe_match_print_list(list);
-
-	g_list_free(dw->dupes);
-	dw->dupes = list;
-}
-
-/*
- * ------------------------------------------------------------------
- * Match group tests
- * ------------------------------------------------------------------
- */
-
-static gboolean dupe_match_md5sum(DupeItem *a, DupeItem *b)
-{
-	if (!a->md5sum) a->md5sum = md5_text_from_file_utf8(a->fd->path);
-	if (!b->md5sum) b->md5sum = md5_text_from_file_utf8(b->fd->path);
-
-	return !a->md5sum->empty()
-	    && !b->md5sum->empty()
-	    && a->md5sum == b->md5sum;
-}
-
-/**
- * @brief
- * @param[in] a
- * @param[in] b
- * @param[in] mask
- * @param[out] rank
- * @param[in] fast
- * @returns
- *
- * For similarity checks, compute rank - (similarity factor between a and b). \n
- * If rank < user-set sim value, returns FALSE.
- */
-static gboolean dupe_match(DupeItem *a, DupeItem *b, DupeMatchType mask, gdouble *rank, gint fast)
-{
-	*rank = 0.0;
-
-	if (a->fd->path == b->fd->path) return FALSE;
-
-	if (mask & DUPE_MATCH_ALL)
-		{
-		return TRUE;
-		}
-	if (mask & DUPE_MATCH_PATH)
-		{
-		if (utf8_compare(a->fd->path, b->fd->path, TRUE) != 0) return FALSE;
-		}
-	if (mask & DUPE_MATCH_NAME)
-		{
-		if (strcmp(a->fd->collate_key_name, b->fd->collate_key_name) != 0) return FALSE;
-		}
-	if (mask & DUPE_MATCH_NAME_CI)
-		{
-		if (strcmp(a->fd->collate_key_name_nocase, b->fd->collate_key_name_nocase) != 0) return FALSE;
-		}
-	if (mask & DUPE_MATCH_NAME_CONTENT)
-		{
-		if (strcmp(a->fd->collate_key_name, b->fd->collate_key_name) != 0) return FALSE;
-
-		return !dupe_match_md5sum(a, b);
-		}
-	if (mask & DUPE_MATCH_NAME_CI_CONTENT)
-		{
-		if (strcmp(a->fd->collate_key_name_nocase, b->fd->collate_key_name_nocase) != 0) return FALSE;
-
-		return !dupe_match_md5sum(a, b);
-		}
-	if (mask & DUPE_MATCH_SIZE)
-		{
-		if (a->fd->size != b->fd->size) return FALSE;
-		}
-	if (mask & DUPE_MATCH_DATE)
-		{
-		if (a->fd->date != b->fd->date) return FALSE;
-		}
-	if (mask & DUPE_MATCH_SUM)
-		{
-		if (!dupe_match_md5sum(a, b)) return FALSE;
-		}
-	if (mask & DUPE_MATCH_DIM)
-		{
-		if (a->dimensions.empty()) image_load_dimensions(a->fd, a->dimensions);
-		if (b->dimensions.empty()) image_load_dimensions(b->fd, b->dimensions);
-		if (a->dimensions != b->dimensions) return FALSE;
-		}
-	if (mask & DUPE_MATCH_SIM)
-		{
-		gdouble f;
-		gdouble m;
-
-		if (mask & DUPE_MATCH_SIM_HIGH) m = 0.95;
-		else if (mask & DUPE_MATCH_SIM_MED) m = 0.90;
-		else if (mask & DUPE_MATCH_SIM_CUSTOM) m = static_cast<gdouble>(options->duplicates_similarity_threshold) / 100.0;
-		else m = 0.85;
-
-		if (fast)
-			{
-			f = image_sim_compare_fast(a->simd.get(), b->simd.get(), m);
-			}
-		else
-			{
-			f = image_sim_compare(a->simd.get(), b->simd.get());
-			}
-
-		*rank = f * 100.0;
-
-		if (f < m) return FALSE;
-
-		DEBUG_3("similar: %32s %32s = %f", a->fd->name, b->fd->name, f);
-		}
-
-	return TRUE;
-}
-
-/**
- * @brief  Determine if there is a match
- * @param di1
- * @param di2
- * @param data
- * @returns DUPE_MATCH/DUPE_NO_MATCH/DUPE_NAME_MATCH
- * 			DUPE_NAME_MATCH is used for name != contents searches:
- * 							the name and content match i.e.
- * 							no match, but keep searching
- *
- * Called when stepping down the array looking for adjacent matches,
- * and from the 2nd set search.
- *
- * Is not used for similarity checks.
- */
-static DUPE_CHECK_RESULT dupe_match_check(DupeItem *di1, DupeItem *di2, gpointer data)
-{
-	auto dw = static_cast<DupeWindow *>(data);
-	DupeMatchType mask = dw->match_mask;
-
-	if (mask & DUPE_MATCH_ALL)
-		{
-		return DUPE_MATCH;
-		}
-	if (mask & DUPE_MATCH_PATH)
-		{
-		if (utf8_compare(di1->fd->path, di2->fd->path, TRUE) != 0)
-			{
-			return DUPE_NO_MATCH;
-			}
-		}
-	if (mask & DUPE_MATCH_NAME)
-		{
-		if (g_strcmp0(di1->fd->collate_key_name, di2->fd->collate_key_name) != 0)
-			{
-			return DUPE_NO_MATCH;
-			}
-		}
-	if (mask & DUPE_MATCH_NAME_CI)
-		{
-		if (g_strcmp0(di1->fd->collate_key_name_nocase, di2->fd->collate_key_name_nocase) != 0 )
-			{
-			return DUPE_NO_MATCH;
-			}
-		}
-	if (mask & DUPE_MATCH_NAME_CONTENT)
-		{
-		if (g_strcmp0(di1->fd->collate_key_name, di2->fd->collate_key_name) != 0)
-			{
-			return DUPE_NO_MATCH;
-			}
-
-		if (di1->md5sum == di2->md5sum)
-			{
-			return DUPE_NAME_MATCH;
-			}
-		}
-	if (mask & DUPE_MATCH_NAME_CI_CONTENT)
-		{
-		if (strcmp(di1->fd->collate_key_name_nocase, di2->fd->collate_key_name_nocase) != 0)
-			{
-			return DUPE_NO_MATCH;
-			}
-
-		if (di1->md5sum == di2->md5sum)
-			{
-			return DUPE_NAME_MATCH;
-			}
-		}
-	if (mask & DUPE_MATCH_SIZE)
-		{
-		if (di1->fd->size != di2->fd->size)
-			{
-			return DUPE_NO_MATCH;
-			}
-		}
-	if (mask & DUPE_MATCH_DATE)
-		{
-		if (di1->fd->date != di2->fd->date)
-			{
-			return DUPE_NO_MATCH;
-			}
-		}
-	if (mask & DUPE_MATCH_SUM)
-		{
-		if (di1->md5sum != di2->md5sum)
-			{
-			return DUPE_NO_MATCH;
-			}
-		}
-	if (mask & DUPE_MATCH_DIM)
-		{
-		if (di1->dimensions_sum != di2->dimensions_sum)
-			{
-			return DUPE_NO_MATCH;
-			}
-		}
-
-	return DUPE_MATCH;
-}
-
-/**
- * @brief The callback for the binary search
- * @param a
- * @param b
- * @param param_match_mask
- * @returns negative/0/positive
- *
- * Is not used for similarity checks.
- *
- * Used only when two file sets are used.
- * Requires use of a global for param_match_mask because there is no
- * g_array_binary_search_with_data() function in glib.
- */
-static gint dupe_match_binary_search_cb(gconstpointer a, gconstpointer b)
-{
-	auto di1 = *(static_cast<const DupeItem *const *>(a));
-	auto di2 = static_cast<const DupeItem *>(b);
-	DupeMatchType mask = param_match_mask;
-
-	if (mask & DUPE_MATCH_ALL)
-		{
-		return 0;
-		}
-	if (mask & DUPE_MATCH_PATH)
-		{
-		return utf8_compare(di1->fd->path, di2->fd->path, TRUE);
-		}
-	if (mask & DUPE_MATCH_NAME)
-		{
-		return g_strcmp0(di1->fd->collate_key_name, di2->fd->collate_key_name);
-		}
-	if (mask & DUPE_MATCH_NAME_CI)
-		{
-		return strcmp(di1->fd->collate_key_name_nocase, di2->fd->collate_key_name_nocase);
-		}
-	if (mask & DUPE_MATCH_NAME_CONTENT)
-		{
-		return g_strcmp0(di1->fd->collate_key_name, di2->fd->collate_key_name);
-		}
-	if (mask & DUPE_MATCH_NAME_CI_CONTENT)
-		{
-		return strcmp(di1->fd->collate_key_name_nocase, di2->fd->collate_key_name_nocase);
-		}
-	if (mask & DUPE_MATCH_SIZE)
-		{
-		return (di1->fd->size - di2->fd->size);
-		}
-	if (mask & DUPE_MATCH_DATE)
-		{
-		return (di1->fd->date - di2->fd->date);
-		}
-	if (mask & DUPE_MATCH_SUM)
-		{
-		if (di1->md5sum < di2->md5sum) return -1;
-		if (di1->md5sum > di2->md5sum) return 1;
-		return 0;
-		}
-	if (mask & DUPE_MATCH_DIM)
-		{
-		return (di1->dimensions_sum - di2->dimensions_sum);
-		}
-
-	return 0;
-}
-
-/**
- * @brief The callback for the array sort
- * @param a
- * @param b
- * @param data
- * @returns negative/0/positive
- *
- * Is not used for similarity checks.
-*/
-static gint dupe_match_sort_cb(gconstpointer a, gconstpointer b, gpointer data)
-{
-	auto di1 = *(static_cast<const DupeItem *const *>(a));
-	auto di2 = *(static_cast<const DupeItem *const *>(b));
-	auto dw = static_cast<DupeWindow *>(data);
-	DupeMatchType mask = dw->match_mask;
-
-	if (mask & DUPE_MATCH_ALL)
-		{
-		return 0;
-		}
-	if (mask & DUPE_MATCH_PATH)
-		{
-		return utf8_compare(di1->fd->path, di2->fd->path, TRUE);
-		}
-	if (mask & DUPE_MATCH_NAME)
-		{
-		return g_strcmp0(di1->fd->collate_key_name, di2->fd->collate_key_name);
-		}
-	if (mask & DUPE_MATCH_NAME_CI)
-		{
-		return strcmp(di1->fd->collate_key_name_nocase, di2->fd->collate_key_name_nocase);
-		}
-	if (mask & DUPE_MATCH_NAME_CONTENT)
-		{
-		return g_strcmp0(di1->fd->collate_key_name, di2->fd->collate_key_name);
-		}
-	if (mask & DUPE_MATCH_NAME_CI_CONTENT)
-		{
-		return strcmp(di1->fd->collate_key_name_nocase, di2->fd->collate_key_name_nocase);
-		}
-	if (mask & DUPE_MATCH_SIZE)
-		{
-		return (di1->fd->size - di2->fd->size);
-		}
-	if (mask & DUPE_MATCH_DATE)
-		{
-		return (di1->fd->date - di2->fd->date);
-		}
-	if (mask & DUPE_MATCH_SUM)
-		{
-		if (!di1->md5sum || di1->md5sum->empty() ||
-		    !di2->md5sum || di2->md5sum->empty())
-			{
-			return -1;
-			}
-
-		return di1->md5sum->compare(di2->md5sum.value());
-		}
-	if (mask & DUPE_MATCH_DIM)
-		{
-		if (!di1 || !di2 || !di1->dimensions.width || !di1->dimensions.height || !di2->dimensions.width || !di2->dimensions.height)
-			{
-			return -1;
-			}
-		return (di1->dimensions_sum - di2->dimensions_sum);
-		}
-
-	return 0; // should not execute
-}
-
-/**
- * @brief Check for duplicate matches
- * @param dw
- *
- * Is not used for similarity checks.
- *
- * Loads the file sets into an array and sorts on the searched
- * for parameter.
- *
- * If one file set, steps down the array looking for adjacent equal values.
- *
- * If two file sets, steps down the first set and for each value
- * does a binary search for matches in the second set.
- */
-static void dupe_array_check(DupeWindow *dw)
-{
-	DUPE_CHECK_RESULT check_result;
-	param_match_mask = dw->match_mask;
-	guint out_match_index;
-
-	if (!dw->list) return;
-
-	dupe_match_reset_list(dw->list);
-
-	const auto list_to_sorted_array = [dw](GList *list)
-	{
-		GArray *array_set = g_array_new(TRUE, TRUE, sizeof(gpointer));
-
-		for (GList *work = list; work; work = work->next)
-			{
-			g_array_append_val(array_set, work->data);
-			}
-
-		g_array_sort_with_data(array_set, dupe_match_sort_cb, dw);
-		return array_set;
-	};
-
-	GArray *array_set1 = list_to_sorted_array(dw->list);
-
-	if (dw->second_set)
-		{
-		/* Two sets - nothing can be done until a second set is loaded */
-		if (dw->second_list)
-			{
-			GArray *array_set2 = list_to_sorted_array(dw->second_list);
-
-			for (gint i_set1 = 0; i_set1 <= static_cast<gint>(array_set1->len) - 1; i_set1++)
-				{
-				auto di1 = static_cast<DupeItem *>(g_array_index(array_set1, gpointer, i_set1));
-				DupeItem *di2 = nullptr;
-				/* If multiple identical entries in set 1, use the last one */
-				if (i_set1 < static_cast<gint>(array_set1->len) - 2)
-					{
-					di2 = static_cast<DupeItem *>(g_array_index(array_set1, gpointer, i_set1 + 1));
-					check_result = dupe_match_check(di1, di2, dw);
-					if (check_result == DUPE_MATCH || check_result == DUPE_NAME_MATCH)
-						{
-						continue;
-						}
-					}
-
-				if (g_array_binary_search(array_set2, di1, dupe_match_binary_search_cb, &out_match_index))
-					{
-					di2 = static_cast<DupeItem *>(g_array_index(array_set2, gpointer, out_match_index));
-
-					check_result = dupe_match_check(di1, di2, dw);
-					if (check_result == DUPE_MATCH || check_result == DUPE_NAME_MATCH)
-						{
-						if (check_result == DUPE_MATCH)
-							{
-							dupe_match_link(di2, di1, 0.0);
-							}
-
-						gint i_set2 = out_match_index + 1;
-						if (i_set2 > static_cast<gint>(array_set2->len) - 1)
-							{
-							break;
-							}
-						/* Look for multiple matches in set 2 for item di1 */
-						di2 = static_cast<DupeItem *>(g_array_index(array_set2, gpointer, i_set2));
-						check_result = dupe_match_check(di1, di2, dw);
-						while (check_result == DUPE_MATCH || check_result == DUPE_NAME_MATCH)
-							{
-							if (check_result == DUPE_MATCH)
-								{
-								dupe_match_link(di2, di1, 0.0);
-								}
-							i_set2++;
-							if (i_set2 > static_cast<gint>(array_set2->len) - 1)
-								{
-								break;
-								}
-							di2 = static_cast<DupeItem *>(g_array_index(array_set2, gpointer, i_set2));
-							check_result = dupe_match_check(di1, di2, dw);
-							}
-						}
-					}
-				}
-
-			g_array_free(array_set2, TRUE);
-			}
-		}
-	else
-		{
-		/* File set 1 only */
-		g_clear_pointer(&dw->dupes, g_list_free);
-
-		for (gint i_set1 = 0; i_set1 <= static_cast<gint>(array_set1->len) - 2; i_set1++)
-			{
-			auto *di1 = static_cast<DupeItem *>(g_array_index(array_set1, gpointer, i_set1));
-
-			/* Look for multiple matches for item di1 */
-			auto *di2 = static_cast<DupeItem *>(g_array_index(array_set1, gpointer, i_set1 + 1));
-			check_result = dupe_match_check(di1, di2, dw);
-			while (check_result == DUPE_MATCH || check_result == DUPE_NAME_MATCH)
-				{
-				if (check_result == DUPE_MATCH)
-					{
-					dupe_match_link(di2, di1, 0.0);
-					}
-
-				i_set1++;
-				if (i_set1 + 1 > static_cast<gint>(array_set1->len) - 1) break;
-
-				di2 = static_cast<DupeItem *>(g_array_index(array_set1, gpointer, i_set1 + 1));
-				check_result = dupe_match_check(di1, di2, dw);
-				}
-			}
-		}
-
-	g_array_free(array_set1, TRUE);
-}
-
-/**
- * @brief Look for similarity match
- * @param dw
- * @param needle
- * @param start
- *
- * Only used for similarity checks.\n
- * Called from dupe_check_cb.
- * Called for each entry in the list.
- * Steps through the list looking for matches against needle.
- * Pushes a #DupeQueueItem onto thread pool queue.
- */
-static void dupe_list_check_match(DupeWindow *dw, DupeItem *needle, GList *start)
-{
-	GList *work;
-	DupeQueueItem *dqi;
-
-	if (dw->second_set)
-		{
-		work = dw->second_list;
-		}
-	else if (start)
-		{
-		work = start;
-		}
-	else
-		{
-		work = g_list_last(dw->list);
-		}
-
-	dqi = g_new0(DupeQueueItem, 1);
-	dqi->needle = needle;
-	dqi->dw = dw;
-	dqi->work = work;
-	dqi->index = dw->queue_count;
-	g_thread_pool_push(dw->dupe_comparison_thread_pool, dqi, nullptr);
-}
-
-/*
- * ------------------------------------------------------------------
- * Thumbnail handling
- * ------------------------------------------------------------------
- */
-
-static void dupe_listview_set_thumb(DupeWindow *dw, DupeItem *di, GtkTreeIter *iter)
-{
-	GtkListStore *store;
-	GtkTreeIter iter_n;
-
-	store = GTK_LIST_STORE(gtk_tree_view_get_model(GTK_TREE_VIEW(dw->listview)));
-	if (!iter)
-		{
-		if (dupe_listview_find_item(store, di, &iter_n) >= 0)
-			{
-			iter = &iter_n;
-			}
-		}
-
-	if (iter) gtk_list_store_set(store, iter, DUPE_COLUMN_THUMB, di->pixbuf, -1);
-}
-
-static void dupe_thumb_do(DupeWindow *dw)
-{
-	DupeItem *di;
-
-	if (!dw->thumb_loader || !dw->thumb_item) return;
-	di = dw->thumb_item;
-
-	if (di->pixbuf) g_object_unref(di->pixbuf);
-	di->pixbuf = thumb_loader_get_pixbuf(dw->thumb_loader);
-
-	dupe_listview_set_thumb(dw, di, nullptr);
-}
-
-static void dupe_thumb_error_cb(ThumbLoader *, gpointer data)
-{
-	auto dw = static_cast<DupeWindow *>(data);
-
-	dupe_thumb_do(dw);
-	dupe_thumb_step(dw);
-}
-
-static void dupe_thumb_done_cb(ThumbLoader *, gpointer data)
-{
-	auto dw = static_cast<DupeWindow *>(data);
-
-	dupe_thumb_do(dw);
-	dupe_thumb_step(dw);
-}
-
-static void dupe_thumb_step(DupeWindow *dw)
-{
-	GtkTreeModel *store;
-	GtkTreeIter iter;
-	DupeItem *di = nullptr;
-	gboolean valid;
-	gint row = 0;
-	gint length = 0;
-
-	store = gtk_tree_view_get_model(GTK_TREE_VIEW(dw->listview));
-	valid = gtk_tree_model_get_iter_first(store, &iter);
-
-	while (!di && valid)
-		{
-		GdkPixbuf *pixbuf;
-
-		length++;
-		gtk_tree_model_get(store, &iter, DUPE_COLUMN_POINTER, &di, DUPE_COLUMN_THUMB, &pixbuf, -1);
-		if (pixbuf || di->pixbuf)
-			{
-			if (!pixbuf) gtk_list_store_set(GTK_LIST_STORE(store), &iter, DUPE_COLUMN_THUMB, di->pixbuf, -1);
-			row++;
-			di = nullptr;
-			}
-		valid = gtk_tree_model_iter_next(store, &iter);
-		}
-	if (valid)
-		{
-		while (gtk_tree_model_iter_next(store, &iter)) length++;
-		}
-
-	if (!di)
-		{
-		dw->thumb_item = nullptr;
-		thumb_loader_free(dw->thumb_loader);
-		dw->thumb_loader = nullptr;
-
-		dupe_window_update_progress(dw, nullptr, 0.0, FALSE);
-		return;
-		}
-
-	dupe_window_update_progress(dw, _("Loading thumbs…"),
-				    length == 0 ? 0.0 : static_cast<gdouble>(row) / length, FALSE);
-
-	dw->thumb_item = di;
-	thumb_loader_free(dw->thumb_loader);
-	dw->thumb_loader = thumb_loader_new(options->thumbnails.max_width, options->thumbnails.max_height);
-
-	thumb_loader_set_callbacks(dw->thumb_loader,
-				   dupe_thumb_done_cb,
-				   dupe_thumb_error_cb,
-				   nullptr,
-				   dw);
-
-	/* start it */
-	if (!thumb_loader_start(dw->thumb_loader, di->fd))
-		{
-		/* error, handle it, do next */
-		DEBUG_1("error loading thumb for %s", di->fd->path);
-		dupe_thumb_do(dw);
-		dupe_thumb_step(dw);
-		}
-}
-
-/*
- * ------------------------------------------------------------------
- * Dupe checking loop
- * ------------------------------------------------------------------
- */
-
-static void dupe_check_stop(DupeWindow *dw)
-{
-	g_clear_handle_id(&dw->idle_id, g_source_remove);
-
-	dw->abort = TRUE;
-
-	while (dw->thread_count < dw->queue_count) // Wait for the queue to empty
-		{
-		dupe_window_update_progress(dw, nullptr, 0.0, FALSE);
-		widget_set_cursor(dw->listview, -1);
-		}
-
-	g_list_free(dw->search_matches);
-	dw->search_matches = nullptr;
-
-	if (dw->idle_id || dw->img_loader || dw->thumb_loader)
-		{
-		g_clear_handle_id(&dw->idle_id, g_source_remove);
-		dupe_window_update_progress(dw, nullptr, 0.0, FALSE);
-		widget_set_cursor(dw->listview, -1);
-		}
-
-	if (dw->add_files_queue_id)
-		{
-		g_clear_handle_id(&dw->add_files_queue_id, g_source_remove);
-		dupe_destroy_list_cache(dw);
-		gtk_widget_set_sensitive(dw->controls_box, TRUE);
-		if (g_list_length(dw->add_files_queue) > 0)
-			{
-			file_data_list_free(dw->add_files_queue);
-			}
-		dw->add_files_queue = nullptr;
-		dupe_window_update_progress(dw, nullptr, 0.0, FALSE);
-		widget_set_cursor(dw->listview, -1);
-		}
-
-	thumb_loader_free(dw->thumb_loader);
-	dw->thumb_loader = nullptr;
-
-	image_loader_free(dw->img_loader);
-	dw->img_loader = nullptr;
-}
-
-static void dupe_check_stop_cb(GtkWidget *, gpointer data)
-{
-	auto dw = static_cast<DupeWindow *>(data);
-
-	dupe_check_stop(dw);
-}
-
-static void dupe_loader_done_cb(ImageLoader *il, gpointer data)
-{
-	auto dw = static_cast<DupeWindow *>(data);
-	GdkPixbuf *pixbuf;
-
-	pixbuf = image_loader_get_pixbuf(il);
-
-	if (dw->setup_point)
-		{
-		auto di = static_cast<DupeItem *>(dw->setup_point->data);
-
-		if (!di->simd)
-			{
-			di->simd = std::make_unique<ImageSimilarityData>();
-			}
-
-		di->simd->fill_data(pixbuf);
-
-		if (di->dimensions.empty() && pixbuf)
-			{
-			di->dimensions.width = gdk_pixbuf_get_width(pixbuf);
-			di->dimensions.height = gdk_pixbuf_get_height(pixbuf);
-			}
-		if (options->thumbnails.enable_caching)
-			{
-			dupe_item_write_cache(di);
-			}
-
-		di->simd->alternate_processing();
-		}
-
-	image_loader_free(dw->img_loader);
-	dw->img_loader = nullptr;
-
-	dw->idle_id = g_idle_add(dupe_check_cb, dw);
-}
-
-static void dupe_setup_reset(DupeWindow *dw)
-{
-	dw->setup_point = nullptr;
-	dw->setup_n = 0;
-	dw->setup_time = msec_time();
-	dw->setup_time_count = 0;
-}
-
-static GList *dupe_setup_point_step(DupeWindow *dw, GList *p)
-{
-	if (!p) return nullptr;
-
-	if (p->next) return p->next;
-
-	if (dw->second_set && g_list_first(p) == dw->list) return dw->second_list;
-
-	return nullptr;
-}
-
-/**
- * @brief Generates the sumcheck or dimensions_sum
- * @param list Set1 or set2
- * @returns TRUE/FALSE = not completed/completed
- *
- * Ensures that the DIs contain the MD5SUM or dimensions_sum for all items in
- * the list. One item at a time. Re-enters if not completed.
- */
-static gboolean create_checksums_dimensions(DupeWindow *dw, GList *list)
-{
-	static const auto setup_progress = [](const DupeWindow *dw)
-	{
-		return (dw->setup_count == 0) ? 0.0 : static_cast<gdouble>(dw->setup_n - 1) / dw->setup_count;
-	};
-
-	if ((dw->match_mask & DUPE_MATCH_SUM) ||
-	    (dw->match_mask & DUPE_MATCH_NAME_CONTENT) ||
-	    (dw->match_mask & DUPE_MATCH_NAME_CI_CONTENT))
-		{
-		/* MD5SUM only */
-		if (!dw->setup_point) dw->setup_point = list; // setup_point clear on 1st entry
-
-		while (dw->setup_point)
-			{
-			auto di = static_cast<DupeItem *>(dw->setup_point->data);
-
-			dw->setup_point = dupe_setup_point_step(dw, dw->setup_point);
-			dw->setup_n++;
-
-			if (!di->md5sum)
-				{
-				dupe_window_update_progress(dw, _("Reading checksums…"), setup_progress(dw), FALSE);
-
-				if (options->thumbnails.enable_caching)
-					{
-					dupe_item_read_cache(di);
-					if (di->md5sum) return TRUE;
-					}
-
-				di->md5sum = md5_text_from_file_utf8(di->fd->path);
-				if (options->thumbnails.enable_caching)
-					{
-					dupe_item_write_cache(di);
-					}
-				return TRUE;
-				}
-			}
-		dupe_setup_reset(dw);
-		}
-
-	if (dw->match_mask & DUPE_MATCH_DIM)
-		{
-		/* Dimensions only */
-		if (!dw->setup_point) dw->setup_point = list;
-
-		while (dw->setup_point)
-			{
-			auto di = static_cast<DupeItem *>(dw->setup_point->data);
-
-			dw->setup_point = dupe_setup_point_step(dw, dw->setup_point);
-			dw->setup_n++;
-			if (di->dimensions.empty())
-				{
-				dupe_window_update_progress(dw, _("Reading dimensions…"), setup_progress(dw), FALSE);
-
-				if (options->thumbnails.enable_caching)
-					{
-					dupe_item_read_cache(di);
-					if (!di->dimensions.empty()) return TRUE;
-					}
-
-				image_load_dimensions(di->fd, di->dimensions);
-				di->dimensions_sum = (di->dimensions.width << 16) + di->dimensions.height;
-				if (options->thumbnails.enable_caching)
-					{
-					dupe_item_write_cache(di);
-					}
-				return TRUE;
-				}
-			}
-		dupe_setup_reset(dw);
-		}
-
-	return FALSE;
-}
-
-/**
- * @brief Compare func. for sorting search matches
- * @param a #DupeSearchMatch
- * @param b #DupeSearchMatch
- * @returns
- *
- * Used only for similarity checks\n
- * Sorts search matches on order they were inserted into the pool queue
- */
-static gint sort_func(gconstpointer a, gconstpointer b)
-{
-	return static_cast<const DupeSearchMatch *>(a)->index - static_cast<const DupeSearchMatch *>(b)->index;
-}
-
-/**
- * @brief Check set 1 (and set 2) for matches
- * @param data DupeWindow
- * @returns TRUE/FALSE = not completed/completed
- *
- * Initiated from start, loader done and item remove
- *
- * On first entry generates di->MD5SUM, di->dimensions and sim data,
- * and updates the cache.
- */
-static gboolean dupe_check_cb(gpointer data)
-{
-	auto dw = static_cast<DupeWindow *>(data);
-	DupeSearchMatch *search_match_list_item;
-
-	if (!dw->idle_id)
-		{
-		return G_SOURCE_REMOVE;
-		}
-
-	if (!dw->setup_done) /* Clear on 1st entry */
-		{
-		if (dw->list)
-			{
-			if (create_checksums_dimensions(dw, dw->list))
-				{
-				return G_SOURCE_CONTINUE;
-				}
-			}
-		if (dw->second_list)
-			{
-			if (create_checksums_dimensions(dw, dw->second_list))
-				{
-				return G_SOURCE_CONTINUE;
-				}
-			}
-		if ((dw->match_mask & DUPE_MATCH_SIM) &&
-		    !(dw->setup_mask & DUPE_MATCH_SIM_MED) )
-			{
-			/* Similarity only */
-			if (!dw->setup_point) dw->setup_point = dw->list;
-
-			while (dw->setup_point)
-				{
-				auto di = static_cast<DupeItem *>(dw->setup_point->data);
-
-				if (!di->simd)
-					{
-					dupe_window_update_progress(dw, _("Reading similarity data…"),
-						dw->setup_count == 0 ? 0.0 : static_cast<gdouble>(dw->setup_n) / dw->setup_count, FALSE);
-
-					if (options->thumbnails.enable_caching)
-						{
-						dupe_item_read_cache(di);
-						if (image_sim_filled(di->simd.get()))
-							{
-							di->simd->alternate_processing();
-							return G_SOURCE_CONTINUE;
-							}
-						}
-
-					dw->img_loader = image_loader_new(di->fd);
-					image_loader_set_buffer_size(dw->img_loader, 8);
-					g_signal_connect(G_OBJECT(dw->img_loader), "error", (GCallback)dupe_loader_done_cb, dw);
-					g_signal_connect(G_OBJECT(dw->img_loader), "done", (GCallback)dupe_loader_done_cb, dw);
-
-					if (!image_loader_start(dw->img_loader))
-						{
-						di->simd = std::make_unique<ImageSimilarityData>();
-						image_loader_free(dw->img_loader);
-						dw->img_loader = nullptr;
-						return G_SOURCE_CONTINUE;
-						}
-					dw->idle_id = 0;
-					return G_SOURCE_REMOVE;
-					}
-
-				dw->setup_point = dupe_setup_point_step(dw, dw->setup_point);
-				dw->setup_n++;
-				}
-			dw->setup_mask = static_cast<DupeMatchType>(dw->setup_mask | DUPE_MATCH_SIM_MED);
-			dupe_setup_reset(dw);
-			}
-
-		/* End of setup not done */
-		dupe_window_update_progress(dw, _("Comparing…"), 0.0, FALSE);
-		dw->setup_done = TRUE;
-		dupe_setup_reset(dw);
-		dw->setup_count = g_list_length(dw->list);
-		}
-
-	/* Setup done - dw->working set to NULL below
-	 * Set before 1st entry: dw->working = g_list_last(dw->list)
-	 * Set before 1st entry: dw->setup_count = g_list_length(dw->list)
-	 */
-	if (!dw->working)
-		{
-		/* Similarity check threads may still be running */
-		if (dw->setup_count > 0 && (dw->match_mask & DUPE_MATCH_SIM))
-			{
-			if( dw->thread_count < dw->queue_count)
-				{
-				g_autofree gchar *progress_text = g_strdup_printf("%s %d/%d", _("Comparing"), dw->thread_count, dw->queue_count);
-
-				dupe_window_update_progress(dw, progress_text, (gdouble)dw->thread_count / dw->queue_count, TRUE);
-
-				return G_SOURCE_CONTINUE;
-				}
-
-			if (dw->search_matches_sorted == nullptr)
-				{
-				dw->search_matches_sorted = g_list_sort(dw->search_matches, sort_func);
-				dupe_setup_reset(dw);
-				}
-
-			while (dw->search_matches_sorted)
-				{
-				dw->setup_n++;
-				dupe_window_update_progress(dw, _("Sorting…"), 0.0, FALSE);
-				search_match_list_item = static_cast<DupeSearchMatch *>(dw->search_matches_sorted->data);
-
-				if (!dupe_match_link_exists(search_match_list_item->a, search_match_list_item->b))
-					{
-					dupe_match_link(search_match_list_item->a, search_match_list_item->b, search_match_list_item->rank);
-					}
-
-				dw->search_matches_sorted = dw->search_matches_sorted->next;
-
-				if (dw->search_matches_sorted != nullptr)
-					{
-					return G_SOURCE_CONTINUE;
-					}
-				}
-			g_list_free(dw->search_matches); // FIXME dw->search_matches doesn't point at the start of the list after g_list_sort() call
-			dw->search_matches = nullptr;
-			dw->search_matches_sorted = nullptr;
-			dw->setup_count = 0;
-			}
-		else
-			{
-			if (dw->setup_count > 0)
-				{
-				dw->setup_count = 0;
-				dupe_window_update_progress(dw, _("Sorting…"), 1.0, TRUE);
-				return G_SOURCE_CONTINUE;
-				}
-			}
-
-		dw->idle_id = 0;
-		dupe_window_update_progress(dw, nullptr, 0.0, FALSE);
-
-		dupe_match_rank(dw);
-		dupe_window_update_count(dw, FALSE);
-
-		dupe_listview_populate(dw);
-
-		/* check thumbs */
-		if (dw->show_thumbs) dupe_thumb_step(dw);
-
-		widget_set_cursor(dw->listview, -1);
-
-		return G_SOURCE_REMOVE;
-		/* The end */
-		}
-
-	/* Setup done - working */
-	if (dw->match_mask & DUPE_MATCH_SIM)
-		{
-		/* This is the similarity comparison */
-		dupe_list_check_match(dw, static_cast<DupeItem *>(dw->working->data), dw->working);
-		dupe_window_update_progress(dw, _("Queuing…"), dw->setup_count == 0 ? 0.0 : static_cast<gdouble>(dw->setup_n) / dw->setup_count, FALSE);
-		dw->setup_n++;
-		dw->queue_count++;
-
-		dw->working = dw->working->prev; /* Is NULL when complete */
-		}
-	else
-		{
-		/* This is the comparison for all other parameters.
-		 * dupe_array_check() processes the entire list in one go
-		*/
-		dw->working = nullptr;
-		dupe_window_update_progress(dw, _("Comparing…"), 0.0, FALSE);
-		dupe_array_check(dw);
-		}
-
-	return G_SOURCE_CONTINUE;
-}
-
-static void dupe_check_start(DupeWindow *dw)
-{
-	dw->setup_done = FALSE;
-
-	dw->setup_count = g_list_length(dw->list);
-	if (dw->second_set) dw->setup_count += g_list_length(dw->second_list);
-
-	dw->setup_mask = DUPE_MATCH_NONE;
-	dupe_setup_reset(dw);
-
-	dw->working = g_list_last(dw->list);
-
-	dupe_window_update_count(dw, TRUE);
-	widget_set_cursor(dw->listview, GDK_WATCH);
-	dw->queue_count = 0;
-	dw->thread_count = 0;
-	dw->search_matches_sorted = nullptr;
-	dw->abort = FALSE;
-
-	if (dw->idle_id) return;
-
-	dw->idle_id = g_idle_add(dupe_check_cb, dw);
-}
-
-static gboolean dupe_check_start_cb(gpointer data)
-{
-	dupe_check_start(static_cast<DupeWindow *>(data));
-
-	return G_SOURCE_REMOVE;
-}
-
-/*
- * ------------------------------------------------------------------
- * Item addition, removal
- * ------------------------------------------------------------------
- */
-
-static void dupe_item_remove(DupeWindow *dw, DupeItem *di)
-{
-	if (!di) return;
-
-	/* handle things that may be in progress… */
-	if (dw->working && dw->working->data == di)
-		{
-		dw->working = dw->working->prev;
-		}
-	if (dw->thumb_loader && dw->thumb_item == di)
-		{
-		dupe_thumb_step(dw);
-		}
-	if (dw->setup_point && dw->setup_point->data == di)
-		{
-		dw->setup_point = dupe_setup_point_step(dw, dw->setup_point);
-		if (dw->img_loader)
-			{
-			image_loader_free(dw->img_loader);
-			dw->img_loader = nullptr;
-			dw->idle_id = g_idle_add(dupe_check_cb, dw);
-			}
-		}
-
-	if (di->group && dw->dupes)
-		{
-		/* is a dupe, must remove from group/reset children if a parent */
-		DupeItem *parent;
-
-		parent = dupe_match_find_parent(dw, di);
-		if (di == parent)
-			{
-			if (g_list_length(parent->group) < 2)
-				{
-				DupeItem *child;
-
-				child = dupe_match_highest_rank(parent);
-				dupe_match_link_clear(child, TRUE);
-				dupe_listview_remove(dw, child);
-
-				dupe_match_link_clear(parent, TRUE);
-				dupe_listview_remove(dw, parent);
-				dw->dupes = g_list_remove(dw->dupes, parent);
-				}
-			else
-				{
-				DupeItem *new_parent;
-				DupeMatch *dm;
-
-				dm = static_cast<DupeMatch *>(parent->group->data);
-				new_parent = dm->di;
-				dupe_match_reparent(dw, parent, new_parent);
-				dupe_listview_remove(dw, parent);
-				}
-			}
-		else
-			{
-			if (g_list_length(parent->group) < 2)
-				{
-				dupe_match_link_clear(parent, TRUE);
-				dupe_listview_remove(dw, parent);
-				dw->dupes = g_list_remove(dw->dupes, parent);
-				}
-			dupe_match_link_clear(di, TRUE);
-			dupe_listview_remove(dw, di);
-			}
-		}
-	else
-		{
-		/* not a dupe, or not sorted yet, simply reset */
-		dupe_match_link_clear(di, TRUE);
-		}
-
-	if (dw->second_list && g_list_find(dw->second_list, di))
-		{
-		dupe_second_remove(dw, di);
-		}
-	else
-		{
-		dw->list = g_list_remove(dw->list, di);
-		}
-	dupe_item_free(di);
-
-	dupe_window_update_count(dw, FALSE);
-}
-
-static gboolean dupe_files_add_queue_cb(gpointer data)
-{
-	auto *dw = static_cast<DupeWindow *>(data);
-
-	gtk_progress_bar_pulse(GTK_PROGRESS_BAR(dw->extra_label));
-
-	if (dw->add_files_queue != nullptr)
-		{
-		DupeItem *di = nullptr;
+		DupeItem *di;
 
-		auto *fd = static_cast<FileData *>(dw->add_files_queue->data);
-		if (fd)
+		gtk_tree_model_get(store, &iter, DUPE_COLUMN_POINTER, &di, DUPE_COLUMN_SET, &set_count, -1);
+		if (set_count != set_count_last)
 			{
-			if (isfile(fd->path))
-				{
-				di = dupe_item_new(fd);
-				}
-			else if (isdir(fd->path))
-				{
-				GList *f;
-				GList *d;
-				dw->add_files_queue = g_list_remove(dw->add_files_queue, g_list_first(dw->add_files_queue)->data);
-
-				if (filelist_read(fd, &f, &d))
-					{
-					f = filelist_filter(f, FALSE);
-					d = filelist_filter(d, TRUE);
-
-					dw->add_files_queue = g_list_concat(f, dw->add_files_queue);
-					dw->add_files_queue = g_list_concat(d, dw->add_files_queue);
-					}
-				}
-			else
+			set_count_last = set_count;
+			if (parents == DUPE_SELECT_GROUP1)
 				{
-				/* Not a file and not a dir */
-				dw->add_files_queue = g_list_remove(dw->add_files_queue, g_list_first(dw->add_files_queue)->data);
+				gtk_tree_selection_select_iter(selection, &iter);
 				}
 			}
-
-		if (!di)
+		else
 			{
-			/* A dir was found. Process the contents on next entry */
-			return G_SOURCE_CONTINUE;
+			if (parents == DUPE_SELECT_GROUP2)
+				{
+				gtk_tree_selection_select_iter(selection, &iter);
+				}
 			}
+		valid = gtk_tree_model_iter_next(store, &iter);
+		}
+}
 
-		dw->add_files_queue = g_list_remove(dw->add_files_queue, g_list_first(dw->add_files_queue)->data);
-
-		dupe_item_read_cache(di);
-
-		/* Ensure images in the lists have unique FileDatas */
-		if (!dupe_insert_in_list_cache(dw, di->fd))
-			{
-			dupe_item_free(di);
-			return G_SOURCE_CONTINUE;
-			}
+/*
+ * ------------------------------------------------------------------
+ * Thumbnail handling
+ * ------------------------------------------------------------------
+ */
 
-		if (dw->second_drop)
-			{
-			dupe_second_add(dw, di);
-			}
-		else
-			{
-			dw->list = g_list_prepend(dw->list, di);
-			}
+static void dupe_listview_set_thumb(DupeWindow *dw, DupeItem *di, GtkTreeIter *iter)
+{
+	GtkListStore *store;
+	GtkTreeIter iter_n;
 
-		if (dw->add_files_queue != nullptr)
+	store = GTK_LIST_STORE(gtk_tree_view_get_model(GTK_TREE_VIEW(dw->listview)));
+	if (!iter)
+		{
+		if (dupe_listview_find_item(store, di, &iter_n) >= 0)
 			{
-			return G_SOURCE_CONTINUE;
+			iter = &iter_n;
 			}
 		}
 
-	dw->add_files_queue_id = 0;
-	dupe_destroy_list_cache(dw);
-	g_idle_add(dupe_check_start_cb, dw);
-	gtk_widget_set_sensitive(dw->controls_box, TRUE);
-	return G_SOURCE_REMOVE;
+	if (iter) gtk_list_store_set(store, iter, DUPE_COLUMN_THUMB, di->pixbuf, -1);
 }
 
-static void dupe_files_add(DupeWindow *dw, CollectInfo *info,
-                           FileData *fd, gboolean recurse)
+static void dupe_thumb_do(DupeWindow *dw)
 {
-	DupeItem *di = nullptr;
+	DupeItem *di;
 
-	if (info)
-		{
-		di = dupe_item_new(info->fd);
-		}
-	else if (fd)
-		{
-		if (isfile(fd->path) && !g_file_test(fd->path, G_FILE_TEST_IS_SYMLINK))
-			{
-			di = dupe_item_new(fd);
-			}
-		else if (isdir(fd->path) && recurse)
-			{
-			GList *f;
-			GList *d;
-			if (filelist_read(fd, &f, &d))
-				{
-				GList *work;
+	if (!dw->thumb_loader || !dw->thumb_item) return;
+	di = dw->thumb_item;
+
+	if (di->pixbuf) g_object_unref(di->pixbuf);
+	di->pixbuf = thumb_loader_get_pixbuf(dw->thumb_loader);
 
-				f = filelist_filter(f, FALSE);
-				d = filelist_filter(d, TRUE);
+	dupe_listview_set_thumb(dw, di, nullptr);
+}
 
-				work = f;
-				while (work)
-					{
-					dupe_files_add(dw, nullptr, static_cast<FileData *>(work->data), TRUE);
-					work = work->next;
-					}
-				file_data_list_free(f);
-				work = d;
-				while (work)
-					{
-					dupe_files_add(dw, nullptr, static_cast<FileData *>(work->data), TRUE);
-					work = work->next;
-					}
-				file_data_list_free(d);
-				}
-			}
-		}
+static void dupe_thumb_error_cb(ThumbLoader *, gpointer data)
+{
+	auto dw = static_cast<DupeWindow *>(data);
 
-	if (!di) return;
+	dupe_thumb_do(dw);
+	dupe_thumb_step(dw);
+}
 
-	dupe_item_read_cache(di);
+static void dupe_thumb_done_cb(ThumbLoader *, gpointer data)
+{
+	auto dw = static_cast<DupeWindow *>(data);
 
-	/* Ensure images in the lists have unique FileDatas */
-	GList *work;
-	DupeItem *di_list;
-	work = g_list_first(dw->list);
-	while (work)
-		{
-		di_list = static_cast<DupeItem *>(work->data);
-		if (di_list->fd == di->fd)
-			{
-			return;
-			}
+	dupe_thumb_do(dw);
+	dupe_thumb_step(dw);
+}
 
-		work = work->next;
-		}
+static void dupe_thumb_step(DupeWindow *dw)
+{
+	GtkTreeModel *store;
+	GtkTreeIter iter;
+	DupeItem *di = nullptr;
+	gboolean valid;
+	gint row = 0;
+	gint length = 0;
+
+	store = gtk_tree_view_get_model(GTK_TREE_VIEW(dw->listview));
+	valid = gtk_tree_model_get_iter_first(store, &iter);
 
-	if (dw->second_list)
+	while (!di && valid)
 		{
-		work = g_list_first(dw->second_list);
-		while (work)
-			{
-			di_list = static_cast<DupeItem *>(work->data);
-			if (di_list->fd == di->fd)
-				{
-				return;
-				}
+		GdkPixbuf *pixbuf;
 
-			work = work->next;
+		length++;
+		gtk_tree_model_get(store, &iter, DUPE_COLUMN_POINTER, &di, DUPE_COLUMN_THUMB, &pixbuf, -1);
+		if (pixbuf || di->pixbuf)
+			{
+			if (!pixbuf) gtk_list_store_set(GTK_LIST_STORE(store), &iter, DUPE_COLUMN_THUMB, di->pixbuf, -1);
+			row++;
+			di = nullptr;
 			}
+		valid = gtk_tree_model_iter_next(store, &iter);
 		}
-
-	if (dw->second_drop)
+	if (valid)
 		{
-		dupe_second_add(dw, di);
+		while (gtk_tree_model_iter_next(store, &iter)) length++;
 		}
-	else
+
+	if (!di)
 		{
-		dw->list = g_list_prepend(dw->list, di);
+		dw->thumb_item = nullptr;
+		thumb_loader_free(dw->thumb_loader);
+		dw->thumb_loader = nullptr;
+
+		dupe_window_update_progress(dw, nullptr, 0.0);
+		return;
 		}
-}
 
-static void dupe_init_list_cache(DupeWindow *dw)
-{
-	dw->list_cache = g_hash_table_new(g_direct_hash, g_direct_equal);
-	dw->second_list_cache = g_hash_table_new(g_direct_hash, g_direct_equal);
+	dupe_window_update_progress(dw, _("Loading thumbs…"),
+				    length == 0 ? 0.0 : static_cast<gdouble>(row) / length);
 
-	for (GList *i = dw->list; i != nullptr; i = i->next)
-		{
-			auto di = static_cast<DupeItem *>(i->data);
+	dw->thumb_item = di;
+	thumb_loader_free(dw->thumb_loader);
+	dw->thumb_loader = thumb_loader_new(options->thumbnails.max_width, options->thumbnails.max_height);
 
-			g_hash_table_add(dw->list_cache, di->fd);
-		}
+	thumb_loader_set_callbacks(dw->thumb_loader,
+				   dupe_thumb_done_cb,
+				   dupe_thumb_error_cb,
+				   nullptr,
+				   dw);
 
-	for (GList *i = dw->second_list; i != nullptr; i = i->next)
+	/* start it */
+	if (!thumb_loader_start(dw->thumb_loader, di->fd))
 		{
-			auto di = static_cast<DupeItem *>(i->data);
-
-			g_hash_table_add(dw->second_list_cache, di->fd);
+		/* error, handle it, do next */
+		DEBUG_1("error loading thumb for %s", di->fd->path);
+		dupe_thumb_do(dw);
+		dupe_thumb_step(dw);
 		}
 }
 
-static void dupe_destroy_list_cache(DupeWindow *dw)
+static void dupe_window_check_stop(DupeWindow *dw)
 {
-	g_hash_table_destroy(dw->list_cache);
-	g_hash_table_destroy(dw->second_list_cache);
+	dupe_engine_check_stop(dw->engine);
+
+	thumb_loader_free(dw->thumb_loader);
+	dw->thumb_loader = nullptr;
+	dw->thumb_item = nullptr;
+
+	dupe_window_update_progress(dw, nullptr, 0.0);
+	widget_set_cursor(dw->listview, -1);
+	gtk_widget_set_sensitive(dw->controls_box, TRUE);
 }
 
-/**
- * @brief Return true if the fd was not in the cache
- * @param dw
- * @param fd
- * @returns
- *
- *
- */
-static gboolean dupe_insert_in_list_cache(DupeWindow *dw, FileData *fd)
+static void dupe_check_stop_cb(GtkWidget *, gpointer data)
 {
-	GHashTable *table =
-		dw->second_drop ? dw->second_list_cache : dw->list_cache;
-	/* We do this as a lookup + add as we don't want to overwrite
-	   items as that would leak the old value. */
-	if (g_hash_table_lookup(table, fd) != nullptr)
-		return FALSE;
-	return g_hash_table_add(table, fd);
+	auto dw = static_cast<DupeWindow *>(data);
+
+	dupe_window_check_stop(dw);
 }
 
 void dupe_window_add_collection(DupeWindow *dw, CollectionData *collection)
 {
-	CollectInfo *info;
-
-	info = collection_get_first(collection);
-	while (info)
-		{
-		dupe_files_add(dw, info, nullptr, FALSE);
-		info = collection_next_by_info(collection, info);
-		}
-
-	dupe_check_start(dw);
+	dupe_engine_add_collection(dw->engine, collection);
 }
 
 void dupe_window_add_files(DupeWindow *dw, GList *list, gboolean recurse)
 {
-	GList *work;
-
-	work = list;
-	while (work)
-		{
-		auto fd = static_cast<FileData *>(work->data);
-		work = work->next;
-		if (isdir(fd->path) && !recurse)
-			{
-			GList *f;
-			GList *d;
-
-			if (filelist_read(fd, &f, &d))
-				{
-				GList *work_file;
-				work_file = f;
-
-				while (work_file)
-					{
-					/* Add only the files, ignore the dirs when no recurse */
-					dw->add_files_queue = g_list_prepend(dw->add_files_queue, work_file->data);
-					file_data_ref((FileData *)work_file->data);
-					work_file = work_file->next;
-					}
-				g_list_free(f);
-				g_list_free(d);
-				}
-			}
-		else
-			{
-			dw->add_files_queue = g_list_prepend(dw->add_files_queue, fd);
-			file_data_ref(fd);
-			}
-		}
-	if (dw->add_files_queue_id == 0)
-		{
-		gtk_progress_bar_pulse(GTK_PROGRESS_BAR(dw->extra_label));
-		gtk_progress_bar_set_pulse_step(GTK_PROGRESS_BAR(dw->extra_label), DUPE_PROGRESS_PULSE_STEP);
-		gtk_progress_bar_set_text(GTK_PROGRESS_BAR(dw->extra_label), _("Loading file list"));
-
-		dupe_init_list_cache(dw);
-		dw->add_files_queue_id = g_idle_add(dupe_files_add_queue_cb, dw);
-		gtk_widget_set_sensitive(dw->controls_box, FALSE);
-		}
+	dupe_engine_add_files(dw->engine, list, recurse);
 }
 
-void dupe_window_add_folder(const gchar *path, gboolean recurse)
+void dupe_window_add_folder(DupeWindow *dw, const gchar *path, gboolean recurse)
 {
-	DupeWindow *dw = dupe_window_new();
+	if (!dw) dw = dupe_window_new();
+
 	FileData *fd = file_data_new_simple(path);
 	g_autoptr(GList) list = nullptr;
 	list = g_list_append(list, fd);
 
 	dupe_window_add_files(dw, list, recurse);
 
-	dupe_check_start(dw);
+	dupe_engine_check_start(dw->engine);
 
 	file_data_unref(fd);
 }
 
+/**
+ * @brief Returns the window of the session file \a path, opening it if needed
+ * @param path In UTF-8
+ * @returns The window, restored from \a path if the file exists
+ *
+ * The results are written to \a path whenever a check is complete. Checks
+ * of a session window only compare the files added since the previous one.
+ */
+DupeWindow *dupe_window_session(const gchar *path)
+{
+	for (GList *work = dupe_window_list; work; work = work->next)
+		{
+		auto dw = static_cast<DupeWindow *>(work->data);
+
+		if (g_strcmp0(dw->engine->session_path, path) == 0) return dw;
+		}
+
+	DupeWindow *dw = dupe_window_new();
+	dw->engine->session_path = g_strdup(path);
+
+	dupe_engine_session_load(dw->engine);
+	if (dw->engine->second_set)
+		{
+		g_signal_handlers_block_by_func(dw->button_second_set, (gpointer)dupe_second_set_toggle_cb, dw);
+		gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(dw->button_second_set), TRUE);
+		g_signal_handlers_unblock_by_func(dw->button_second_set, (gpointer)dupe_second_set_toggle_cb, dw);
+		dupe_second_update_status(dw);
+		gtk_widget_show(dw->second_vbox);
+		}
+	dupe_engine_check_start(dw->engine);
+
+	return dw;
+}
+
 static void dupe_item_update(DupeWindow *dw, DupeItem *di)
 {
-	if ( (dw->match_mask & DUPE_MATCH_NAME) || (dw->match_mask & DUPE_MATCH_PATH || (dw->match_mask & DUPE_MATCH_NAME_CI)) )
+	if ( (dw->engine->match_mask & DUPE_MATCH_NAME) || (dw->engine->match_mask & DUPE_MATCH_PATH || (dw->engine->match_mask & DUPE_MATCH_NAME_CI)) )
 		{
 		/* only effects matches on name or path */
 /*
@@ -2771,13 +714,13 @@ static void dupe_item_update(DupeWindow *dw, DupeItem *di)
 		second = di->second;
 		dupe_item_remove(dw, di);
 
-		dw->second_drop = second;
+		dw->engine->second_drop = second;
 		dupe_files_add(dw, nullptr, fd, FALSE);
-		dw->second_drop = FALSE;
+		dw->engine->second_drop = FALSE;
 
 		file_data_unref(fd);
 */
-		dupe_check_start(dw);
+		dupe_engine_check_start(dw->engine);
 		}
 	else
 		{
@@ -2823,8 +766,8 @@ static void dupe_item_update_fd_in_list(DupeWindow *dw, FileData *fd, GList *wor
 
 static void dupe_item_update_fd(DupeWindow *dw, FileData *fd)
 {
-	dupe_item_update_fd_in_list(dw, fd, dw->list);
-	if (dw->second_set) dupe_item_update_fd_in_list(dw, fd, dw->second_list);
+	dupe_item_update_fd_in_list(dw, fd, dw->engine->list);
+	if (dw->engine->second_set) dupe_item_update_fd_in_list(dw, fd, dw->engine->second_list);
 }
 
 
@@ -2878,10 +821,11 @@ static void dupe_display_stats(DupeWindow *dw, DupeItem *di)
 
 	dupe_display_label(gd->vbox, "md5sum:", di->md5sum.value_or("not generated"s).c_str());
 
-	dupe_display_label(gd->vbox, "thumbprint:", (di->simd) ? "" : "not generated");
-	if (di->simd)
+	const ImageSimilarityData *sd = dupe_engine_item_simd(dw->engine, di);
+	dupe_display_label(gd->vbox, "thumbprint:", sd ? "" : "not generated");
+	if (sd)
 		{
-		g_autoptr(GdkPixbuf) pixbuf = di->simd->to_pixbuf();
+		g_autoptr(GdkPixbuf) pixbuf = sd->to_pixbuf();
 
 		GtkWidget *image = gtk_image_new_from_pixbuf(pixbuf);
 		gq_gtk_box_pack_start(GTK_BOX(gd->vbox), image, FALSE, FALSE, 0);
@@ -2895,19 +839,13 @@ static void dupe_window_recompare(DupeWindow *dw)
 {
 	GtkListStore *store;
 
-	dupe_check_stop(dw);
+	dupe_window_check_stop(dw);
 
 	store = GTK_LIST_STORE(gtk_tree_view_get_model(GTK_TREE_VIEW(dw->listview)));
 	gtk_list_store_clear(store);
-
-	g_list_free(dw->dupes);
-	dw->dupes = nullptr;
-
-	dupe_match_reset_list(dw->list);
-	dupe_match_reset_list(dw->second_list);
 	dw->set_count = 0;
 
-	dupe_check_start(dw);
+	dupe_engine_recompare(dw->engine);
 }
 
 static void dupe_menu_view(DupeItem *di, GtkWidget *listview, gboolean new_window)
@@ -2966,7 +904,7 @@ static void dupe_window_remove_selection(DupeWindow *dw, GtkWidget *listview)
 
 		di = static_cast<DupeItem *>(work->data);
 		work = work->next;
-		dupe_item_remove(dw, di);
+		dupe_engine_item_remove(dw->engine, di);
 		}
 	dw->color_frozen = FALSE;
 
@@ -3004,7 +942,7 @@ static void dupe_window_collection_from_selection(DupeWindow *dw)
 
 static void dupe_window_append_file_list(DupeWindow *dw, gint on_second)
 {
-	dw->second_drop = (dw->second_set && on_second);
+	dw->engine->second_drop = (dw->engine->second_set && on_second);
 
 	g_autoptr(FileDataList) list = layout_list(nullptr);
 	dupe_window_add_files(dw, list, FALSE);
@@ -3177,13 +1115,13 @@ static GtkWidget *dupe_menu_popup_main(DupeWindow *dw, DupeItem *di)
 	menu_item_add_icon_sensitive(menu, _("View in _new window"), GQ_ICON_NEW, on_row,
 	                             G_CALLBACK(dupe_menu_view_cb<TRUE>), dw);
 	menu_item_add_divider(menu);
-	menu_item_add_sensitive(menu, _("Select all"), (dw->dupes != nullptr),
+	menu_item_add_sensitive(menu, _("Select all"), (dw->engine->dupes != nullptr),
 				G_CALLBACK(dupe_menu_select_all_cb), dw);
-	menu_item_add_sensitive(menu, _("Select none"), (dw->dupes != nullptr),
+	menu_item_add_sensitive(menu, _("Select none"), (dw->engine->dupes != nullptr),
 				G_CALLBACK(dupe_menu_select_none_cb), dw);
-	menu_item_add_sensitive(menu, _("Select group _1 duplicates"), (dw->dupes != nullptr),
+	menu_item_add_sensitive(menu, _("Select group _1 duplicates"), (dw->engine->dupes != nullptr),
 	                        G_CALLBACK(dupe_menu_select_dupes_cb<DUPE_SELECT_GROUP1>), dw);
-	menu_item_add_sensitive(menu, _("Select group _2 duplicates"), (dw->dupes != nullptr),
+	menu_item_add_sensitive(menu, _("Select group _2 duplicates"), (dw->engine->dupes != nullptr),
 	                        G_CALLBACK(dupe_menu_select_dupes_cb<DUPE_SELECT_GROUP2>), dw);
 	menu_item_add_divider(menu);
 
@@ -3225,7 +1163,7 @@ static GtkWidget *dupe_menu_popup_main(DupeWindow *dw, DupeItem *di)
 	menu_item_add_divider(menu);
 	menu_item_add_icon_sensitive(menu, _("Rem_ove"), GQ_ICON_REMOVE, on_row,
 				G_CALLBACK(dupe_menu_remove_cb), dw);
-	menu_item_add_icon_sensitive(menu, _("C_lear"), GQ_ICON_CLEAR, (dw->list != nullptr),
+	menu_item_add_icon_sensitive(menu, _("C_lear"), GQ_ICON_CLEAR, (dw->engine->list != nullptr),
 				G_CALLBACK(dupe_menu_clear_cb), dw);
 	menu_item_add_divider(menu);
 	menu_item_add_icon(menu, _("Close _window"), GQ_ICON_CLOSE,
@@ -3382,7 +1320,7 @@ static gboolean dupe_listview_release_cb(GtkWidget *widget, GdkEventButton *beve
 
 static void dupe_second_update_status(DupeWindow *dw)
 {
-	g_autofree gchar *buf = g_strdup_printf(_("%d files (set 2)"), g_list_length(dw->second_list));
+	g_autofree gchar *buf = g_strdup_printf(_("%d files (set 2)"), g_list_length(dw->engine->second_list));
 	gtk_label_set_text(GTK_LABEL(dw->second_status_label), buf);
 }
 
@@ -3391,11 +1329,6 @@ static void dupe_second_add(DupeWindow *dw, DupeItem *di)
 	GtkListStore *store;
 	GtkTreeIter iter;
 
-	if (!di) return;
-
-	di->second = TRUE;
-	dw->second_list = g_list_prepend(dw->second_list, di);
-
 	store = GTK_LIST_STORE(gtk_tree_view_get_model(GTK_TREE_VIEW(dw->second_listview)));
 	gtk_list_store_append(store, &iter);
 	gtk_list_store_set(store, &iter, DUPE_COLUMN_POINTER, di, 1, di->fd->path, -1);
@@ -3415,8 +1348,6 @@ static void dupe_second_remove(DupeWindow *dw, DupeItem *di)
 		gtk_list_store_remove(store, &iter);
 		}
 
-	dw->second_list = g_list_remove(dw->second_list, di);
-
 	dupe_second_update_status(dw);
 }
 
@@ -3428,13 +1359,7 @@ static void dupe_second_clear(DupeWindow *dw)
 	gtk_list_store_clear(store);
 	gtk_tree_view_columns_autosize(GTK_TREE_VIEW(dw->second_listview));
 
-	g_list_free(dw->dupes);
-	dw->dupes = nullptr;
-
-	g_list_free_full(dw->second_list, reinterpret_cast<GDestroyNotify>(dupe_item_free));
-	dw->second_list = nullptr;
-
-	dupe_match_reset_list(dw->list);
+	dupe_engine_second_clear(dw->engine);
 
 	dupe_second_update_status(dw);
 }
@@ -3483,7 +1408,7 @@ static void dupe_second_menu_clear_cb(GtkWidget *, gpointer data)
 static GtkWidget *dupe_menu_popup_second(DupeWindow *dw, DupeItem *di)
 {
 	GtkWidget *menu;
-	gboolean notempty = (dw->second_list != nullptr);
+	gboolean notempty = (dw->engine->second_list != nullptr);
 	gboolean on_row = (di != nullptr);
 	GtkAccelGroup *accel_group;
 
@@ -3519,9 +1444,9 @@ static void dupe_second_set_toggle_cb(GtkWidget *widget, gpointer data)
 {
 	auto dw = static_cast<DupeWindow *>(data);
 
-	dw->second_set = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(widget));
+	dw->engine->second_set = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(widget));
 
-	if (dw->second_set)
+	if (dw->engine->second_set)
 		{
 		dupe_second_update_status(dw);
 		gtk_widget_show(dw->second_vbox);
@@ -3565,11 +1490,11 @@ static void dupe_menu_type_cb(GtkWidget *combo, gpointer data)
 
 	store = gtk_combo_box_get_model(GTK_COMBO_BOX(combo));
 	if (!gtk_combo_box_get_active_iter(GTK_COMBO_BOX(combo), &iter)) return;
-	gtk_tree_model_get(store, &iter, DUPE_MENU_COLUMN_MASK, &dw->match_mask, -1);
+	gtk_tree_model_get(store, &iter, DUPE_MENU_COLUMN_MASK, &dw->engine->match_mask, -1);
 
-	options->duplicates_match = dw->match_mask;
+	options->duplicates_match = dw->engine->match_mask;
 
-	dupe_listview_show_rank(dw->listview, dw->match_mask & DUPE_MATCH_SIM);
+	dupe_listview_show_rank(dw->listview, dw->engine->match_mask & DUPE_MATCH_SIM);
 	dupe_window_recompare(dw);
 }
 
@@ -3581,7 +1506,7 @@ static void dupe_menu_add_item(GtkListStore *store, const gchar *text, DupeMatch
 	gtk_list_store_set(store, &iter, DUPE_MENU_COLUMN_NAME, text,
 					 DUPE_MENU_COLUMN_MASK, type, -1);
 
-	if (dw->match_mask == type) gtk_combo_box_set_active_iter(GTK_COMBO_BOX(dw->combo), &iter);
+	if (dw->engine->match_mask == type) gtk_combo_box_set_active_iter(GTK_COMBO_BOX(dw->combo), &iter);
 }
 
 static void dupe_menu_setup(DupeWindow *dw)
@@ -3751,7 +1676,7 @@ static void dupe_window_show_thumb_cb(GtkWidget *widget, gpointer data)
 
 	if (dw->show_thumbs)
 		{
-		if (!dw->working) dupe_thumb_step(dw);
+		if (!dw->engine->working) dupe_thumb_step(dw);
 		}
 	else
 		{
@@ -3770,7 +1695,7 @@ static void dupe_window_show_thumb_cb(GtkWidget *widget, gpointer data)
 			gtk_list_store_set(GTK_LIST_STORE(store), &iter, DUPE_COLUMN_THUMB, NULL, -1);
 			valid = gtk_tree_model_iter_next(store, &iter);
 			}
-		dupe_window_update_progress(dw, nullptr, 0.0, FALSE);
+		dupe_window_update_progress(dw, nullptr, 0.0);
 		}
 
 	dupe_listview_set_height(dw->listview, dw->show_thumbs);
@@ -3793,7 +1718,7 @@ static void dupe_window_custom_threshold_cb(GtkSpinButton *custom_threshold, gpo
 	GtkTreeIter iter;
 
 	options->duplicates_similarity_threshold = gtk_spin_button_get_value_as_int(custom_threshold);
-	dw->match_mask = DUPE_MATCH_SIM_CUSTOM;
+	dw->engine->match_mask = DUPE_MATCH_SIM_CUSTOM;
 
 	store = gtk_combo_box_get_model(GTK_COMBO_BOX(dw->combo));
 	valid = gtk_tree_model_get_iter_first(store, &iter);
@@ -4010,23 +1935,17 @@ void dupe_window_clear(DupeWindow *dw)
 {
 	GtkListStore *store;
 
-	dupe_check_stop(dw);
+	dupe_window_check_stop(dw);
 
 	store = GTK_LIST_STORE(gtk_tree_view_get_model(GTK_TREE_VIEW(dw->listview)));
 	gtk_list_store_clear(store);
 	gtk_tree_view_columns_autosize(GTK_TREE_VIEW(dw->listview));
 
-	g_list_free(dw->dupes);
-	dw->dupes = nullptr;
-
-	g_list_free_full(dw->list, reinterpret_cast<GDestroyNotify>(dupe_item_free));
-	dw->list = nullptr;
+	dupe_engine_clear(dw->engine);
 	dw->set_count = 0;
 
-	dupe_match_reset_list(dw->second_list);
-
 	dupe_window_update_count(dw, FALSE);
-	dupe_window_update_progress(dw, nullptr, 0.0, FALSE);
+	dupe_window_update_progress(dw, nullptr, 0.0);
 }
 
 static void dupe_window_get_geometry(DupeWindow *dw)
@@ -4040,22 +1959,16 @@ static void dupe_window_get_geometry(DupeWindow *dw)
 
 void dupe_window_close(DupeWindow *dw)
 {
-	dupe_check_stop(dw);
+	dupe_window_check_stop(dw);
 
 	dupe_window_get_geometry(dw);
 
 	dupe_window_list = g_list_remove(dupe_window_list, dw);
 	gq_gtk_widget_destroy(dw->window);
 
-	g_list_free(dw->dupes);
-	g_list_free_full(dw->list, reinterpret_cast<GDestroyNotify>(dupe_item_free));
-
-	g_list_free_full(dw->second_list, reinterpret_cast<GDestroyNotify>(dupe_item_free));
-
 	file_data_unregister_notify_func(dupe_notify_cb, dw);
 
-	g_thread_pool_free(dw->dupe_comparison_thread_pool, TRUE, TRUE);
-
+	dupe_engine_free(dw->engine);
 	g_free(dw);
 }
 
@@ -4150,6 +2063,58 @@ static void column_clicked_cb(GtkWidget *,  gpointer data)
 }
 
 /* collection and files can be NULL */
+/**
+ * @brief Connects the engine of \a dw to the widgets
+ * @param dw
+ */
+static void dupe_window_engine_setup(DupeWindow *dw)
+{
+	DupeEngine *de = dw->engine;
+
+	de->progress_func = [dw](DupeEngine *, const gchar *text, gdouble fraction)
+		{
+		dupe_window_update_progress(dw, text, fraction);
+		};
+	de->files_func = [dw](DupeEngine *, gboolean adding)
+		{
+		gtk_widget_set_sensitive(dw->controls_box, !adding);
+		};
+	de->start_func = [dw](DupeEngine *)
+		{
+		dupe_window_update_count(dw, TRUE);
+		widget_set_cursor(dw->listview, GDK_WATCH);
+		};
+	de->added_func = [dw](DupeEngine *, DupeItem *di)
+		{
+		dupe_second_add(dw, di);
+		};
+	de->ungrouped_func = [dw](DupeEngine *, DupeItem *di)
+		{
+		dupe_listview_remove(dw, di);
+		};
+	de->removed_func = [dw](DupeEngine *, DupeItem *di)
+		{
+		if (di->second) dupe_second_remove(dw, di);
+
+		if (dw->thumb_loader && dw->thumb_item == di)
+			{
+			dupe_thumb_step(dw);
+			}
+
+		dupe_window_update_count(dw, FALSE);
+		};
+	de->done_func = [dw](DupeEngine *)
+		{
+		dupe_window_update_count(dw, FALSE);
+		dupe_listview_populate(dw);
+
+		/* check thumbs */
+		if (dw->show_thumbs) dupe_thumb_step(dw);
+
+		widget_set_cursor(dw->listview, -1);
+		};
+}
+
 DupeWindow *dupe_window_new()
 {
 	DupeWindow *dw;
@@ -4165,25 +2130,24 @@ DupeWindow *dupe_window_new()
 	GtkListStore *store;
 	GdkGeometry geometry;
 
+	DupeMatchType match_mask = DUPE_MATCH_NAME;
+	if (options->duplicates_match == DUPE_MATCH_NAME) match_mask = DUPE_MATCH_NAME;
+	if (options->duplicates_match == DUPE_MATCH_SIZE) match_mask = DUPE_MATCH_SIZE;
+	if (options->duplicates_match == DUPE_MATCH_DATE) match_mask = DUPE_MATCH_DATE;
+	if (options->duplicates_match == DUPE_MATCH_DIM) match_mask = DUPE_MATCH_DIM;
+	if (options->duplicates_match == DUPE_MATCH_SUM) match_mask = DUPE_MATCH_SUM;
+	if (options->duplicates_match == DUPE_MATCH_PATH) match_mask = DUPE_MATCH_PATH;
+	if (options->duplicates_match == DUPE_MATCH_SIM_HIGH) match_mask = DUPE_MATCH_SIM_HIGH;
+	if (options->duplicates_match == DUPE_MATCH_SIM_MED) match_mask = DUPE_MATCH_SIM_MED;
+	if (options->duplicates_match == DUPE_MATCH_SIM_LOW) match_mask = DUPE_MATCH_SIM_LOW;
+	if (options->duplicates_match == DUPE_MATCH_SIM_CUSTOM) match_mask = DUPE_MATCH_SIM_CUSTOM;
+	if (options->duplicates_match == DUPE_MATCH_NAME_CI) match_mask = DUPE_MATCH_NAME_CI;
+	if (options->duplicates_match == DUPE_MATCH_NAME_CONTENT) match_mask = DUPE_MATCH_NAME_CONTENT;
+	if (options->duplicates_match == DUPE_MATCH_NAME_CI_CONTENT) match_mask = DUPE_MATCH_NAME_CI_CONTENT;
+	if (options->duplicates_match == DUPE_MATCH_ALL) match_mask = DUPE_MATCH_ALL;
+
 	dw = g_new0(DupeWindow, 1);
-	dw->add_files_queue = nullptr;
-	dw->add_files_queue_id = 0;
-
-	dw->match_mask = DUPE_MATCH_NAME;
-	if (options->duplicates_match == DUPE_MATCH_NAME) dw->match_mask = DUPE_MATCH_NAME;
-	if (options->duplicates_match == DUPE_MATCH_SIZE) dw->match_mask = DUPE_MATCH_SIZE;
-	if (options->duplicates_match == DUPE_MATCH_DATE) dw->match_mask = DUPE_MATCH_DATE;
-	if (options->duplicates_match == DUPE_MATCH_DIM) dw->match_mask = DUPE_MATCH_DIM;
-	if (options->duplicates_match == DUPE_MATCH_SUM) dw->match_mask = DUPE_MATCH_SUM;
-	if (options->duplicates_match == DUPE_MATCH_PATH) dw->match_mask = DUPE_MATCH_PATH;
-	if (options->duplicates_match == DUPE_MATCH_SIM_HIGH) dw->match_mask = DUPE_MATCH_SIM_HIGH;
-	if (options->duplicates_match == DUPE_MATCH_SIM_MED) dw->match_mask = DUPE_MATCH_SIM_MED;
-	if (options->duplicates_match == DUPE_MATCH_SIM_LOW) dw->match_mask = DUPE_MATCH_SIM_LOW;
-	if (options->duplicates_match == DUPE_MATCH_SIM_CUSTOM) dw->match_mask = DUPE_MATCH_SIM_CUSTOM;
-	if (options->duplicates_match == DUPE_MATCH_NAME_CI) dw->match_mask = DUPE_MATCH_NAME_CI;
-	if (options->duplicates_match == DUPE_MATCH_NAME_CONTENT) dw->match_mask = DUPE_MATCH_NAME_CONTENT;
-	if (options->duplicates_match == DUPE_MATCH_NAME_CI_CONTENT) dw->match_mask = DUPE_MATCH_NAME_CI_CONTENT;
-	if (options->duplicates_match == DUPE_MATCH_ALL) dw->match_mask = DUPE_MATCH_ALL;
+	dw->engine = dupe_engine_new(match_mask);
 
 	dw->window = window_new("dupe", nullptr, _("Find duplicates"));
 	DEBUG_NAME(dw->window);
@@ -4282,7 +2246,7 @@ DupeWindow *dupe_window_new()
 	gtk_paned_pack2(GTK_PANED(dw->paned), dw->second_vbox, TRUE, FALSE);
 #endif
 
-	if (dw->second_set)
+	if (dw->engine->second_set)
 		{
 		gtk_widget_show(dw->second_vbox);
 		}
@@ -4328,6 +2292,7 @@ DupeWindow *dupe_window_new()
 	gtk_widget_show(dw->status_label);
 
 	dw->extra_label = gtk_progress_bar_new();
+	gtk_progress_bar_set_pulse_step(GTK_PROGRESS_BAR(dw->extra_label), DUPE_PROGRESS_PULSE_STEP);
 	gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(dw->extra_label), 0.0);
 	gtk_progress_bar_set_text(GTK_PROGRESS_BAR(dw->extra_label), "");
 	gtk_progress_bar_set_show_text(GTK_PROGRESS_BAR(dw->extra_label), TRUE);
@@ -4379,12 +2344,12 @@ DupeWindow *dupe_window_new()
 	gq_gtk_box_pack_start(GTK_BOX(controls_box), dw->button_rotation_invariant, FALSE, FALSE, PREF_PAD_SPACE);
 	gtk_widget_show(dw->button_rotation_invariant);
 
-	button = gtk_check_button_new_with_label(_("Compare two file sets"));
-	gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(button), dw->second_set);
-	g_signal_connect(G_OBJECT(button), "toggled",
+	dw->button_second_set = gtk_check_button_new_with_label(_("Compare two file sets"));
+	gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(dw->button_second_set), dw->engine->second_set);
+	g_signal_connect(G_OBJECT(dw->button_second_set), "toggled",
 			 G_CALLBACK(dupe_second_set_toggle_cb), dw);
-	gq_gtk_box_pack_start(GTK_BOX(controls_box), button, FALSE, FALSE, PREF_PAD_SPACE);
-	gtk_widget_show(button);
+	gq_gtk_box_pack_start(GTK_BOX(controls_box), dw->button_second_set, FALSE, FALSE, PREF_PAD_SPACE);
+	gtk_widget_show(dw->button_second_set);
 
 	button_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
 	gq_gtk_box_pack_start(GTK_BOX(vbox), button_box, FALSE, FALSE, 0);
@@ -4427,22 +2392,20 @@ DupeWindow *dupe_window_new()
 	g_signal_connect(G_OBJECT(dw->second_listview), "button_release_event",
 			 G_CALLBACK(dupe_listview_release_cb), dw);
 
+	dupe_window_engine_setup(dw);
+
 	gtk_widget_show(dw->window);
 
 	dupe_listview_set_height(dw->listview, dw->show_thumbs);
 	g_signal_emit_by_name(G_OBJECT(dw->combo), "changed");
 
 	dupe_window_update_count(dw, TRUE);
-	dupe_window_update_progress(dw, nullptr, 0.0, FALSE);
+	dupe_window_update_progress(dw, nullptr, 0.0);
 
 	dupe_window_list = g_list_append(dupe_window_list, dw);
 
 	file_data_register_notify_func(dupe_notify_cb, dw, NOTIFY_PRIORITY_MEDIUM);
 
-	g_mutex_init(&dw->thread_count_mutex);
-	g_mutex_init(&dw->search_matches_mutex);
-	dw->dupe_comparison_thread_pool = g_thread_pool_new(dupe_comparison_func, dw, options->threads.duplicates, FALSE, nullptr);
-
 	return dw;
 }
 
@@ -4565,7 +2528,7 @@ static void dupe_dnd_data_get(GtkWidget *widget, GdkDragContext *context,
 {
 	auto dw = static_cast<DupeWindow *>(data);
 
-	if (dw->add_files_queue_id > 0)
+	if (dw->engine->add_files_queue_id > 0)
 		{
 		warning_dialog(_("Find duplicates"), _("Please wait for the current file selection to be loaded."), GQ_ICON_DIALOG_INFO, dw->window);
 		return;
@@ -4574,7 +2537,7 @@ static void dupe_dnd_data_get(GtkWidget *widget, GdkDragContext *context,
 	GtkWidget *source = gtk_drag_get_source_widget(context);
 	if (source == dw->listview || source == dw->second_listview) return;
 
-	dw->second_drop = (dw->second_set && widget == dw->second_listview);
+	dw->engine->second_drop = (dw->engine->second_set && widget == dw->second_listview);
 
 	g_autoptr(FileDataList) list = nullptr;
 	switch (info)
@@ -4787,7 +2750,7 @@ static GString *export_duplicates_data(DupeWindow *dw, const gchar *sep)
 		g_string_append_printf(output_string, "%d", match_count);
 		output_string = g_string_append(output_string, sep);
 
-		if ((dupe_match_find_parent(dw, di) == di))
+		if ((dupe_engine_find_parent(dw->engine, di) == di))
 			{
 			output_string = g_string_append(output_string, "1");
 			}
@@ -4843,7 +2806,7 @@ GString *export_duplicates_data_command_line()
 
 	auto *dw = static_cast<DupeWindow *>(g_list_last(dupe_window_list)->data);
 
-	if (dw->idle_id != 0) return g_string_new(_("Incomplete"));
+	if (dw->engine->idle_id != 0) return g_string_new(_("Incomplete"));
 
 	GtkTreeSelection *selection = gtk_tree_view_get_selection(GTK_TREE_VIEW(dw->listview));
 	gtk_tree_selection_select_all(selection);
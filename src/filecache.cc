@@ -20,14 +20,19 @@
 
 #include "filecache.h"
 
-#include <algorithm>
 #include <config.h>
+#include <iterator>
 #include <list>
 #include <optional>
+#include <unordered_map>
 
 #include "filedata.h"
 
-/* this implements a simple LRU algorithm */
+/*
+ * This implements a simple LRU algorithm. The entries are kept in a list in
+ * order of use, with a hash table from FileData to list node, so that lookup,
+ * move to front and eviction do not depend on the number of entries.
+ */
 
 #ifdef DEBUG
 constexpr bool debug_file_cache = false; /* Set to true to add file cache dumps to the debug output */
@@ -64,6 +69,7 @@ bool FileCache::remove_entry(FileCache::ListIterT entry_iter)
 	DEBUG_1("cache remove: fc=%p %s", (void *)this, entry.fd->path);
 
 	size_ -= entry.size;
+	index_.erase(entry.fd);
 	release_(entry.fd);
 	file_data_unref(entry.fd);
 	contents_.erase(entry_iter);
@@ -73,12 +79,9 @@ bool FileCache::remove_entry(FileCache::ListIterT entry_iter)
 
 std::optional<FileCache::ListIterT> FileCache::find_by_fd(FileData *fd)
 {
-	const auto entry_iter = std::find_if(
-		contents_.begin(),
-		contents_.end(),
-		[fd](const Entry &entry) { return entry.fd == fd; });
+	const auto index_iter = index_.find(fd);
 
-	if (entry_iter != contents_.end()) return entry_iter;
+	if (index_iter != index_.end()) return index_iter->second;
 	return std::nullopt;
 }
 
@@ -105,26 +108,24 @@ void FileCache::shrink_to_max_size()
 
 	g_assert((size_ == 0) == contents_.empty());  // Assert that size is consistent with emptiness.
 
-	if (contents_.empty()) return;
-	auto entry_iter = std::prev(contents_.end());
-	while(size_ > max_size_ && entry_iter != contents_.begin())
+	// Evict from the least recently used end.  An entry that is being checked for changes is
+	// skipped: this resize was then implicitly triggered during a file_cache_get call, and any
+	// file_cache_put after the file_cache_get will re-trigger the shrink and correct the cache
+	// size, if needed.
+	auto entry_iter = contents_.end();
+	while (size_ > max_size_ && entry_iter != contents_.begin())
 		{
-		// This is valid since the list is guaranteed non-empty.
-		auto evict_iter = entry_iter;
-		--entry_iter;
-
-		// This may fail to remove the specified entry if this resize was implicitly
-		// triggered during a file_cache_get call.  Any file_cache_put after the
-		// file_cache_get will re-trigger the shrink and correct the cache size, if needed.
-		remove_entry(evict_iter);
-		}
-
-	g_assert((size_ == 0) == contents_.empty());  // Assert that size is consistent with emptiness.
+		const auto evict_iter = std::prev(entry_iter);
 
-	// At this point, the loop won't have been able to evict the begin() entry.  Maybe do so now.
-	if (size_ > max_size_ && !contents_.empty())
-		{
-		remove_entry(contents_.begin());
+		// Erasing evict_iter leaves entry_iter valid.
+		if (remove_entry(evict_iter))
+			{
+			stats_.evictions++;
+			}
+		else
+			{
+			entry_iter = evict_iter;
+			}
 		}
 
 	g_assert((size_ == 0) == contents_.empty());  // Assert that size is consistent with emptiness.
@@ -138,9 +139,42 @@ FileCache::FileCache(ReleaseFunc release, size_t max_size) : release_(release),
 FileCache::~FileCache()
 {
 	file_data_unregister_notify_func(FileCache::notify_cb, this);
+
+	for (const auto &entry : contents_)
+		{
+		release_(entry.fd);
+		file_data_unref(entry.fd);
+		}
 }
 
 bool FileCache::get(FileData *fd)
+{
+	const bool hit = lookup(fd);
+
+	if (hit)
+		{
+		stats_.hits++;
+		}
+	else
+		{
+		stats_.misses++;
+		}
+
+	return hit;
+}
+
+/**
+ * @brief Whether fd has an entry
+ *
+ * Unlike get(), this does not mark the entry as used, does not count in the
+ * stats, and does not check whether the file changed.
+ */
+bool FileCache::contains(FileData *fd) const
+{
+	return index_.count(fd) > 0;
+}
+
+bool FileCache::lookup(FileData *fd)
 {
 	/* Operating theory of this function:
 	 * This function must be re-entrant, which means it must specifically be implemented in a
@@ -216,15 +250,27 @@ bool FileCache::get(FileData *fd)
 
 void FileCache::put(FileData *fd, size_t size)
 {
-	if (get(fd)) return;
+	if (lookup(fd)) return;
 
 	DEBUG_2("cache add: fc=%p %s", (void *)this, fd->path);
 	contents_.emplace_front(file_data_ref(fd), size);
+	index_.emplace(fd, contents_.begin());
 	size_ += size;
 
 	shrink_to_max_size();
 }
 
+/**
+ * @brief Releases the entry of fd, if there is one
+ */
+void FileCache::remove(FileData *fd)
+{
+	const auto maybe_iter = find_by_fd(fd);
+	if (!maybe_iter) return;
+
+	remove_entry(*maybe_iter);
+}
+
 void FileCache::set_max_size(size_t size)
 {
 	max_size_ = size;
@@ -242,11 +288,21 @@ bool file_cache_get(FileCache *fc, FileData *fd)
 	return fc->get(fd);
 }
 
+bool file_cache_contains(const FileCache *fc, FileData *fd)
+{
+	return fc->contains(fd);
+}
+
 void file_cache_put(FileCache *fc, FileData *fd, size_t size)
 {
 	fc->put(fd, size);
 }
 
+void file_cache_remove(FileCache *fc, FileData *fd)
+{
+	fc->remove(fd);
+}
+
 void file_cache_set_max_size(FileCache *fc, size_t size)
 {
 	fc->set_max_size(size);
@@ -23,8 +23,10 @@
 
 #include <glib.h>
 
+#include <cstddef>
 #include <list>
 #include <optional>
+#include <unordered_map>
 
 // From filedata.h
 class FileData;
@@ -34,6 +36,13 @@ class FileCache {
     public:
 	using ReleaseFunc = void (*)(FileData *);
 
+	/** @brief Lookup and eviction counters, since the cache was created */
+	struct Stats {
+		size_t hits = 0;
+		size_t misses = 0;
+		size_t evictions = 0; /**< entries dropped to stay within the maximum size */
+	};
+
 	FileCache(ReleaseFunc release, size_t max_size);
 	~FileCache();
 
@@ -43,9 +52,15 @@ class FileCache {
 
 	// TODO[xsdg]: The name "get" here is really misleading.  Rename.
 	bool get(FileData *fd);
+	bool contains(FileData *fd) const;
 	void put(FileData *fd, size_t size);
+	void remove(FileData *fd);
 	void set_max_size(size_t size);
 
+	size_t get_size() const { return size_; }
+	size_t get_count() const { return index_.size(); }
+	const Stats &get_stats() const { return stats_; }
+
     private:
 	struct Entry {
 		Entry(FileData *fd, size_t size) : fd(fd), size(size) {}
@@ -61,22 +76,27 @@ class FileCache {
 	using ListIterT = std::list<Entry>::iterator;
 
 	void dump();
+	bool lookup(FileData *fd);
 	bool remove_entry(ListIterT entry_iter);
 	std::optional<ListIterT> find_by_fd(FileData *fd);
 	static void notify_cb(FileData *fd, NotifyType type, gpointer data);
 	void shrink_to_max_size();
 
 	ReleaseFunc release_;
-	std::list<Entry> contents_;
+	std::list<Entry> contents_; ///< Most recently used first
+	std::unordered_map<FileData *, ListIterT> index_; ///< Entry of each FileData in contents_
 	size_t max_size_;
 	size_t size_ = 0;
+	Stats stats_;
 };
 
 using FileCacheReleaseFunc = FileCache::ReleaseFunc;
 
 FileCache *file_cache_new(FileCacheReleaseFunc release, size_t max_size);
 bool file_cache_get(FileCache *fc, FileData *fd);
+bool file_cache_contains(const FileCache *fc, FileData *fd);
 void file_cache_put(FileCache *fc, FileData *fd, size_t size);
+void file_cache_remove(FileCache *fc, FileData *fd);
 void file_cache_set_max_size(FileCache *fc, size_t size);
 
 #endif
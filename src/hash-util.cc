@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "hash-util.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <iterator>
+#include <vector>
+
+#include <config.h>
+
+#if HAVE_XXHASH
+#include <xxhash.h>
+#endif
+
+namespace
+{
+
+/** Large enough to keep the per-read overhead small, small enough for many threads */
+constexpr gsize HASH_BUFFER_SIZE = 1024 * 1024;
+
+/**
+ * @brief Opens \a path for one sequential read
+ * @returns file descriptor, -1 on failure
+ */
+gint hash_open(const gchar *path)
+{
+	const gint fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return -1;
+
+#ifdef POSIX_FADV_SEQUENTIAL
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	return fd;
+}
+
+/**
+ * @brief Hashes \a length bytes of \a fd from \a offset on, or less at the end of the file
+ */
+gboolean hash_update_from_fd(Hash &hash, gint fd, off_t offset, gsize length, std::vector<guchar> &buffer)
+{
+	while (length > 0)
+		{
+		const gssize n = pread(fd, buffer.data(), std::min(buffer.size(), length), offset);
+		if (n < 0)
+			{
+			if (errno == EINTR) continue;
+			return FALSE;
+			}
+		if (n == 0) break;
+
+		hash.update(buffer.data(), n);
+		offset += n;
+		length -= n;
+		}
+
+	return TRUE;
+}
+
+} // namespace
+
+Hash::Hash(HashType type)
+{
+#if HAVE_XXHASH
+	if (type == HashType::FAST)
+		{
+		xxh3 = XXH3_createState();
+		XXH3_128bits_reset(xxh3);
+		return;
+		}
+#else
+	(void)type;
+#endif
+
+	md5 = g_checksum_new(G_CHECKSUM_MD5);
+}
+
+Hash::~Hash()
+{
+	if (md5) g_checksum_free(md5);
+#if HAVE_XXHASH
+	if (xxh3) XXH3_freeState(xxh3);
+#endif
+}
+
+void Hash::update(const guchar *data, gsize length)
+{
+#if HAVE_XXHASH
+	if (xxh3)
+		{
+		XXH3_128bits_update(xxh3, data, length);
+		return;
+		}
+#endif
+
+	/* g_checksum_update() takes a signed length */
+	while (length > 0)
+		{
+		const gsize chunk = std::min<gsize>(length, G_MAXSSIZE);
+
+		g_checksum_update(md5, data, chunk);
+		data += chunk;
+		length -= chunk;
+		}
+}
+
+/**
+ * @brief Hashes the whole file
+ * @param path In locale encoding
+ * @returns TRUE on success
+ */
+gboolean Hash::update_from_file(const gchar *path)
+{
+	const gint fd = hash_open(path);
+	if (fd < 0) return FALSE;
+
+	std::vector<guchar> buffer(HASH_BUFFER_SIZE);
+	const gboolean success = hash_update_from_fd(*this, fd, 0, G_MAXSIZE, buffer);
+
+	close(fd);
+
+	return success;
+}
+
+/**
+ * @brief Hashes the first and last \a length bytes of the file
+ * @param path In locale encoding
+ * @param length
+ * @returns TRUE on success
+ *
+ * Files of the same size with a different hash differ in content.
+ * Parts in both ends of a file shorter than 2 x \a length are hashed twice.
+ */
+gboolean Hash::update_from_file_ends(const gchar *path, gsize length)
+{
+	const gint fd = hash_open(path);
+	if (fd < 0) return FALSE;
+
+	struct stat st;
+	std::vector<guchar> buffer(std::min(length, HASH_BUFFER_SIZE));
+	gboolean success = fstat(fd, &st) == 0 && hash_update_from_fd(*this, fd, 0, length, buffer);
+
+	if (success && static_cast<gsize>(st.st_size) > length)
+		{
+		success = hash_update_from_fd(*this, fd, st.st_size - length, length, buffer);
+		}
+
+	close(fd);
+
+	return success;
+}
+
+/**
+ * @brief Finishes the hash
+ * @returns hash as a hexadecimal string
+ */
+std::string Hash::get_string()
+{
+	if (md5) return g_checksum_get_string(md5);
+
+	guint8 digest[16];
+	gsize length = sizeof(digest);
+	if (!get_digest(digest, length)) return {};
+
+	static const gchar hex_digits[] = "0123456789abcdef";
+	std::string text;
+
+	for (gsize i = 0; i < length; i++)
+		{
+		text += hex_digits[(digest[i] & 0xf0) >> 4];
+		text += hex_digits[digest[i] & 0x0f];
+		}
+
+	return text;
+}
+
+/**
+ * @brief Finishes the hash
+ * @param buffer Receives the hash
+ * @param[in,out] length Size of \a buffer, set to the size of the hash
+ * @returns FALSE if \a buffer is too small
+ */
+gboolean Hash::get_digest(guint8 *buffer, gsize &length)
+{
+#if HAVE_XXHASH
+	if (xxh3)
+		{
+		XXH128_canonical_t canonical;
+		XXH128_canonicalFromHash(&canonical, XXH3_128bits_digest(xxh3));
+
+		if (length < sizeof(canonical.digest)) return FALSE;
+
+		std::copy(std::begin(canonical.digest), std::end(canonical.digest), buffer);
+		length = sizeof(canonical.digest);
+		return TRUE;
+		}
+#endif
+
+	if (length < 16) return FALSE;
+
+	g_checksum_get_digest(md5, buffer, &length);
+	return TRUE;
+}
+
+/**
+ * @brief Get the hash of a file
+ * @param type
+ * @param path In locale encoding
+ * @returns hash as a hexadecimal string, empty on failure
+ */
+std::string hash_get_string_from_file(HashType type, const gchar *path)
+{
+	Hash hash(type);
+	if (!hash.update_from_file(path)) return {};
+
+	return hash.get_string();
+}
+
+/**
+ * @brief Get the hash of the beginning and end of a file
+ * @param type
+ * @param path In locale encoding
+ * @param length Number of bytes hashed at each end
+ * @returns hash as a hexadecimal string, empty on failure
+ */
+std::string hash_get_string_from_file_ends(HashType type, const gchar *path, gsize length)
+{
+	Hash hash(type);
+	if (!hash.update_from_file_ends(path, length)) return {};
+
+	return hash.get_string();
+}
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
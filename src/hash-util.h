@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef HASH_UTIL_H
+#define HASH_UTIL_H
+
+#include <string>
+
+#include <glib.h>
+
+struct XXH3_state_s;
+
+enum class HashType {
+	MD5,  /**< stored in the cache, see #CacheData */
+	FAST  /**< XXH3 128 bit if available, else MD5. Only compare with hashes of the same run */
+};
+
+/**
+ * @brief Streaming hash of data and files
+ *
+ * Files are read with one large buffer and sequential read-ahead advice,
+ * which is several times faster than small stdio reads on fast disks.
+ */
+class Hash
+{
+public:
+	explicit Hash(HashType type);
+	~Hash();
+
+	// Not copyable.
+	Hash(const Hash &) = delete;
+	Hash &operator=(const Hash &) = delete;
+
+	void update(const guchar *data, gsize length);
+	gboolean update_from_file(const gchar *path);
+	gboolean update_from_file_ends(const gchar *path, gsize length);
+
+	std::string get_string();
+	gboolean get_digest(guint8 *buffer, gsize &length);
+
+private:
+	GChecksum *md5 = nullptr;
+	XXH3_state_s *xxh3 = nullptr;
+};
+
+std::string hash_get_string_from_file(HashType type, const gchar *path);
+std::string hash_get_string_from_file_ends(HashType type, const gchar *path, gsize length);
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -232,10 +232,19 @@ static gboolean histmap_idle_cb(gpointer data)
 
 gboolean histmap_start_idle(FileData *fd)
 {
-	if (fd->histmap || !fd->pixbuf) return FALSE;
+	return histmap_start_idle(fd, fd->pixbuf);
+}
+
+/**
+ * @brief Reads the histmap of fd from another pixbuf of the image,
+ * such as a reduced copy when there is no pixbuf of the whole image
+ */
+gboolean histmap_start_idle(FileData *fd, GdkPixbuf *pixbuf)
+{
+	if (fd->histmap || !pixbuf) return FALSE;
 
 	fd->histmap = histmap_new();
-	fd->histmap->pixbuf = g_object_ref(fd->pixbuf);
+	fd->histmap->pixbuf = g_object_ref(pixbuf);
 	fd->histmap->idle_id = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, histmap_idle_cb, fd, nullptr);
 
 	return TRUE;
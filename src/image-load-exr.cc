@@ -22,6 +22,7 @@
 
 #include <OpenEXR/ImfArray.h>
 #include <OpenEXR/ImfRgbaFile.h>
+#include <OpenEXR/ImfTiledRgbaFile.h>
 #include <vector>
 
 #include "image-load.h"
@@ -35,6 +36,8 @@ public:
 	~ImageLoaderEXR() override;
 
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data) override;
+	void set_size(int width, int height) override;
+	gboolean can_reduce_size() override;
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
 	GdkPixbuf *get_pixbuf() override;
 	gchar *get_format_name() override;
@@ -44,11 +47,14 @@ public:
 
 private:
 	AreaUpdatedCb area_updated_cb;
+	SizePreparedCb size_prepared_cb;
 	gpointer data;
 
 	GdkPixbuf *pixbuf = nullptr;
 	gint page_num;
 	gint page_total;
+	gint requested_width = 0;
+	gint requested_height = 0;
 };
 
 class MemBufferIStream : public Imf::IStream
@@ -100,6 +106,41 @@ private:
 	size_t _pos;
 };
 
+/**
+ * @brief Reads the smallest mipmap level of a tiled file that is at least of the requested size
+ * @returns FALSE if the file has no such level below the full size one
+ */
+gboolean exr_read_mipmap_level(const guchar *buffer, gsize count, gint requested_width, gint requested_height,
+                               Imf::Array2D<Imf::Rgba> &pixels, gint &width, gint &height)
+{
+	MemBufferIStream stream("buffer.exr", buffer, count, 0);
+	Imf::TiledRgbaInputFile file(stream);
+
+	if (file.levelMode() != Imf::MIPMAP_LEVELS) return FALSE;
+
+	gint level = 0;
+	while (level + 1 < file.numLevels())
+		{
+		Imath::Box2i dw = file.dataWindowForLevel(level + 1);
+		if (dw.max.x - dw.min.x + 1 < requested_width || dw.max.y - dw.min.y + 1 < requested_height) break;
+
+		level++;
+		}
+
+	if (level == 0) return FALSE;
+
+	Imath::Box2i dw = file.dataWindowForLevel(level);
+
+	width = dw.max.x - dw.min.x + 1;
+	height = dw.max.y - dw.min.y + 1;
+
+	pixels.resizeErase(height, width);
+	file.setFrameBuffer(&pixels[0][0] - dw.min.x - (dw.min.y * width), 1, width);
+	file.readTiles(0, file.numXTiles(level) - 1, 0, file.numYTiles(level) - 1, level);
+
+	return TRUE;
+}
+
 gboolean ImageLoaderEXR::write(const guchar *buffer, gsize &chunk_size, gsize count, GError **)
 {
 	try
@@ -111,10 +152,18 @@ gboolean ImageLoaderEXR::write(const guchar *buffer, gsize &chunk_size, gsize co
 		gint width = dw.max.x - dw.min.x + 1;
 		gint height = dw.max.y - dw.min.y + 1;
 
+		size_prepared_cb(nullptr, width, height, data);
+
 		// Allocate memory for the pixel data
-		Imf::Array2D<Imf::Rgba> pixels(height, width);
-		file.setFrameBuffer(&pixels[0][0] - dw.min.x - (dw.min.y * width), 1, width);
-		file.readPixels(dw.min.y, dw.max.y);
+		Imf::Array2D<Imf::Rgba> pixels;
+
+		if (requested_width < 1 || requested_height < 1 || !file.header().hasTileDescription() ||
+		    !exr_read_mipmap_level(buffer, count, requested_width, requested_height, pixels, width, height))
+			{
+			pixels.resizeErase(height, width);
+			file.setFrameBuffer(&pixels[0][0] - dw.min.x - (dw.min.y * width), 1, width);
+			file.readPixels(dw.min.y, dw.max.y);
+			}
 
 		// Convert EXR pixel data to GdkPixbuf format (8-bit RGBA)
 		auto *image_data = g_new0(guchar, width * height * 4);
@@ -156,13 +205,26 @@ gboolean ImageLoaderEXR::write(const guchar *buffer, gsize &chunk_size, gsize co
 		}
 }
 
-void ImageLoaderEXR::init(AreaUpdatedCb area_updated_cb, SizePreparedCb, gpointer data)
+void ImageLoaderEXR::init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data)
 {
 	this->area_updated_cb = area_updated_cb;
+	this->size_prepared_cb = size_prepared_cb;
 	this->data = data;
 	page_num = 0;
 }
 
+void ImageLoaderEXR::set_size(int width, int height)
+{
+	requested_width = width;
+	requested_height = height;
+}
+
+/* by mipmap levels, if the file has them */
+gboolean ImageLoaderEXR::can_reduce_size()
+{
+	return TRUE;
+}
+
 GdkPixbuf *ImageLoaderEXR::get_pixbuf()
 {
 	return pixbuf;
@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "image-load-formats.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+#include <config.h>
+
+#include "image-load-dds.h"
+#if HAVE_DJVU
+#  include "image-load-djvu.h"
+#endif
+#if HAVE_EXR
+#  include "image-load-exr.h"
+#endif
+#if HAVE_FITS
+#  include "image-load-fits.h"
+#endif
+#if HAVE_HEIF
+#  include "image-load-heif.h"
+#endif
+#if HAVE_J2K
+#  include "image-load-j2k.h"
+#endif
+#if HAVE_JPEG
+#  if !HAVE_RAW
+#    include "image-load-cr3.h"
+#  endif
+#  include "image-load-jpeg.h"
+#endif
+#if HAVE_JPEGXL
+#  include "image-load-jpegxl.h"
+#endif
+#if HAVE_NPY
+#  include "image-load-npy.h"
+#endif
+#if HAVE_PDF
+#  include "image-load-pdf.h"
+#endif
+#include "image-load-psd.h"
+#include "image-load-svgz.h"
+#if HAVE_TIFF
+#  include "image-load-tiff.h"
+#endif
+#if HAVE_WEBP
+#  include "image-load-webp.h"
+#endif
+#include "image-load-zxscr.h"
+#include "ui-fileops.h"
+
+using namespace std::literals::string_view_literals;
+
+namespace
+{
+
+constexpr gsize MAGIC_MAX_END = 16;
+
+/* formats recognized by extension come after all magic bytes */
+constexpr gint PRIORITY_MAGIC = 0;
+constexpr gint PRIORITY_EXTENSION = -1;
+
+#if HAVE_JPEG && !HAVE_RAW
+gboolean image_loader_format_accept_cr3(const guchar *data, gsize size)
+{
+	return size >= 72 && memcmp(data + 64, "CanonCR3", 8) == 0;
+}
+#endif
+
+#if HAVE_DJVU
+gboolean image_loader_format_accept_djvu(const guchar *data, gsize size)
+{
+	return size >= 16 && memcmp(data + 12, "DJV", 3) == 0;
+}
+#endif
+
+#if HAVE_WEBP
+gboolean image_loader_format_accept_webp(const guchar *data, gsize size)
+{
+	return size >= 12 && memcmp(data + 8, "WEBP", 4) == 0;
+}
+#endif
+
+gboolean image_loader_format_accept_zxscr(const guchar *, gsize size)
+{
+	return size == 6144 || size == 6912;
+}
+
+/* formats with several signatures have one entry for each */
+const ImageLoaderFormat image_loader_formats[] = {
+#if HAVE_FITS
+	{ "fits", PRIORITY_MAGIC, 0, "SIMPLE"sv, nullptr, nullptr, get_image_loader_backend_fits },
+#endif
+#if HAVE_PDF
+	{ "pdf", PRIORITY_MAGIC, 0, "%PDF"sv, nullptr, nullptr, get_image_loader_backend_pdf },
+#endif
+#if HAVE_HEIF
+	{ "heif", PRIORITY_MAGIC, 4, "ftypheic"sv, nullptr, nullptr, get_image_loader_backend_heif },
+	{ "heif", PRIORITY_MAGIC, 4, "ftypheix"sv, nullptr, nullptr, get_image_loader_backend_heif },
+	{ "heif", PRIORITY_MAGIC, 4, "ftypmsf1"sv, nullptr, nullptr, get_image_loader_backend_heif },
+	{ "heif", PRIORITY_MAGIC, 4, "ftypmif1"sv, nullptr, nullptr, get_image_loader_backend_heif },
+	{ "heif", PRIORITY_MAGIC, 4, "ftypavif"sv, nullptr, nullptr, get_image_loader_backend_heif },
+#endif
+#if HAVE_WEBP
+	{ "webp", PRIORITY_MAGIC, 0, "RIFF"sv, nullptr, image_loader_format_accept_webp, get_image_loader_backend_webp },
+#endif
+#if HAVE_DJVU
+	{ "djvu", PRIORITY_MAGIC, 0, "AT&TFORM"sv, nullptr, image_loader_format_accept_djvu, get_image_loader_backend_djvu },
+#endif
+#if HAVE_EXR
+	{ "exr", PRIORITY_MAGIC, 0, "\x76\x2F\x31\x01"sv, nullptr, nullptr, get_image_loader_backend_exr },
+#endif
+#if HAVE_JPEG
+	{ "jpeg", PRIORITY_MAGIC, 0, "\xFF\xD8"sv, nullptr, nullptr, get_image_loader_backend_jpeg },
+#  if !HAVE_RAW
+	{ "cr3", PRIORITY_MAGIC, 4, "ftypcrx"sv, nullptr, image_loader_format_accept_cr3, get_image_loader_backend_cr3 },
+#  endif
+#endif
+#if HAVE_TIFF
+	{ "tiff", PRIORITY_MAGIC, 0, "MM\0*"sv, nullptr, nullptr, get_image_loader_backend_tiff },
+	{ "tiff", PRIORITY_MAGIC, 0, "MM\0+\0\x08\0\0"sv, nullptr, nullptr, get_image_loader_backend_tiff },
+	{ "tiff", PRIORITY_MAGIC, 0, "II+\0\x08\0\0\0"sv, nullptr, nullptr, get_image_loader_backend_tiff },
+	{ "tiff", PRIORITY_MAGIC, 0, "II*\0"sv, nullptr, nullptr, get_image_loader_backend_tiff },
+#endif
+#if HAVE_NPY
+	{ "npy", PRIORITY_MAGIC, 0, "\x93NUMPY"sv, nullptr, nullptr, get_image_loader_backend_npy },
+#endif
+	{ "dds", PRIORITY_MAGIC, 0, "DDS"sv, nullptr, nullptr, get_image_loader_backend_dds },
+	{ "psd", PRIORITY_MAGIC, 0, "8BPS\0\x01"sv, nullptr, nullptr, get_image_loader_backend_psd },
+#if HAVE_J2K
+	{ "j2k", PRIORITY_MAGIC, 0, "\0\0\0\x0CjP\x20\x20\x0D\x0A\x87\x0A"sv, nullptr, nullptr, get_image_loader_backend_j2k },
+#endif
+#if HAVE_JPEGXL
+	{ "jpeg xl", PRIORITY_MAGIC, 0, "\0\0\0\x0C\x4A\x58\x4C\x20\x0D\x0A\x87\x0A"sv, nullptr, nullptr, get_image_loader_backend_jpegxl },
+	{ "jpeg xl", PRIORITY_MAGIC, 0, "\xFF\x0A"sv, nullptr, nullptr, get_image_loader_backend_jpegxl },
+#endif
+	{ "zxscr", PRIORITY_EXTENSION, 0, ""sv, ".scr", image_loader_format_accept_zxscr, get_image_loader_backend_zxscr },
+	{ "svgz", PRIORITY_EXTENSION, 0, ""sv, ".svgz", nullptr, get_image_loader_backend_svgz },
+};
+
+/*
+ * The formats that can match a file, by its first byte, in the order in
+ * which they are checked. Only the magic bytes at offset 0 depend on the
+ * first byte, all other formats are in every list.
+ */
+using ImageLoaderFormatTable = std::array<std::vector<const ImageLoaderFormat *>, 256>;
+
+ImageLoaderFormatTable image_loader_format_table_new()
+{
+	ImageLoaderFormatTable table;
+
+	for (const ImageLoaderFormat &format : image_loader_formats)
+		{
+		g_assert(format.offset + format.magic.size() <= MAGIC_MAX_END);
+
+		for (guint byte = 0; byte < table.size(); byte++)
+			{
+			if (format.magic.empty() || format.offset > 0 ||
+			    static_cast<guchar>(format.magic[0]) == byte)
+				{
+				table[byte].push_back(&format);
+				}
+			}
+		}
+
+	for (auto &formats : table)
+		{
+		std::stable_sort(formats.begin(), formats.end(),
+		                 [](const ImageLoaderFormat *a, const ImageLoaderFormat *b) { return a->priority > b->priority; });
+		}
+
+	return table;
+}
+
+gboolean image_loader_format_match(const ImageLoaderFormat &format, const guchar *data, gsize size, const gchar *path)
+{
+	if (format.magic.empty())
+		{
+		if (!path || !file_extension_match(path, format.extension)) return FALSE;
+		}
+	else
+		{
+		if (size < format.offset + format.magic.size() ||
+		    memcmp(data + format.offset, format.magic.data(), format.magic.size()) != 0) return FALSE;
+		}
+
+	return !format.accept || format.accept(data, size);
+}
+
+} // namespace
+
+/**
+ * @brief Finds the format of a file with its own loader backend
+ * @param data The start of the file
+ * @param size The file size
+ * @param path The file path, may be nullptr
+ * @returns The format, or nullptr if the default (gdk-pixbuf) loader should be used
+ */
+const ImageLoaderFormat *image_loader_format_find(const guchar *data, gsize size, const gchar *path)
+{
+	static const ImageLoaderFormatTable table = image_loader_format_table_new();
+
+	if (size == 0) return nullptr;
+
+	for (const ImageLoaderFormat *format : table[data[0]])
+		{
+		if (image_loader_format_match(*format, data, size, path)) return format;
+		}
+
+	return nullptr;
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
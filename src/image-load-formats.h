@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef IMAGE_LOAD_FORMATS_H
+#define IMAGE_LOAD_FORMATS_H
+
+#include <memory>
+#include <string_view>
+
+#include <glib.h>
+
+struct ImageLoaderBackend;
+
+/**
+ * @brief A file format with its own loader backend, recognized by magic
+ * bytes near the start of the file or, failing that, by its extension
+ */
+struct ImageLoaderFormat
+{
+	const gchar *name;
+	gint priority;          /**< formats of higher priority are checked first */
+	gsize offset;           /**< of the magic bytes, which must be within the first 16 bytes */
+	std::string_view magic; /**< empty if the format is recognized by extension */
+	const gchar *extension; /**< only checked if magic is empty */
+	gboolean (*accept)(const guchar *data, gsize size); /**< further checks, may be nullptr */
+	std::unique_ptr<ImageLoaderBackend> (*get_backend)();
+};
+
+const ImageLoaderFormat *image_loader_format_find(const guchar *data, gsize size, const gchar *path);
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -21,6 +21,8 @@
 
 #include "image-load-gdk.h"
 
+#include <cstring>
+
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <glib-object.h>
 #include <glib.h>
@@ -38,11 +40,13 @@ public:
 
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data) override;
 	void set_size(int width, int height) override;
+	gboolean can_reduce_size() override;
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
 	GdkPixbuf *get_pixbuf() override;
 	gboolean close(GError **error) override;
 	gchar *get_format_name() override;
 	gchar **get_format_mime_types() override;
+	gboolean is_progressive() override;
 
 private:
 	GdkPixbufLoader *loader;
@@ -90,11 +94,33 @@ void ImageLoaderGdk::set_size(int width, int height)
 	gdk_pixbuf_loader_set_size(loader, width, height);
 }
 
+/* only the jpeg loader of gdk-pixbuf decodes at a reduced size, the others scale afterwards */
+gboolean ImageLoaderGdk::can_reduce_size()
+{
+	if (!gdk_pixbuf_loader_get_format(loader)) return FALSE;
+
+	g_auto(GStrv) mime_types = get_format_mime_types();
+	if (!mime_types) return FALSE;
+
+	for (gint n = 0; mime_types[n]; n++)
+		{
+		if (strstr(mime_types[n], "jpeg")) return TRUE;
+		}
+
+	return FALSE;
+}
+
 gboolean ImageLoaderGdk::write(const guchar *buf, gsize &chunk_size, gsize, GError **error)
 {
 	return gdk_pixbuf_loader_write(loader, buf, chunk_size, error);
 }
 
+/* gdk-pixbuf shows the parts of the image decoded so far */
+gboolean ImageLoaderGdk::is_progressive()
+{
+	return TRUE;
+}
+
 GdkPixbuf *ImageLoaderGdk::get_pixbuf()
 {
 	return gdk_pixbuf_loader_get_pixbuf(loader);
@@ -22,22 +22,29 @@
 
 #include <vector>
 
+#include <config.h>
+
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <glib-object.h>
 #include <glib.h>
-#include <libheif/heif_cxx.h>
+#include <libheif/heif.h>
 
 #include "image-load.h"
 
 namespace
 {
 
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(heif_context, heif_context_free)
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(heif_image_handle, heif_image_handle_release)
+
 struct ImageLoaderHEIF : public ImageLoaderBackend
 {
 public:
 	~ImageLoaderHEIF() override;
 
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data) override;
+	void set_size(int width, int height) override;
+	gboolean can_reduce_size() override;
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
 	GdkPixbuf *get_pixbuf() override;
 	gchar *get_format_name() override;
@@ -47,11 +54,14 @@ public:
 
 private:
 	AreaUpdatedCb area_updated_cb;
+	SizePreparedCb size_prepared_cb;
 	gpointer data;
 
-	GdkPixbuf *pixbuf;
+	GdkPixbuf *pixbuf = nullptr;
 	gint page_num;
 	gint page_total;
+	gint requested_width = 0;
+	gint requested_height = 0;
 };
 
 void free_buffer(guchar *, gpointer data)
@@ -59,53 +69,123 @@ void free_buffer(guchar *, gpointer data)
 	heif_image_release(static_cast<const struct heif_image*>(data));
 }
 
-gboolean ImageLoaderHEIF::write(const guchar *buf, gsize &chunk_size, gsize count, GError **)
+gboolean heif_check(const heif_error &error)
+{
+	if (error.code == heif_error_Ok) return TRUE;
+
+	log_printf("warning: heif reader error: %s\n", error.message);
+	return FALSE;
+}
+
+/**
+ * @brief Finds the smallest thumbnail of an image that is at least of the requested size
+ * @returns The thumbnail, or nullptr if none is large enough
+ */
+heif_image_handle *heif_get_reduced_image_handle(const heif_image_handle *handle, gint requested_width, gint requested_height)
 {
-	heif::Context ctx{};
+	const gint count = heif_image_handle_get_number_of_thumbnails(handle);
+	if (count < 1) return nullptr;
+
+	std::vector<heif_item_id> ids(count);
+	heif_image_handle_get_list_of_thumbnail_IDs(handle, ids.data(), count);
 
-	try
+	heif_image_handle *reduced = nullptr;
+	gint reduced_width = heif_image_handle_get_width(handle);
+
+	for (heif_item_id id : ids)
 		{
-		ctx.read_from_memory_without_copy(buf, count);
+		heif_image_handle *thumbnail;
+		if (heif_image_handle_get_thumbnail(handle, id, &thumbnail).code != heif_error_Ok) continue;
+
+		const gint width = heif_image_handle_get_width(thumbnail);
+		if (width >= requested_width && heif_image_handle_get_height(thumbnail) >= requested_height &&
+		    width < reduced_width)
+			{
+			if (reduced) heif_image_handle_release(reduced);
+			reduced = thumbnail;
+			reduced_width = width;
+			}
+		else
+			{
+			heif_image_handle_release(thumbnail);
+			}
+		}
+
+	return reduced;
+}
+
+gboolean ImageLoaderHEIF::write(const guchar *buf, gsize &chunk_size, gsize count, GError **)
+{
+	g_autoptr(heif_context) ctx = heif_context_alloc();
 
-		page_total = ctx.get_number_of_top_level_images();
+	if (!heif_check(heif_context_read_from_memory_without_copy(ctx, buf, count, nullptr))) return FALSE;
 
-		/* get list of all (top level) image IDs */
-		std::vector<heif_item_id> IDs = ctx.get_list_of_top_level_image_IDs();
+#if HAVE_HEIF_DECODING_THREADS
+	heif_context_set_max_decoding_threads(ctx, image_loader_get_decode_thread_count());
+#endif
 
-		heif::ImageHandle handle = ctx.get_image_handle(IDs[page_num]);
+	page_total = heif_context_get_number_of_top_level_images(ctx);
+	if (page_num >= page_total) return FALSE;
 
-		// decode the image and convert colorspace to RGB, saved as 24bit interleaved
-		heif_image *img;
-		heif_error error = heif_decode_image(handle.get_raw_image_handle(), &img, heif_colorspace_RGB, heif_chroma_interleaved_24bit, nullptr);
-		if (error.code) throw heif::Error(error);
+	/* get list of all (top level) image IDs */
+	std::vector<heif_item_id> IDs(page_total);
+	heif_context_get_list_of_top_level_image_IDs(ctx, IDs.data(), page_total);
 
-		gint stride;
-		guint8* pixels = heif_image_get_plane(img, heif_channel_interleaved, &stride);
-		gint width = heif_image_get_width(img,heif_channel_interleaved);
-		gint height = heif_image_get_height(img,heif_channel_interleaved);
-		gboolean alpha = handle.has_alpha_channel();
+	g_autoptr(heif_image_handle) handle = nullptr;
+	if (!heif_check(heif_context_get_image_handle(ctx, IDs[page_num], &handle))) return FALSE;
 
-		pixbuf = gdk_pixbuf_new_from_data(pixels, GDK_COLORSPACE_RGB, alpha, 8, width, height, stride, free_buffer, img);
+	size_prepared_cb(nullptr, heif_image_handle_get_width(handle), heif_image_handle_get_height(handle), data);
 
-		area_updated_cb(nullptr, 0, 0, width, height, data);
-		}
-	catch (const heif::Error &error)
+	/* a thumbnail stored in the file is much faster to decode than the image */
+	if (requested_width > 0 && requested_height > 0)
 		{
-		log_printf("warning: heif reader error: %s\n", error.get_message().c_str());
-		return FALSE;
+		heif_image_handle *thumbnail = heif_get_reduced_image_handle(handle, requested_width, requested_height);
+		if (thumbnail)
+			{
+			heif_image_handle_release(handle);
+			handle = thumbnail;
+			}
 		}
 
+	// decode the image and convert colorspace to RGB, saved as 24 or 32bit interleaved
+	gboolean alpha = heif_image_handle_has_alpha_channel(handle);
+	heif_image *img;
+	if (!heif_check(heif_decode_image(handle, &img, heif_colorspace_RGB,
+	                                  alpha ? heif_chroma_interleaved_RGBA : heif_chroma_interleaved_RGB, nullptr))) return FALSE;
+
+	gint stride;
+	guint8* pixels = heif_image_get_plane(img, heif_channel_interleaved, &stride);
+	gint width = heif_image_get_width(img,heif_channel_interleaved);
+	gint height = heif_image_get_height(img,heif_channel_interleaved);
+
+	pixbuf = gdk_pixbuf_new_from_data(pixels, GDK_COLORSPACE_RGB, alpha, 8, width, height, stride, free_buffer, img);
+
+	area_updated_cb(nullptr, 0, 0, width, height, data);
+
 	chunk_size = count;
 	return TRUE;
 }
 
-void ImageLoaderHEIF::init(AreaUpdatedCb area_updated_cb, SizePreparedCb, gpointer data)
+void ImageLoaderHEIF::init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data)
 {
 	this->area_updated_cb = area_updated_cb;
+	this->size_prepared_cb = size_prepared_cb;
 	this->data = data;
 	page_num = 0;
 }
 
+void ImageLoaderHEIF::set_size(int width, int height)
+{
+	requested_width = width;
+	requested_height = height;
+}
+
+/* by thumbnails, if the file has them */
+gboolean ImageLoaderHEIF::can_reduce_size()
+{
+	return TRUE;
+}
+
 GdkPixbuf *ImageLoaderHEIF::get_pixbuf()
 {
 	return pixbuf;
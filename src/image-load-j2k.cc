@@ -31,7 +31,6 @@
 
 #include "image-load.h"
 #include "intl.h"
-#include "misc.h"
 
 namespace
 {
@@ -46,6 +45,8 @@ public:
 	~ImageLoaderJ2K() override;
 
     void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data) override;
+	void set_size(int width, int height) override;
+	gboolean can_reduce_size() override;
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
 	GdkPixbuf *get_pixbuf() override;
 	gchar *get_format_name() override;
@@ -53,9 +54,12 @@ public:
 
 private:
 	AreaUpdatedCb area_updated_cb;
+	SizePreparedCb size_prepared_cb;
 	gpointer data;
 
 	GdkPixbuf *pixbuf;
+	gint requested_width = 0;
+	gint requested_height = 0;
 };
 
 struct OpjBufferInfo
@@ -153,7 +157,7 @@ gboolean ImageLoaderJ2K::write(const guchar *buf, gsize &chunk_size, gsize count
 		return FALSE;
 		}
 
-	if (opj_codec_set_threads(codec, get_cpu_cores()) != OPJ_TRUE)
+	if (opj_codec_set_threads(codec, image_loader_get_decode_thread_count()) != OPJ_TRUE)
 		{
 		log_printf("%s", _("Couldn't allocate worker threads on decoder for file."));
 		return FALSE;
@@ -166,6 +170,27 @@ gboolean ImageLoaderJ2K::write(const guchar *buf, gsize &chunk_size, gsize count
 		return FALSE;
 		}
 
+	const gint image_width = image->x1 - image->x0;
+	const gint image_height = image->y1 - image->y0;
+
+	size_prepared_cb(nullptr, image_width, image_height, data);
+
+	/* each resolution level halves the size, decode only as many as needed */
+	if (requested_width > 0 && requested_height > 0)
+		{
+		guint reduce = 0;
+		while ((image_width >> (reduce + 1)) >= requested_width && (image_height >> (reduce + 1)) >= requested_height)
+			{
+			reduce++;
+			}
+
+		/* fails if the file has fewer resolution levels */
+		while (reduce > 0 && opj_set_decoded_resolution_factor(codec, reduce) != OPJ_TRUE)
+			{
+			reduce--;
+			}
+		}
+
 	if (opj_decode(codec, stream, image) != OPJ_TRUE)
 		{
 		log_printf("%s", _("Couldn't decode JP2 image in file"));
@@ -208,12 +233,25 @@ gboolean ImageLoaderJ2K::write(const guchar *buf, gsize &chunk_size, gsize count
 	return TRUE;
 }
 
-void ImageLoaderJ2K::init(AreaUpdatedCb area_updated_cb, SizePreparedCb, gpointer data)
+void ImageLoaderJ2K::init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data)
 {
 	this->area_updated_cb = area_updated_cb;
+	this->size_prepared_cb = size_prepared_cb;
 	this->data = data;
 }
 
+void ImageLoaderJ2K::set_size(int width, int height)
+{
+	requested_width = width;
+	requested_height = height;
+}
+
+/* by resolution levels */
+gboolean ImageLoaderJ2K::can_reduce_size()
+{
+	return TRUE;
+}
+
 GdkPixbuf *ImageLoaderJ2K::get_pixbuf()
 {
 	return pixbuf;
@@ -30,8 +30,14 @@
 #include "image-load-jpeg.h"
 
 #include <algorithm>
+#include <atomic>
 #include <csetjmp>
 #include <cstdio> // for FILE and size_t in jpeglib.h
+#include <list>
+#include <utility>
+#include <vector>
+
+#include <config.h>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <glib-object.h>
@@ -42,8 +48,42 @@
 #include "image-load.h"
 #include "intl.h"
 #include "jpeg-parser.h"
+#include "misc.h"
 #include "pixbuf-renderer.h"
 
+namespace
+{
+
+/* jpeg can decode at 1/2, 1/4 and 1/8 of the size almost for free */
+constexpr gint JPEG_TILES_MAX_REDUCTION = 8;
+
+/* largest preview kept in memory to serve zoomed out views */
+constexpr gint64 JPEG_TILES_PREVIEW_PIXELS = 16 * 1024 * 1024;
+
+/* size of the regions of the reduced image decoded at once for the tiles,
+ * wide because the entropy-coded data is decoded for whole rows anyway */
+constexpr gint JPEG_TILES_BLOCK_WIDTH = 4096;
+constexpr gint JPEG_TILES_BLOCK_HEIGHT = 512;
+
+/* decoded blocks kept to serve the tiles, in bytes */
+constexpr gsize JPEG_TILES_BLOCKS_CACHE_SIZE = 256 * 1024 * 1024;
+
+/* smaller images decode too fast to be worth the threads */
+constexpr gint64 JPEG_BANDS_MIN_PIXELS = 4 * 1024 * 1024;
+
+struct JpegBandDecode
+{
+	const JpegRestartBand *band;
+	guint scale_denom;
+	gint out_color_components;
+	GdkPixbuf *pixbuf;	/**< shared by all bands */
+	guint row;	/**< first kept row of the band in pixbuf */
+	const std::atomic<gboolean> *aborted;
+	gboolean success;
+};
+
+} // namespace
+
 /* error handler data */
 struct error_handler_data {
 	struct jpeg_error_mgr pub;
@@ -244,6 +284,136 @@ static void set_mem_src (j_decompress_ptr cinfo, const guchar *buffer, guint nby
 }
 
 
+/**
+ * @brief Decodes a band into its rows of the shared pixbuf
+ *
+ * The rows of the band that overlap its neighbours are decoded, so that
+ * chroma upsampling sees the same rows as in a whole image decode, and
+ * then discarded. No other band writes the kept rows.
+ */
+static void image_loader_jpeg_band_decode(JpegBandDecode &bd)
+{
+	struct jpeg_decompress_struct cinfo;
+	struct error_handler_data jerr;
+
+	cinfo.err = jpeg_std_error(&jerr.pub);
+	jerr.pub.error_exit = fatal_error_handler;
+	jerr.pub.output_message = output_message_handler;
+	jerr.error = nullptr;
+
+	if (sigsetjmp(jerr.setjmp_buffer, 0))
+		{
+		jpeg_destroy_decompress(&cinfo);
+		return;
+		}
+
+	jpeg_create_decompress(&cinfo);
+	set_mem_src(&cinfo, bd.band->data.data(), bd.band->data.size());
+	jpeg_read_header(&cinfo, TRUE);
+
+	cinfo.scale_num = 1;
+	cinfo.scale_denom = bd.scale_denom;
+	jpeg_start_decompress(&cinfo);
+
+	/* the band rows are multiples of the MCU height, so they scale exactly */
+	const JpegRestartBand &band = *bd.band;
+	const JDIMENSION skip = (band.keep_row - band.row) / bd.scale_denom;
+	const JDIMENSION end = (band.keep_row + band.keep_height == band.row + band.height) ?
+	                       cinfo.output_height : (band.keep_row + band.keep_height - band.row) / bd.scale_denom;
+
+	if (static_cast<gint>(cinfo.output_width) != gdk_pixbuf_get_width(bd.pixbuf) ||
+	    skip > end || end > cinfo.output_height ||
+	    static_cast<gint>(bd.row + end - skip) > gdk_pixbuf_get_height(bd.pixbuf) ||
+	    cinfo.out_color_components != bd.out_color_components)
+		{
+		jpeg_destroy_decompress(&cinfo);
+		return;
+		}
+
+	const guint rowstride = gdk_pixbuf_get_rowstride(bd.pixbuf);
+	guchar *pixels = gdk_pixbuf_get_pixels(bd.pixbuf) + static_cast<gsize>(bd.row) * rowstride;
+
+	/* the rows outside the kept ones, libjpeg may return up to rec_outbuf_height rows at once */
+	std::vector<guchar> discarded(static_cast<gsize>(rowstride) * cinfo.rec_outbuf_height);
+
+	while (cinfo.output_scanline < end && !*bd.aborted)
+		{
+		guchar *lines[4];
+
+		for (gint i = 0; i < cinfo.rec_outbuf_height; i++)
+			{
+			const JDIMENSION line = cinfo.output_scanline + i;
+
+			lines[i] = (line >= skip && line < end) ? pixels + static_cast<gsize>(line - skip) * rowstride :
+			                                          discarded.data() + static_cast<gsize>(i) * rowstride;
+			}
+
+		if (jpeg_read_scanlines(&cinfo, lines, cinfo.rec_outbuf_height) == 0) break;
+
+		switch (cinfo.out_color_space)
+			{
+			case JCS_GRAYSCALE:
+				explode_gray_into_buf(&cinfo, lines);
+				break;
+			case JCS_CMYK:
+				convert_cmyk_to_rgb(&cinfo, lines);
+				break;
+			default:
+				break;
+			}
+		}
+
+	bd.success = cinfo.output_scanline >= end;
+
+	/* the rows of the margin below are not needed */
+	jpeg_destroy_decompress(&cinfo);
+}
+
+/**
+ * @brief Decodes the image in bands split at restart markers, in the threads of the decoders
+ * @param cinfo The image, with the output dimensions calculated
+ * @returns FALSE if the image can not be split, or a band failed to decode
+ */
+gboolean ImageLoaderJpeg::write_restart_bands(const guchar *buf, gsize count, const struct jpeg_decompress_struct &cinfo)
+{
+	if (static_cast<gint64>(cinfo.image_width) * cinfo.image_height < JPEG_BANDS_MIN_PIXELS) return FALSE;
+
+	const gint band_count = image_loader_get_decode_thread_count();
+	if (band_count < 2) return FALSE;
+
+	/* with an MCU row of margin, chroma upsampling uses the rows next to each band */
+	const std::vector<JpegRestartBand> bands = jpeg_split_restart_bands(buf, count, band_count, 1);
+	if (bands.empty()) return FALSE;
+
+	DEBUG_1("jpeg decode in %zu bands", bands.size());
+
+	GdkPixbuf *band_pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, cinfo.out_color_components == 4, 8,
+	                                        cinfo.output_width, cinfo.output_height);
+	if (!band_pixbuf) return FALSE;
+
+	std::vector<JpegBandDecode> decodes;
+	decodes.reserve(bands.size());
+	for (const JpegRestartBand &band : bands)
+		{
+		decodes.push_back({&band, cinfo.scale_denom, cinfo.out_color_components, band_pixbuf,
+		                   band.keep_row / cinfo.scale_denom, &aborted, FALSE});
+		}
+
+	image_loader_parallel_run(0, decodes.size(), decodes.size(),
+	                          [&decodes](guint32 value, gint){ image_loader_jpeg_band_decode(decodes[value]); });
+
+	if (!std::all_of(decodes.cbegin(), decodes.cend(), [](const JpegBandDecode &bd){ return bd.success; }))
+		{
+		g_object_unref(band_pixbuf);
+		return FALSE;
+		}
+
+	pixbuf = band_pixbuf;
+	area_updated_cb(nullptr, 0, 0, cinfo.output_width, cinfo.output_height, data);
+
+	return TRUE;
+}
+
 gboolean ImageLoaderJpeg::write(const guchar *buf, gsize &chunk_size, gsize count, GError **error)
 {
 	struct jpeg_decompress_struct cinfo;
@@ -347,6 +517,15 @@ gboolean ImageLoaderJpeg::write(const guchar *buf, gsize &chunk_size, gsize coun
 		}
 	}
 	jpeg_calc_output_dimensions(&cinfo);
+
+	if (!stereo && write_restart_bands(buf, count, cinfo))
+		{
+		jpeg_destroy_decompress(&cinfo);
+
+		chunk_size = count;
+		return TRUE;
+		}
+
 	if (stereo)
 		{
 		cinfo2.scale_num = cinfo.scale_num;
@@ -420,6 +599,12 @@ void ImageLoaderJpeg::set_size(int width, int height)
 	requested_height = height;
 }
 
+/* by scale_denom */
+gboolean ImageLoaderJpeg::can_reduce_size()
+{
+	return TRUE;
+}
+
 GdkPixbuf *ImageLoaderJpeg::get_pixbuf()
 {
 	return pixbuf;
@@ -451,4 +636,548 @@ std::unique_ptr<ImageLoaderBackend> get_image_loader_backend_jpeg()
 	return std::make_unique<ImageLoaderJpeg>();
 }
 
+/*
+ *-------------------------------------------------------------------
+ * region decoding
+ *-------------------------------------------------------------------
+ */
+
+struct JpegTilesBlock
+{
+	gint reduction;
+	gint column;	/**< the block is at column * JPEG_TILES_BLOCK_WIDTH of the reduced image */
+	gint row;	/**< and at row * JPEG_TILES_BLOCK_HEIGHT */
+	GdkPixbuf *pixbuf;
+	gint crop_x;	/**< reduced column of the first pixel of pixbuf, at most the block column */
+
+	bool operator==(const JpegTilesBlock &other) const
+	{
+		return reduction == other.reduction && column == other.column && row == other.row;
+	}
+};
+
+struct JpegTiles
+{
+	gint ref_count;	/**< held by jpeg_tiles_new() and by each block job */
+	GMappedFile *mapped_file;
+	gint width;
+	gint height;
+
+	JpegRestartIndex restart_index;
+	gboolean has_restart_index;
+
+	GdkPixbuf *preview;	/**< the whole image at 1/preview_reduction of its size */
+	gint preview_reduction;
+
+	GThreadPool *pool;	/**< decodes the blocks */
+	std::atomic<gboolean> aborted;
+	std::atomic<gint> reduction;	/**< of the last request, blocks of other reductions are dropped */
+	JpegTilesReadyFunc ready_func;
+
+	GMutex mutex;	/**< for the members below */
+	std::list<JpegTilesBlock> blocks;	/**< decoded, the most recently used first */
+	gsize blocks_size;
+	std::vector<JpegTilesBlock> pending;	/**< the blocks in the pool, without pixbuf */
+	guint serial;
+};
+
+struct JpegTilesJob
+{
+	JpegTiles *jt;
+	JpegTilesBlock block;
+	guint serial;	/**< later requests are decoded first */
+};
+
+static void jpeg_tiles_unref(JpegTiles *jt)
+{
+	if (!g_atomic_int_dec_and_test(&jt->ref_count)) return;
+
+	for (const JpegTilesBlock &block : jt->blocks)
+		{
+		g_object_unref(block.pixbuf);
+		}
+	if (jt->preview) g_object_unref(jt->preview);
+	g_mapped_file_unref(jt->mapped_file);
+	g_mutex_clear(&jt->mutex);
+	delete jt;
+}
+
+#if HAVE_JPEG_CROP_SCANLINE
+/**
+ * @brief Decodes a region of the image at 1/reduction of its size
+ * @param x,y,width,height The region, in reduced coordinates
+ * @param[out] crop_x Column of the first decoded pixel, at most x
+ * @returns The region, widened to the left to crop_x, or nullptr on error or when aborted
+ *
+ * Only the columns of the region are decoded, see jpeg_crop_scanline().
+ * With restart markers, only the MCU rows around the region are decoded,
+ * see jpeg_get_restart_band(). Otherwise the rows above are skipped, which
+ * still decodes their entropy-coded data.
+ */
+static GdkPixbuf *jpeg_tiles_decode(const JpegTiles *jt, gint reduction,
+                                    gint x, gint y, gint width, gint height, gint &crop_x)
+{
+	struct jpeg_decompress_struct cinfo;
+	struct error_handler_data jerr;
+	GdkPixbuf * volatile pixbuf = nullptr;
+
+	const auto *data = reinterpret_cast<const guchar *>(g_mapped_file_get_contents(jt->mapped_file));
+	gsize size = g_mapped_file_get_length(jt->mapped_file);
+	gint skip = y;	/* decoded rows above the region */
+
+	JpegRestartBand band;
+	if (jt->has_restart_index && y > 0)
+		{
+		const JpegRestartIndex &index = jt->restart_index;
+
+		/* with an MCU row of margin, chroma upsampling uses the rows next to the wanted ones */
+		guint first_row = static_cast<guint>(y) * reduction / index.mcu_height;
+		if (first_row > 0) first_row--;
+		while (!index.is_band_start(first_row)) first_row--;
+
+		guint end_row = (static_cast<guint>(y + height) * reduction + index.mcu_height - 1) / index.mcu_height + 1;
+		while (!index.is_band_start(end_row)) end_row++;
+
+		band = jpeg_get_restart_band(data, index, first_row, end_row);
+		data = band.data.data();
+		size = band.data.size();
+		skip = y - band.row / reduction;
+		}
+
+	cinfo.err = jpeg_std_error(&jerr.pub);
+	jerr.pub.error_exit = fatal_error_handler;
+	jerr.pub.output_message = output_message_handler;
+	jerr.error = nullptr;
+
+	if (sigsetjmp(jerr.setjmp_buffer, 0))
+		{
+		jpeg_destroy_decompress(&cinfo);
+		if (pixbuf) g_object_unref(pixbuf);
+		return nullptr;
+		}
+
+	jpeg_create_decompress(&cinfo);
+	set_mem_src(&cinfo, data, size);
+	jpeg_read_header(&cinfo, TRUE);
+
+	cinfo.scale_num = 1;
+	cinfo.scale_denom = reduction;
+	jpeg_start_decompress(&cinfo);
+
+	width = std::min<gint>(width, static_cast<gint>(cinfo.output_width) - x);
+	height = std::min<gint>(height, static_cast<gint>(cinfo.output_height) - skip);
+	if (x < 0 || skip < 0 || width < 1 || height < 1)
+		{
+		jpeg_destroy_decompress(&cinfo);
+		return nullptr;
+		}
+
+	JDIMENSION xoffset = x;
+	JDIMENSION crop_width = width;
+	if (crop_width < cinfo.output_width)
+		{
+		/* widens the region to the left to the next iMCU boundary */
+		jpeg_crop_scanline(&cinfo, &xoffset, &crop_width);
+		}
+
+	/* in steps, to notice soon when aborted */
+	while (static_cast<gint>(cinfo.output_scanline) < skip && !jt->aborted)
+		{
+		jpeg_skip_scanlines(&cinfo, std::min(skip - static_cast<gint>(cinfo.output_scanline), JPEG_TILES_BLOCK_HEIGHT));
+		}
+
+	/* a few spare rows, libjpeg may return up to rec_outbuf_height rows at once */
+	pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, cinfo.out_color_components == 4, 8,
+	                        cinfo.output_width, height + cinfo.rec_outbuf_height);
+	if (!pixbuf)
+		{
+		jpeg_destroy_decompress(&cinfo);
+		return nullptr;
+		}
+
+	guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+	const gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+	const JDIMENSION end = skip + height;
+
+	while (cinfo.output_scanline < end && !jt->aborted)
+		{
+		guchar *lines[4];
+
+		for (gint i = 0; i < cinfo.rec_outbuf_height; i++)
+			{
+			lines[i] = pixels + static_cast<gsize>(cinfo.output_scanline - skip + i) * rowstride;
+			}
+
+		if (jpeg_read_scanlines(&cinfo, lines, cinfo.rec_outbuf_height) == 0) break;
+
+		switch (cinfo.out_color_space)
+			{
+			case JCS_GRAYSCALE:
+				explode_gray_into_buf(&cinfo, lines);
+				break;
+			case JCS_CMYK:
+				convert_cmyk_to_rgb(&cinfo, lines);
+				break;
+			default:
+				break;
+			}
+		}
+
+	const gboolean complete = cinfo.output_scanline >= end;
+
+	/* the rows below the region are not needed */
+	jpeg_destroy_decompress(&cinfo);
+
+	if (!complete)
+		{
+		g_object_unref(pixbuf);
+		return nullptr;
+		}
+
+	crop_x = xoffset;
+
+	GdkPixbuf *region = gdk_pixbuf_new_subpixbuf(pixbuf, 0, 0, gdk_pixbuf_get_width(pixbuf), height);
+	g_object_unref(pixbuf);
+
+	return region;
+}
+#endif
+
+static void jpeg_tiles_job_free(JpegTilesJob *job)
+{
+	if (job->block.pixbuf) g_object_unref(job->block.pixbuf);
+	jpeg_tiles_unref(job->jt);
+	delete job;
+}
+
+static gboolean jpeg_tiles_block_ready_cb(gpointer data)
+{
+	auto *job = static_cast<JpegTilesJob *>(data);
+	JpegTiles *jt = job->jt;
+	const JpegTilesBlock &block = job->block;
+
+	if (!jt->aborted && jt->ready_func)
+		{
+		const gint block_width = JPEG_TILES_BLOCK_WIDTH * block.reduction;
+		const gint block_height = JPEG_TILES_BLOCK_HEIGHT * block.reduction;
+		const gint x = block.column * block_width;
+		const gint y = block.row * block_height;
+
+		jt->ready_func(block.reduction, {x, y, std::min(block_width, jt->width - x), std::min(block_height, jt->height - y)});
+		}
+
+	jpeg_tiles_job_free(job);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void jpeg_tiles_block_run(gpointer data, gpointer)
+{
+	auto *job = static_cast<JpegTilesJob *>(data);
+	JpegTiles *jt = job->jt;
+	JpegTilesBlock &block = job->block;
+
+#if HAVE_JPEG_CROP_SCANLINE
+	if (!jt->aborted && jt->reduction == block.reduction)
+		{
+		block.pixbuf = jpeg_tiles_decode(jt, block.reduction,
+		                                 block.column * JPEG_TILES_BLOCK_WIDTH, block.row * JPEG_TILES_BLOCK_HEIGHT,
+		                                 JPEG_TILES_BLOCK_WIDTH, JPEG_TILES_BLOCK_HEIGHT, block.crop_x);
+		}
+#endif
+
+	g_mutex_lock(&jt->mutex);
+
+	jt->pending.erase(std::find(jt->pending.begin(), jt->pending.end(), block));
+
+	if (block.pixbuf)
+		{
+		jt->blocks.push_front(block);
+		g_object_ref(block.pixbuf);
+		jt->blocks_size += gdk_pixbuf_get_byte_length(block.pixbuf);
+
+		while (jt->blocks.size() > 1 && jt->blocks_size > JPEG_TILES_BLOCKS_CACHE_SIZE)
+			{
+			jt->blocks_size -= gdk_pixbuf_get_byte_length(jt->blocks.back().pixbuf);
+			g_object_unref(jt->blocks.back().pixbuf);
+			jt->blocks.pop_back();
+			}
+		}
+
+	g_mutex_unlock(&jt->mutex);
+
+	if (block.pixbuf)
+		{
+		g_idle_add(jpeg_tiles_block_ready_cb, job);
+		}
+	else
+		{
+		jpeg_tiles_job_free(job);
+		}
+}
+
+static gint jpeg_tiles_job_compare(gconstpointer a, gconstpointer b, gpointer)
+{
+	const guint serial_a = static_cast<const JpegTilesJob *>(a)->serial;
+	const guint serial_b = static_cast<const JpegTilesJob *>(b)->serial;
+
+	return (serial_a < serial_b) - (serial_a > serial_b);
+}
+
+#if HAVE_JPEG_CROP_SCANLINE
+/**
+ * @brief Reads the size of a jpeg file which can be decoded by regions
+ * @returns FALSE if the file is progressive or stereo, or not a jpeg file
+ *
+ * A progressive file is decoded in full at the first scanline, so it
+ * would not save anything. Stereo files are left to the normal loader.
+ */
+static gboolean jpeg_tiles_get_size(const guchar *buf, gsize count, gint &width, gint &height)
+{
+	if (count < 2 || buf[0] != 0xff || buf[1] != 0xd8) return FALSE;
+
+	MPOData mpo = jpeg_get_mpo_data(buf, count);
+	if (std::count_if(mpo.images.cbegin(), mpo.images.cend(),
+	                  [](const MPOEntry &mpe){ return mpe.type_code == 0x20002; }) > 1) return FALSE;
+
+	struct jpeg_decompress_struct cinfo;
+	struct error_handler_data jerr;
+
+	cinfo.err = jpeg_std_error(&jerr.pub);
+	jerr.pub.error_exit = fatal_error_handler;
+	jerr.pub.output_message = output_message_handler;
+	jerr.error = nullptr;
+
+	if (sigsetjmp(jerr.setjmp_buffer, 0))
+		{
+		jpeg_destroy_decompress(&cinfo);
+		return FALSE;
+		}
+
+	jpeg_create_decompress(&cinfo);
+	set_mem_src(&cinfo, buf, count);
+	jpeg_read_header(&cinfo, TRUE);
+
+	width = cinfo.image_width;
+	height = cinfo.image_height;
+	const gboolean progressive = jpeg_has_multiple_scans(&cinfo);
+
+	jpeg_destroy_decompress(&cinfo);
+
+	return !progressive;
+}
+#endif
+
+/**
+ * @brief Whether jpeg_tiles_new() would open a file, without decoding anything
+ */
+gboolean jpeg_tiles_supported(const guchar *buf, gsize count, gint64 min_pixels)
+{
+#if HAVE_JPEG_CROP_SCANLINE
+	gint width;
+	gint height;
+
+	return jpeg_tiles_get_size(buf, count, width, height) && static_cast<gint64>(width) * height >= min_pixels;
+#else
+	(void)buf;
+	(void)count;
+	(void)min_pixels;
+
+	return FALSE;
+#endif
+}
+
+/**
+ * @brief Opens a jpeg file for region decoding
+ * @param path The file
+ * @param min_pixels Files with fewer pixels are not worth it
+ * @returns nullptr if the file is small, progressive, stereo or region decoding is not supported
+ *
+ * The whole image is decoded once at a reduced size, which serves the
+ * zoomed out views, so this takes a while. Zoomed in views decode blocks
+ * of the image in other threads, see jpeg_tiles_read().
+ */
+JpegTiles *jpeg_tiles_new(const gchar *path, gint64 min_pixels)
+{
+#if HAVE_JPEG_CROP_SCANLINE
+	GMappedFile *mapped_file = g_mapped_file_new(path, FALSE, nullptr);
+	if (!mapped_file) return nullptr;
+
+	const auto *buf = reinterpret_cast<const guchar *>(g_mapped_file_get_contents(mapped_file));
+	const gsize count = g_mapped_file_get_length(mapped_file);
+
+	gint width;
+	gint height;
+	if (!jpeg_tiles_get_size(buf, count, width, height) || static_cast<gint64>(width) * height < min_pixels)
+		{
+		g_mapped_file_unref(mapped_file);
+		return nullptr;
+		}
+
+	auto *jt = new JpegTiles();
+	jt->ref_count = 1;
+	jt->mapped_file = mapped_file;
+	jt->width = width;
+	jt->height = height;
+	jt->has_restart_index = jpeg_get_restart_index(buf, count, jt->restart_index);
+	g_mutex_init(&jt->mutex);
+
+	jt->preview_reduction = 1;
+	while (jt->preview_reduction < JPEG_TILES_MAX_REDUCTION &&
+	       (static_cast<gint64>(width) / jt->preview_reduction) * (height / jt->preview_reduction) > JPEG_TILES_PREVIEW_PIXELS)
+		{
+		jt->preview_reduction *= 2;
+		}
+
+	gint crop_x;
+	jt->preview = jpeg_tiles_decode(jt, jt->preview_reduction, 0, 0, width, height, crop_x);
+	if (!jt->preview)
+		{
+		jpeg_tiles_free(jt);
+		return nullptr;
+		}
+
+	jt->pool = g_thread_pool_new(jpeg_tiles_block_run, nullptr, image_loader_get_decode_thread_count(), FALSE, nullptr);
+	g_thread_pool_set_sort_function(jt->pool, jpeg_tiles_job_compare, nullptr);
+
+	DEBUG_1("jpeg tiles %dx%d, restart index %d", width, height, jt->has_restart_index);
+
+	return jt;
+#else
+	(void)path;
+	(void)min_pixels;
+
+	return nullptr;
+#endif
+}
+
+/**
+ * @brief Drops the blocks waiting to be decoded, the blocks being decoded
+ * hold on to jt until their threads are done
+ */
+void jpeg_tiles_free(JpegTiles *jt)
+{
+	if (!jt) return;
+
+	jt->aborted = TRUE;
+	if (jt->pool) g_thread_pool_free(jt->pool, FALSE, FALSE);
+
+	jpeg_tiles_unref(jt);
+}
+
+gint jpeg_tiles_get_width(const JpegTiles *jt)
+{
+	return jt->width;
+}
+
+gint jpeg_tiles_get_height(const JpegTiles *jt)
+{
+	return jt->height;
+}
+
+gint jpeg_tiles_get_max_reduction(const JpegTiles *)
+{
+	return JPEG_TILES_MAX_REDUCTION;
+}
+
+/**
+ * @returns The whole image at a reduced size, owned by jt
+ */
+GdkPixbuf *jpeg_tiles_get_preview(const JpegTiles *jt)
+{
+	return jt->preview;
+}
+
+void jpeg_tiles_set_ready_func(JpegTiles *jt, const JpegTilesReadyFunc &func)
+{
+	jt->ready_func = func;
+}
+
+/**
+ * @returns TRUE with a reference to the pixbuf of the block, or FALSE if
+ * it is not decoded yet, in which case it is queued for decoding
+ */
+static gboolean jpeg_tiles_block_get(JpegTiles *jt, JpegTilesBlock &block)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&jt->mutex);
+
+	const auto it = std::find(jt->blocks.begin(), jt->blocks.end(), block);
+	if (it != jt->blocks.end())
+		{
+		jt->blocks.splice(jt->blocks.begin(), jt->blocks, it);
+		block = *it;
+		g_object_ref(block.pixbuf);
+		return TRUE;
+		}
+
+	if (std::find(jt->pending.cbegin(), jt->pending.cend(), block) == jt->pending.cend())
+		{
+		jt->pending.push_back(block);
+
+		g_atomic_int_inc(&jt->ref_count);
+		g_thread_pool_push(jt->pool, new JpegTilesJob{jt, block, jt->serial++}, nullptr);
+		}
+
+	return FALSE;
+}
+
+/**
+ * @brief Fills a source tile, see PixbufRenderer::TileRequestFunc
+ * @param reduction The tile needs only 1/reduction of the image detail,
+ * see pixbuf_renderer_get_tiles_reduction()
+ * @param x,y,width,height The region, in image coordinates
+ * @param pixbuf Receives the region at its origin, in full size
+ * @returns TRUE if the region was filled
+ *
+ * This does not wait for decoding. The parts of the region which are not
+ * decoded yet are filled from the preview, and the ready func is called
+ * when they are.
+ */
+gboolean jpeg_tiles_read(JpegTiles *jt, gint reduction,
+                         gint x, gint y, gint width, gint height, GdkPixbuf *pixbuf)
+{
+	width = std::min({width, jt->width - x, gdk_pixbuf_get_width(pixbuf)});
+	height = std::min({height, jt->height - y, gdk_pixbuf_get_height(pixbuf)});
+	if (x < 0 || y < 0 || width < 1 || height < 1) return FALSE;
+
+	if (reduction >= jt->preview_reduction)
+		{
+		gdk_pixbuf_scale(jt->preview, pixbuf, 0, 0, width, height,
+		                 -x, -y, jt->preview_reduction, jt->preview_reduction, GDK_INTERP_NEAREST);
+		return TRUE;
+		}
+
+	jt->reduction = reduction;
+
+	/* in image coordinates */
+	const gint block_width = JPEG_TILES_BLOCK_WIDTH * reduction;
+	const gint block_height = JPEG_TILES_BLOCK_HEIGHT * reduction;
+
+	for (gint block_y = y / block_height * block_height; block_y < y + height; block_y += block_height)
+		{
+		for (gint block_x = x / block_width * block_width; block_x < x + width; block_x += block_width)
+			{
+			const gint x1 = std::max(x, block_x);
+			const gint y1 = std::max(y, block_y);
+			const gint x2 = std::min(x + width, block_x + block_width);
+			const gint y2 = std::min(y + height, block_y + block_height);
+
+			JpegTilesBlock block{reduction, block_x / block_width, block_y / block_height, nullptr, 0};
+			if (jpeg_tiles_block_get(jt, block))
+				{
+				gdk_pixbuf_scale(block.pixbuf, pixbuf, x1 - x, y1 - y, x2 - x1, y2 - y1,
+				                 block.crop_x * reduction - x, block_y - y, reduction, reduction, GDK_INTERP_NEAREST);
+				g_object_unref(block.pixbuf);
+				}
+			else
+				{
+				gdk_pixbuf_scale(jt->preview, pixbuf, x1 - x, y1 - y, x2 - x1, y2 - y1,
+				                 -x, -y, jt->preview_reduction, jt->preview_reduction, GDK_INTERP_NEAREST);
+				}
+			}
+		}
+
+	return TRUE;
+}
+
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
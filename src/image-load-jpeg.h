@@ -22,11 +22,16 @@
 #ifndef IMAGE_LOAD_JPEG_H
 #define IMAGE_LOAD_JPEG_H
 
+#include <atomic>
+#include <functional>
 #include <memory>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gdk/gdk.h>
 #include <glib.h>
 
+struct jpeg_decompress_struct;
+
 #include "image-load.h"
 
 struct ImageLoaderJpeg : public ImageLoaderBackend
@@ -36,6 +41,7 @@ public:
 
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data) override;
 	void set_size(int width, int height) override;
+	gboolean can_reduce_size() override;
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
 	GdkPixbuf *get_pixbuf() override;
 	void abort() override;
@@ -43,6 +49,8 @@ public:
 	gchar **get_format_mime_types() override;
 
 private:
+	gboolean write_restart_bands(const guchar *buf, gsize count, const struct jpeg_decompress_struct &cinfo);
+
 	AreaUpdatedCb area_updated_cb;
 	SizePreparedCb size_prepared_cb;
 
@@ -52,12 +60,39 @@ private:
 	guint requested_width;
 	guint requested_height;
 
-	gboolean aborted;
+	std::atomic<gboolean> aborted{FALSE}; /**< set by abort() from another thread */
 	gboolean stereo;
 };
 
 std::unique_ptr<ImageLoaderBackend> get_image_loader_backend_jpeg();
 
+/**
+ * @struct JpegTiles
+ * Decodes regions of a large jpeg file on request, in other threads,
+ * see pixbuf_renderer_set_tiles()
+ */
+struct JpegTiles;
+
+/**
+ * @brief Called in the main thread when a region requested at 1/reduction of the detail
+ * has been decoded, see jpeg_tiles_read()
+ */
+using JpegTilesReadyFunc = std::function<void(gint reduction, GdkRectangle area)>;
+
+gboolean jpeg_tiles_supported(const guchar *buf, gsize count, gint64 min_pixels);
+JpegTiles *jpeg_tiles_new(const gchar *path, gint64 min_pixels);
+void jpeg_tiles_free(JpegTiles *jt);
+
+gint jpeg_tiles_get_width(const JpegTiles *jt);
+gint jpeg_tiles_get_height(const JpegTiles *jt);
+gint jpeg_tiles_get_max_reduction(const JpegTiles *jt);
+GdkPixbuf *jpeg_tiles_get_preview(const JpegTiles *jt);
+
+void jpeg_tiles_set_ready_func(JpegTiles *jt, const JpegTilesReadyFunc &func);
+
+gboolean jpeg_tiles_read(JpegTiles *jt, gint reduction,
+                         gint x, gint y, gint width, gint height, GdkPixbuf *pixbuf);
+
 #endif /* IMAGE_LOAD_JPEG_H */
 
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
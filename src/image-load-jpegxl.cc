@@ -52,15 +52,19 @@
 
 #include "image-load-jpegxl.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
 #include <memory>
 
+#include <config.h>
+
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <glib-object.h>
 #include <glib.h>
 #include <jxl/codestream_header.h>
 #include <jxl/decode_cxx.h>
+#include <jxl/parallel_runner.h>
 #include <jxl/types.h>
 
 #include "image-load.h"
@@ -74,19 +78,41 @@ public:
 	~ImageLoaderJPEGXL() override;
 
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data) override;
+	void set_size(int width, int height) override;
+	gboolean can_reduce_size() override;
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
 	GdkPixbuf *get_pixbuf() override;
 	gchar *get_format_name() override;
 	gchar **get_format_mime_types() override;
 
 private:
+	uint8_t *memory_to_pixels(const uint8_t *next_in, size_t size, size_t &xsize, size_t &ysize, size_t &stride);
+
 	AreaUpdatedCb area_updated_cb;
+	SizePreparedCb size_prepared_cb;
 	gpointer data;
 
 	GdkPixbuf *pixbuf;
+	size_t requested_width = 0;
+	size_t requested_height = 0;
 };
 
-uint8_t *JxlMemoryToPixels(const uint8_t *next_in, size_t size, size_t &xsize, size_t &ysize, size_t &stride)
+/* Runs the parallel parts of a decode in the threads shared by all image decoders */
+JxlParallelRetCode image_loader_jxl_runner(void *, void *jpegxl_opaque, JxlParallelRunInit init,
+                                           JxlParallelRunFunction func, uint32_t start_range, uint32_t end_range)
+{
+	const gint thread_count = std::max<gint>(1, std::min<uint32_t>(image_loader_get_decode_thread_count(), end_range - start_range));
+
+	const JxlParallelRetCode ret = init(jpegxl_opaque, thread_count);
+	if (ret != 0) return ret;
+
+	image_loader_parallel_run(start_range, end_range, thread_count,
+	                          [jpegxl_opaque, func](guint32 value, gint thread_id) { func(jpegxl_opaque, value, thread_id); });
+
+	return 0;
+}
+
+uint8_t *ImageLoaderJPEGXL::memory_to_pixels(const uint8_t *next_in, size_t size, size_t &xsize, size_t &ysize, size_t &stride)
 {
 	JxlDecoderPtr dec = JxlDecoderMake(nullptr);
 	if (!dec)
@@ -94,11 +120,29 @@ uint8_t *JxlMemoryToPixels(const uint8_t *next_in, size_t size, size_t &xsize, s
 		log_printf("JxlDecoderCreate failed\n");
 		return nullptr;
 		}
-	if (JXL_DEC_SUCCESS != JxlDecoderSubscribeEvents(dec.get(), JXL_DEC_BASIC_INFO | JXL_DEC_FULL_IMAGE))
+	if (JXL_DEC_SUCCESS != JxlDecoderSetParallelRunner(dec.get(), image_loader_jxl_runner, nullptr))
+		{
+		log_printf("JxlDecoderSetParallelRunner failed\n");
+		return nullptr;
+		}
+
+	int events = JXL_DEC_BASIC_INFO | JXL_DEC_FULL_IMAGE;
+#if HAVE_JPEGXL_PROGRESSIVE
+	events |= JXL_DEC_FRAME_PROGRESSION;
+#endif
+	if (JXL_DEC_SUCCESS != JxlDecoderSubscribeEvents(dec.get(), events))
 		{
 		log_printf("JxlDecoderSubscribeEvents failed\n");
 		return nullptr;
 		}
+#if HAVE_JPEGXL_PROGRESSIVE
+	/* stop after the 1:8 pass if that is enough for the requested size */
+	if (JXL_DEC_SUCCESS != JxlDecoderSetProgressiveDetail(dec.get(), kDC))
+		{
+		log_printf("JxlDecoderSetProgressiveDetail failed\n");
+		return nullptr;
+		}
+#endif
 
 	/* Avoid compiler warning - used uninitialized */
 	/* This file will be replaced by libjxl at some time */
@@ -131,6 +175,8 @@ uint8_t *JxlMemoryToPixels(const uint8_t *next_in, size_t size, size_t &xsize, s
 				xsize = info.xsize;
 				ysize = info.ysize;
 				stride = info.xsize * 4;
+
+				size_prepared_cb(nullptr, xsize, ysize, data);
 				break;
 			case JXL_DEC_NEED_IMAGE_OUT_BUFFER:
 				{
@@ -154,6 +200,20 @@ uint8_t *JxlMemoryToPixels(const uint8_t *next_in, size_t size, size_t &xsize, s
 					}
 				}
 				break;
+#if HAVE_JPEGXL_PROGRESSIVE
+			case JXL_DEC_FRAME_PROGRESSION:
+				{
+				/* the buffer stays full size, but with only as much detail as is needed */
+				const size_t ratio = JxlDecoderGetIntendedDownsamplingRatio(dec.get());
+				if (pixels && requested_width > 0 && requested_height > 0 &&
+				    xsize / ratio >= requested_width && ysize / ratio >= requested_height &&
+				    JXL_DEC_SUCCESS == JxlDecoderFlushImage(dec.get()))
+					{
+					return pixels.release();
+					}
+				}
+				break;
+#endif
 			case JXL_DEC_FULL_IMAGE:
 				// This means the decoder has decoded all pixels into the buffer.
 				return pixels.release();
@@ -177,7 +237,7 @@ gboolean ImageLoaderJPEGXL::write(const guchar *buf, gsize &chunk_size, gsize co
 	size_t stride;
 	uint8_t *pixels = nullptr;
 
-	pixels = JxlMemoryToPixels(buf, count, xsize, ysize, stride);
+	pixels = memory_to_pixels(buf, count, xsize, ysize, stride);
 
 	if (pixels)
 		{
@@ -192,12 +252,29 @@ gboolean ImageLoaderJPEGXL::write(const guchar *buf, gsize &chunk_size, gsize co
 	return ret;
 }
 
-void ImageLoaderJPEGXL::init(AreaUpdatedCb area_updated_cb, SizePreparedCb, gpointer data)
+void ImageLoaderJPEGXL::init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data)
 {
 	this->area_updated_cb = area_updated_cb;
+	this->size_prepared_cb = size_prepared_cb;
 	this->data = data;
 }
 
+void ImageLoaderJPEGXL::set_size(int width, int height)
+{
+	requested_width = width;
+	requested_height = height;
+}
+
+/* by stopping after a progressive pass, if libjxl can do that */
+gboolean ImageLoaderJPEGXL::can_reduce_size()
+{
+#if HAVE_JPEGXL_PROGRESSIVE
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
 GdkPixbuf *ImageLoaderJPEGXL::get_pixbuf()
 {
 	return pixbuf;
@@ -23,6 +23,9 @@
  * This uses libraw to extract a thumbnail from a raw image. The exiv2 library
  * does not (yet) extract thumbnails from .cr3 images.
  * LibRaw seems to be slower than exiv2, so let exiv2 have priority.
+ *
+ * The loader backend decodes the raw data itself, for showing the full
+ * image after its preview.
  */
 
 #include "image-load-libraw.h"
@@ -33,13 +36,159 @@
 
 #include <sys/mman.h>
 
+#include <atomic>
 #include <cstddef>
 
+#include <gdk-pixbuf/gdk-pixbuf.h>
 #include <libraw/libraw.h>
 
 #include "filefilter.h"
+#include "image-load.h"
 #include "ui-fileops.h"
 
+namespace
+{
+
+struct ImageLoaderLibraw : public ImageLoaderBackend
+{
+public:
+	~ImageLoaderLibraw() override;
+
+	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data) override;
+	void set_size(int width, int height) override;
+	gboolean can_reduce_size() override;
+	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
+	GdkPixbuf *get_pixbuf() override;
+	void abort() override;
+	gchar *get_format_name() override;
+	gchar **get_format_mime_types() override;
+
+private:
+	AreaUpdatedCb area_updated_cb;
+	SizePreparedCb size_prepared_cb;
+	gpointer data;
+
+	GdkPixbuf *pixbuf = nullptr;
+	gint requested_width = 0;
+	gint requested_height = 0;
+	std::atomic<gboolean> aborted{FALSE};
+};
+
+/* libraw calls this between its processing stages, a non-zero return cancels */
+int libraw_progress_cb(void *data, enum LibRaw_progress, int, int)
+{
+	return *static_cast<std::atomic<gboolean> *>(data) ? 1 : 0;
+}
+
+void libraw_free_image(guchar *, gpointer data)
+{
+	LibRaw::dcraw_clear_mem(static_cast<libraw_processed_image_t *>(data));
+}
+
+gboolean ImageLoaderLibraw::write(const guchar *buf, gsize &chunk_size, gsize count, GError **)
+{
+	auto lr = std::make_unique<LibRaw>();
+
+	/* the orientation is applied when the image is shown, as for the preview */
+	lr->imgdata.params.user_flip = 0;
+	lr->set_progress_handler(libraw_progress_cb, &aborted);
+
+	int ret = lr->open_buffer(buf, count);
+	if (ret != LIBRAW_SUCCESS)
+		{
+		log_printf("warning: libraw reader error: %s\n", libraw_strerror(ret));
+		return FALSE;
+		}
+
+	const gint width = lr->imgdata.sizes.width;
+	const gint height = lr->imgdata.sizes.height;
+
+	size_prepared_cb(nullptr, width, height, data);
+
+	/* half size skips the interpolation, which is most of the work */
+	if (requested_width > 0 && requested_height > 0 &&
+	    requested_width <= width / 2 && requested_height <= height / 2)
+		{
+		lr->imgdata.params.half_size = 1;
+		}
+
+	ret = lr->unpack();
+	if (ret == LIBRAW_SUCCESS) ret = lr->dcraw_process();
+	if (ret != LIBRAW_SUCCESS)
+		{
+		if (ret != LIBRAW_CANCELLED_BY_CALLBACK) log_printf("warning: libraw reader error: %s\n", libraw_strerror(ret));
+		return FALSE;
+		}
+
+	libraw_processed_image_t *image = lr->dcraw_make_mem_image(&ret);
+	if (!image)
+		{
+		log_printf("warning: libraw reader error: %s\n", libraw_strerror(ret));
+		return FALSE;
+		}
+
+	if (image->type != LIBRAW_IMAGE_BITMAP || image->colors != 3 || image->bits != 8)
+		{
+		LibRaw::dcraw_clear_mem(image);
+		return FALSE;
+		}
+
+	pixbuf = gdk_pixbuf_new_from_data(image->data, GDK_COLORSPACE_RGB, FALSE, 8, image->width, image->height,
+	                                  image->width * 3, libraw_free_image, image);
+
+	area_updated_cb(nullptr, 0, 0, image->width, image->height, data);
+
+	chunk_size = count;
+	return TRUE;
+}
+
+void ImageLoaderLibraw::init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data)
+{
+	this->area_updated_cb = area_updated_cb;
+	this->size_prepared_cb = size_prepared_cb;
+	this->data = data;
+}
+
+void ImageLoaderLibraw::set_size(int width, int height)
+{
+	requested_width = width;
+	requested_height = height;
+}
+
+/* by half size decoding */
+gboolean ImageLoaderLibraw::can_reduce_size()
+{
+	return TRUE;
+}
+
+GdkPixbuf *ImageLoaderLibraw::get_pixbuf()
+{
+	return pixbuf;
+}
+
+void ImageLoaderLibraw::abort()
+{
+	aborted = TRUE;
+}
+
+gchar *ImageLoaderLibraw::get_format_name()
+{
+	return g_strdup("raw");
+}
+
+gchar **ImageLoaderLibraw::get_format_mime_types()
+{
+	static const gchar *mime[] = {"image/x-dcraw", nullptr};
+	return g_strdupv(const_cast<gchar **>(mime));
+}
+
+ImageLoaderLibraw::~ImageLoaderLibraw()
+{
+	if (pixbuf) g_object_unref(pixbuf);
+}
+
+} // namespace
+
 struct UnmapData
 {
 	guchar *ptr;
@@ -107,6 +256,11 @@ guchar *libraw_get_preview(const gchar *path, gsize &data_len)
 	return nullptr;
 }
 
+std::unique_ptr<ImageLoaderBackend> get_image_loader_backend_libraw()
+{
+	return std::make_unique<ImageLoaderLibraw>();
+}
+
 #else /* !define HAVE_RAW */
 
 void libraw_free_preview(const guchar *)
@@ -21,11 +21,17 @@
 #ifndef IMAGE_LOAD_RAW_H
 #define IMAGE_LOAD_RAW_H
 
+#include <memory>
+
 #include <glib.h>
 
+struct ImageLoaderBackend;
+
 guchar *libraw_get_preview(const gchar *path, gsize &data_len);
 void libraw_free_preview(const guchar *buf);
 
+std::unique_ptr<ImageLoaderBackend> get_image_loader_backend_libraw();
+
 #endif
 
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -27,9 +27,12 @@
 
 #include "image-load-tiff.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdio>
 #include <cstring>
+#include <vector>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <glib-object.h>
@@ -42,6 +45,9 @@
 namespace
 {
 
+/* decode strips or tiles in several threads from this size */
+constexpr gint64 TIFF_PARALLEL_MIN_PIXELS = 4 * 1024 * 1024;
+
 struct ImageLoaderTiff : public ImageLoaderBackend
 {
 public:
@@ -49,6 +55,7 @@ public:
 
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data) override;
 	void set_size(int width, int height) override;
+	gboolean can_reduce_size() override;
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
 	GdkPixbuf *get_pixbuf() override;
 	void abort() override;
@@ -58,6 +65,9 @@ public:
 	gint get_page_total() override;
 
 private:
+	gboolean write_direct(TIFF *tiff, const guchar *buf, gsize count, gint width, gint height, GError **error);
+	gboolean write_rgba(TIFF *tiff, gint width, gint height);
+
 	AreaUpdatedCb area_updated_cb;
 	SizePreparedCb size_prepared_cb;
 	gpointer data;
@@ -66,7 +76,7 @@ private:
 	guint requested_width;
 	guint requested_height;
 
-	gboolean aborted;
+	std::atomic<gboolean> aborted{FALSE}; /**< set by abort() from another thread */
 
 	gint page_num;
 	gint page_total;
@@ -149,70 +159,346 @@ void tiff_load_unmap_file (thandle_t, tdata_t, toff_t)
 {
 }
 
-gboolean ImageLoaderTiff::write(const guchar *buf, gsize &chunk_size, gsize count, GError **)
+TIFF *tiff_open(GqTiffContext *context)
 {
-	TIFF *tiff;
-	guchar *pixels = nullptr;
+	return TIFFClientOpen (	"libtiff-geeqie", "r", context,
+				tiff_load_read, tiff_load_write,
+				tiff_load_seek, tiff_load_close,
+				tiff_load_size,
+				tiff_load_map_file, tiff_load_unmap_file);
+}
+
+/* The directories of the pages, that is all directories except reduced resolution images */
+std::vector<tdir_t> tiff_page_directories(TIFF *tiff)
+{
+	std::vector<tdir_t> pages;
+
+	do	{
+		guint32 subfile_type = 0;
+
+		if (!TIFFGetField(tiff, TIFFTAG_SUBFILETYPE, &subfile_type) || !(subfile_type & FILETYPE_REDUCEDIMAGE))
+			{
+			pages.push_back(TIFFCurrentDirectory(tiff));
+			}
+		} while (TIFFReadDirectory(tiff));
+
+	if (pages.empty()) pages.push_back(0);
+
+	return pages;
+}
+
+/**
+ * @brief Changes to the smallest reduced resolution image of the current page that is
+ * at least the requested size, if there is one
+ * @param next_page The directory of the next page, or 0 if the current page is the last
+ *
+ * Reduced images are either in SubIFDs of the page, or in the directories that follow it.
+ */
+void tiff_set_reduced_directory(TIFF *tiff, tdir_t next_page, guint requested_width, guint requested_height)
+{
+	const tdir_t page = TIFFCurrentDirectory(tiff);
+	const toff_t page_offset = TIFFCurrentDirOffset(tiff);
+	std::vector<toff_t> offsets;
+
+	guint16 subifd_count = 0;
+	toff_t *subifd_offsets = nullptr;
+	if (TIFFGetField(tiff, TIFFTAG_SUBIFD, &subifd_count, &subifd_offsets))
+		{
+		offsets.assign(subifd_offsets, subifd_offsets + subifd_count);
+		}
+
+	for (tdir_t dir = page + 1; next_page == 0 || dir < next_page; dir++)
+		{
+		if (!TIFFSetDirectory(tiff, dir)) break;
+		offsets.push_back(TIFFCurrentDirOffset(tiff));
+		}
+
+	toff_t best_offset = page_offset;
+	guint64 best_pixels = G_MAXUINT64;
+
+	for (const toff_t offset : offsets)
+		{
+		guint32 width;
+		guint32 height;
+
+		if (!TIFFSetSubDirectory(tiff, offset) ||
+		    !TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &width) ||
+		    !TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &height)) continue;
+
+		if (width < requested_width || height < requested_height) continue;
+
+		if (static_cast<guint64>(width) * height < best_pixels)
+			{
+			best_offset = offset;
+			best_pixels = static_cast<guint64>(width) * height;
+			}
+		}
+
+	if (best_offset != page_offset) DEBUG_1("Using reduced TIFF image at offset %" G_GUINT64_FORMAT, static_cast<guint64>(best_offset));
+
+	TIFFSetSubDirectory(tiff, best_offset);
+}
+
+/**
+ * @brief A directory that is decoded from its strips or tiles: 8 bit samples,
+ * interleaved, grey or RGB, optionally with unassociated alpha
+ */
+struct TiffDirectLayout
+{
+	toff_t dir_offset;
 	gint width;
 	gint height;
-	gint rowstride;
-	size_t bytes;
-	guint32 rowsperstrip;
-	gint dircount = 0;
+	guint16 samples;
+	gboolean tiled;
+	guint32 chunk_width;  /**< of a tile, or the image width for strips */
+	guint32 chunk_height; /**< of a tile, or the rows per strip */
+	guint32 chunk_count;
+};
 
-	TIFFSetWarningHandler(nullptr);
+gboolean tiff_get_direct_layout(TIFF *tiff, gint width, gint height, TiffDirectLayout &layout)
+{
+	guint16 bits_per_sample;
+	guint16 samples;
+	guint16 planar_config;
+	guint16 sample_format;
+	guint16 orientation;
+	guint16 photometric;
+	guint16 extra_count;
+	guint16 *extra_types;
 
-	GqTiffContext context{buf, count, 0};
-	tiff = TIFFClientOpen (	"libtiff-geeqie", "r", &context,
-							tiff_load_read, tiff_load_write,
-							tiff_load_seek, tiff_load_close,
-							tiff_load_size,
-							tiff_load_map_file, tiff_load_unmap_file);
-	if (!tiff)
+	if (!TIFFGetField(tiff, TIFFTAG_PHOTOMETRIC, &photometric)) return FALSE;
+
+	TIFFGetFieldDefaulted(tiff, TIFFTAG_BITSPERSAMPLE, &bits_per_sample);
+	TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLESPERPIXEL, &samples);
+	TIFFGetFieldDefaulted(tiff, TIFFTAG_PLANARCONFIG, &planar_config);
+	TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLEFORMAT, &sample_format);
+	TIFFGetFieldDefaulted(tiff, TIFFTAG_ORIENTATION, &orientation);
+	TIFFGetFieldDefaulted(tiff, TIFFTAG_EXTRASAMPLES, &extra_count, &extra_types);
+
+	if (bits_per_sample != 8 || planar_config != PLANARCONFIG_CONTIG ||
+	    sample_format != SAMPLEFORMAT_UINT || orientation != ORIENTATION_TOPLEFT) return FALSE;
+
+	if (photometric != PHOTOMETRIC_RGB && photometric != PHOTOMETRIC_MINISBLACK) return FALSE;
+
+	const guint16 color_samples = (photometric == PHOTOMETRIC_RGB) ? 3 : 1;
+
+	if (samples == color_samples)
+		{
+		if (extra_count != 0) return FALSE;
+		}
+	else if (samples == color_samples + 1)
+		{
+		if (extra_count != 1 || extra_types[0] != EXTRASAMPLE_UNASSALPHA) return FALSE;
+		}
+	else
 		{
-		DEBUG_1("Failed to open TIFF image");
 		return FALSE;
 		}
 
-	do	{
-		dircount++;
-		} while (TIFFReadDirectory(tiff));
+	layout.dir_offset = TIFFCurrentDirOffset(tiff);
+	layout.width = width;
+	layout.height = height;
+	layout.samples = samples;
+	layout.tiled = TIFFIsTiled(tiff);
 
-	page_total = dircount;
+	if (layout.tiled)
+		{
+		if (!TIFFGetField(tiff, TIFFTAG_TILEWIDTH, &layout.chunk_width) ||
+		    !TIFFGetField(tiff, TIFFTAG_TILELENGTH, &layout.chunk_height)) return FALSE;
+		layout.chunk_count = TIFFNumberOfTiles(tiff);
+		}
+	else
+		{
+		guint32 rows_per_strip;
 
-	if (!TIFFSetDirectory(tiff, page_num))
+		TIFFGetFieldDefaulted(tiff, TIFFTAG_ROWSPERSTRIP, &rows_per_strip);
+		layout.chunk_width = width;
+		layout.chunk_height = std::min(rows_per_strip, static_cast<guint32>(height));
+		layout.chunk_count = TIFFNumberOfStrips(tiff);
+		}
+
+	return layout.chunk_width > 0 && layout.chunk_height > 0 && layout.chunk_count > 0;
+}
+
+/* The region of a strip or tile in the image, FALSE if it is outside */
+gboolean tiff_chunk_region(const TiffDirectLayout &layout, guint32 chunk, gint &x, gint &y, gint &w, gint &h)
+{
+	const guint32 chunks_across = (layout.width + layout.chunk_width - 1) / layout.chunk_width;
+	x = (chunk % chunks_across) * layout.chunk_width;
+	y = (chunk / chunks_across) * layout.chunk_height;
+	if (x >= layout.width || y >= layout.height) return FALSE;
+
+	w = std::min(static_cast<gint>(layout.chunk_width), layout.width - x);
+	h = std::min(static_cast<gint>(layout.chunk_height), layout.height - y);
+	return TRUE;
+}
+
+/* Converts a decoded strip or tile into the pixbuf */
+void tiff_copy_chunk(const TiffDirectLayout &layout, guint32 chunk, const guchar *src, GdkPixbuf *pixbuf)
+{
+	gint x;
+	gint y;
+	gint w;
+	gint h;
+	if (!tiff_chunk_region(layout, chunk, x, y, w, h)) return;
+
+	const gsize src_rowstride = static_cast<gsize>(layout.chunk_width) * layout.samples;
+	const gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+	const gint channels = gdk_pixbuf_get_n_channels(pixbuf);
+	guchar *dst = gdk_pixbuf_get_pixels(pixbuf) + static_cast<gsize>(y) * rowstride + x * channels;
+
+	for (gint row = 0; row < h; row++)
 		{
-		DEBUG_1("Failed to open TIFF image");
-		TIFFClose(tiff);
+		const guchar *s = src + row * src_rowstride;
+		guchar *d = dst + static_cast<gsize>(row) * rowstride;
+
+		if (layout.samples == channels)
+			{
+			memcpy(d, s, static_cast<gsize>(w) * channels);
+			}
+		else
+			{
+			/* grey, optionally with alpha */
+			for (gint i = 0; i < w; i++)
+				{
+				d[0] = d[1] = d[2] = s[0];
+				if (channels == 4) d[3] = s[1];
+				s += layout.samples;
+				d += channels;
+				}
+			}
+		}
+}
+
+/* The TIFF handle of one decoding thread, opened for its first chunk */
+struct TiffChunkDecoder
+{
+	GqTiffContext context;
+	TIFF *tiff = nullptr;
+	gboolean opened = FALSE;
+	std::vector<guchar> chunk;
+};
+
+gboolean tiff_chunk_decoder_open(TiffChunkDecoder &decoder, const guchar *buf, gsize count, const TiffDirectLayout &layout)
+{
+	decoder.opened = TRUE;
+	decoder.context = {buf, count, 0};
+	decoder.tiff = tiff_open(&decoder.context);
+	if (!decoder.tiff) return FALSE;
+
+	if (!TIFFSetSubDirectory(decoder.tiff, layout.dir_offset))
+		{
+		TIFFClose(decoder.tiff);
+		decoder.tiff = nullptr;
 		return FALSE;
 		}
 
-	if (!TIFFGetField (tiff, TIFFTAG_IMAGEWIDTH, &width))
+	decoder.chunk.resize(layout.tiled ? TIFFTileSize(decoder.tiff) : TIFFStripSize(decoder.tiff));
+	return TRUE;
+}
+
+/* Blanks a strip or tile which could not be read, the pixbuf is not initialized */
+void tiff_clear_chunk(const TiffDirectLayout &layout, guint32 chunk, GdkPixbuf *pixbuf)
+{
+	gint x;
+	gint y;
+	gint w;
+	gint h;
+	if (!tiff_chunk_region(layout, chunk, x, y, w, h)) return;
+
+	g_autoptr(GdkPixbuf) region = gdk_pixbuf_new_subpixbuf(pixbuf, x, y, w, h);
+	gdk_pixbuf_fill(region, 0);
+}
+
+/**
+ * @brief Decodes one strip or tile with the TIFF handle of the calling thread
+ * @returns FALSE if it could not be read, it is then blank
+ */
+gboolean tiff_decode_chunk(TiffChunkDecoder &decoder, const guchar *buf, gsize count,
+                           const TiffDirectLayout &layout, guint32 i, GdkPixbuf *pixbuf)
+{
+	if (!decoder.opened) tiff_chunk_decoder_open(decoder, buf, count, layout);
+	if (!decoder.tiff)
 		{
-		DEBUG_1("Could not get image width (bad TIFF file)");
-		TIFFClose(tiff);
+		tiff_clear_chunk(layout, i, pixbuf);
 		return FALSE;
 		}
 
-	if (!TIFFGetField (tiff, TIFFTAG_IMAGELENGTH, &height))
+	const tmsize_t chunk_size = decoder.chunk.size();
+	const tmsize_t read = layout.tiled ? TIFFReadEncodedTile(decoder.tiff, i, decoder.chunk.data(), chunk_size)
+	                                   : TIFFReadEncodedStrip(decoder.tiff, i, decoder.chunk.data(), chunk_size);
+	if (read < 0)
 		{
-		DEBUG_1("Could not get image height (bad TIFF file)");
-		TIFFClose(tiff);
+		DEBUG_1("Failed to read TIFF %s %u", layout.tiled ? "tile" : "strip", i);
+		tiff_clear_chunk(layout, i, pixbuf);
 		return FALSE;
 		}
 
-	if (width <= 0 || height <= 0)
+	tiff_copy_chunk(layout, i, decoder.chunk.data(), pixbuf);
+	return TRUE;
+}
+
+/**
+ * @brief Decodes the strips or tiles straight into the pixbuf, in several threads for large images
+ * @param[out] error Set if some strips or tiles could not be read, the pixbuf is then partial
+ * @returns FALSE if the layout of the image is not supported
+ */
+gboolean ImageLoaderTiff::write_direct(TIFF *tiff, const guchar *buf, gsize count, gint width, gint height, GError **error)
+{
+	TiffDirectLayout layout;
+	if (!tiff_get_direct_layout(tiff, width, height, layout)) return FALSE;
+
+	pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, layout.samples == 2 || layout.samples == 4, 8, width, height);
+	if (!pixbuf)
 		{
-		DEBUG_1("Width or height of TIFF image is zero");
-		TIFFClose(tiff);
+		DEBUG_1("Insufficient memory to open TIFF file");
 		return FALSE;
 		}
 
+	gint thread_count = 1;
+	if (static_cast<gint64>(width) * height >= TIFF_PARALLEL_MIN_PIXELS)
+		{
+		thread_count = std::clamp(image_loader_get_decode_thread_count(), 1, static_cast<gint>(std::min<guint32>(layout.chunk_count, G_MAXINT)));
+		}
+
+	DEBUG_1("tiff decode of %u %s in %d threads", layout.chunk_count, layout.tiled ? "tiles" : "strips", thread_count);
+
+	/* each thread decodes with its own TIFF handle */
+	std::vector<TiffChunkDecoder> decoders(thread_count);
+	std::atomic<guint32> failed_chunks{0};
+	image_loader_parallel_run(0, layout.chunk_count, thread_count, [this, buf, count, &layout, &decoders, &failed_chunks](guint32 value, gint thread_id)
+	{
+		if (!aborted && !tiff_decode_chunk(decoders[thread_id], buf, count, layout, value, pixbuf)) failed_chunks++;
+	});
+
+	for (const TiffChunkDecoder &decoder : decoders)
+		{
+		if (decoder.tiff) TIFFClose(decoder.tiff);
+		}
+
+	if (failed_chunks > 0)
+		{
+		g_set_error(error, GDK_PIXBUF_ERROR, GDK_PIXBUF_ERROR_CORRUPT_IMAGE,
+		            "Failed to read %u of %u TIFF %s", failed_chunks.load(), layout.chunk_count, layout.tiled ? "tiles" : "strips");
+		}
+
+	area_updated_cb(nullptr, 0, 0, width, height, data);
+
+	return TRUE;
+}
+
+/* Decodes any image that libtiff can convert to RGBA */
+gboolean ImageLoaderTiff::write_rgba(TIFF *tiff, gint width, gint height)
+{
+	guchar *pixels = nullptr;
+	gint rowstride;
+	size_t bytes;
+	guint32 rowsperstrip;
+
 	rowstride = width * 4;
 	if (rowstride / 4 != width)
 		{ /* overflow */
 		DEBUG_1("Dimensions of TIFF image too large: width %d", width);
-		TIFFClose(tiff);
 		return FALSE;
 		}
 
@@ -220,20 +506,14 @@ gboolean ImageLoaderTiff::write(const guchar *buf, gsize &chunk_size, gsize coun
 	if (bytes / rowstride != static_cast<size_t>(height))
 		{ /* overflow */
 		DEBUG_1("Dimensions of TIFF image too large: height %d", height);
-		TIFFClose(tiff);
 		return FALSE;
 		}
 
-	requested_width = width;
-	requested_height = height;
-	size_prepared_cb(nullptr, requested_width, requested_height, data);
-
 	pixels = static_cast<guchar *>(g_try_malloc (bytes));
 
 	if (!pixels)
 		{
 		DEBUG_1("Insufficient memory to open TIFF file: need %zu", bytes);
-		TIFFClose(tiff);
 		return FALSE;
 		}
 
@@ -244,7 +524,6 @@ gboolean ImageLoaderTiff::write(const guchar *buf, gsize &chunk_size, gsize coun
 		{
 		g_free (pixels);
 		DEBUG_1("Insufficient memory to open TIFF file");
-		TIFFClose(tiff);
 		return FALSE;
 		}
 
@@ -301,7 +580,6 @@ gboolean ImageLoaderTiff::write(const guchar *buf, gsize &chunk_size, gsize coun
 		/* fallback, tiled tiff */
 		if (!TIFFReadRGBAImageOriented (tiff, width, height, reinterpret_cast<guint32 *>(pixels), ORIENTATION_TOPLEFT, 1))
 			{
-			TIFFClose(tiff);
 			return FALSE;
 			}
 
@@ -328,9 +606,93 @@ gboolean ImageLoaderTiff::write(const guchar *buf, gsize &chunk_size, gsize coun
 
 		area_updated_cb(nullptr, 0, 0, width, height, data);
 		}
+
+	return TRUE;
+}
+
+gboolean ImageLoaderTiff::write(const guchar *buf, gsize &chunk_size, gsize count, GError **error)
+{
+	TIFF *tiff;
+	gint width;
+	gint height;
+
+	TIFFSetWarningHandler(nullptr);
+
+	GqTiffContext context{buf, count, 0};
+	tiff = tiff_open(&context);
+	if (!tiff)
+		{
+		DEBUG_1("Failed to open TIFF image");
+		return FALSE;
+		}
+
+	const std::vector<tdir_t> pages = tiff_page_directories(tiff);
+	page_total = pages.size();
+
+	if (page_num < 0 || page_num >= page_total || !TIFFSetDirectory(tiff, pages[page_num]))
+		{
+		DEBUG_1("Failed to open TIFF image");
+		TIFFClose(tiff);
+		return FALSE;
+		}
+
+	if (!TIFFGetField (tiff, TIFFTAG_IMAGEWIDTH, &width))
+		{
+		DEBUG_1("Could not get image width (bad TIFF file)");
+		TIFFClose(tiff);
+		return FALSE;
+		}
+
+	if (!TIFFGetField (tiff, TIFFTAG_IMAGELENGTH, &height))
+		{
+		DEBUG_1("Could not get image height (bad TIFF file)");
+		TIFFClose(tiff);
+		return FALSE;
+		}
+
+	if (width <= 0 || height <= 0)
+		{
+		DEBUG_1("Width or height of TIFF image is zero");
+		TIFFClose(tiff);
+		return FALSE;
+		}
+
+	requested_width = width;
+	requested_height = height;
+	size_prepared_cb(nullptr, requested_width, requested_height, data);
+
+	/* a smaller size may have been requested by set_size() */
+	if (requested_width < static_cast<guint>(width) || requested_height < static_cast<guint>(height))
+		{
+		const tdir_t next_page = (page_num + 1 < page_total) ? pages[page_num + 1] : 0;
+
+		tiff_set_reduced_directory(tiff, next_page, requested_width, requested_height);
+
+		if (!TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &width) ||
+		    !TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &height) ||
+		    width <= 0 || height <= 0)
+			{
+			DEBUG_1("Bad reduced TIFF image");
+			TIFFClose(tiff);
+			return FALSE;
+			}
+		}
+
+	GError *direct_error = nullptr;
+	const gboolean ret = write_direct(tiff, buf, count, width, height, &direct_error) || write_rgba(tiff, width, height);
 	TIFFClose(tiff);
 
+	if (!ret) return FALSE;
+
 	chunk_size = count;
+
+	/* the loader reports the error, and keeps the partial pixbuf */
+	if (direct_error)
+		{
+		g_propagate_error(error, direct_error);
+		return FALSE;
+		}
+
 	return TRUE;
 }
 
@@ -348,6 +710,12 @@ void ImageLoaderTiff::set_size(int width, int height)
 	requested_height = height;
 }
 
+/* by reduced resolution images, if the file has them */
+gboolean ImageLoaderTiff::can_reduce_size()
+{
+	return TRUE;
+}
+
 GdkPixbuf *ImageLoaderTiff::get_pixbuf()
 {
 	return pixbuf;
@@ -36,6 +36,8 @@ public:
 	~ImageLoaderWEBP() override;
 
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data) override;
+	void set_size(int width, int height) override;
+	gboolean can_reduce_size() override;
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
 	GdkPixbuf *get_pixbuf() override;
 	gchar *get_format_name() override;
@@ -43,63 +45,92 @@ public:
 
 private:
 	AreaUpdatedCb area_updated_cb;
+	SizePreparedCb size_prepared_cb;
 	gpointer data;
 
 	GdkPixbuf *pixbuf;
+	gint requested_width = 0;
+	gint requested_height = 0;
 };
 
 gboolean ImageLoaderWEBP::write(const guchar *buf, gsize &chunk_size, gsize count, GError **)
 {
-	guint8* pixels;
-	gint width;
-	gint height;
-	gboolean res_info;
-	WebPBitstreamFeatures features;
-	VP8StatusCode status_code;
-
-	res_info = WebPGetInfo(buf, count, &width, &height);
-	if (!res_info)
-		{
-		log_printf("warning: webp reader error\n");
-		return FALSE;
-		}
+	WebPDecoderConfig config;
 
-	status_code = WebPGetFeatures(buf, count, &features);
-	if (status_code != VP8_STATUS_OK)
+	if (!WebPInitDecoderConfig(&config) ||
+	    WebPGetFeatures(buf, count, &config.input) != VP8_STATUS_OK)
 		{
 		log_printf("warning: webp reader error\n");
 		return FALSE;
 		}
 
-	if (features.has_alpha)
+	size_prepared_cb(nullptr, config.input.width, config.input.height, data);
+
+	gint width = config.input.width;
+	gint height = config.input.height;
+
+	/* the decoder scales while decoding, which is faster than scaling the full size image */
+	if (requested_width > 0 && requested_height > 0 &&
+	    (requested_width < width || requested_height < height))
 		{
-		pixels = WebPDecodeRGBA(buf, count, &width, &height);
+		width = requested_width;
+		height = requested_height;
+
+		config.options.use_scaling = 1;
+		config.options.scaled_width = width;
+		config.options.scaled_height = height;
 		}
-	else
+
+	const gboolean alpha = config.input.has_alpha;
+	const gint stride = width * (alpha ? 4 : 3);
+	auto *pixels = static_cast<guchar *>(g_try_malloc(static_cast<gsize>(stride) * height));
+	if (!pixels)
 		{
-		pixels = WebPDecodeRGB(buf, count, &width, &height);
+		log_printf("warning: webp reader error\n");
+		return FALSE;
 		}
 
-	if (pixels)
+	config.output.colorspace = alpha ? MODE_RGBA : MODE_RGB;
+	config.output.is_external_memory = 1;
+	config.output.u.RGBA.rgba = pixels;
+	config.output.u.RGBA.stride = stride;
+	config.output.u.RGBA.size = static_cast<gsize>(stride) * height;
+
+	if (WebPDecode(buf, count, &config) != VP8_STATUS_OK)
 		{
-		pixbuf = gdk_pixbuf_new_from_data(pixels, GDK_COLORSPACE_RGB, features.has_alpha, 8, width, height, width * (features.has_alpha ? 4 : 3), free_pixels, nullptr);
+		g_free(pixels);
+		log_printf("warning: webp reader error\n");
+		return FALSE;
+		}
 
-		area_updated_cb(nullptr, 0, 0, width, height, data);
+	pixbuf = gdk_pixbuf_new_from_data(pixels, GDK_COLORSPACE_RGB, alpha, 8, width, height, stride, free_pixels, nullptr);
 
-		chunk_size = count;
+	area_updated_cb(nullptr, 0, 0, width, height, data);
 
-		return TRUE;
-		}
+	chunk_size = count;
 
-	return FALSE;
+	return TRUE;
 }
 
-void ImageLoaderWEBP::init(AreaUpdatedCb area_updated_cb, SizePreparedCb, gpointer data)
+void ImageLoaderWEBP::init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data)
 {
 	this->area_updated_cb = area_updated_cb;
+	this->size_prepared_cb = size_prepared_cb;
 	this->data = data;
 }
 
+void ImageLoaderWEBP::set_size(int width, int height)
+{
+	requested_width = width;
+	requested_height = height;
+}
+
+/* by scaling while decoding */
+gboolean ImageLoaderWEBP::can_reduce_size()
+{
+	return TRUE;
+}
+
 GdkPixbuf *ImageLoaderWEBP::get_pixbuf()
 {
 	return pixbuf;
@@ -23,7 +23,10 @@
 
 #include <sys/mman.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <utility>
 
 #include <config.h>
 
@@ -31,50 +34,16 @@
 #include "filedata.h"
 #include "geometry.h"
 #include "image-load-collection.h"
-#include "image-load-dds.h"
-#if HAVE_DJVU
-#  include "image-load-djvu.h"
-#endif
-#if HAVE_EXR
-#  include "image-load-exr.h"
-#endif
 #include "image-load-external.h"
 #if HAVE_FFMPEGTHUMBNAILER
 #  include "image-load-ffmpegthumbnailer.h"
 #endif
-#if HAVE_FITS
-#  include "image-load-fits.h"
-#endif
+#include "image-load-formats.h"
 #include "image-load-gdk.h"
-#if HAVE_HEIF
-#  include "image-load-heif.h"
-#endif
-#if HAVE_J2K
-#  include "image-load-j2k.h"
-#endif
 #if HAVE_JPEG
-#  if !HAVE_RAW
-#    include "image-load-cr3.h"
-#  endif
 #  include "image-load-jpeg.h"
 #endif
-#if HAVE_JPEGXL
-#  include "image-load-jpegxl.h"
-#endif
 #include "image-load-libraw.h"
-#if HAVE_NPY
-#  include "image-load-npy.h"
-#endif
-#if HAVE_PDF
-#  include "image-load-pdf.h"
-#endif
-#include "image-load-psd.h"
-#include "image-load-svgz.h"
-#if HAVE_TIFF
-#  include "image-load-tiff.h"
-#endif
-#include "image-load-webp.h"
-#include "image-load-zxscr.h"
 #include "jpeg-parser.h"
 #include "misc.h"
 #include "options.h"
@@ -147,6 +116,11 @@ static void image_loader_init(GTypeInstance *instance, gpointer)
 	il->read_buffer_size = IMAGE_LOADER_READ_BUFFER_SIZE_DEFAULT;
 	il->mapped_file = nullptr;
 	il->preview = IMAGE_LOADER_PREVIEW_NONE;
+	il->raw_decode = FALSE;
+	il->tiles_min_pixels = 0;
+	il->tiles_prepare = FALSE;
+	il->tiles_skipped = FALSE;
+	il->jpeg_tiles = nullptr;
 
 	il->requested_width = 0;
 	il->requested_height = 0;
@@ -269,6 +243,9 @@ static void image_loader_finalize(GObject *object)
 		}
 
 	if (il->pixbuf) g_object_unref(il->pixbuf);
+#if HAVE_JPEG
+	jpeg_tiles_free(il->jpeg_tiles);
+#endif
 
 	if (il->error) g_error_free(il->error);
 
@@ -362,12 +339,12 @@ static gboolean image_loader_emit_size_prepared_cb(gpointer data)
 
 static void image_loader_emit_done(ImageLoader *il)
 {
-	g_idle_add_full(il->idle_priority, image_loader_emit_done_cb, il, nullptr);
+	g_idle_add_full(g_atomic_int_get(&il->idle_priority), image_loader_emit_done_cb, il, nullptr);
 }
 
 static void image_loader_emit_error(ImageLoader *il)
 {
-	g_idle_add_full(il->idle_priority, image_loader_emit_error_cb, il, nullptr);
+	g_idle_add_full(g_atomic_int_get(&il->idle_priority), image_loader_emit_error_cb, il, nullptr);
 }
 
 static void image_loader_emit_percent(ImageLoader *il)
@@ -492,6 +469,11 @@ static void image_loader_sync_pixbuf(ImageLoader *il)
 		g_object_set_data(G_OBJECT(pb), "stereo_data", GINT_TO_POINTER(STEREO_PIXBUF_CROSS));
 		}
 
+	if (pb && il->preview != IMAGE_LOADER_PREVIEW_NONE)
+		{
+		g_object_set_data(G_OBJECT(pb), "embedded_preview", GINT_TO_POINTER(TRUE));
+		}
+
 	if (il->pixbuf) g_object_unref(il->pixbuf);
 
 	il->pixbuf = pb;
@@ -529,7 +511,6 @@ static void image_loader_area_updated_cb(gpointer,
 static void image_loader_size_prepared_cb(gpointer, gint width, gint height, gpointer data)
 {
 	auto il = static_cast<ImageLoader *>(data);
-	gboolean scale = FALSE;
 
 	g_mutex_lock(il->data_mutex);
 	il->actual_width = width;
@@ -542,23 +523,7 @@ static void image_loader_size_prepared_cb(gpointer, gint width, gint height, gpo
 		}
 	g_mutex_unlock(il->data_mutex);
 
-#if HAVE_FFMPEGTHUMBNAILER
-	if (il->fd->format_class == FORMAT_CLASS_VIDEO)
-		scale = TRUE;
-#endif
-
-	if (!scale)
-		{
-		g_auto(GStrv) mime_types = il->backend->get_format_mime_types();
-		gint n = 0;
-		while (mime_types[n] && !scale)
-			{
-			if (strstr(mime_types[n], "jpeg")) scale = TRUE;
-			n++;
-			}
-		}
-
-	if (!scale)
+	if (!il->backend->can_reduce_size())
 		{
 		image_loader_emit_size_prepared(il);
 		return;
@@ -587,7 +552,12 @@ static void image_loader_stop_loader(ImageLoader *il)
 		/* some loaders do not have a pixbuf till close, order is important here */
 		il->backend->close(il->error ? nullptr : &il->error); /* we are interested in the first error only */
 		image_loader_sync_pixbuf(il);
+
+		/* image_loader_stop() aborts the backend under the lock, close above
+		 * is not locked as it may emit area updates, which take the lock */
+		g_mutex_lock(il->data_mutex);
 		il->backend.reset(nullptr);
+		g_mutex_unlock(il->data_mutex);
 		}
 	g_mutex_lock(il->data_mutex);
 	il->done = TRUE;
@@ -598,8 +568,7 @@ static void image_loader_setup_loader(ImageLoader *il)
 {
 	gint external_preview = 1;
 
-	g_mutex_lock(il->data_mutex);
-
+	/* the command can take a while, do not hold the lock meanwhile */
 	if (options->external_preview.enable)
 		{
 		g_autofree gchar *tilde_filename = expand_tilde(options->external_preview.select);
@@ -608,175 +577,45 @@ static void image_loader_setup_loader(ImageLoader *il)
 		external_preview = runcmd(cmd_line);
 		}
 
+	std::unique_ptr<ImageLoaderBackend> backend;
+
 	if (external_preview == 0)
 		{
 		DEBUG_1("Using custom external loader");
-		il->backend = get_image_loader_backend_external();
+		backend = get_image_loader_backend_external();
 		}
-	else
-		{
 #if HAVE_FFMPEGTHUMBNAILER
-		if (il->fd->format_class == FORMAT_CLASS_VIDEO)
-			{
-			DEBUG_1("Using custom ffmpegthumbnailer loader");
-			il->backend = get_image_loader_backend_ft();
-			}
-		else
-#endif
-#if HAVE_FITS
-		if (il->bytes_total >= 6 &&
-			(memcmp(il->mapped_file, "SIMPLE", 6) == 0))
-			{
-			DEBUG_1("Using custom fits loader");
-			il->backend = get_image_loader_backend_fits();
-			}
-		else
-#endif
-#if HAVE_PDF
-		if (il->bytes_total >= 4 &&
-		    (memcmp(il->mapped_file + 0, "%PDF", 4) == 0))
-			{
-			DEBUG_1("Using custom pdf loader");
-			il->backend = get_image_loader_backend_pdf();
-			}
-		else
-#endif
-#if HAVE_HEIF
-		if (il->bytes_total >= 12 &&
-		    ((memcmp(il->mapped_file + 4, "ftypheic", 8) == 0) ||
-		     (memcmp(il->mapped_file + 4, "ftypheix", 8) == 0) ||
-		     (memcmp(il->mapped_file + 4, "ftypmsf1", 8) == 0) ||
-		     (memcmp(il->mapped_file + 4, "ftypmif1", 8) == 0) ||
-		     (memcmp(il->mapped_file + 4, "ftypavif", 8) == 0)))
-			{
-			DEBUG_1("Using custom heif loader");
-			il->backend = get_image_loader_backend_heif();
-			}
-		else
-	#endif
-	#if HAVE_WEBP
-		if (il->bytes_total >= 12 &&
-			(memcmp(il->mapped_file, "RIFF", 4) == 0) &&
-			(memcmp(il->mapped_file + 8, "WEBP", 4) == 0))
-			{
-			DEBUG_1("Using custom webp loader");
-			il->backend = get_image_loader_backend_webp();
-			}
-		else
-#endif
-#if HAVE_DJVU
-		if (il->bytes_total >= 16 &&
-			(memcmp(il->mapped_file, "AT&TFORM", 8) == 0) &&
-			(memcmp(il->mapped_file + 12, "DJV", 3) == 0))
-			{
-			DEBUG_1("Using custom djvu loader");
-			il->backend = get_image_loader_backend_djvu();
-			}
-		else
-#endif
-#if HAVE_EXR
-		if (il->bytes_total >= 4 &&
-			(memcmp(il->mapped_file, "\x76\x2F\x31\x01", 4) == 0))
-			{
-			DEBUG_1("Using custom exr loader");
-			il->backend = get_image_loader_backend_exr();
-			}
-		else
-#endif
-#if HAVE_JPEG
-		if (il->bytes_total >= 2 && il->mapped_file[0] == 0xff && il->mapped_file[1] == 0xd8)
-			{
-			DEBUG_1("Using custom jpeg loader");
-			il->backend = get_image_loader_backend_jpeg();
-			}
-#if !HAVE_RAW
-		else
-		if (il->bytes_total >= 11 &&
-		    (memcmp(il->mapped_file + 4, "ftypcrx", 7) == 0) &&
-		    (memcmp(il->mapped_file + 64, "CanonCR3", 8) == 0))
-			{
-			DEBUG_1("Using custom cr3 loader");
-			il->backend = get_image_loader_backend_cr3();
-			}
-#endif
-		else
-#endif
-#if HAVE_TIFF
-		if (il->bytes_total >= 10 &&
-		    (memcmp(il->mapped_file, "MM\0*", 4) == 0 ||
-		     memcmp(il->mapped_file, "MM\0+\0\x08\0\0", 8) == 0 ||
-		     memcmp(il->mapped_file, "II+\0\x08\0\0\0", 8) == 0 ||
-		     memcmp(il->mapped_file, "II*\0", 4) == 0))
-		     	{
-			DEBUG_1("Using custom tiff loader");
-			il->backend = get_image_loader_backend_tiff();
-			}
-		else
-#endif
-#if HAVE_NPY
-		if (il->bytes_total >= 6 &&
-			(memcmp(il->mapped_file, "\x93NUMPY", 6) == 0))
-			{
-			DEBUG_1("Using custom npy loader");
-			il->backend = get_image_loader_backend_npy();
-			}
-		else
-#endif
-		if (il->bytes_total >= 3 && il->mapped_file[0] == 0x44 && il->mapped_file[1] == 0x44 && il->mapped_file[2] == 0x53)
-			{
-			DEBUG_1("Using dds loader");
-			il->backend = get_image_loader_backend_dds();
-			}
-		else
-		if (il->bytes_total >= 6 &&
-			(memcmp(il->mapped_file, "8BPS\0\x01", 6) == 0))
-			{
-			DEBUG_1("Using custom psd loader");
-			il->backend = get_image_loader_backend_psd();
-			}
-		else
-#if HAVE_J2K
-		if (il->bytes_total >= 12 &&
-			(memcmp(il->mapped_file, "\0\0\0\x0CjP\x20\x20\x0D\x0A\x87\x0A", 12) == 0))
-			{
-			DEBUG_1("Using custom j2k loader");
-			il->backend = get_image_loader_backend_j2k();
-			}
-		else
+	else if (il->fd->format_class == FORMAT_CLASS_VIDEO)
+		{
+		DEBUG_1("Using custom ffmpegthumbnailer loader");
+		backend = get_image_loader_backend_ft();
+		}
 #endif
-#if HAVE_JPEGXL
-		if ((il->bytes_total >= 12 &&
-		     (memcmp(il->mapped_file, "\0\0\0\x0C\x4A\x58\x4C\x20\x0D\x0A\x87\x0A", 12) == 0)) ||
-		    (il->bytes_total >= 2 &&
-		     (memcmp(il->mapped_file, "\xFF\x0A", 2) == 0)))
-			{
-			DEBUG_1("Using custom jpeg xl loader");
-			il->backend = get_image_loader_backend_jpegxl();
-			}
-		else
+#if HAVE_RAW
+	else if (il->raw_decode)
+		{
+		DEBUG_1("Using custom libraw loader");
+		backend = get_image_loader_backend_libraw();
+		}
 #endif
-		if ((il->bytes_total == 6144 || il->bytes_total == 6912) &&
-			(file_extension_match(il->fd->path, ".scr")))
-			{
-			DEBUG_1("Using custom zxscr loader");
-			il->backend = get_image_loader_backend_zxscr();
-			}
-		else
-		if (il->fd->format_class == FORMAT_CLASS_COLLECTION)
-			{
-			DEBUG_1("Using custom collection loader");
-			il->backend = get_image_loader_backend_collection();
-			}
-		else
-		if (g_strcmp0(strrchr(il->fd->path, '.'), ".svgz") == 0)
-			{
-			DEBUG_1("Using custom svgz loader");
-			il->backend = get_image_loader_backend_svgz();
-			}
-		else
-			il->backend = get_image_loader_backend_default();
+	else if (il->fd->format_class == FORMAT_CLASS_COLLECTION)
+		{
+		DEBUG_1("Using custom collection loader");
+		backend = get_image_loader_backend_collection();
+		}
+	else if (const ImageLoaderFormat *format = image_loader_format_find(il->mapped_file, il->bytes_total, il->fd->path))
+		{
+		DEBUG_1("Using custom %s loader", format->name);
+		backend = format->get_backend();
+		}
+	else
+		{
+		backend = get_image_loader_backend_default();
 		}
 
+	g_mutex_lock(il->data_mutex);
+
+	il->backend = std::move(backend);
 	il->backend->init(image_loader_area_updated_cb, image_loader_size_prepared_cb, il);
 	il->backend->set_page_num(il->fd->page_num);
 
@@ -802,6 +641,16 @@ static void image_loader_error(ImageLoader *il)
 	image_loader_emit_error(il);
 }
 
+/* The amount of data for the next write to the backend */
+static gsize image_loader_chunk_size(ImageLoader *il)
+{
+	const gsize remaining = il->bytes_total - il->bytes_read;
+
+	if (!il->backend->is_progressive()) return remaining;
+
+	return std::min(il->read_buffer_size, remaining);
+}
+
 static gboolean image_loader_continue(ImageLoader *il)
 {
 	gint c;
@@ -823,7 +672,7 @@ static gboolean image_loader_continue(ImageLoader *il)
 			return G_SOURCE_REMOVE;
 			}
 
-		gsize b = std::min(il->read_buffer_size, il->bytes_total - il->bytes_read);
+		gsize b = image_loader_chunk_size(il);
 
 		if (!il->backend->write(il->mapped_file + il->bytes_read, b, il->bytes_total, &il->error))
 			{
@@ -844,16 +693,59 @@ static gboolean image_loader_continue(ImageLoader *il)
 	return G_SOURCE_CONTINUE;
 }
 
+/* A large jpeg file is not decoded here, only prepared to be decoded by regions */
+static gboolean image_loader_begin_tiles(ImageLoader *il)
+{
+#if HAVE_JPEG
+	g_mutex_lock(il->data_mutex);
+	const gint64 min_pixels = il->tiles_min_pixels;
+	g_mutex_unlock(il->data_mutex);
+
+	if (min_pixels < 1 || il->preview != IMAGE_LOADER_PREVIEW_NONE) return FALSE;
+	if (!is_jpeg_container(il->mapped_file, il->bytes_total)) return FALSE;
+	if (!jpeg_tiles_supported(il->mapped_file, il->bytes_total, min_pixels)) return FALSE;
+
+	/* decided under the lock, as the loader may be taken over meanwhile */
+	g_mutex_lock(il->data_mutex);
+	il->tiles_skipped = !il->tiles_prepare;
+	const gboolean skipped = il->tiles_skipped;
+	g_mutex_unlock(il->data_mutex);
+
+	if (skipped)
+		{
+		DEBUG_1("skipped, to be shown as tiles: %s", il->fd->path);
+		image_loader_done(il);
+		return TRUE;
+		}
+
+	JpegTiles *jt = jpeg_tiles_new(il->fd->path, min_pixels);
+	if (!jt) return FALSE;
+
+	g_mutex_lock(il->data_mutex);
+	il->jpeg_tiles = jt;
+	g_mutex_unlock(il->data_mutex);
+
+	image_loader_done(il);
+	return TRUE;
+#else
+	(void)il;
+
+	return FALSE;
+#endif
+}
+
 static gboolean image_loader_begin(ImageLoader *il)
 {
 	if (il->pixbuf) return FALSE;
 
 	if (il->bytes_total <= il->bytes_read) return FALSE;
 
-	gsize b = std::min(il->read_buffer_size, il->bytes_total - il->bytes_read);
+	if (image_loader_begin_tiles(il)) return TRUE;
 
 	image_loader_setup_loader(il);
 
+	gsize b = image_loader_chunk_size(il);
+
 	g_assert(il->bytes_read == 0);
 	if (!il->backend->write(il->mapped_file, b, il->bytes_total, &il->error))
 		{
@@ -874,7 +766,7 @@ static gboolean image_loader_begin(ImageLoader *il)
 			return FALSE;
 			}
 
-		b = std::min(il->read_buffer_size, il->bytes_total - il->bytes_read);
+		b = image_loader_chunk_size(il);
 		if (b > 0 && !il->backend->write(il->mapped_file + il->bytes_read, b, il->bytes_total, &il->error))
 			{
 			image_loader_stop_loader(il);
@@ -914,7 +806,7 @@ static gboolean image_loader_setup_source(ImageLoader *il)
 
 	il->mapped_file = nullptr;
 
-	if (il->fd)
+	if (il->fd && !il->raw_decode)
 		{
 		ExifData *exif = exif_read_fd(il->fd);
 
@@ -975,6 +867,10 @@ static gboolean image_loader_setup_source(ImageLoader *il)
 			return FALSE;
 			}
 		il->preview = IMAGE_LOADER_PREVIEW_NONE;
+
+		/* start reading the file in the background, before the loader thread gets to it */
+		madvise(il->mapped_file, il->bytes_total, MADV_SEQUENTIAL);
+		madvise(il->mapped_file, il->bytes_total, MADV_WILLNEED);
 		}
 
 	return TRUE;
@@ -1013,6 +909,7 @@ static void image_loader_stop(ImageLoader *il)
 		/* stop loader in the other thread */
 		g_mutex_lock(il->data_mutex);
 		il->stopping = TRUE;
+		if (il->backend) il->backend->abort();
 		while (!il->can_destroy) g_cond_wait(il->can_destroy_cond, il->data_mutex);
 		g_mutex_unlock(il->data_mutex);
 		}
@@ -1103,13 +1000,8 @@ static GCond *image_loader_prio_cond = nullptr;
 static GMutex *image_loader_prio_mutex = nullptr;
 static gint image_loader_prio_num = 0;
 
+static gint image_loader_active_threads = 0;
 
-static void image_loader_thread_enter_high()
-{
-	g_mutex_lock(image_loader_prio_mutex);
-	image_loader_prio_num++;
-	g_mutex_unlock(image_loader_prio_mutex);
-}
 
 static void image_loader_thread_leave_high()
 {
@@ -1119,15 +1011,28 @@ static void image_loader_thread_leave_high()
 	g_mutex_unlock(image_loader_prio_mutex);
 }
 
-static void image_loader_thread_wait_high()
+/**
+ * @brief Waits while the loader has low priority and high priority loaders run
+ * @returns TRUE if the loader has high priority, it is then counted as a running
+ * high priority loader until image_loader_thread_leave_high()
+ *
+ * The priority is read under the lock, as image_loader_set_priority() may
+ * raise it meanwhile.
+ */
+static gboolean image_loader_thread_wait_high(ImageLoader *il)
 {
 	g_mutex_lock(image_loader_prio_mutex);
-	while (image_loader_prio_num)
+	while (il->idle_priority > G_PRIORITY_DEFAULT_IDLE && image_loader_prio_num)
 		{
 		g_cond_wait(image_loader_prio_cond, image_loader_prio_mutex);
 		}
 
+	const gboolean high = il->idle_priority <= G_PRIORITY_DEFAULT_IDLE;
+	if (high) image_loader_prio_num++;
+
 	g_mutex_unlock(image_loader_prio_mutex);
+
+	return high;
 }
 
 
@@ -1137,16 +1042,11 @@ static void image_loader_thread_run(gpointer data, gpointer)
 	gboolean cont;
 	gboolean err;
 
-	if (il->idle_priority > G_PRIORITY_DEFAULT_IDLE)
-		{
-		/* low prio, wait until high prio tasks finishes */
-		image_loader_thread_wait_high();
-		}
-	else
-		{
-		/* high prio */
-		image_loader_thread_enter_high();
-		}
+	/* low prio, wait until high prio tasks finishes */
+	gboolean high = image_loader_thread_wait_high(il);
+
+	/* only the loaders which are decoding share the decode threads */
+	g_atomic_int_inc(&image_loader_active_threads);
 
 	err = !image_loader_begin(il);
 
@@ -1164,21 +1064,24 @@ static void image_loader_thread_run(gpointer data, gpointer)
 
 	while (cont && !image_loader_get_is_done(il) && !image_loader_get_stopping(il))
 		{
-		if (il->idle_priority > G_PRIORITY_DEFAULT_IDLE)
+		if (!high)
 			{
 			/* low prio, wait until high prio tasks finishes */
-			image_loader_thread_wait_high();
+			g_atomic_int_add(&image_loader_active_threads, -1);
+			high = image_loader_thread_wait_high(il);
+			g_atomic_int_inc(&image_loader_active_threads);
 			}
 		cont = image_loader_continue(il);
 		}
 	image_loader_stop_loader(il);
 
-	if (il->idle_priority <= G_PRIORITY_DEFAULT_IDLE)
+	if (high)
 		{
-		/* high prio */
 		image_loader_thread_leave_high();
 		}
 
+	g_atomic_int_add(&image_loader_active_threads, -1);
+
 	g_mutex_lock(il->data_mutex);
 	il->can_destroy = TRUE;
 	g_cond_signal(il->can_destroy_cond);
@@ -1215,6 +1118,135 @@ static gboolean image_loader_start_thread(ImageLoader *il)
 }
 
 
+/**************************************************************************************/
+/* threads of the decoders */
+
+/* The values of one image_loader_parallel_run() call */
+struct ImageLoaderParallelRun
+{
+	ImageLoaderParallelRun(guint32 start, guint32 end, const std::function<void(guint32, gint)> &func)
+	    : next(start)
+	    , end(end)
+	    , remaining(end - start)
+	    , func(func)
+	{
+		g_mutex_init(&mutex);
+		g_cond_init(&cond);
+	}
+
+	~ImageLoaderParallelRun()
+	{
+		g_cond_clear(&cond);
+		g_mutex_clear(&mutex);
+	}
+
+	std::atomic<guint64> next;
+	const guint64 end;
+	std::atomic<guint32> remaining; /**< values not yet done, the caller waits for 0 */
+	std::function<void(guint32, gint)> func;
+
+	GMutex mutex;
+	GCond cond;
+};
+
+struct ImageLoaderParallelTask
+{
+	std::shared_ptr<ImageLoaderParallelRun> run;
+	gint thread_id;
+};
+
+static void image_loader_parallel_run_values(ImageLoaderParallelRun &run, gint thread_id)
+{
+	for (guint64 value = run.next++; value < run.end; value = run.next++)
+		{
+		run.func(static_cast<guint32>(value), thread_id);
+
+		if (--run.remaining == 0)
+			{
+			g_mutex_lock(&run.mutex);
+			g_cond_broadcast(&run.cond);
+			g_mutex_unlock(&run.mutex);
+			}
+		}
+}
+
+/* A task may start after all values are done, it then owns the last reference of the run */
+static void image_loader_parallel_task_run(gpointer data, gpointer)
+{
+	auto *task = static_cast<ImageLoaderParallelTask *>(data);
+
+	image_loader_parallel_run_values(*task->run, task->thread_id);
+
+	delete task;
+}
+
+static gint image_loader_decode_thread_budget()
+{
+	return options->threads.image_decode > 0 ? options->threads.image_decode : get_cpu_cores();
+}
+
+/* Shared by the decoders of all loader threads, which decode too */
+static GThreadPool *image_loader_decode_pool()
+{
+	static GThreadPool *pool = g_thread_pool_new(image_loader_parallel_task_run, nullptr,
+	                                             std::max(1, image_loader_decode_thread_budget() - 1), FALSE, nullptr);
+
+	return pool;
+}
+
+/**
+ * @brief The number of threads one decoder may use
+ *
+ * The budget of options->threads.image_decode is split between the loader
+ * threads running at the time, so that loaders times decoder threads do not
+ * exceed it.
+ */
+gint image_loader_get_decode_thread_count()
+{
+	const gint loaders = std::max(1, g_atomic_int_get(&image_loader_active_threads));
+
+	return std::max(1, image_loader_decode_thread_budget() / loaders);
+}
+
+/**
+ * @brief Calls func for each value from start to end - 1, in up to thread_count threads
+ * @param thread_count The calling thread is one of them, the others are from a
+ * thread pool shared by all decoders
+ * @param func Gets the value and a thread id from 0 to thread_count - 1, it is
+ * called by one thread at a time for each id
+ *
+ * Returns when func has been called for all values.
+ */
+void image_loader_parallel_run(guint32 start, guint32 end, gint thread_count,
+                               const std::function<void(guint32 value, gint thread_id)> &func)
+{
+	if (start >= end) return;
+
+	auto run = std::make_shared<ImageLoaderParallelRun>(start, end, func);
+
+	if (thread_count > 1)
+		{
+		GThreadPool *pool = image_loader_decode_pool();
+		g_thread_pool_set_max_threads(pool, std::max(1, image_loader_decode_thread_budget() - 1), nullptr);
+
+		const gint task_count = static_cast<gint>(std::min<guint32>(thread_count - 1, end - start - 1));
+		for (gint i = 1; i <= task_count; i++)
+			{
+			g_thread_pool_push(pool, new ImageLoaderParallelTask{run, i}, nullptr);
+			}
+		}
+
+	image_loader_parallel_run_values(*run, 0);
+
+	g_mutex_lock(&run->mutex);
+	while (run->remaining > 0)
+		{
+		g_cond_wait(&run->cond, &run->mutex);
+		}
+	g_mutex_unlock(&run->mutex);
+}
+
+
 /**************************************************************************************/
 /* public interface */
 
@@ -1243,7 +1275,7 @@ GdkPixbuf *image_loader_get_pixbuf(ImageLoader *il)
 
 /**
  * @brief Speed up loading when you only need at most width x height size image,
- * only the jpeg GdkPixbuf loader benefits from it - so there is no
+ * only the backends that can_reduce_size() benefit from it - so there is no
  * guarantee that the image will scale down to the requested size..
  */
 void image_loader_set_requested_size(ImageLoader *il, gint width, gint height)
@@ -1256,6 +1288,43 @@ void image_loader_set_requested_size(ImageLoader *il, gint width, gint height)
 	g_mutex_unlock(il->data_mutex);
 }
 
+/**
+ * @brief Decode a raw file in full, instead of loading its embedded preview
+ *
+ * Only has an effect with libraw, and must be set before the loader is started.
+ */
+void image_loader_set_raw_decode(ImageLoader *il, gboolean enable)
+{
+	if (!il) return;
+
+	g_mutex_lock(il->data_mutex);
+	il->raw_decode = enable;
+	g_mutex_unlock(il->data_mutex);
+}
+
+/**
+ * @brief Do not decode a jpeg file with more than min_pixels, it is shown as tiles
+ * @param prepare Prepare the tiles, or load nothing, for the loaders of images not shown yet
+ * @returns FALSE if the loader already skipped the file
+ *
+ * When the loader is done, the file is either decoded as usual, available
+ * from image_loader_steal_jpeg_tiles() or skipped, with neither. A loader
+ * which has not decided yet can be changed to prepare the tiles when the
+ * image window takes it over.
+ */
+gboolean image_loader_set_tiles(ImageLoader *il, gint64 min_pixels, gboolean prepare)
+{
+	if (!il) return FALSE;
+
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new(il->data_mutex);
+
+	if (il->tiles_skipped) return FALSE;
+
+	il->tiles_min_pixels = min_pixels;
+	il->tiles_prepare = prepare;
+	return TRUE;
+}
+
 void image_loader_set_buffer_size(ImageLoader *il, guint count)
 {
 	if (!il) return;
@@ -1266,15 +1335,31 @@ void image_loader_set_buffer_size(ImageLoader *il, guint count)
 }
 
 /**
- * @brief This only has effect if used before image_loader_start()
- * default is G_PRIORITY_DEFAULT_IDLE
+ * @brief Default is G_PRIORITY_DEFAULT_IDLE
+ *
+ * Once the thread of the loader runs, the priority can only be raised, for
+ * a prefetch loader taken over by the image window. A low priority thread
+ * waiting for the high priority ones then goes on as one of them.
  */
 void image_loader_set_priority(ImageLoader *il, gint priority)
 {
 	if (!il) return;
 
-	if (il->thread) return; /* can't change prio if the thread already runs */
-	il->idle_priority = priority;
+	if (!il->thread)
+		{
+		il->idle_priority = priority;
+		return;
+		}
+
+	if (!image_loader_prio_mutex) return;
+
+	g_mutex_lock(image_loader_prio_mutex);
+	if (priority < il->idle_priority)
+		{
+		g_atomic_int_set(&il->idle_priority, priority);
+		g_cond_broadcast(image_loader_prio_cond); /* wake up the thread if it waits */
+		}
+	g_mutex_unlock(image_loader_prio_mutex);
 }
 
 
@@ -1331,6 +1416,27 @@ gboolean image_loader_get_shrunk(ImageLoader *il)
 	return ret;
 }
 
+/**
+ * @brief Whether a pixbuf of a loader is the embedded preview of the file, not the image itself
+ */
+gboolean image_loader_get_is_preview(GdkPixbuf *pixbuf)
+{
+	return pixbuf && g_object_get_data(G_OBJECT(pixbuf), "embedded_preview");
+}
+
+
+/**
+ * @returns The tiles of a file prepared by image_loader_set_tiles(), the caller frees them
+ * with jpeg_tiles_free(), or nullptr if the file was decoded as usual
+ */
+JpegTiles *image_loader_steal_jpeg_tiles(ImageLoader *il)
+{
+	if (!il) return nullptr;
+
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new(il->data_mutex);
+
+	return std::exchange(il->jpeg_tiles, nullptr);
+}
 
 /**
  *  @FIXME this can be rather slow and blocks until the size is known
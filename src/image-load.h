@@ -22,6 +22,7 @@
 #ifndef IMAGE_LOAD_H
 #define IMAGE_LOAD_H
 
+#include <functional>
 #include <memory>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -31,6 +32,7 @@
 
 class FileData;
 struct GqSize;
+struct JpegTiles;
 
 #define TYPE_IMAGE_LOADER		(image_loader_get_type())
 
@@ -52,6 +54,16 @@ public:
 	virtual gchar **get_format_mime_types() = 0;
 	virtual void set_page_num(gint /*page_num*/) {};
 	virtual gint get_page_total() { return 0; };
+	/**
+	 * @brief Progressive backends are fed the file in read_buffer_size chunks,
+	 * all others get the whole file in one write call
+	 */
+	virtual gboolean is_progressive() { return FALSE; };
+	/**
+	 * @brief Whether set_size(), called when the size is prepared, makes the backend
+	 * decode at or near a requested smaller size instead of the full size
+	 */
+	virtual gboolean can_reduce_size() { return FALSE; };
 };
 
 enum ImageLoaderPreview {
@@ -74,6 +86,11 @@ struct ImageLoader
 	gsize bytes_total;
 
 	ImageLoaderPreview preview;
+	gboolean raw_decode; /**< decode a raw file with libraw instead of loading its embedded preview */
+	gint64 tiles_min_pixels; /**< see image_loader_set_tiles() */
+	gboolean tiles_prepare;
+	gboolean tiles_skipped;
+	JpegTiles *jpeg_tiles; /**< set instead of the pixbuf for a file shown as tiles */
 
 	gint requested_width;
 	gint requested_height;
@@ -127,6 +144,8 @@ void image_loader_free(ImageLoader *il);
 void image_loader_delay_area_ready(ImageLoader *il, gboolean enable);
 
 void image_loader_set_requested_size(ImageLoader *il, gint width, gint height);
+void image_loader_set_raw_decode(ImageLoader *il, gboolean enable);
+gboolean image_loader_set_tiles(ImageLoader *il, gint64 min_pixels, gboolean prepare);
 
 void image_loader_set_buffer_size(ImageLoader *il, guint count);
 
@@ -140,9 +159,15 @@ gdouble image_loader_get_percent(ImageLoader *il);
 gboolean image_loader_get_is_done(ImageLoader *il);
 FileData *image_loader_get_fd(ImageLoader *il);
 gboolean image_loader_get_shrunk(ImageLoader *il);
+gboolean image_loader_get_is_preview(GdkPixbuf *pixbuf);
+JpegTiles *image_loader_steal_jpeg_tiles(ImageLoader *il);
 
 gboolean image_load_dimensions(FileData *fd, GqSize &dimensions);
 
+gint image_loader_get_decode_thread_count();
+void image_loader_parallel_run(guint32 start, guint32 end, gint thread_count,
+                               const std::function<void(guint32 value, gint thread_id)> &func);
+
 void free_pixels(guchar *pixels, gpointer data);
 
 #endif
@@ -21,12 +21,16 @@
 
 #include "image.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
+#include <memory>
 
 #include <cairo.h>
 #include <glib-object.h>
 
+#include <config.h>
+
 #include "collect-table.h"
 #include "collect.h"
 #include "color-man.h"
@@ -36,8 +40,12 @@
 #include "filecache.h"
 #include "filedata.h"
 #include "geometry.h"
+#include "histogram.h"
 #include "history-list.h"
 #include "image-load.h"
+#if HAVE_JPEG
+#  include "image-load-jpeg.h"
+#endif
 #include "intl.h"
 #include "layout-image.h"
 #include "layout-util.h"
@@ -57,6 +65,12 @@ namespace
 
 constexpr gdouble aspect_ratios[5] {0.0, gdouble(1.0), gdouble(4.0) / 3, gdouble(3) / 2, gdouble(16) / 9};
 
+#if HAVE_JPEG
+/* the source tiles of the jpeg files shown as tiles, see image_load_tiles_min_pixels() */
+constexpr gint IMAGE_JPEG_TILE_SIZE = 1024;
+constexpr gint IMAGE_JPEG_TILES_CACHE_SIZE = 16;
+#endif
+
 /*
  * SelectionRectangle
  */
@@ -643,6 +657,13 @@ void image_alter_orientation(ImageWindow *imd, FileData *fd_n, AlterType type)
 
 	if (imd->image_fd == fd_n && (!options->metadata.write_orientation || options->image.exif_rotate_enable))
 		{
+		/* tiles are not rotated, the oriented image is decoded in full */
+		if (image_get_tiled(imd) && orientation != EXIF_ORIENTATION_TOP_LEFT)
+			{
+			image_reload(imd);
+			return;
+			}
+
 		imd->orientation = orientation;
 		pixbuf_renderer_set_orientation(PIXBUF_RENDERER(imd->pr), orientation);
 		}
@@ -690,6 +711,55 @@ void image_set_ignore_alpha(ImageWindow *imd, gboolean ignore_alpha)
    pixbuf_renderer_set_ignore_alpha(PIXBUF_RENDERER(imd->pr), ignore_alpha);
 }
 
+/*
+ *-------------------------------------------------------------------
+ * jpeg tiles
+ *-------------------------------------------------------------------
+ */
+
+/**
+ * @brief The size from which a jpeg file is shown as source tiles, 0 if it is not
+ *
+ * Source tiles are not rotated, so oriented files are loaded in full.
+ */
+static gint64 image_load_tiles_min_pixels(FileData *fd)
+{
+#if HAVE_JPEG
+	if (options->image.jpeg_tiles_min_megapixels < 1) return 0;
+
+	gint orientation = fd->user_orientation;
+	if (!orientation && options->image.exif_rotate_enable && fd->supports_exif_orientation())
+		{
+		orientation = metadata_read_int(fd, ORIENTATION_KEY, EXIF_ORIENTATION_TOP_LEFT);
+		}
+	if (orientation && orientation != EXIF_ORIENTATION_TOP_LEFT) return 0;
+
+	return static_cast<gint64>(options->image.jpeg_tiles_min_megapixels) * 1000 * 1000;
+#else
+	(void)fd;
+
+	return 0;
+#endif
+}
+
+/**
+ * @brief Makes the loader of an image not shown yet skip a file shown as tiles,
+ * its full size image would only fill the image cache
+ */
+static void image_load_tiles_skip(ImageLoader *il, FileData *fd)
+{
+	image_loader_set_tiles(il, image_load_tiles_min_pixels(fd), FALSE);
+}
+
+/**
+ * @brief Makes a loader prepare the tiles of a file shown as tiles, see image_loader_set_tiles()
+ * @returns FALSE if the loader already skipped the file, it can not be used to show it
+ */
+static gboolean image_load_tiles_prepare(ImageLoader *il, FileData *fd)
+{
+	return image_loader_set_tiles(il, image_load_tiles_min_pixels(fd), TRUE);
+}
+
 /*
  *-------------------------------------------------------------------
  * read ahead (prebuffer)
@@ -747,6 +817,7 @@ static void image_read_ahead_start(ImageWindow *imd)
 	DEBUG_1("%s read ahead started for :%s", get_exec_time(), imd->read_ahead_fd->path);
 
 	imd->read_ahead_il = image_loader_new(imd->read_ahead_fd);
+	image_load_tiles_skip(imd->read_ahead_il, imd->read_ahead_fd);
 
 	image_loader_delay_area_ready(imd->read_ahead_il, TRUE); /* we will need the area_ready signals later */
 
@@ -773,6 +844,94 @@ static void image_read_ahead_set(ImageWindow *imd, FileData *fd)
 	image_read_ahead_start(imd);
 }
 
+/*
+ *-------------------------------------------------------------------
+ * prefetch
+ *-------------------------------------------------------------------
+ */
+
+struct ImagePrefetch
+{
+	ImageWindow *imd;
+	FileData *fd;
+	ImageLoader *il;
+};
+
+static void image_prefetch_free(ImagePrefetch *ip)
+{
+	image_loader_free(ip->il);
+	file_data_unref(ip->fd);
+	g_free(ip);
+}
+
+static void image_prefetch_cancel(ImageWindow *imd)
+{
+	g_list_free_full(imd->prefetch_list, reinterpret_cast<GDestroyNotify>(image_prefetch_free));
+	imd->prefetch_list = nullptr;
+}
+
+static ImagePrefetch *image_prefetch_find(ImageWindow *imd, FileData *fd)
+{
+	for (GList *work = imd->prefetch_list; work; work = work->next)
+		{
+		auto ip = static_cast<ImagePrefetch *>(work->data);
+
+		if (ip->fd == fd) return ip;
+		}
+
+	return nullptr;
+}
+
+static void image_prefetch_done_cb(ImageLoader *, gpointer data)
+{
+	auto ip = static_cast<ImagePrefetch *>(data);
+	ImageWindow *imd = ip->imd;
+
+	DEBUG_1("%s prefetch done for :%s", get_exec_time(), ip->fd->path);
+
+	GdkPixbuf *pixbuf = image_loader_get_pixbuf(ip->il);
+	if (!ip->fd->pixbuf && pixbuf)
+		{
+		ip->fd->pixbuf = g_object_ref(pixbuf);
+		image_cache_set(imd, ip->fd);
+		}
+
+	imd->prefetch_list = g_list_remove(imd->prefetch_list, ip);
+	image_prefetch_free(ip);
+}
+
+static void image_prefetch_error_cb(ImageLoader *il, gpointer data)
+{
+	/* like the read ahead, keep whatever was loaded */
+	image_prefetch_done_cb(il, data);
+}
+
+static void image_prefetch_start(ImageWindow *imd, FileData *fd)
+{
+	DEBUG_1("%s prefetch started for :%s", get_exec_time(), fd->path);
+
+	auto ip = g_new0(ImagePrefetch, 1);
+	ip->imd = imd;
+	ip->fd = file_data_ref(fd);
+	ip->il = image_loader_new(fd);
+	image_load_tiles_skip(ip->il, fd);
+
+	/* waits for the image shown and the read ahead to finish loading */
+	image_loader_set_priority(ip->il, G_PRIORITY_LOW);
+	image_loader_delay_area_ready(ip->il, TRUE); /* we will need the area_ready signals if the image is shown */
+
+	g_signal_connect(G_OBJECT(ip->il), "error", (GCallback)image_prefetch_error_cb, ip);
+	g_signal_connect(G_OBJECT(ip->il), "done", (GCallback)image_prefetch_done_cb, ip);
+
+	if (!image_loader_start(ip->il))
+		{
+		image_prefetch_free(ip);
+		return;
+		}
+
+	imd->prefetch_list = g_list_append(imd->prefetch_list, ip);
+}
+
 /*
  *-------------------------------------------------------------------
  * post buffering
@@ -796,7 +955,7 @@ static void image_cache_set(ImageWindow *, FileData *fd)
 {
 	g_assert(fd->pixbuf);
 
-	file_cache_put(image_get_cache(), fd, static_cast<gulong>(gdk_pixbuf_get_rowstride(fd->pixbuf)) * static_cast<gulong>(gdk_pixbuf_get_height(fd->pixbuf)));
+	file_cache_put(image_get_cache(), fd, gdk_pixbuf_get_byte_length(fd->pixbuf));
 	file_data_send_notification(fd, NOTIFY_PIXBUF); /* to update histogram */
 }
 
@@ -814,6 +973,80 @@ static gint image_cache_get(ImageWindow *imd)
 	return success;
 }
 
+/*
+ *-------------------------------------------------------------------
+ * raw decoding
+ *-------------------------------------------------------------------
+ */
+
+static void image_raw_decode_cancel(ImageWindow *imd)
+{
+	image_loader_free(imd->raw_il);
+	imd->raw_il = nullptr;
+}
+
+static void image_raw_decode_done_cb(ImageLoader *il, gpointer data)
+{
+	auto imd = static_cast<ImageWindow *>(data);
+	GdkPixbuf *pixbuf = image_loader_get_pixbuf(il);
+	GdkPixbuf *preview = image_get_pixbuf(imd);
+
+	if (pixbuf && image_loader_get_fd(il) == imd->image_fd && image_loader_get_is_preview(preview))
+		{
+		DEBUG_1("%s raw decode done for :%s", get_exec_time(), imd->image_fd->path);
+
+		/* keep the size on screen and the visible part of the image */
+		gdouble zoom = image_zoom_get(imd);
+		if (zoom != 0.0)
+			{
+			const gdouble scale = image_zoom_get_real(imd) * gdk_pixbuf_get_width(preview) / gdk_pixbuf_get_width(pixbuf);
+			zoom = scale >= 1.0 ? scale : -1.0 / scale;
+			}
+
+		gdouble x;
+		gdouble y;
+		image_get_scroll_center(imd, x, y);
+		image_change_pixbuf(imd, pixbuf, zoom, FALSE);
+		image_set_scroll_center(imd, x, y);
+
+		/* the cache holds the preview */
+		if (imd->image_fd->pixbuf) file_cache_remove(image_get_cache(), imd->image_fd);
+
+		if (options->image.enable_read_ahead && !imd->image_fd->pixbuf)
+			{
+			imd->image_fd->pixbuf = g_object_ref(pixbuf);
+			image_cache_set(imd, imd->image_fd);
+			}
+		}
+
+	image_raw_decode_cancel(imd);
+}
+
+/**
+ * @brief Decodes a raw image shown by its embedded preview, to replace the preview when done
+ */
+static void image_raw_decode_start(ImageWindow *imd)
+{
+	/* only libraw can decode the raw data */
+	if (!HAVE_RAW || !options->image.raw_decode || imd->raw_il || imd->il || !imd->image_fd) return;
+	if (imd->image_fd->format_class != FORMAT_CLASS_RAWIMAGE) return;
+	if (!image_loader_get_is_preview(image_get_pixbuf(imd))) return;
+
+	DEBUG_1("%s raw decode started for :%s", get_exec_time(), imd->image_fd->path);
+
+	imd->raw_il = image_loader_new(imd->image_fd);
+	image_loader_set_raw_decode(imd->raw_il, TRUE);
+
+	/* on error the preview stays */
+	g_signal_connect(G_OBJECT(imd->raw_il), "error", (GCallback)image_raw_decode_done_cb, imd);
+	g_signal_connect(G_OBJECT(imd->raw_il), "done", (GCallback)image_raw_decode_done_cb, imd);
+
+	if (!image_loader_start(imd->raw_il))
+		{
+		image_raw_decode_cancel(imd);
+		}
+}
+
 /*
  *-------------------------------------------------------------------
  * loading
@@ -843,6 +1076,66 @@ static void image_load_area_ready_cb(ImageLoader *il, const GdkRectangle *area,
 	pixbuf_renderer_area_changed(pr, *area);
 }
 
+
+/**
+ * @brief Shows a very large jpeg file as source tiles, see image_loader_set_tiles()
+ *
+ * Only the regions visible at the current zoom are decoded, in other threads,
+ * and the decoded regions are cached and dropped like any other source tile.
+ * Color management applies to the rendered tiles as for any image. There is
+ * no pixbuf of the whole image, see image_get_tiled(): the histogram is read
+ * from the reduced copy of the tiles instead.
+ */
+static void image_load_jpeg_tiles(ImageWindow *imd, JpegTiles *jt)
+{
+#if HAVE_JPEG
+	DEBUG_1("%s image tiles: %s", get_exec_time(), imd->image_fd->path);
+
+	PixbufRenderer *pr = PIXBUF_RENDERER(imd->pr);
+	const gint image_width = jpeg_tiles_get_width(jt);
+	const gint image_height = jpeg_tiles_get_height(jt);
+	const gint max_reduction = jpeg_tiles_get_max_reduction(jt);
+
+	/* jt is freed with the tiles, before the renderer */
+	jpeg_tiles_set_ready_func(jt, [pr](gint reduction, GdkRectangle area)
+	{
+		if (reduction == pixbuf_renderer_get_tiles_reduction(pr)) pixbuf_renderer_area_changed(pr, area);
+	});
+
+	std::shared_ptr<JpegTiles> tiles(jt, jpeg_tiles_free);
+	const auto tile_request_func = [tiles](PixbufRenderer *renderer, gint x, gint y, gint width, gint height, GdkPixbuf *pixbuf)
+	{
+		return jpeg_tiles_read(tiles.get(), pixbuf_renderer_get_tiles_reduction(renderer), x, y, width, height, pixbuf);
+	};
+
+	imd->orientation = EXIF_ORIENTATION_TOP_LEFT;
+
+	pixbuf_renderer_set_post_process_func(pr, nullptr, FALSE);
+	g_clear_pointer(&imd->cm, delete_cb<ColorMan>);
+
+	pr->orientation = imd->orientation;
+	pixbuf_renderer_set_tiles(pr, image_width, image_height,
+	                          IMAGE_JPEG_TILE_SIZE, IMAGE_JPEG_TILE_SIZE, IMAGE_JPEG_TILES_CACHE_SIZE,
+	                          tile_request_func, nullptr,
+	                          image_zoom_get(imd), max_reduction);
+
+	LayoutWindow *lw = layout_find_by_image(imd);
+	if (imd->color_profile_enable && lw && !lw->animation)
+		{
+		image_post_process_color(imd, FALSE);
+		}
+
+	image_set_pixbuf_renderer_post_process_func(imd);
+
+	histmap_start_idle(imd->image_fd, jpeg_tiles_get_preview(jt));
+
+	image_state_set(imd, IMAGE_STATE_IMAGE);
+#else
+	(void)imd;
+	(void)jt;
+#endif
+}
+
 static void image_load_done_cb(ImageLoader *, gpointer data)
 {
 	auto imd = static_cast<ImageWindow *>(data);
@@ -858,7 +1151,11 @@ static void image_load_done_cb(ImageLoader *, gpointer data)
 	g_object_set(imd->pr, "loading", FALSE, NULL);
 	image_state_unset(imd, IMAGE_STATE_LOADING);
 
-	if (!image_loader_get_pixbuf(imd->il))
+	if (JpegTiles *jt = image_loader_steal_jpeg_tiles(imd->il))
+		{
+		image_load_jpeg_tiles(imd, jt);
+		}
+	else if (!image_loader_get_pixbuf(imd->il))
 		{
 		GdkPixbuf *pixbuf = pixbuf_fallback(imd->image_fd, 0, 0);
 
@@ -877,6 +1174,7 @@ static void image_load_done_cb(ImageLoader *, gpointer data)
 	image_loader_free(imd->il);
 	imd->il = nullptr;
 
+	image_raw_decode_start(imd);
 	image_read_ahead_start(imd);
 }
 
@@ -926,7 +1224,7 @@ static gboolean image_read_ahead_check(ImageWindow *imd)
 		return FALSE;
 		}
 
-	if (imd->read_ahead_il)
+	if (imd->read_ahead_il && image_load_tiles_prepare(imd->read_ahead_il, imd->read_ahead_fd))
 		{
 		imd->il = imd->read_ahead_il;
 		imd->read_ahead_il = nullptr;
@@ -961,6 +1259,47 @@ static gboolean image_read_ahead_check(ImageWindow *imd)
 	return FALSE;
 }
 
+/**
+ * @brief Shows the image of a prefetch still loading, continuing its loader
+ */
+static gboolean image_prefetch_check(ImageWindow *imd, FileData *fd)
+{
+	if (imd->il) return FALSE;
+
+	ImagePrefetch *ip = image_prefetch_find(imd, fd);
+	if (!ip) return FALSE;
+
+	imd->prefetch_list = g_list_remove(imd->prefetch_list, ip);
+
+	if (!image_load_tiles_prepare(ip->il, fd))
+		{
+		image_prefetch_free(ip);
+		return FALSE;
+		}
+
+	imd->il = ip->il;
+	ip->il = nullptr;
+	g_signal_handlers_disconnect_matched(G_OBJECT(imd->il), G_SIGNAL_MATCH_DATA, 0, 0, nullptr, nullptr, ip);
+	image_prefetch_free(ip);
+
+	/* the image is shown now, do not wait for the other loaders */
+	image_loader_set_priority(imd->il, G_PRIORITY_DEFAULT_IDLE);
+
+	image_load_set_signals(imd, FALSE);
+
+	g_object_set(imd->pr, "loading", TRUE, NULL);
+	image_state_set(imd, IMAGE_STATE_LOADING);
+
+	if (!imd->delay_flip)
+		{
+		image_change_pixbuf(imd, image_loader_get_pixbuf(imd->il), image_zoom_get(imd), TRUE);
+		}
+
+	image_loader_delay_area_ready(imd->il, FALSE); /* send the delayed area_ready signals */
+
+	return TRUE;
+}
+
 static gboolean image_load_begin(ImageWindow *imd, FileData *fd)
 {
 	DEBUG_1("%s image begin", get_exec_time());
@@ -982,6 +1321,12 @@ static gboolean image_load_begin(ImageWindow *imd, FileData *fd)
 		return TRUE;
 		}
 
+	if (image_prefetch_check(imd, fd))
+		{
+		DEBUG_1("from prefetch: %s", imd->image_fd->path);
+		return TRUE;
+		}
+
 	if (!imd->delay_flip && image_get_pixbuf(imd))
 		{
 		PixbufRenderer *pr;
@@ -994,6 +1339,7 @@ static gboolean image_load_begin(ImageWindow *imd, FileData *fd)
 	g_object_set(imd->pr, "loading", TRUE, NULL);
 
 	imd->il = image_loader_new(fd);
+	image_load_tiles_prepare(imd->il, fd);
 
 	image_load_set_signals(imd, FALSE);
 
@@ -1033,6 +1379,8 @@ static void image_reset(ImageWindow *imd)
 	image_loader_free(imd->il);
 	imd->il = nullptr;
 
+	image_raw_decode_cancel(imd);
+
 	g_clear_pointer(&imd->cm, delete_cb<ColorMan>);
 
 	image_state_set(imd, IMAGE_STATE_NONE);
@@ -1087,6 +1435,9 @@ static void image_change_complete(ImageWindow *imd, gdouble zoom)
 			if (image_load_begin(imd, imd->image_fd))
 				{
 				imd->unknown = FALSE;
+
+				/* for an image from the cache or the read ahead buffer */
+				image_raw_decode_start(imd);
 				}
 			}
 
@@ -1337,6 +1688,14 @@ GdkPixbuf *image_get_pixbuf(ImageWindow *imd)
 	return pixbuf_renderer_get_pixbuf(PIXBUF_RENDERER(imd->pr));
 }
 
+/**
+ * @brief Whether the image is shown as tiles, there is then no pixbuf of the whole image
+ */
+gboolean image_get_tiled(ImageWindow *imd)
+{
+	return pixbuf_renderer_get_tiles(PIXBUF_RENDERER(imd->pr));
+}
+
 void image_change_pixbuf(ImageWindow *imd, GdkPixbuf *pixbuf, gdouble zoom, gboolean lazy)
 {
 	LayoutWindow *lw;
@@ -1478,6 +1837,8 @@ void image_move_from_image(ImageWindow *imd, ImageWindow *source)
 
 	image_loader_free(imd->il);
 	imd->il = nullptr;
+	image_raw_decode_cancel(imd);
+	image_raw_decode_cancel(source);
 
 	image_set_fd(imd, image_get_fd(source));
 
@@ -1511,6 +1872,8 @@ void image_move_from_image(ImageWindow *imd, ImageWindow *source)
 	pixbuf_renderer_move(PIXBUF_RENDERER(imd->pr), PIXBUF_RENDERER(source->pr));
 
 	image_set_pixbuf_renderer_post_process_func(imd);
+
+	image_raw_decode_start(imd);
 }
 
 /* this is  a copy function
@@ -1527,6 +1890,8 @@ void image_copy_from_image(ImageWindow *imd, ImageWindow *source)
 
 	image_loader_free(imd->il);
 	imd->il = nullptr;
+	image_raw_decode_cancel(imd);
+	image_raw_decode_cancel(source);
 
 	image_set_fd(imd, image_get_fd(source));
 
@@ -1562,6 +1927,8 @@ void image_copy_from_image(ImageWindow *imd, ImageWindow *source)
 	pixbuf_renderer_copy(PIXBUF_RENDERER(imd->pr), PIXBUF_RENDERER(source->pr));
 
 	image_set_pixbuf_renderer_post_process_func(imd);
+
+	image_raw_decode_start(imd);
 }
 
 
@@ -1574,7 +1941,8 @@ void image_area_changed(ImageWindow *imd, gint x, gint y, gint width, gint heigh
 
 void image_reload(ImageWindow *imd)
 {
-	if (pixbuf_renderer_get_tiles(PIXBUF_RENDERER(imd->pr))) return;
+	/* the tiles of the pan view are not loaded from a file */
+	if (image_get_tiled(imd) && !imd->image_fd) return;
 
 	image_change_complete(imd, image_zoom_get(imd));
 }
@@ -1650,7 +2018,7 @@ void image_zoom_set_fill_geometry(ImageWindow *imd, gboolean vertical)
 	gint width;
 	gint height;
 
-	if (!pixbuf_renderer_get_pixbuf(pr) ||
+	if ((!pixbuf_renderer_get_pixbuf(pr) && !pixbuf_renderer_get_tiles(pr)) ||
 	    !pixbuf_renderer_get_image_size(pr, width, height)) return;
 
 	if (vertical)
@@ -1767,7 +2135,7 @@ void image_prebuffer_set(ImageWindow *imd, FileData *fd)
 
 	if (fd)
 		{
-		if (!file_cache_get(image_get_cache(), fd))
+		if (!file_cache_contains(image_get_cache(), fd))
 			{
 			image_read_ahead_set(imd, fd);
 			}
@@ -1778,11 +2146,62 @@ void image_prebuffer_set(ImageWindow *imd, FileData *fd)
 		}
 }
 
+/**
+ * @brief Loads the images around the read ahead into the image cache
+ * @param list FileData, most wanted first
+ *
+ * Loads of images no longer in the list are cancelled. The list is cut
+ * to what the image cache can hold next to the image shown and the read
+ * ahead, guessing from the size of the image shown.
+ */
+void image_prefetch_set(ImageWindow *imd, GList *list)
+{
+	if (pixbuf_renderer_get_tiles(PIXBUF_RENDERER(imd->pr))) list = nullptr;
+
+	gint64 count = g_list_length(list);
+
+	GdkPixbuf *pixbuf = image_get_pixbuf(imd);
+	if (pixbuf)
+		{
+		const gint64 image_size = std::max<gint64>(static_cast<gint64>(gdk_pixbuf_get_rowstride(pixbuf)) * gdk_pixbuf_get_height(pixbuf), 1);
+		const gint64 cache_size = static_cast<gint64>(options->image.image_cache_max) * 1048576;
+
+		count = std::min(count, std::max<gint64>(cache_size / image_size - 2, 0));
+		}
+
+	GList *work = imd->prefetch_list;
+	while (work)
+		{
+		auto ip = static_cast<ImagePrefetch *>(work->data);
+		work = work->next;
+
+		const gint position = g_list_index(list, ip->fd);
+		if (position < 0 || position >= count)
+			{
+			DEBUG_1("%s prefetch cancelled for :%s", get_exec_time(), ip->fd->path);
+			imd->prefetch_list = g_list_remove(imd->prefetch_list, ip);
+			image_prefetch_free(ip);
+			}
+		}
+
+	work = list;
+	for (gint64 i = 0; i < count; i++, work = work->next)
+		{
+		auto fd = static_cast<FileData *>(work->data);
+
+		if (fd == imd->image_fd || fd == imd->read_ahead_fd) continue;
+		if (image_prefetch_find(imd, fd)) continue;
+		if (file_cache_contains(image_get_cache(), fd)) continue;
+
+		image_prefetch_start(imd, fd);
+		}
+}
+
 static void image_notify_cb(FileData *fd, NotifyType type, gpointer data)
 {
 	auto imd = static_cast<ImageWindow *>(data);
 
-	if (!imd || !image_get_pixbuf(imd) ||
+	if (!imd || (!image_get_pixbuf(imd) && !image_get_tiled(imd)) ||
 	    /* imd->il || */ /* loading in progress - do not check - it should start from the beginning anyway */
 	    !imd->image_fd || /* nothing to reload */
 	    imd->state == IMAGE_STATE_NONE /* loading not started, no need to reload */
@@ -2024,6 +2443,7 @@ static void image_free(ImageWindow *imd)
 	image_reset(imd);
 
 	image_read_ahead_cancel(imd);
+	image_prefetch_cancel(imd);
 
 	file_data_unref(imd->image_fd);
 	g_free(imd->title);
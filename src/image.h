@@ -128,6 +128,8 @@ struct ImageWindow
 
 	FileData *read_ahead_fd;
 	ImageLoader *read_ahead_il;
+	GList *prefetch_list;	/**< ImagePrefetch, low priority loads of the images around read_ahead_fd */
+	ImageLoader *raw_il;	/**< full decode of a raw image shown by its embedded preview */
 
 	gint prev_color_row;
 
@@ -197,6 +199,7 @@ void image_move_from_image(ImageWindow *imd, ImageWindow *source);
 
 gboolean image_get_image_size(ImageWindow *imd, gint &width, gint &height);
 GdkPixbuf *image_get_pixbuf(ImageWindow *imd);
+gboolean image_get_tiled(ImageWindow *imd);
 
 /* manipulation */
 void image_area_changed(ImageWindow *imd, gint x, gint y, gint width, gint height);
@@ -231,6 +234,7 @@ StereoPixbufData image_stereo_pixbuf_get(const ImageWindow *imd);
 void image_stereo_pixbuf_set(ImageWindow *imd, StereoPixbufData stereo_mode);
 
 void image_prebuffer_set(ImageWindow *imd, FileData *fd);
+void image_prefetch_set(ImageWindow *imd, GList *list);
 
 void image_auto_refresh_enable(ImageWindow *imd, gboolean enable);
 
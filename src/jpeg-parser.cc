@@ -24,6 +24,7 @@
 #include <algorithm>
 #include <cstring>
 #include <functional>
+#include <utility>
 
 namespace
 {
@@ -346,4 +347,199 @@ MPOData jpeg_get_mpo_data(const guchar *data, guint size)
 	return mpo;
 }
 
+/**
+ * @brief Finds the restart markers of an image
+ * @returns FALSE if the image has no restart markers, or they can not be used
+ *
+ * Only sequential images with a single interleaved scan can be indexed.
+ */
+gboolean jpeg_get_restart_index(const guchar *data, guint size, JpegRestartIndex &index)
+{
+	JpegSegment seg;
+
+	if (!is_jpeg_container(data, size)) return FALSE;
+
+	if (!jpeg_segment_find(data, size, JPEG_MARKER_DRI, {}, seg) || seg.length < 2) return FALSE;
+	const guint restart_interval = (static_cast<guint>(data[seg.offset]) << 8) + data[seg.offset + 1];
+	if (restart_interval == 0) return FALSE;
+
+	JpegSegment sof;
+	if (!jpeg_segment_find(data, size, JPEG_MARKER_SOF0, {}, sof) &&
+	    !jpeg_segment_find(data, size, JPEG_MARKER_SOF1, {}, sof)) return FALSE;
+	if (sof.length < 6) return FALSE;
+
+	const guint height = (static_cast<guint>(data[sof.offset + 1]) << 8) + data[sof.offset + 2];
+	const guint width = (static_cast<guint>(data[sof.offset + 3]) << 8) + data[sof.offset + 4];
+	const guint components = data[sof.offset + 5];
+	if (data[sof.offset] != 8 || width == 0 || height == 0 ||
+	    components == 0 || sof.length < 6 + 3 * components) return FALSE;
+
+	/* a single component scan is not interleaved, its MCU is one block */
+	guint h_max = 1;
+	guint v_max = 1;
+	for (guint i = 0; components > 1 && i < components; i++)
+		{
+		const guchar sampling = data[sof.offset + 6 + 3 * i + 1];
+		h_max = std::max<guint>(h_max, sampling >> 4);
+		v_max = std::max<guint>(v_max, sampling & 0x0f);
+		}
+
+	const guint mcu_width = 8 * h_max;
+	const guint mcu_height = 8 * v_max;
+	const guint mcus_per_row = (width + mcu_width - 1) / mcu_width;
+	const guint mcu_rows = (height + mcu_height - 1) / mcu_height;
+
+	JpegSegment sos;
+	if (!jpeg_segment_find(data, size, JPEG_MARKER_SOS, {}, sos) ||
+	    sos.length < 1 || data[sos.offset] != components) return FALSE;
+
+	const guint scan_start = sos.offset + sos.length;
+	guint scan_end = size;
+
+	std::vector<guint> restart_markers;
+	guint offset = scan_start;
+	while (offset + 1 < size)
+		{
+		const auto *next = static_cast<const guchar *>(memchr(data + offset, JPEG_MARKER, size - 1 - offset));
+		if (!next) break;
+
+		offset = next - data;
+		const guchar marker = data[offset + 1];
+
+		if (marker >= JPEG_MARKER_RST0 && marker <= JPEG_MARKER_RST7)
+			{
+			restart_markers.push_back(offset);
+			offset += 2;
+			}
+		else if (marker == 0x00)
+			{
+			/* stuffed 0xff data byte */
+			offset += 2;
+			}
+		else if (marker == JPEG_MARKER)
+			{
+			/* fill byte */
+			offset++;
+			}
+		else
+			{
+			scan_end = offset;
+			break;
+			}
+		}
+
+	const guint intervals = (mcus_per_row * mcu_rows + restart_interval - 1) / restart_interval;
+	if (restart_markers.size() + 1 != intervals) return FALSE;
+
+	index.sof_offset = sof.offset;
+	index.scan_start = scan_start;
+	index.scan_end = scan_end;
+	index.height = height;
+	index.mcu_height = mcu_height;
+	index.mcus_per_row = mcus_per_row;
+	index.mcu_rows = mcu_rows;
+	index.restart_interval = restart_interval;
+	index.restart_markers = std::move(restart_markers);
+
+	return TRUE;
+}
+
+/**
+ * @brief Whether a band can start at an MCU row, or end in front of it
+ */
+gboolean JpegRestartIndex::is_band_start(guint mcu_row) const
+{
+	return mcu_row == 0 || mcu_row >= mcu_rows || (mcu_row * mcus_per_row) % restart_interval == 0;
+}
+
+/**
+ * @brief Copies the MCU rows from first_row to end_row - 1 into a jpeg file of their own
+ * @param first_row,end_row Rows for which JpegRestartIndex::is_band_start() is TRUE
+ *
+ * The band is a copy of the headers, with the image height set to the
+ * height of the band, followed by the entropy-coded data of the band
+ * with its restart markers numbered from 0.
+ */
+JpegRestartBand jpeg_get_restart_band(const guchar *data, const JpegRestartIndex &index, guint first_row, guint end_row)
+{
+	const guint intervals = index.restart_markers.size() + 1;
+	const gboolean last_band = end_row >= index.mcu_rows;
+	const guint first_interval = first_row * index.mcus_per_row / index.restart_interval;
+	const guint end_interval = last_band ? intervals : end_row * index.mcus_per_row / index.restart_interval;
+	const guint data_start = first_interval == 0 ? index.scan_start : index.restart_markers[first_interval - 1] + 2;
+	const guint data_end = last_band ? index.scan_end : index.restart_markers[end_interval - 1];
+
+	JpegRestartBand band;
+	band.row = first_row * index.mcu_height;
+	band.height = (last_band ? index.height : end_row * index.mcu_height) - band.row;
+	band.keep_row = band.row;
+	band.keep_height = band.height;
+
+	band.data.reserve(index.scan_start + data_end - data_start + 2);
+	band.data.insert(band.data.end(), data, data + index.scan_start);
+	band.data[index.sof_offset + 1] = band.height >> 8;
+	band.data[index.sof_offset + 2] = band.height & 0xff;
+
+	band.data.insert(band.data.end(), data + data_start, data + data_end);
+	for (guint j = first_interval; j + 1 < end_interval; j++)
+		{
+		band.data[index.restart_markers[j] - data_start + index.scan_start + 1] = JPEG_MARKER_RST0 + ((j - first_interval) & 7);
+		}
+
+	band.data.push_back(JPEG_MARKER);
+	band.data.push_back(JPEG_MARKER_EOI);
+
+	return band;
+}
+
+/**
+ * @brief Splits an image with restart markers into bands of MCU rows
+ * @param band_count The wanted number of bands
+ * @param margin MCU rows of the neighbouring bands added above and below each band
+ * @returns At least two bands, or none if the image can not be split
+ *
+ * Images are split only at the restart markers which start an MCU row,
+ * see jpeg_get_restart_band(). A margin is widened to the next such marker.
+ * It gives the decoder the rows next to the band, which chroma upsampling
+ * uses, and is not part of JpegRestartBand::keep_row and keep_height.
+ */
+std::vector<JpegRestartBand> jpeg_split_restart_bands(const guchar *data, guint size, guint band_count, guint margin)
+{
+	JpegRestartIndex index;
+
+	if (band_count < 2 || !jpeg_get_restart_index(data, size, index)) return {};
+
+	/* first MCU row of each band */
+	std::vector<guint> band_rows{0};
+	const guint rows_per_band = (index.mcu_rows + band_count - 1) / band_count;
+	for (guint row = rows_per_band; row < index.mcu_rows; row++)
+		{
+		if (row >= band_rows.back() + rows_per_band && index.is_band_start(row))
+			{
+			band_rows.push_back(row);
+			}
+		}
+	if (band_rows.size() < 2) return {};
+
+	std::vector<JpegRestartBand> bands;
+	for (gsize i = 0; i < band_rows.size(); i++)
+		{
+		const guint end_row = i + 1 == band_rows.size() ? index.mcu_rows : band_rows[i + 1];
+
+		guint first_margin_row = band_rows[i] - std::min(band_rows[i], margin);
+		while (!index.is_band_start(first_margin_row)) first_margin_row--;
+
+		guint end_margin_row = std::min(end_row + margin, index.mcu_rows);
+		while (!index.is_band_start(end_margin_row)) end_margin_row++;
+
+		JpegRestartBand band = jpeg_get_restart_band(data, index, first_margin_row, end_margin_row);
+		band.keep_row = band_rows[i] * index.mcu_height;
+		band.keep_height = (end_row >= index.mcu_rows ? index.height : end_row * index.mcu_height) - band.keep_row;
+
+		bands.push_back(std::move(band));
+		}
+
+	return bands;
+}
+
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
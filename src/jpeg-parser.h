@@ -32,6 +32,12 @@
 #define JPEG_MARKER_EOI		0xD9
 #define JPEG_MARKER_APP1	0xE1
 #define JPEG_MARKER_APP2	0xE2
+#define JPEG_MARKER_SOF0	0xC0
+#define JPEG_MARKER_SOF1	0xC1
+#define JPEG_MARKER_RST0	0xD0
+#define JPEG_MARKER_RST7	0xD7
+#define JPEG_MARKER_SOS		0xDA
+#define JPEG_MARKER_DRI		0xDD
 
 /* jpeg container format:
      all data markers start with 0XFF
@@ -96,6 +102,41 @@ struct MPOData {
 
 MPOData jpeg_get_mpo_data(const guchar *data, guint size);
 
+
+/**
+ * @struct JpegRestartBand
+ * A horizontal band of a jpeg image, which can be decoded on its own
+ */
+struct JpegRestartBand {
+	guint row;	/**< first pixel row of the band in the image */
+	guint height;	/**< pixel rows of the band */
+	guint keep_row;	/**< first pixel row the band is decoded for, the rows above overlap the band before */
+	guint keep_height;	/**< pixel rows the band is decoded for, the rows below overlap the band after */
+	std::vector<guchar> data;	/**< a complete jpeg file holding only the rows of the band */
+};
+
+/**
+ * @struct JpegRestartIndex
+ * Where the restart intervals of a jpeg image start, see jpeg_get_restart_index()
+ */
+struct JpegRestartIndex {
+	guint sof_offset;	/**< of the frame header, which holds the image height */
+	guint scan_start;	/**< offset of the entropy-coded data */
+	guint scan_end;
+	guint height;	/**< pixel rows of the image */
+	guint mcu_height;	/**< pixel rows of an MCU row */
+	guint mcus_per_row;
+	guint mcu_rows;
+	guint restart_interval;	/**< MCUs */
+	std::vector<guint> restart_markers;	/**< restart_markers[i] is the offset of the marker in front of restart interval i + 1 */
+
+	gboolean is_band_start(guint mcu_row) const;
+};
+
+gboolean jpeg_get_restart_index(const guchar *data, guint size, JpegRestartIndex &index);
+JpegRestartBand jpeg_get_restart_band(const guchar *data, const JpegRestartIndex &index, guint first_row, guint end_row);
+std::vector<JpegRestartBand> jpeg_split_restart_bands(const guchar *data, guint size, guint band_count, guint margin = 0);
+
 #endif
 
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
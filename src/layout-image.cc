@@ -597,6 +597,10 @@ static void li_pop_menu_copy_image_cb(GtkWidget *widget, gpointer data)
 	GdkPixbuf *pixbuf = image_get_pixbuf(imd);
 	if (!pixbuf)
 		{
+		if (image_get_tiled(imd))
+			{
+			warning_dialog(_("Copy image"), _("This image is shown as tiles and is not decoded in full.\nSee Preferences, General, Show JPEG images as tiles from"), GQ_ICON_DIALOG_WARNING, nullptr);
+			}
 		return;
 		}
 
@@ -1353,6 +1357,45 @@ void layout_image_set_fd(LayoutWindow *lw, FileData *fd)
 		}
 }
 
+/**
+ * @brief Preloads the images around fd, more of them in the direction of read_ahead_fd
+ */
+static void layout_image_prefetch(LayoutWindow *lw, FileData *fd, FileData *read_ahead_fd)
+{
+	const gint index = layout_list_get_index(lw, fd);
+	const gint read_ahead_index = layout_list_get_index(lw, read_ahead_fd);
+	GList *list = nullptr;
+
+	if (index >= 0 && read_ahead_index >= 0)
+		{
+		const gint step = read_ahead_index < index ? -1 : 1;
+
+		for (gint i = 1; i <= options->image.read_ahead_forward; i++)
+			{
+			if (index + i * step < 0) break;
+
+			FileData *ahead_fd = layout_list_get_fd(lw, index + i * step);
+			if (!ahead_fd) break;
+
+			list = g_list_prepend(list, ahead_fd);
+			}
+
+		for (gint i = 1; i <= options->image.read_ahead_backward; i++)
+			{
+			if (index - i * step < 0) break;
+
+			FileData *behind_fd = layout_list_get_fd(lw, index - i * step);
+			if (!behind_fd) break;
+
+			list = g_list_prepend(list, behind_fd);
+			}
+		}
+
+	list = g_list_reverse(list);
+	image_prefetch_set(lw->image, list);
+	g_list_free(list);
+}
+
 void layout_image_set_with_ahead(LayoutWindow *lw, FileData *fd, FileData *read_ahead_fd)
 {
 	if (!layout_valid(&lw)) return;
@@ -1367,7 +1410,11 @@ void layout_image_set_with_ahead(LayoutWindow *lw, FileData *fd, FileData *read_
 		}
 */
 	layout_image_set_fd(lw, fd);
-	if (options->image.enable_read_ahead) image_prebuffer_set(lw->image, read_ahead_fd);
+	if (options->image.enable_read_ahead)
+		{
+		image_prebuffer_set(lw->image, read_ahead_fd);
+		layout_image_prefetch(lw, fd, read_ahead_fd);
+		}
 }
 
 void layout_image_set_index(LayoutWindow *lw, gint index)
@@ -1971,7 +2018,7 @@ static void layout_status_update_pixel_cb(PixbufRenderer *pr, gpointer data)
 		if (const auto color = pixbuf_renderer_get_pixel_colors(pr, pixel);
 		    color.has_value())
 			{
-			if (gdk_pixbuf_get_has_alpha(pr->pixbuf))
+			if (pr->pixbuf && gdk_pixbuf_get_has_alpha(pr->pixbuf))
 				{
 				text = g_strdup_printf(_("[%*d,%*d]: RGBA(%3d,%3d,%3d,%3d)"),
 				                       num_length(width - 1), pixel.x,
@@ -610,7 +610,14 @@ static void layout_menu_copy_image_cb(GtkAction *, gpointer data)
 
 	GdkPixbuf *pixbuf;
 	pixbuf = image_get_pixbuf(imd);
-	if (!pixbuf) return;
+	if (!pixbuf)
+		{
+		if (image_get_tiled(imd))
+			{
+			warning_dialog(_("Copy image"), _("This image is shown as tiles and is not decoded in full.\nSee Preferences, General, Show JPEG images as tiles from"), GQ_ICON_DIALOG_WARNING, nullptr);
+			}
+		return;
+		}
 
 #if HAVE_GTK4
 	GdkDisplay *display = gdk_display_get_default();
@@ -60,6 +60,7 @@
 #include "command-line-handling.h"
 #include "compat-deprecated.h"
 #include "compat.h"
+#include "dupe-cli.h"
 #include "exif.h"
 #include "filedata.h"
 #include "filefilter.h"
@@ -121,6 +122,8 @@ To disable Clutter use:\n \
 GQ_DISABLE_CLUTTER=y[es] geeqie\n\n \
 To run or stop Geeqie in cache maintenance (non-GUI) mode use:\n \
 GQ_CACHE_MAINTENANCE=y[es] geeqie --help\n \
+To find duplicates without a display, e.g. from cron, use:\n \
+GQ_DUPES=y[es] geeqie --help\n \
 Note that bash command line completion does not work in this mode.\n\n \
 User manual: https://www.geeqie.org/help/GuideIndex.html\n \
            : https://www.geeqie.org/help-pdf/help.pdf");
@@ -158,6 +161,7 @@ GOptionEntry command_line_options[] =
 	{ "dupes"                     ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, nullptr, _("find duplicates in folder")                                                   , "<FOLDER>" },
 	{ "dupes-export"              ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE,   nullptr, _("export duplicates search result")                                             , nullptr },
 	{ "dupes-recurse"             ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, nullptr, _("find duplicates in folder recursively")                                       , "<FOLDER>" },
+	{ "dupes-session"             ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, nullptr, _("keep duplicates results in FILE, compare only files added since")             , "<FILE>" },
 	{ "file"                      ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, nullptr, _("open FILE or URL bring Geeqie window to the top")                             , "<FILE>|<URL>" },
 	{ "File"                      ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, nullptr, _("open FILE or URL do not bring Geeqie window to the top")                      , "<FILE>|<URL>" },
 	{ "file-extensions"           ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE  , nullptr, _("list known file extensions")                                                  , nullptr },
@@ -927,6 +931,35 @@ void startup_cache_maintenance_cb(GtkApplication *app, gpointer)
 	g_application_hold(G_APPLICATION(app));
 }
 
+/**
+ * @brief Sets up what the command line duplicate finder needs
+ *
+ * Neither GTK nor the configuration file are used, so that it runs
+ * without a display and the results do not depend on the user's settings.
+ */
+void startup_dupes()
+{
+	setup_sig_handler();
+
+	create_application_paths();
+
+	setlocale(LC_ALL, "");
+
+#ifdef ENABLE_NLS
+	bindtextdomain(PACKAGE, gq_localedir);
+	bind_textdomain_codeset(PACKAGE, "UTF-8");
+	textdomain(PACKAGE);
+#endif
+
+	options = init_options(nullptr);
+	setup_default_options(options);
+
+	filter_add_defaults();
+	filter_rebuild();
+
+	mkdir_if_not_exists(get_thumbnails_cache_dir());
+}
+
 } // namespace
 
 void exit_program()
@@ -964,6 +997,14 @@ gint main(gint argc, gchar *argv[])
 #endif
 		}
 
+	const gchar *gq_dupes = g_getenv("GQ_DUPES");
+	if (gq_dupes && tolower(gq_dupes[0]) == 'y')
+		{
+		startup_dupes();
+
+		return dupe_cli_main(argc, argv);
+		}
+
 #if HAVE_CLUTTER
 	const gchar *gq_disable_clutter = g_getenv("GQ_DISABLE_CLUTTER");
 
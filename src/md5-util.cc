@@ -32,38 +32,7 @@
 
 #include "md5-util.h"
 
-#include <cstdio>
-
-#include "ui-fileops.h"
-
-namespace
-{
-
-/**
- * md5_update_from_file: get the md5 hash of a file
- * @md5: MD5 checksumming context
- * @path: file name
- * @return: TRUE on success
- *
- * Get the md5 hash of a file.
- **/
-gboolean md5_update_from_file(GChecksum *md5, const gchar *path)
-{
-	guchar tmp_buf[1024];
-	gint nb_bytes_read;
-
-	g_autoptr(FILE) fp = fopen(path, "r");
-	if (!fp) return FALSE;
-
-	while ((nb_bytes_read = fread(tmp_buf, sizeof (guchar), sizeof(tmp_buf), fp)) > 0)
-		{
-		g_checksum_update(md5, tmp_buf, nb_bytes_read);
-		}
-
-	return ferror(fp) == 0;
-}
-
-} // namespace
+#include "hash-util.h"
 
 /**
  * @brief Get the md5 hash of a file
@@ -76,13 +45,11 @@ gboolean md5_update_from_file(GChecksum *md5, const gchar *path)
  **/
 gboolean md5_get_digest_from_file(const gchar *path, Md5Digest &digest)
 {
-	g_autoptr(GChecksum) md5 = g_checksum_new(G_CHECKSUM_MD5);
-	if (!md5) return FALSE;
-
-	if (!md5_update_from_file(md5, path)) return FALSE;
+	Hash md5(HashType::MD5);
+	if (!md5.update_from_file(path)) return FALSE;
 
 	gsize digest_size = MD5_SIZE;
-	g_checksum_get_digest(md5, digest.data(), &digest_size);
+	if (!md5.get_digest(digest.data(), digest_size)) return FALSE;
 	if (digest_size != MD5_SIZE) return FALSE;
 
 	return TRUE;
@@ -98,15 +65,7 @@ gboolean md5_get_digest_from_file(const gchar *path, Md5Digest &digest)
  **/
 std::string md5_get_string_from_file(const gchar *path)
 {
-	g_autoptr(GChecksum) md5 = g_checksum_new(G_CHECKSUM_MD5);
-	if (!md5) return {};
-
-	if (!md5_update_from_file(md5, path)) return {};
-
-	const gchar *str = g_checksum_get_string(md5);
-	if (!str) return {};
-
-	return str;
+	return hash_get_string_from_file(HashType::MD5, path);
 }
 
 /**
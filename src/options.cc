@@ -73,6 +73,8 @@ ConfOptions *init_options(ConfOptions *options)
 	options->dnd_default_action = DND_ACTION_ASK;
 	options->duplicates_similarity_threshold = 99;
 	options->rot_invariant_sim = TRUE;
+	options->duplicates_similarity_index = FALSE;
+	options->duplicates_incremental = FALSE;
 	options->sort_totals = FALSE;
 	options->rectangle_draw_aspect_ratio = RECTANGLE_DRAW_ASPECT_RATIO_NONE;
 
@@ -129,6 +131,10 @@ ConfOptions *init_options(ConfOptions *options)
 	options->image.alpha_color_2.green = static_cast<gdouble>(0x006666) / 65535;
 	options->image.alpha_color_2.blue = static_cast<gdouble>(0x006666) / 65535;
 	options->image.enable_read_ahead = TRUE;
+	options->image.read_ahead_forward = 3;
+	options->image.read_ahead_backward = 1;
+	options->image.raw_decode = FALSE;
+	options->image.jpeg_tiles_min_megapixels = 50;
 	options->image.exif_rotate_enable = TRUE;
 	options->image.fit_window_to_image = FALSE;
 	options->image.limit_autofit_size = FALSE;
@@ -198,6 +204,7 @@ ConfOptions *init_options(ConfOptions *options)
 
 	options->thumbnails.cache_into_dirs = FALSE;
 	options->thumbnails.enable_caching = TRUE;
+	options->thumbnails.similarity_database = FALSE;
 	options->thumbnails.max_width = DEFAULT_THUMB_WIDTH;
 	options->thumbnails.max_height = DEFAULT_THUMB_HEIGHT;
 	options->thumbnails.quality = GDK_INTERP_TILES;
@@ -236,6 +243,8 @@ ConfOptions *init_options(ConfOptions *options)
 	options->printer.page_text_position = HEADER_1;
 
 	options->threads.duplicates = get_cpu_cores() - 1;
+	options->threads.duplicates_read = 4;
+	options->threads.image_decode = 0;
 
 	options->disabled_plugins.clear();
 
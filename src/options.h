@@ -115,6 +115,8 @@ struct ConfOptions
 	gboolean duplicates_thumbnails;
 	DupeSelectType duplicates_select_type;
 	gboolean rot_invariant_sim;
+	gboolean duplicates_similarity_index;
+	gboolean duplicates_incremental;
 	gboolean sort_totals;
 
 	gint open_recent_list_maxsize;
@@ -215,6 +217,10 @@ struct ConfOptions
 		gint tile_cache_max;	/**< in megabytes */
 		gint image_cache_max;   /**< in megabytes */
 		gboolean enable_read_ahead;
+		gint read_ahead_forward;	/**< images preloaded in the direction of browsing */
+		gint read_ahead_backward;	/**< images preloaded against the direction of browsing */
+		gboolean raw_decode;	/**< decode raw images in full after showing their embedded preview */
+		gint jpeg_tiles_min_megapixels;	/**< larger jpeg images are shown as tiles decoded on demand, 0 disables */
 
 		ZoomMode zoom_mode;
 		gboolean zoom_2pass;
@@ -238,6 +244,7 @@ struct ConfOptions
 		gint max_height;
 		gboolean enable_caching;
 		gboolean cache_into_dirs;
+		gboolean similarity_database;
 		gboolean use_xvpics;
 		gboolean spec_standard;
 		GdkInterpType quality;
@@ -412,6 +419,8 @@ struct ConfOptions
 	/* Threads */
 	struct {
 		gint duplicates;
+		gint duplicates_read; /**< checksum and cache reading threads of a duplicate check */
+		gint image_decode; /**< decoder threads of all image loads together */
 	} threads;
 
 	/* Selectable bars */
@@ -32,6 +32,7 @@
 #include "misc.h"
 #include "options.h"
 #include "renderer-tiles.h"
+#include "tile-grid.h"
 #include "ui-misc.h"
 
 /* comment this out if not using this from within Geeqie
@@ -138,6 +139,7 @@ static void pr_scroller_timer_set(PixbufRenderer *pr, gboolean start);
 
 
 static void pr_source_tile_free_all(PixbufRenderer *pr);
+static void pr_source_tile_unset(PixbufRenderer *pr);
 
 static void pr_zoom_sync(PixbufRenderer *pr, gdouble zoom,
 			 PrZoomFlags flags, gint px, gint py);
@@ -469,6 +471,7 @@ static void pixbuf_renderer_init(PixbufRenderer *pr)
 
 	pr->source_tiles_enabled = FALSE;
 	pr->source_tiles = nullptr;
+	pr->source_tile_max_reduction = 1;
 
 	pr->orientation = 1;
 
@@ -507,7 +510,7 @@ static void pixbuf_renderer_finalize(GObject *object)
 
 	pr_scroller_timer_set(pr, FALSE);
 
-	pr_source_tile_free_all(pr);
+	pr_source_tile_unset(pr);
 }
 
 PixbufRenderer *pixbuf_renderer_new()
@@ -942,7 +945,15 @@ static void pr_source_tile_free(SourceTile *st)
 
 static void pr_source_tile_free_all(PixbufRenderer *pr)
 {
-	g_list_free_full(pr->source_tiles, reinterpret_cast<GDestroyNotify>(pr_source_tile_free));
+	if (!pr->source_tiles) return;
+
+	while (SourceTile *st = pr->source_tiles->last())
+		{
+		pr->source_tiles->remove(st);
+		pr_source_tile_free(st);
+		}
+
+	delete pr->source_tiles;
 	pr->source_tiles = nullptr;
 }
 
@@ -950,6 +961,11 @@ static void pr_source_tile_unset(PixbufRenderer *pr)
 {
 	pr_source_tile_free_all(pr);
 	pr->source_tiles_enabled = FALSE;
+	pr->source_tile_max_reduction = 1;
+
+	/* the request func may hold on to the image source */
+	pr->func_tile_request = nullptr;
+	pr->func_tile_dispose = nullptr;
 }
 
 static gboolean pr_source_tile_visible(PixbufRenderer *pr, SourceTile *st)
@@ -975,28 +991,23 @@ static gboolean pr_source_tile_visible(PixbufRenderer *pr, SourceTile *st)
 static SourceTile *pr_source_tile_new(PixbufRenderer *pr, gint x, gint y)
 {
 	SourceTile *st = nullptr;
-	gint count;
 
 	g_return_val_if_fail(pr->source_tile_width >= 1 && pr->source_tile_height >= 1, NULL);
 
 	pr->source_tiles_cache_size = std::max(pr->source_tiles_cache_size, 4);
 
-	count = g_list_length(pr->source_tiles);
-	if (count >= pr->source_tiles_cache_size)
-		{
-		GList *work;
+	if (!pr->source_tiles) pr->source_tiles = new TileGrid<SourceTile>();
 
-		work = g_list_last(pr->source_tiles);
-		while (work && count >= pr->source_tiles_cache_size)
+	if (pr->source_tiles->size() >= static_cast<gsize>(pr->source_tiles_cache_size))
+		{
+		SourceTile *needle = pr->source_tiles->last();
+		while (needle && pr->source_tiles->size() >= static_cast<gsize>(pr->source_tiles_cache_size))
 			{
-			SourceTile *needle;
-
-			needle = static_cast<SourceTile *>(work->data);
-			work = work->prev;
+			SourceTile *prev = needle->lru_prev;
 
 			if (!pr_source_tile_visible(pr, needle))
 				{
-				pr->source_tiles = g_list_remove(pr->source_tiles, needle);
+				pr->source_tiles->remove(needle);
 
 				if (pr->func_tile_dispose)
 					{
@@ -1013,15 +1024,26 @@ static SourceTile *pr_source_tile_new(PixbufRenderer *pr, gint x, gint y)
 					{
 					pr_source_tile_free(needle);
 					}
-
-				count--;
 				}
+
+			needle = prev;
 			}
 		}
 
+	if (st && G_OBJECT(st->pixbuf)->ref_count > 1)
+		{
+		/* the renderer is still scaling from it */
+		g_object_unref(st->pixbuf);
+		st->pixbuf = nullptr;
+		}
+
 	if (!st)
 		{
 		st = g_new0(SourceTile, 1);
+		}
+
+	if (!st->pixbuf)
+		{
 		st->pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8,
 					    pr->source_tile_width, pr->source_tile_height);
 		}
@@ -1030,17 +1052,14 @@ static SourceTile *pr_source_tile_new(PixbufRenderer *pr, gint x, gint y)
 	st->y = ROUND_DOWN(y, pr->source_tile_height);
 	st->blank = TRUE;
 
-	pr->source_tiles = g_list_prepend(pr->source_tiles, st);
+	pr->source_tiles->insert(st);
 
 	return st;
 }
 
-static SourceTile *pr_source_tile_request(PixbufRenderer *pr, gint x, gint y)
+static void pr_source_tile_fill(PixbufRenderer *pr, SourceTile *st, gint reduction)
 {
-	SourceTile *st;
-
-	st = pr_source_tile_new(pr, x, y);
-	if (!st) return nullptr;
+	st->reduction = reduction;
 
 	if (pr->func_tile_request &&
 	    pr->func_tile_request(pr, st->x, st->y,
@@ -1053,33 +1072,29 @@ static SourceTile *pr_source_tile_request(PixbufRenderer *pr, gint x, gint y)
 	pr_scale_region(rect, pr->scale);
 
 	pixbuf_renderer_invalidate_region(pr, rect);
-	return st;
 }
 
-static SourceTile *pr_source_tile_find(PixbufRenderer *pr, gint x, gint y)
+static SourceTile *pr_source_tile_request(PixbufRenderer *pr, gint x, gint y, gint reduction)
 {
-	GList *work;
+	SourceTile *st;
 
-	work = pr->source_tiles;
-	while (work)
-		{
-		auto st = static_cast<SourceTile *>(work->data);
+	st = pr_source_tile_new(pr, x, y);
+	if (!st) return nullptr;
 
-		if (x >= st->x && x < st->x + pr->source_tile_width &&
-		    y >= st->y && y < st->y + pr->source_tile_height)
-			{
-			if (work != pr->source_tiles)
-				{
-				pr->source_tiles = g_list_remove_link(pr->source_tiles, work);
-				pr->source_tiles = g_list_concat(work, pr->source_tiles);
-				}
-			return st;
-			}
+	pr_source_tile_fill(pr, st, reduction);
 
-		work = work->next;
-		}
+	return st;
+}
+
+static SourceTile *pr_source_tile_find(PixbufRenderer *pr, gint x, gint y)
+{
+	if (!pr->source_tiles) return nullptr;
 
-	return nullptr;
+	SourceTile *st = pr->source_tiles->find(ROUND_DOWN(x, pr->source_tile_width),
+	                                        ROUND_DOWN(y, pr->source_tile_height));
+	if (st) pr->source_tiles->touch(st);
+
+	return st;
 }
 
 GList *pr_source_tile_compute_region(PixbufRenderer *pr, gint x, gint y, gint w, gint h, gboolean request)
@@ -1089,6 +1104,7 @@ GList *pr_source_tile_compute_region(PixbufRenderer *pr, gint x, gint y, gint w,
 	GList *list = nullptr;
 	gint sx;
 	gint sy;
+	const gint reduction = pixbuf_renderer_get_tiles_reduction(pr);
 
 	x = std::max(x, 0);
 	y = std::max(y, 0);
@@ -1105,7 +1121,15 @@ GList *pr_source_tile_compute_region(PixbufRenderer *pr, gint x, gint y, gint w,
 			SourceTile *st;
 
 			st = pr_source_tile_find(pr, x1, y1);
-			if (!st && request) st = pr_source_tile_request(pr, x1, y1);
+			if (!st && request)
+				{
+				st = pr_source_tile_request(pr, x1, y1, reduction);
+				}
+			else if (st && request && st->reduction > reduction)
+				{
+				/* zoomed in past the detail held by the tile */
+				pr_source_tile_fill(pr, st, reduction);
+				}
 
 			if (st) list = g_list_prepend(list, st);
 			}
@@ -1118,13 +1142,13 @@ static void pr_source_tile_changed(PixbufRenderer *pr, GdkRectangle request_rect
 {
 	if (request_rect.width < 1 || request_rect.height < 1) return;
 
+	if (!pr->source_tiles) return;
+
 	GdkRectangle st_rect{0, 0, pr->source_tile_width, pr->source_tile_height};
 	GdkRectangle r;
 
-	for (GList *work = pr->source_tiles; work; work = work->next)
+	for (SourceTile *st = pr->source_tiles->first(); st; st = st->lru_next)
 		{
-		auto *st = static_cast<SourceTile *>(work->data);
-
 		st_rect.x = st->x;
 		st_rect.y = st->y;
 
@@ -1147,12 +1171,15 @@ static void pr_source_tile_changed(PixbufRenderer *pr, GdkRectangle request_rect
 
 /**
  * @brief Display an on-request array of pixbuf tiles
+ * @param max_reduction When greater than 1, a zoomed out view may request tiles
+ * holding only 1/reduction of the image detail, see pixbuf_renderer_get_tiles_reduction().
+ * Such tiles are requested again when zooming in.
  */
 void pixbuf_renderer_set_tiles(PixbufRenderer *pr, gint width, gint height,
                                gint tile_width, gint tile_height, gint cache_size,
                                const PixbufRenderer::TileRequestFunc &func_request,
                                const PixbufRenderer::TileDisposeFunc &func_dispose,
-                               gdouble zoom)
+                               gdouble zoom, gint max_reduction)
 {
 	g_return_if_fail(IS_PIXBUF_RENDERER(pr));
 	g_return_if_fail(tile_width >= 32 && tile_height >= 32);
@@ -1168,6 +1195,7 @@ void pixbuf_renderer_set_tiles(PixbufRenderer *pr, gint width, gint height,
 	pr->source_tiles_cache_size = std::max(cache_size, 4);
 	pr->source_tile_width = tile_width;
 	pr->source_tile_height = tile_height;
+	pr->source_tile_max_reduction = std::max(max_reduction, 1);
 
 	pr->image_width = width;
 	pr->image_height = height;
@@ -1200,6 +1228,26 @@ gint pixbuf_renderer_get_tiles(PixbufRenderer *pr)
 	return pr->source_tiles_enabled;
 }
 
+/**
+ * @brief The power of two by which tiles requested now may be reduced
+ * @returns 1 for full detail, up to the max_reduction given to pixbuf_renderer_set_tiles()
+ *
+ * A tile reduced by n still has the full tile size, each of its
+ * pixels repeated n times, which is enough while the scale is at most 1/n.
+ */
+gint pixbuf_renderer_get_tiles_reduction(PixbufRenderer *pr)
+{
+	const gdouble scale = pr->scale * gtk_widget_get_scale_factor(GTK_WIDGET(pr));
+	gint reduction = 1;
+
+	while (reduction * 2 <= pr->source_tile_max_reduction && scale * reduction * 2 <= 1.0)
+		{
+		reduction *= 2;
+		}
+
+	return reduction;
+}
+
 static gdouble pr_zoom_adjust(const PixbufRenderer *pr, gdouble increment)
 {
 	gdouble zoom = pr->zoom;
@@ -1368,56 +1416,6 @@ static void pr_update_pixel_signal(PixbufRenderer *pr)
  */
 
 
-void pr_tile_coords_map_orientation(gint orientation,
-                                    gdouble tile_x, gdouble tile_y, /* coordinates of the tile */
-                                    gdouble image_w, gdouble image_h,
-                                    gdouble tile_w, gdouble tile_h,
-                                    gdouble &res_x, gdouble &res_y)
-{
-	res_x = tile_x;
-	res_y = tile_y;
-	switch (orientation)
-		{
-		case EXIF_ORIENTATION_TOP_LEFT:
-			/* normal -- nothing to do */
-			break;
-		case EXIF_ORIENTATION_TOP_RIGHT:
-			/* mirrored */
-			res_x = image_w - tile_x - tile_w;
-			break;
-		case EXIF_ORIENTATION_BOTTOM_RIGHT:
-			/* upside down */
-			res_x = image_w - tile_x - tile_w;
-			res_y = image_h - tile_y - tile_h;
-			break;
-		case EXIF_ORIENTATION_BOTTOM_LEFT:
-			/* flipped */
-			res_y = image_h - tile_y - tile_h;
-			break;
-		case EXIF_ORIENTATION_LEFT_TOP:
-			res_x = tile_y;
-			res_y = tile_x;
-			break;
-		case EXIF_ORIENTATION_RIGHT_TOP:
-			/* rotated -90 (270) */
-			res_x = tile_y;
-			res_y = image_w - tile_x - tile_w;
-			break;
-		case EXIF_ORIENTATION_RIGHT_BOTTOM:
-			res_x = image_h - tile_y - tile_h;
-			res_y = image_w - tile_x - tile_w;
-			break;
-		case EXIF_ORIENTATION_LEFT_BOTTOM:
-			/* rotated 90 */
-			res_x = image_h - tile_y - tile_h;
-			res_y = tile_x;
-			break;
-		default:
-			/* The other values are out of range */
-			break;
-		}
-}
-
 GdkRectangle pr_tile_region_map_orientation(gint orientation,
                                             GdkRectangle area, /* coordinates of the area inside tile */
                                             gint tile_w, gint tile_h)
@@ -2720,6 +2718,7 @@ void pixbuf_renderer_move(PixbufRenderer *pr, PixbufRenderer *source)
 		pr->source_tiles_cache_size = source->source_tiles_cache_size;
 		pr->source_tile_width = source->source_tile_width;
 		pr->source_tile_height = source->source_tile_height;
+		pr->source_tile_max_reduction = source->source_tile_max_reduction;
 		pr->image_width = source->image_width;
 		pr->image_height = source->image_height;
 
@@ -2772,12 +2771,14 @@ void pixbuf_renderer_copy(PixbufRenderer *pr, PixbufRenderer *source)
 		pr->source_tiles_cache_size = source->source_tiles_cache_size;
 		pr->source_tile_width = source->source_tile_width;
 		pr->source_tile_height = source->source_tile_height;
+		pr->source_tile_max_reduction = source->source_tile_max_reduction;
 		pr->image_width = source->image_width;
 		pr->image_height = source->image_height;
 
 		pr->func_tile_request = source->func_tile_request;
 		pr->func_tile_dispose = source->func_tile_dispose;
 
+		pr_source_tile_free_all(pr);
 		pr->source_tiles = source->source_tiles;
 		source->source_tiles = nullptr;
 
@@ -2933,14 +2934,48 @@ static void pr_stereo_temp_disable(PixbufRenderer *pr, gboolean disable)
 	pr_size_sync(pr, pr->window_width, pr->window_height); /* recalculate new viewport */
 }
 
+static GqColor pr_pixbuf_get_pixel_color(const GdkPixbuf *pixbuf, gint x, gint y)
+{
+	const gboolean p_alpha = gdk_pixbuf_get_has_alpha(pixbuf);
+	const gint p_rs = gdk_pixbuf_get_rowstride(pixbuf);
+	const guchar *p_pix = gdk_pixbuf_get_pixels(pixbuf);
+
+	const auto xoff = static_cast<size_t>(x) * (p_alpha ? 4 : 3);
+	const auto yoff = static_cast<size_t>(y) * p_rs;
+	p_pix += yoff + xoff;
+
+	GqColor color{ p_pix[0], p_pix[1], p_pix[2], 0 };
+	if (p_alpha) {
+		color.a = p_pix[3];
+	} else {
+		color.a = 255;
+	}
+
+	return color;
+}
+
 /**
  * @brief pixel are the pixel coordinates see #pixbuf_renderer_get_mouse_position
+ *
+ * Source tiles give the pixel of the loaded tile, and nothing where
+ * no tile is loaded.
  */
 std::optional<GqColor> pixbuf_renderer_get_pixel_colors(PixbufRenderer *pr, GqPoint pixel)
 {
 	g_return_val_if_fail(IS_PIXBUF_RENDERER(pr), std::nullopt);
 
-	if (!pr->pixbuf && !pr->source_tiles_enabled) return {};
+	if (pr->source_tiles_enabled)
+		{
+		/* source tiles are not rotated */
+		if (pixel.x < 0 || pixel.x >= pr->image_width || pixel.y < 0 || pixel.y >= pr->image_height) return {};
+
+		SourceTile *st = pr_source_tile_find(pr, pixel.x, pixel.y);
+		if (!st || st->blank) return {};
+
+		return pr_pixbuf_get_pixel_color(st->pixbuf, pixel.x - st->x, pixel.y - st->y);
+		}
+
+	if (!pr->pixbuf) return {};
 
 	GdkRectangle map_rect = pr_tile_region_map_orientation(pr->orientation,
 	                                                       {pixel.x, pixel.y, 1, 1}, /*single pixel */
@@ -2949,22 +2984,7 @@ std::optional<GqColor> pixbuf_renderer_get_pixel_colors(PixbufRenderer *pr, GqPo
 	if (map_rect.x < 0 || map_rect.x > gdk_pixbuf_get_width(pr->pixbuf) - 1) return {};
 	if (map_rect.y < 0 || map_rect.y > gdk_pixbuf_get_height(pr->pixbuf) - 1) return {};
 
-	const gboolean p_alpha = gdk_pixbuf_get_has_alpha(pr->pixbuf);
-	const gint p_rs = gdk_pixbuf_get_rowstride(pr->pixbuf);
-	const guchar *p_pix = gdk_pixbuf_get_pixels(pr->pixbuf);
-
-	const auto xoff = static_cast<size_t>(map_rect.x) * (p_alpha ? 4 : 3);
-	const auto yoff = static_cast<size_t>(map_rect.y) * p_rs;
-	p_pix += yoff + xoff;
-
-	GqColor color{ p_pix[0], p_pix[1], p_pix[2], 0 };
-	if (p_alpha) {
-		color.a = p_pix[3];
-	} else {
-		color.a = 255;
-	}
-
-	return color;
+	return pr_pixbuf_get_pixel_color(pr->pixbuf, map_rect.x, map_rect.y);
 }
 
 gboolean pixbuf_renderer_get_mouse_position(PixbufRenderer *pr, GqPoint &pixel)
@@ -36,6 +36,8 @@
 
 struct GqColor;
 struct PixbufRenderer;
+struct SourceTile;
+template<typename T> class TileGrid;
 
 #define TYPE_PIXBUF_RENDERER		(pixbuf_renderer_get_type())
 #define PIXBUF_RENDERER(obj)		(G_TYPE_CHECK_INSTANCE_CAST((obj), TYPE_PIXBUF_RENDERER, PixbufRenderer))
@@ -226,9 +228,10 @@ struct PixbufRenderer
 	gboolean source_tiles_enabled;
 	gint source_tiles_cache_size;
 
-	GList *source_tiles;	/**< list of active source tiles */
+	TileGrid<SourceTile> *source_tiles;	/**< active source tiles, nullptr if there are none */
 	gint source_tile_width;
 	gint source_tile_height;
+	gint source_tile_max_reduction;	/**< tiles may be requested at down to 1/n of the image size */
 
 	using TileRequestFunc = std::function<gboolean(PixbufRenderer *, gint, gint, gint, gint, GdkPixbuf *)>;
 	TileRequestFunc func_tile_request;
@@ -314,9 +317,10 @@ void pixbuf_renderer_set_tiles(PixbufRenderer *pr, gint width, gint height,
                                gint tile_width, gint tile_height, gint cache_size,
                                const PixbufRenderer::TileRequestFunc &func_request,
                                const PixbufRenderer::TileDisposeFunc &func_dispose,
-                               gdouble zoom);
+                               gdouble zoom, gint max_reduction = 1);
 void pixbuf_renderer_set_tiles_size(PixbufRenderer *pr, gint width, gint height);
 gint pixbuf_renderer_get_tiles(PixbufRenderer *pr);
+gint pixbuf_renderer_get_tiles_reduction(PixbufRenderer *pr);
 
 void pixbuf_renderer_move(PixbufRenderer *pr, PixbufRenderer *source);
 void pixbuf_renderer_copy(PixbufRenderer *pr, PixbufRenderer *source);
@@ -377,16 +381,15 @@ struct SourceTile
 	gint y;
 	GdkPixbuf *pixbuf;
 	gboolean blank;
+	gint reduction;	/**< the tile holds image data at 1/reduction of the image size */
+
+	SourceTile *lru_prev;	/**< links of PixbufRenderer::source_tiles */
+	SourceTile *lru_next;
 };
 
 
 void pr_render_complete_signal(PixbufRenderer *pr);
 
-void pr_tile_coords_map_orientation(gint orientation,
-                                    gdouble tile_x, gdouble tile_y, /**< coordinates of the tile */
-                                    gdouble image_w, gdouble image_h,
-                                    gdouble tile_w, gdouble tile_h,
-                                    gdouble &res_x, gdouble &res_y);
 GdkRectangle pr_tile_region_map_orientation(gint orientation,
                                             GdkRectangle area, /**< coordinates of the area inside tile */
                                             gint tile_w, gint tile_h);
@@ -0,0 +1,728 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "pixbuf-scale.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  include <immintrin.h>
+#endif
+
+/**
+ * @file
+ *
+ * A separable resampler of 8 bit RGB and RGBA pixbufs, which replaces
+ * gdk_pixbuf_scale() where images are drawn.
+ *
+ * Each source row is filtered horizontally once, into a row of 16 bit values
+ * with ROW_BITS of fraction. The rows are kept in a ring of as many rows as
+ * the vertical filter has taps, and each destination row is the weighted sum
+ * of the rows of the ring. The weights of both axes are precomputed for each
+ * zoom and kept in a small cache of each thread, the tiles of an image at the
+ * same zoom share them.
+ *
+ * RGBA is filtered with premultiplied alpha, as gdk-pixbuf does.
+ *
+ * An orientation reverses the filters of the mirrored axes, and with a
+ * transposed orientation each filtered row is written as a column of the
+ * destination. The orientation needs no pass of its own.
+ *
+ * The filters follow those of gdk-pixbuf:
+ * - GDK_INTERP_NEAREST: the nearest pixel
+ * - GDK_INTERP_TILES: the area of each source pixel covered by the destination pixel
+ * - GDK_INTERP_BILINEAR: linear interpolation to enlarge, as tiles to reduce
+ * - GDK_INTERP_HYPER: a Catmull-Rom cubic, widened to reduce
+ */
+
+namespace
+{
+
+constexpr gint FILTER_BITS = 14; /**< fraction bits of the weights */
+constexpr gint ROW_BITS = 6;     /**< fraction bits of the horizontally filtered rows */
+constexpr gint ROW_SHIFT = FILTER_BITS - ROW_BITS;
+constexpr gint OUT_SHIFT = FILTER_BITS + ROW_BITS;
+
+constexpr gsize FILTER_CACHE_SIZE = 32; /**< enough for the rows and columns of tiles on a screen */
+
+/**
+ * @brief The filter of one axis
+ *
+ * Destination pixel i is the sum of source pixels starts[i] to starts[i] + taps - 1,
+ * weighted by weights[i * taps] on. The weights of a pixel sum to 1 << FILTER_BITS.
+ */
+struct ScaleFilter
+{
+	gint taps = 0;
+	std::vector<gint> starts;
+	std::vector<gint16> weights;
+};
+
+struct ScaleFilterKey
+{
+	GdkInterpType interp_type = GDK_INTERP_NEAREST;
+	gint src_size = 0;
+	gint dest_start = 0;
+	gint dest_size = 0;
+	gdouble offset = 0.0;
+	gdouble scale = 0.0;
+
+	bool operator==(const ScaleFilterKey &other) const
+	{
+		return interp_type == other.interp_type &&
+		       src_size == other.src_size &&
+		       dest_start == other.dest_start &&
+		       dest_size == other.dest_size &&
+		       offset == other.offset &&
+		       scale == other.scale;
+	}
+};
+
+/* Catmull-Rom */
+gdouble filter_cubic(gdouble t)
+{
+	t = std::abs(t);
+
+	if (t < 1.0) return ((1.5 * t - 2.5) * t * t) + 1.0;
+	if (t < 2.0) return (((-0.5 * t + 2.5) * t - 4.0) * t) + 2.0;
+
+	return 0.0;
+}
+
+/**
+ * @brief The weights of the source pixels of one destination pixel
+ * @param[out] first The source pixel of weights[0], the others follow
+ * @param[out] weights Not normalized, may reach past the source
+ */
+void scale_filter_pixel_weights(const ScaleFilterKey &key, gint x, gint &first, std::vector<gdouble> &weights)
+{
+	/* the destination pixel covers [x0, x1) of the source, where pixel i covers [i, i + 1),
+	 * a negative scale reverses the axis
+	 */
+	const gdouble scale = std::abs(key.scale);
+	const gdouble x0 = std::min((x - key.offset) / key.scale, (x + 1 - key.offset) / key.scale);
+	const gdouble x1 = std::max((x - key.offset) / key.scale, (x + 1 - key.offset) / key.scale);
+	const gdouble center = ((x0 + x1) / 2.0) - 0.5;
+
+	weights.clear();
+
+	switch (key.interp_type)
+		{
+		case GDK_INTERP_NEAREST:
+			first = static_cast<gint>(std::floor(center + 0.5));
+			weights.push_back(1.0);
+			break;
+		case GDK_INTERP_BILINEAR:
+			if (scale >= 1.0)
+				{
+				first = static_cast<gint>(std::floor(center));
+				weights.push_back(1.0 - (center - first));
+				weights.push_back(center - first);
+				break;
+				}
+			/* reduce as tiles */
+			[[fallthrough]];
+		case GDK_INTERP_TILES:
+			first = static_cast<gint>(std::floor(x0));
+			for (gint i = first; i < x1; i++)
+				{
+				weights.push_back(std::min<gdouble>(i + 1, x1) - std::max<gdouble>(i, x0));
+				}
+			break;
+		case GDK_INTERP_HYPER:
+		default:
+			{
+			const gdouble width = std::max(1.0, 1.0 / scale);
+
+			first = static_cast<gint>(std::ceil(center - (2.0 * width)));
+			for (gint i = first; i <= center + (2.0 * width); i++)
+				{
+				weights.push_back(filter_cubic((i - center) / width));
+				}
+			}
+			break;
+		}
+}
+
+std::shared_ptr<const ScaleFilter> scale_filter_new(const ScaleFilterKey &key)
+{
+	const gint size = key.src_size;
+	std::vector<gint> lows(key.dest_size);
+	std::vector<std::vector<gdouble>> clamped(key.dest_size);
+	std::vector<gdouble> weights;
+
+	auto filter = std::make_shared<ScaleFilter>();
+
+	/* the pixels past the edges of the source repeat the edge pixels */
+	for (gint i = 0; i < key.dest_size; i++)
+		{
+		gint first;
+		scale_filter_pixel_weights(key, key.dest_start + i, first, weights);
+
+		const gint low = std::clamp(first, 0, size - 1);
+		const gint high = std::clamp(first + static_cast<gint>(weights.size()) - 1, 0, size - 1);
+
+		clamped[i].assign(high - low + 1, 0.0);
+		for (gsize k = 0; k < weights.size(); k++)
+			{
+			clamped[i][std::clamp(first + static_cast<gint>(k), 0, size - 1) - low] += weights[k];
+			}
+
+		lows[i] = low;
+		filter->taps = std::max(filter->taps, high - low + 1);
+		}
+
+	filter->starts.resize(key.dest_size);
+	filter->weights.assign(key.dest_size * filter->taps, 0);
+
+	for (gint i = 0; i < key.dest_size; i++)
+		{
+		/* every pixel has all taps inside the source */
+		const gint start = std::min(lows[i], size - filter->taps);
+		gint16 *w = filter->weights.data() + (i * filter->taps) + (lows[i] - start);
+
+		gdouble sum = 0.0;
+		for (gdouble weight : clamped[i]) sum += weight;
+		if (sum == 0.0) sum = 1.0;
+
+		gint total = 0;
+		gsize largest = 0;
+		for (gsize k = 0; k < clamped[i].size(); k++)
+			{
+			w[k] = static_cast<gint16>(std::lround(clamped[i][k] / sum * (1 << FILTER_BITS)));
+			total += w[k];
+			if (std::abs(w[k]) > std::abs(w[largest])) largest = k;
+			}
+		w[largest] += (1 << FILTER_BITS) - total;
+
+		filter->starts[i] = start;
+		}
+
+	return filter;
+}
+
+/**
+ * @brief The filter of an axis from the cache of the thread, computed if missing
+ */
+std::shared_ptr<const ScaleFilter> scale_filter_get(const ScaleFilterKey &key)
+{
+	struct Entry
+	{
+		ScaleFilterKey key;
+		std::shared_ptr<const ScaleFilter> filter;
+	};
+	thread_local std::array<Entry, FILTER_CACHE_SIZE> cache;
+	thread_local gsize next = 0;
+
+	for (const Entry &entry : cache)
+		{
+		if (entry.filter && entry.key == key) return entry.filter;
+		}
+
+	Entry &entry = cache[next];
+	next = (next + 1) % cache.size();
+
+	entry.key = key;
+	entry.filter = scale_filter_new(key);
+
+	return entry.filter;
+}
+
+/*
+ *-----------------------------------------------------------------------------
+ * kernels
+ *-----------------------------------------------------------------------------
+ */
+
+/**
+ * @brief Filters a row horizontally
+ * @param src The row, its pixel 0 is source pixel origin, readable one byte past its last pixel
+ * @param dest channels values for each destination pixel, and one more of padding
+ */
+using ScaleRowFunc = void (*)(const guchar *src, gint origin, const ScaleFilter &filter, gint16 *dest);
+
+/**
+ * @brief Sums the horizontally filtered rows of the ring into a destination row
+ * @param rows The rows of the taps
+ * @param weights The weight of each row
+ * @param count The number of values in a row
+ */
+using ScaleRowsFunc = void (*)(const gint16 *const *rows, const gint16 *weights, gint taps, gint count, guchar *dest);
+
+/* A pair of weights for _mm_madd_epi16() */
+inline gint32 weight_pair(gint16 a, gint16 b)
+{
+	return static_cast<gint32>((static_cast<guint32>(static_cast<guint16>(b)) << 16) | static_cast<guint16>(a));
+}
+
+inline guchar scale_rows_value(const gint16 *const *rows, const gint16 *weights, gint taps, gint i)
+{
+	gint sum = 1 << (OUT_SHIFT - 1);
+
+	for (gint k = 0; k < taps; k++)
+		{
+		sum += rows[k][i] * weights[k];
+		}
+
+	return std::clamp(sum >> OUT_SHIFT, 0, 255);
+}
+
+template<gint channels>
+void scale_row_scalar(const guchar *src, gint origin, const ScaleFilter &filter, gint16 *dest)
+{
+	const gint dest_size = filter.starts.size();
+
+	for (gint x = 0; x < dest_size; x++)
+		{
+		const guchar *s = src + ((filter.starts[x] - origin) * channels);
+		const gint16 *w = filter.weights.data() + (x * filter.taps);
+		std::array<gint, channels> sum{};
+
+		for (gint k = 0; k < filter.taps; k++)
+			{
+			for (gint c = 0; c < channels; c++)
+				{
+				sum[c] += s[(k * channels) + c] * w[k];
+				}
+			}
+
+		for (gint c = 0; c < channels; c++)
+			{
+			dest[(x * channels) + c] = (sum[c] + (1 << (ROW_SHIFT - 1))) >> ROW_SHIFT;
+			}
+		}
+}
+
+void scale_rows_scalar(const gint16 *const *rows, const gint16 *weights, gint taps, gint count, guchar *dest)
+{
+	for (gint i = 0; i < count; i++)
+		{
+		dest[i] = scale_rows_value(rows, weights, taps, i);
+		}
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+template<gint channels>
+__attribute__((target("sse2")))
+inline __m128i scale_load_pixel(const guchar *p)
+{
+	/* with 3 channels this reads the next byte too */
+	gint32 pixel;
+	memcpy(&pixel, p, sizeof(pixel));
+	return _mm_cvtsi32_si128(pixel);
+}
+
+/* Each pair of taps is one _mm_madd_epi16() of the channels of both pixels */
+template<gint channels>
+__attribute__((target("sse2")))
+void scale_row_sse2(const guchar *src, gint origin, const ScaleFilter &filter, gint16 *dest)
+{
+	const gint dest_size = filter.starts.size();
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi32(1 << (ROW_SHIFT - 1));
+
+	for (gint x = 0; x < dest_size; x++)
+		{
+		const guchar *s = src + ((filter.starts[x] - origin) * channels);
+		const gint16 *w = filter.weights.data() + (x * filter.taps);
+		__m128i sum = round;
+		gint k = 0;
+
+		for (; k + 1 < filter.taps; k += 2)
+			{
+			const __m128i pixels = _mm_unpacklo_epi8(scale_load_pixel<channels>(s + (k * channels)),
+			                                         scale_load_pixel<channels>(s + ((k + 1) * channels)));
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero),
+			                                        _mm_set1_epi32(weight_pair(w[k], w[k + 1]))));
+			}
+		if (k < filter.taps)
+			{
+			const __m128i pixel = _mm_unpacklo_epi16(_mm_unpacklo_epi8(scale_load_pixel<channels>(s + (k * channels)), zero), zero);
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(pixel, _mm_set1_epi32(weight_pair(w[k], 0))));
+			}
+
+		sum = _mm_srai_epi32(sum, ROW_SHIFT);
+		/* with 3 channels this writes into the next pixel, or the padding */
+		_mm_storel_epi64(reinterpret_cast<__m128i *>(dest + (x * channels)), _mm_packs_epi32(sum, sum));
+		}
+}
+
+__attribute__((target("sse2")))
+void scale_rows_sse2(const gint16 *const *rows, const gint16 *weights, gint taps, gint count, guchar *dest)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi32(1 << (OUT_SHIFT - 1));
+	gint i = 0;
+
+	for (; i + 8 <= count; i += 8)
+		{
+		__m128i low = round;
+		__m128i high = round;
+		gint k = 0;
+
+		for (; k + 1 < taps; k += 2)
+			{
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[k] + i));
+			const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[k + 1] + i));
+			const __m128i w = _mm_set1_epi32(weight_pair(weights[k], weights[k + 1]));
+
+			low = _mm_add_epi32(low, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+			high = _mm_add_epi32(high, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+			}
+		if (k < taps)
+			{
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[k] + i));
+			const __m128i w = _mm_set1_epi32(weight_pair(weights[k], 0));
+
+			low = _mm_add_epi32(low, _mm_madd_epi16(_mm_unpacklo_epi16(a, zero), w));
+			high = _mm_add_epi32(high, _mm_madd_epi16(_mm_unpackhi_epi16(a, zero), w));
+			}
+
+		const __m128i values = _mm_packs_epi32(_mm_srai_epi32(low, OUT_SHIFT), _mm_srai_epi32(high, OUT_SHIFT));
+		_mm_storel_epi64(reinterpret_cast<__m128i *>(dest + i), _mm_packus_epi16(values, values));
+		}
+
+	for (; i < count; i++)
+		{
+		dest[i] = scale_rows_value(rows, weights, taps, i);
+		}
+}
+
+__attribute__((target("avx2")))
+void scale_rows_avx2(const gint16 *const *rows, const gint16 *weights, gint taps, gint count, guchar *dest)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i round = _mm256_set1_epi32(1 << (OUT_SHIFT - 1));
+	gint i = 0;
+
+	for (; i + 16 <= count; i += 16)
+		{
+		__m256i low = round;
+		__m256i high = round;
+		gint k = 0;
+
+		for (; k + 1 < taps; k += 2)
+			{
+			const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rows[k] + i));
+			const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rows[k + 1] + i));
+			const __m256i w = _mm256_set1_epi32(weight_pair(weights[k], weights[k + 1]));
+
+			low = _mm256_add_epi32(low, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), w));
+			high = _mm256_add_epi32(high, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), w));
+			}
+		if (k < taps)
+			{
+			const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rows[k] + i));
+			const __m256i w = _mm256_set1_epi32(weight_pair(weights[k], 0));
+
+			low = _mm256_add_epi32(low, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, zero), w));
+			high = _mm256_add_epi32(high, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, zero), w));
+			}
+
+		/* the unpacks and packs work within each 128 bit lane, the values are in order per lane */
+		const __m256i values = _mm256_packs_epi32(_mm256_srai_epi32(low, OUT_SHIFT), _mm256_srai_epi32(high, OUT_SHIFT));
+		const __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(values, values), _MM_SHUFFLE(3, 1, 2, 0));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i), _mm256_castsi256_si128(bytes));
+		}
+
+	for (; i < count; i++)
+		{
+		dest[i] = scale_rows_value(rows, weights, taps, i);
+		}
+}
+#endif
+
+struct ScaleKernels
+{
+	ScaleRowFunc row_rgb;
+	ScaleRowFunc row_rgba;
+	ScaleRowsFunc rows;
+};
+
+/**
+ * @brief Selects the fastest kernels supported by the CPU, once
+ *
+ * Elsewhere the scalar kernels are left to the vectorizer of the compiler.
+ */
+const ScaleKernels &scale_kernels()
+{
+	static const ScaleKernels kernels = []() -> ScaleKernels
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) return {scale_row_sse2<3>, scale_row_sse2<4>, scale_rows_avx2};
+		if (__builtin_cpu_supports("sse2")) return {scale_row_sse2<3>, scale_row_sse2<4>, scale_rows_sse2};
+#endif
+		return {scale_row_scalar<3>, scale_row_scalar<4>, scale_rows_scalar};
+	}();
+
+	return kernels;
+}
+
+void scale_premultiply(const guchar *src, gint width, guchar *dest)
+{
+	for (gint x = 0; x < width; x++)
+		{
+		const guint alpha = src[3];
+
+		for (gint c = 0; c < 3; c++)
+			{
+			const guint value = (src[c] * alpha) + 128;
+			dest[c] = (value + (value >> 8)) >> 8;
+			}
+		dest[3] = alpha;
+
+		src += 4;
+		dest += 4;
+		}
+}
+
+void scale_unpremultiply(guchar *row, gint width)
+{
+	/* 255 / alpha with 16 bits of fraction */
+	static const std::array<guint32, 256> inverse = []()
+	{
+		std::array<guint32, 256> table{};
+		for (guint alpha = 1; alpha < table.size(); alpha++)
+			{
+			table[alpha] = ((255U << 16) + (alpha / 2)) / alpha;
+			}
+		return table;
+	}();
+
+	for (gint x = 0; x < width; x++)
+		{
+		const guint alpha = row[3];
+
+		if (alpha < 255)
+			{
+			for (gint c = 0; c < 3; c++)
+				{
+				row[c] = std::min<guint32>(255, ((row[c] * inverse[alpha]) + (1 << 15)) >> 16);
+				}
+			}
+
+		row += 4;
+		}
+}
+
+/**
+ * @brief How an orientation maps the axes of the destination to the source
+ */
+struct ScaleOrientation
+{
+	bool transposed = false; /**< destination x runs along source y */
+	bool reverse_x = false;  /**< destination x runs backwards */
+	bool reverse_y = false;  /**< destination y runs backwards */
+};
+
+ScaleOrientation scale_orientation(gint orientation)
+{
+	switch (orientation)
+		{
+		case EXIF_ORIENTATION_TOP_RIGHT:
+			return {false, true, false};
+		case EXIF_ORIENTATION_BOTTOM_RIGHT:
+			return {false, true, true};
+		case EXIF_ORIENTATION_BOTTOM_LEFT:
+			return {false, false, true};
+		case EXIF_ORIENTATION_LEFT_TOP:
+			return {true, false, false};
+		case EXIF_ORIENTATION_RIGHT_TOP:
+			return {true, true, false};
+		case EXIF_ORIENTATION_RIGHT_BOTTOM:
+			return {true, true, true};
+		case EXIF_ORIENTATION_LEFT_BOTTOM:
+			return {true, false, true};
+		case EXIF_ORIENTATION_TOP_LEFT:
+		default:
+			return {};
+		}
+}
+
+} // namespace
+
+/**
+ * @brief Scales an area of a pixbuf into another, like gdk_pixbuf_scale()
+ * @param src The source pixbuf
+ * @param dest The destination pixbuf
+ * @param dest_x,dest_y,dest_width,dest_height The area of dest to render
+ * @param offset_x,offset_y The offset of the scaled and oriented source in dest
+ * @param scale_x,scale_y The scale factors of the source axes
+ * @param interp_type The filter
+ * @param orientation The EXIF orientation of the source
+ *
+ * The source is scaled, then oriented about its origin, then moved by the offset.
+ * The mirrored axes of the orientation thus run to negative coordinates, and
+ * their offset includes the size of the scaled image on that axis, e.g. a
+ * source mirrored left to right fills dest from 0 with offset_x of
+ * width * scale_x. With a transposed orientation (5 to 8), scale_x still
+ * scales the width of the source, which becomes the height in dest.
+ *
+ * Both pixbufs must have 8 bit samples and the same layout, RGB or RGBA,
+ * other pixbufs are left to gdk_pixbuf_scale(), which ignores the orientation.
+ *
+ * Pixbufs with alpha are filtered with premultiplied alpha.
+ * This may run in any thread.
+ */
+void pixbuf_scale(const GdkPixbuf *src, GdkPixbuf *dest,
+                  gint dest_x, gint dest_y, gint dest_width, gint dest_height,
+                  gdouble offset_x, gdouble offset_y, gdouble scale_x, gdouble scale_y,
+                  GdkInterpType interp_type, gint orientation)
+{
+	g_return_if_fail(dest_x >= 0 && dest_x + dest_width <= gdk_pixbuf_get_width(dest));
+	g_return_if_fail(dest_y >= 0 && dest_y + dest_height <= gdk_pixbuf_get_height(dest));
+
+	const gint channels = gdk_pixbuf_get_n_channels(src);
+
+	if (gdk_pixbuf_get_bits_per_sample(src) != 8 || gdk_pixbuf_get_bits_per_sample(dest) != 8 ||
+	    gdk_pixbuf_get_n_channels(dest) != channels || (channels != 3 && channels != 4))
+		{
+		gdk_pixbuf_scale(const_cast<GdkPixbuf *>(src), dest, dest_x, dest_y, dest_width, dest_height,
+		                 offset_x, offset_y, scale_x, scale_y, interp_type);
+		return;
+		}
+
+	const gint src_width = gdk_pixbuf_get_width(src);
+	const gint src_height = gdk_pixbuf_get_height(src);
+
+	if (dest_width <= 0 || dest_height <= 0 || src_width <= 0 || src_height <= 0 ||
+	    scale_x <= 0.0 || scale_y <= 0.0) return;
+
+	/* a reversed axis is a negative scale, the filters of the destination axes
+	 * are those of the source columns and rows they run along
+	 */
+	const ScaleOrientation o = scale_orientation(orientation);
+	const ScaleFilterKey key_x{interp_type, o.transposed ? src_height : src_width, dest_x, dest_width,
+	                           offset_x, (o.reverse_x ? -1.0 : 1.0) * (o.transposed ? scale_y : scale_x)};
+	const ScaleFilterKey key_y{interp_type, o.transposed ? src_width : src_height, dest_y, dest_height,
+	                           offset_y, (o.reverse_y ? -1.0 : 1.0) * (o.transposed ? scale_x : scale_y)};
+
+	const auto filter_cols = scale_filter_get(o.transposed ? key_y : key_x);
+	const auto filter_rows = scale_filter_get(o.transposed ? key_x : key_y);
+
+	const ScaleKernels &kernels = scale_kernels();
+	const ScaleRowFunc scale_row = (channels == 4) ? kernels.row_rgba : kernels.row_rgb;
+
+	const gint src_rowstride = gdk_pixbuf_get_rowstride(src);
+	const gint dest_rowstride = gdk_pixbuf_get_rowstride(dest);
+	const guchar *src_pixels = gdk_pixbuf_read_pixels(src);
+	guchar *dest_pixels = gdk_pixbuf_get_pixels(dest);
+
+	/* the columns of the source that are used */
+	const gint src_x = std::min(filter_cols->starts.front(), filter_cols->starts.back());
+	const gint src_span = std::max(filter_cols->starts.front(), filter_cols->starts.back()) + filter_cols->taps - src_x;
+
+	/* the ring of horizontally filtered rows, reused by later calls of the thread */
+	thread_local std::vector<gint16> ring;
+	thread_local std::vector<gint> ring_rows;
+	thread_local std::vector<const gint16 *> rows;
+	thread_local std::vector<guchar> row_copy;
+	thread_local std::vector<guchar> out_row;
+
+	const gint out_count = filter_rows->starts.size();
+	const gint out_size = filter_cols->starts.size();
+	const gint taps = filter_rows->taps;
+	const gint row_size = (out_size * channels) + 1;
+
+	ring.resize(taps * row_size);
+	ring_rows.assign(taps, -1);
+	rows.resize(taps);
+	row_copy.resize((src_span * channels) + 1);
+	if (o.transposed) out_row.resize(out_size * channels);
+
+	for (gint r = 0; r < out_count; r++)
+		{
+		const gint start = filter_rows->starts[r];
+
+		for (gint k = 0; k < taps; k++)
+			{
+			const gint src_y = start + k;
+			const gint slot = src_y % taps;
+			gint16 *row = ring.data() + (slot * row_size);
+
+			if (ring_rows[slot] != src_y)
+				{
+				const guchar *s = src_pixels + (src_y * src_rowstride) + (src_x * channels);
+
+				if (channels == 4)
+					{
+					scale_premultiply(s, src_span, row_copy.data());
+					s = row_copy.data();
+					}
+				else if (src_y == src_height - 1)
+					{
+					/* the end of the pixbuf may be the end of its last pixel */
+					memcpy(row_copy.data(), s, src_span * channels);
+					s = row_copy.data();
+					}
+
+				scale_row(s, src_x, *filter_cols, row);
+				ring_rows[slot] = src_y;
+				}
+
+			rows[k] = row;
+			}
+
+		const gint16 *weights = filter_rows->weights.data() + (r * taps);
+
+		if (!o.transposed)
+			{
+			guchar *d = dest_pixels + ((dest_y + r) * dest_rowstride) + (dest_x * channels);
+
+			kernels.rows(rows.data(), weights, taps, out_size * channels, d);
+			if (channels == 4) scale_unpremultiply(d, out_size);
+			continue;
+			}
+
+		/* the row is column dest_x + r of dest */
+		kernels.rows(rows.data(), weights, taps, out_size * channels, out_row.data());
+		if (channels == 4) scale_unpremultiply(out_row.data(), out_size);
+
+		guchar *d = dest_pixels + (dest_y * dest_rowstride) + ((dest_x + r) * channels);
+		for (gint c = 0; c < out_size; c++)
+			{
+			memcpy(d, out_row.data() + (c * channels), channels);
+			d += dest_rowstride;
+			}
+		}
+}
+
+/**
+ * @brief Scales a pixbuf to a new size, like gdk_pixbuf_scale_simple()
+ * @returns A new pixbuf with the layout of src, or nullptr
+ */
+GdkPixbuf *pixbuf_scale_simple(const GdkPixbuf *src, gint dest_width, gint dest_height, GdkInterpType interp_type)
+{
+	GdkPixbuf *dest = gdk_pixbuf_new(GDK_COLORSPACE_RGB, gdk_pixbuf_get_has_alpha(src), 8, dest_width, dest_height);
+	if (!dest) return nullptr;
+
+	pixbuf_scale(src, dest, 0, 0, dest_width, dest_height, 0, 0,
+	             static_cast<gdouble>(dest_width) / gdk_pixbuf_get_width(src),
+	             static_cast<gdouble>(dest_height) / gdk_pixbuf_get_height(src),
+	             interp_type);
+
+	return dest;
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
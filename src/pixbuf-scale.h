@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef PIXBUF_SCALE_H
+#define PIXBUF_SCALE_H
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib.h>
+
+#include "exif.h"
+
+void pixbuf_scale(const GdkPixbuf *src, GdkPixbuf *dest,
+                  gint dest_x, gint dest_y, gint dest_width, gint dest_height,
+                  gdouble offset_x, gdouble offset_y, gdouble scale_x, gdouble scale_y,
+                  GdkInterpType interp_type, gint orientation = EXIF_ORIENTATION_TOP_LEFT);
+
+GdkPixbuf *pixbuf_scale_simple(const GdkPixbuf *src, gint dest_width, gint dest_height, GdkInterpType interp_type);
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -47,6 +47,7 @@
 #include "geometry.h"
 #include "gq-color.h"
 #include "main-defines.h"
+#include "pixbuf-scale.h"
 #include "ui-fileops.h"
 #include "ui-misc.h"
 
@@ -374,7 +375,7 @@ GdkPixbuf *pixbuf_fallback(FileData *fd, gint requested_width, gint requested_he
 				GdkPixbuf *tmp;
 
 				tmp = pixbuf;
-				pixbuf = gdk_pixbuf_scale_simple(tmp, nw, nh, GDK_INTERP_TILES);
+				pixbuf = pixbuf_scale_simple(tmp, nw, nh, GDK_INTERP_TILES);
 				g_object_unref(G_OBJECT(tmp));
 				}
 			}
@@ -436,6 +437,77 @@ GdkPixbuf *pixbuf_apply_orientation(GdkPixbuf *pixbuf, gint orientation)
 }
 
 
+/*
+ *-----------------------------------------------------------------------------
+ * pixbuf reduction
+ *-----------------------------------------------------------------------------
+ */
+
+/**
+ * @brief Reduces a pixbuf to half its size, rounded up, averaging each block of 2x2 pixels
+ * @param pixbuf An 8 bit RGB pixbuf, with or without alpha
+ * @returns A new pixbuf
+ *
+ * The blocks at the right and bottom edges of an odd sized pixbuf average
+ * the pixels they have. The colors of pixels with alpha are weighted by it.
+ */
+GdkPixbuf *pixbuf_half_size(const GdkPixbuf *pixbuf)
+{
+	const gint sw = gdk_pixbuf_get_width(pixbuf);
+	const gint sh = gdk_pixbuf_get_height(pixbuf);
+	const gint srs = gdk_pixbuf_get_rowstride(pixbuf);
+	const guchar *s_pix = gdk_pixbuf_read_pixels(pixbuf);
+	const gboolean has_alpha = gdk_pixbuf_get_has_alpha(pixbuf);
+	const gint channels = has_alpha ? 4 : 3;
+
+	const gint dw = (sw + 1) / 2;
+	const gint dh = (sh + 1) / 2;
+	GdkPixbuf *dest = gdk_pixbuf_new(GDK_COLORSPACE_RGB, has_alpha, 8, dw, dh);
+	const gint drs = gdk_pixbuf_get_rowstride(dest);
+	guchar *d_pix = gdk_pixbuf_get_pixels(dest);
+
+	for (gint y = 0; y < dh; y++)
+		{
+		const guchar *sp1 = s_pix + (2 * y * srs);
+		const guchar *sp2 = (2 * y + 1 < sh) ? sp1 + srs : sp1;
+		guchar *dp = d_pix + (y * drs);
+
+		for (gint x = 0; x < dw; x++)
+			{
+			const gint next = (2 * x + 1 < sw) ? channels : 0;
+
+			if (has_alpha)
+				{
+				const guint a1 = sp1[3];
+				const guint a2 = sp1[next + 3];
+				const guint a3 = sp2[3];
+				const guint a4 = sp2[next + 3];
+				const guint alpha = a1 + a2 + a3 + a4;
+
+				for (gint c = 0; c < 3; c++)
+					{
+					dp[c] = alpha ? (sp1[c] * a1 + sp1[next + c] * a2 + sp2[c] * a3 + sp2[next + c] * a4 + alpha / 2) / alpha : 0;
+					}
+				dp[3] = (alpha + 2) / 4;
+				}
+			else
+				{
+				for (gint c = 0; c < 3; c++)
+					{
+					dp[c] = (sp1[c] + sp1[next + c] + sp2[c] + sp2[next + c] + 2) / 4;
+					}
+				}
+
+			sp1 += 2 * channels;
+			sp2 += 2 * channels;
+			dp += channels;
+			}
+		}
+
+	return dest;
+}
+
+
 /*
  *-----------------------------------------------------------------------------
  * pixbuf drawing (rectangles)
@@ -354,6 +354,7 @@ static void config_window_apply()
 		}
 	options->thumbnails.enable_caching = c_options->thumbnails.enable_caching;
 	options->thumbnails.cache_into_dirs = c_options->thumbnails.cache_into_dirs;
+	options->thumbnails.similarity_database = c_options->thumbnails.similarity_database;
 	options->thumbnails.use_exif = c_options->thumbnails.use_exif;
 	options->thumbnails.use_color_management = c_options->thumbnails.use_color_management;
 	options->thumbnails.collection_preview = c_options->thumbnails.collection_preview;
@@ -387,6 +388,10 @@ static void config_window_apply()
 	options->image.zoom_style = c_options->image.zoom_style;
 
 	options->image.enable_read_ahead = c_options->image.enable_read_ahead;
+	options->image.read_ahead_forward = c_options->image.read_ahead_forward;
+	options->image.read_ahead_backward = c_options->image.read_ahead_backward;
+	options->image.raw_decode = c_options->image.raw_decode;
+	options->image.jpeg_tiles_min_megapixels = c_options->image.jpeg_tiles_min_megapixels;
 
 	options->appimage_notifications = c_options->appimage_notifications;
 
@@ -429,6 +434,8 @@ static void config_window_apply()
 
 	options->duplicates_similarity_threshold = c_options->duplicates_similarity_threshold;
 	options->rot_invariant_sim = c_options->rot_invariant_sim;
+	options->duplicates_similarity_index = c_options->duplicates_similarity_index;
+	options->duplicates_incremental = c_options->duplicates_incremental;
 
 	options->tree_descend_subdirs = c_options->tree_descend_subdirs;
 
@@ -488,6 +495,8 @@ static void config_window_apply()
 	options->star_rating = c_options->star_rating;
 
 	options->threads.duplicates = c_options->threads.duplicates > 0 ? c_options->threads.duplicates : -1;
+	options->threads.duplicates_read = c_options->threads.duplicates_read > 0 ? c_options->threads.duplicates_read : -1;
+	options->threads.image_decode = c_options->threads.image_decode > 0 ? c_options->threads.image_decode : -1;
 
 	options->alternate_similarity_algorithm = c_options->alternate_similarity_algorithm;
 
@@ -1897,6 +1906,10 @@ static void config_tab_general(GtkWidget *notebook)
 							options->thumbnails.spec_standard && !options->thumbnails.cache_into_dirs,
 							G_CALLBACK(cache_standard_cb), nullptr);
 
+	button = pref_checkbox_new_int(subgroup, _("Store sim. data in one file per folder"),
+	                               options->thumbnails.similarity_database, &c_options->thumbnails.similarity_database);
+	gtk_widget_set_tooltip_text(button, _("Faster on slow or network file systems. Existing sim. files are moved into it when read"));
+
 	pref_checkbox_new_int(group, _("Use EXIF thumbnails when available (EXIF thumbnails may be outdated)"),
 			      options->thumbnails.use_exif, &c_options->thumbnails.use_exif);
 
@@ -1964,6 +1977,18 @@ static void config_tab_general(GtkWidget *notebook)
 			  0, 99999, 1, options->image.image_cache_max, &c_options->image.image_cache_max);
 	pref_checkbox_new_int(group, _("Preload next image"),
 			      options->image.enable_read_ahead, &c_options->image.enable_read_ahead);
+	pref_spin_new_int(group, _("Preload ahead:"), _("images"),
+			  1, 32, 1, options->image.read_ahead_forward, &c_options->image.read_ahead_forward);
+	pref_spin_new_int(group, _("Preload behind:"), _("images"),
+			  0, 32, 1, options->image.read_ahead_backward, &c_options->image.read_ahead_backward);
+#if HAVE_RAW
+	pref_checkbox_new_int(group, _("Decode raw images after showing their preview"),
+			      options->image.raw_decode, &c_options->image.raw_decode);
+#endif
+#if HAVE_JPEG
+	pref_spin_new_int(group, _("Show JPEG images as tiles from:"), _("megapixels, 0 for never"),
+			  0, 100000, 1, options->image.jpeg_tiles_min_megapixels, &c_options->image.jpeg_tiles_min_megapixels);
+#endif
 
 	pref_checkbox_new_int(group, _("Refresh on file change"),
 			      options->update_on_time_change, &c_options->update_on_time_change);
@@ -3606,7 +3631,11 @@ static void config_tab_advanced(GtkWidget *notebook)
 {
 	GtkWidget *alternate_checkbox;
 	GtkWidget *dupes_threads_spin;
+	GtkWidget *dupes_read_threads_spin;
+	GtkWidget *decode_threads_spin;
 	GtkWidget *group;
+	GtkWidget *index_checkbox;
+	GtkWidget *incremental_checkbox;
 	GtkWidget *subgroup;
 	GtkWidget *threads_string_label;
 	GtkWidget *types_string_label;
@@ -3646,7 +3675,7 @@ static void config_tab_advanced(GtkWidget *notebook)
 	pref_line(vbox, PREF_PAD_SPACE);
 	group = pref_group_new(vbox, FALSE, _("Thread pool limits"), GTK_ORIENTATION_VERTICAL);
 
-	threads_string_label = pref_label_new(group, _("This option limits the number of threads (or cpu cores) that Geeqie will use when running duplicate checks.\nThe value 0 means all available cores will be used."));
+	threads_string_label = pref_label_new(group, _("This option limits the number of threads (or cpu cores) that Geeqie will use when running duplicate checks and decoding large images.\nThe value 0 means all available cores will be used."));
 	gtk_label_set_line_wrap(GTK_LABEL(threads_string_label), TRUE);
 
 	pref_spacer(vbox, PREF_PAD_GROUP);
@@ -3654,10 +3683,30 @@ static void config_tab_advanced(GtkWidget *notebook)
 	dupes_threads_spin = pref_spin_new_int(vbox, _("Duplicate check:"), _("max. threads"), 0, get_cpu_cores(), 1, options->threads.duplicates, &c_options->threads.duplicates);
 	gtk_widget_set_tooltip_markup(dupes_threads_spin, _("Set to 0 for unlimited"));
 
+	dupes_read_threads_spin = pref_spin_new_int(vbox, _("Duplicate check, reading files:"), _("max. threads"), 0, 4 * get_cpu_cores(), 1, options->threads.duplicates_read, &c_options->threads.duplicates_read);
+	gtk_widget_set_tooltip_markup(dupes_read_threads_spin, _("Checksums and cached data are read by this many threads.\nMore threads help on SSDs and RAID arrays, fewer on single hard disks.\nSet to 0 to use one thread per core"));
+
+	decode_threads_spin = pref_spin_new_int(vbox, _("Image decoding:"), _("max. threads"), 0, get_cpu_cores(), 1, options->threads.image_decode, &c_options->threads.image_decode);
+	gtk_widget_set_tooltip_markup(decode_threads_spin, _("Large images are decoded in several threads, this is the limit for all images loading at the same time.\nSet to 0 to use one thread per core"));
+
 	pref_spacer(group, PREF_PAD_GROUP);
 
 	pref_line(vbox, PREF_PAD_SPACE);
 
+	group = pref_group_new(vbox, FALSE, _("Similarity index"), GTK_ORIENTATION_VERTICAL);
+
+	index_checkbox = pref_checkbox_new_int(group, _("Use an index for similarity duplicate checks"), options->duplicates_similarity_index, &c_options->duplicates_similarity_index);
+	gtk_widget_set_tooltip_text(index_checkbox, _("Only compare images which can reach the similarity threshold. Faster for large sets, the results are the same. Not used by the alternate similarity algorithm"));
+
+	pref_line(vbox, PREF_PAD_SPACE);
+
+	group = pref_group_new(vbox, FALSE, _("Incremental duplicate checks"), GTK_ORIENTATION_VERTICAL);
+
+	incremental_checkbox = pref_checkbox_new_int(group, _("Only compare files added since the last check"), options->duplicates_incremental, &c_options->duplicates_incremental);
+	gtk_widget_set_tooltip_text(incremental_checkbox, _("Files added to a Find duplicates window are compared with each other and with the files already there, the matches found before are kept. Changing the comparison method compares all files again"));
+
+	pref_line(vbox, PREF_PAD_SPACE);
+
 	group = pref_group_new(vbox, FALSE, _("Alternate similarity algorithm"), GTK_ORIENTATION_VERTICAL);
 
 	alternate_checkbox = pref_checkbox_new_int(group, _("Enable alternate similarity algorithm"), options->alternate_similarity_algorithm.enabled, &c_options->alternate_similarity_algorithm.enabled);
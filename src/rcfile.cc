@@ -418,6 +418,8 @@ static void write_global_attributes(GString *outstr, gint indent)
 	WRITE_NL(); WRITE_UINT(*options, duplicates_select_type);
 	WRITE_NL(); WRITE_BOOL(*options, duplicates_thumbnails);
 	WRITE_NL(); WRITE_BOOL(*options, rot_invariant_sim);
+	WRITE_NL(); WRITE_BOOL(*options, duplicates_similarity_index);
+	WRITE_NL(); WRITE_BOOL(*options, duplicates_incremental);
 	WRITE_NL(); WRITE_BOOL(*options, sort_totals);
 	WRITE_SEPARATOR();
 
@@ -496,6 +498,10 @@ static void write_global_attributes(GString *outstr, gint indent)
 	WRITE_NL(); WRITE_INT(*options, image.tile_cache_max);
 	WRITE_NL(); WRITE_INT(*options, image.image_cache_max);
 	WRITE_NL(); WRITE_BOOL(*options, image.enable_read_ahead);
+	WRITE_NL(); WRITE_INT(*options, image.read_ahead_forward);
+	WRITE_NL(); WRITE_INT(*options, image.read_ahead_backward);
+	WRITE_NL(); WRITE_BOOL(*options, image.raw_decode);
+	WRITE_NL(); WRITE_INT(*options, image.jpeg_tiles_min_megapixels);
 	WRITE_NL(); WRITE_BOOL(*options, image.exif_rotate_enable);
 	WRITE_NL(); WRITE_BOOL(*options, image.use_custom_border_color);
 	WRITE_NL(); WRITE_BOOL(*options, image.use_custom_border_color_in_fullscreen);
@@ -509,6 +515,7 @@ static void write_global_attributes(GString *outstr, gint indent)
 	WRITE_NL(); WRITE_INT(*options, thumbnails.max_height);
 	WRITE_NL(); WRITE_BOOL(*options, thumbnails.enable_caching);
 	WRITE_NL(); WRITE_BOOL(*options, thumbnails.cache_into_dirs);
+	WRITE_NL(); WRITE_BOOL(*options, thumbnails.similarity_database);
 	WRITE_NL(); WRITE_BOOL(*options, thumbnails.use_xvpics);
 	WRITE_NL(); WRITE_BOOL(*options, thumbnails.spec_standard);
 	WRITE_NL(); WRITE_UINT(*options, thumbnails.quality);
@@ -620,6 +627,8 @@ static void write_global_attributes(GString *outstr, gint indent)
 
 	/* Threads */
 	WRITE_NL(); WRITE_INT(*options, threads.duplicates);
+	WRITE_NL(); WRITE_INT(*options, threads.duplicates_read);
+	WRITE_NL(); WRITE_INT(*options, threads.image_decode);
 	WRITE_SEPARATOR();
 
 	/* user-definable mouse buttons */
@@ -895,6 +904,8 @@ static gboolean load_global_params(const gchar **attribute_names, const gchar **
 		if (READ_UINT_ENUM_CLAMP(*options, duplicates_select_type, DUPE_SELECT_NONE, DUPE_SELECT_GROUP2)) continue;
 		if (READ_BOOL(*options, duplicates_thumbnails)) continue;
 		if (READ_BOOL(*options, rot_invariant_sim)) continue;
+		if (READ_BOOL(*options, duplicates_similarity_index)) continue;
+		if (READ_BOOL(*options, duplicates_incremental)) continue;
 		if (READ_BOOL(*options, sort_totals)) continue;
 
 		if (READ_BOOL(*options, progressive_key_scrolling)) continue;
@@ -964,6 +975,10 @@ static gboolean load_global_params(const gchar **attribute_names, const gchar **
 		if (READ_UINT_ENUM_CLAMP(*options, image.zoom_quality, GDK_INTERP_NEAREST, GDK_INTERP_BILINEAR)) continue;
 		if (READ_INT(*options, image.zoom_increment)) continue;
 		if (READ_BOOL(*options, image.enable_read_ahead)) continue;
+		if (READ_INT_CLAMP(*options, image.read_ahead_forward, 1, 32)) continue;
+		if (READ_INT_CLAMP(*options, image.read_ahead_backward, 0, 32)) continue;
+		if (READ_BOOL(*options, image.raw_decode)) continue;
+		if (READ_INT_CLAMP(*options, image.jpeg_tiles_min_megapixels, 0, 100000)) continue;
 		if (READ_BOOL(*options, image.exif_rotate_enable)) continue;
 		if (READ_BOOL(*options, image.use_custom_border_color)) continue;
 		if (READ_BOOL(*options, image.use_custom_border_color_in_fullscreen)) continue;
@@ -978,6 +993,7 @@ static gboolean load_global_params(const gchar **attribute_names, const gchar **
 
 		if (READ_BOOL(*options, thumbnails.enable_caching)) continue;
 		if (READ_BOOL(*options, thumbnails.cache_into_dirs)) continue;
+		if (READ_BOOL(*options, thumbnails.similarity_database)) continue;
 		if (READ_BOOL(*options, thumbnails.use_xvpics)) continue;
 		if (READ_BOOL(*options, thumbnails.spec_standard)) continue;
 		if (READ_UINT_ENUM_CLAMP(*options, thumbnails.quality, GDK_INTERP_NEAREST, GDK_INTERP_BILINEAR)) continue;
@@ -1093,6 +1109,8 @@ static gboolean load_global_params(const gchar **attribute_names, const gchar **
 
 		/* Threads */
 		if (READ_INT(*options, threads.duplicates)) continue;
+		if (READ_INT(*options, threads.duplicates_read)) continue;
+		if (READ_INT(*options, threads.image_decode)) continue;
 
 		/* user-definable mouse buttons */
 		if (READ_CHAR(*options, mouse_button_8)) continue;
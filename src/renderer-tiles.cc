@@ -27,16 +27,21 @@
 #include <cstring>
 #include <functional>
 #include <utility>
+#include <vector>
 
 #include <cairo.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gdk/gdk.h>
+#include <gio/gio.h>
 #include <glib-object.h>
 #include <glib.h>
 #include <gtk/gtk.h>
 
+#include "image-load.h"
 #include "options.h"
 #include "pixbuf-renderer.h"
+#include "pixbuf-scale.h"
+#include "tile-grid.h"
 
 /* comment this out if not using this from within Geeqie
  * defining GQ_BUILD does these things:
@@ -93,7 +98,12 @@ struct ImageTile
 	QueueData *qd;
 	QueueData *qd2;
 
-	guint size;		/* est. memory used by pixmap and pixbuf */
+	gboolean locked;	/* being rendered, must not be freed */
+
+	gsize size;		/* bytes used by the tile, its surface and pixbuf */
+
+	ImageTile *lru_prev;	/* links of RendererTiles::tiles */
+	ImageTile *lru_next;
 };
 
 struct QueueData
@@ -106,6 +116,43 @@ struct QueueData
 	gboolean new_data;
 };
 
+/**
+ * @brief The scaling of a SourceTile into an ImageTile, see rt_source_tile_render_prepare()
+ */
+struct SourceTileScale
+{
+	GdkPixbuf *pixbuf; /**< a reference of the SourceTile pixbuf */
+	GdkRectangle dest;
+	gdouble offset_x;
+	gdouble offset_y;
+	gdouble scale_x;
+	gdouble scale_y;
+	GdkInterpType interp_type;
+};
+
+/**
+ * @brief An area of an ImageTile rendered by rt_queue_draw_idle_cb()
+ *
+ * It is set up and committed to the tile surface on the main thread, the
+ * scaling in between runs in any thread.
+ */
+struct TileRenderJob
+{
+	ImageTile *it;
+	GdkRectangle area;   /**< to render, in tile coordinates */
+	GdkRectangle expose; /**< to copy to the screen, empty if the tile is not visible */
+	gboolean new_data;
+	gboolean fast;
+
+	gboolean scale; /**< rt_tile_render_scale() has work to do */
+	gboolean draw;  /**< it->pixbuf has new contents for it->surface */
+	GdkPixbuf *spare; /**< the right eye of an anaglyph */
+	GdkPixbuf *alpha; /**< the scaled image to composite, for images with alpha */
+	std::vector<SourceTileScale> source_tiles;
+};
+
+struct MipLevelsBuild;
+
 struct OverlayData
 {
 	gint id;
@@ -128,8 +175,8 @@ struct RendererTiles
 
 	gint tile_width;
 	gint tile_height;
-	GList *tiles;		/* list of buffer tiles */
-	gint tile_cache_size;	/* allocated size of pixmaps/pixbufs */
+	TileGrid<ImageTile> *tiles;	/* buffer tiles */
+	gsize tile_cache_size;	/* bytes of the buffer tiles */
 	GList *draw_queue;	/* list of areas to redraw */
 	GList *draw_queue_2pass;/* list when 2 pass is enabled */
 
@@ -139,7 +186,7 @@ struct RendererTiles
 
 	guint draw_idle_id; /* event source id */
 
-	GdkPixbuf *spare_tile;
+	GList *spare_tiles; /* tile sized buffers, RGB and RGBA, for the tiles rendered at a time */
 
 	gint stereo_mode;
 	gint stereo_off_x;
@@ -149,6 +196,28 @@ struct RendererTiles
 	gint y_scroll;
 
 	gint hidpi_scale;
+
+	GdkPixbuf *mip_pixbuf;	/* the pixbuf of the mip levels, set while they are built */
+	GPtrArray *mip_levels;	/* mip_pixbuf at 1/2^(mip_first + 1), 1/2^(mip_first + 2), ... of its size */
+	guint mip_first;	/* the number of halvings left out of mip_levels */
+	MipLevelsBuild *mip_build;
+};
+
+/* levels down to 1/256 */
+constexpr guint MIP_LEVELS_MAX = 8;
+/* the smallest level has at least this width and height */
+constexpr gint MIP_LEVEL_MIN_SIZE = 64;
+
+/**
+ * @brief The background build of the mip levels of RendererTiles
+ */
+struct MipLevelsBuild
+{
+	RendererTiles *rt; /**< nullptr once the levels are no longer wanted */
+	GdkPixbuf *pixbuf;
+	GCancellable *cancellable;
+	gsize budget; /**< bytes the kept levels may use */
+	guint first; /**< set by the thread, the number of halvings left out */
 };
 
 constexpr size_t COLOR_BYTES = 3; /* rgb */
@@ -282,6 +351,8 @@ ImageTile *rt_tile_new(gint x, gint y, gint width, gint height)
 
 	it->render_done = TileRender::NONE;
 
+	it->size = sizeof(ImageTile);
+
 	return it;
 }
 
@@ -297,8 +368,11 @@ void rt_tile_free(ImageTile *it)
 
 void rt_tile_free_all(RendererTiles *rt)
 {
-	g_list_free_full(rt->tiles, reinterpret_cast<GDestroyNotify>(rt_tile_free));
-	rt->tiles = nullptr;
+	while (ImageTile *it = rt->tiles->last())
+		{
+		rt->tiles->remove(it);
+		rt_tile_free(it);
+		}
 	rt->tile_cache_size = 0;
 }
 
@@ -312,7 +386,7 @@ ImageTile *rt_tile_add(RendererTiles *rt, gint x, gint y)
 	if (it->x + it->w > pr->width) it->w = pr->width - it->x;
 	if (it->y + it->h > pr->height) it->h = pr->height - it->y;
 
-	rt->tiles = g_list_prepend(rt->tiles, it);
+	rt->tiles->insert(it);
 	rt->tile_cache_size += it->size;
 
 	return it;
@@ -338,57 +412,70 @@ void rt_tile_remove(RendererTiles *rt, ImageTile *it)
 		g_free(qd);
 		}
 
-	rt->tiles = g_list_remove(rt->tiles, it);
+	rt->tiles->remove(it);
 	rt->tile_cache_size -= it->size;
 
 	rt_tile_free(it);
 }
 
-void rt_tile_free_space(RendererTiles *rt, guint space, ImageTile *it)
+/* The bytes of the surface of a tile */
+gsize rt_tile_surface_size(const RendererTiles *rt)
+{
+	const gint width = rt->hidpi_scale * rt->tile_width;
+	const gint height = rt->hidpi_scale * rt->tile_height;
+
+	return static_cast<gsize>(cairo_format_stride_for_width(CAIRO_FORMAT_RGB24, width)) * height;
+}
+
+/* The bytes of the pixbuf of a tile, as allocated by gdk_pixbuf_new() */
+gsize rt_tile_pixbuf_size(const RendererTiles *rt)
+{
+	const gint width = rt->hidpi_scale * rt->tile_width;
+	const gint height = rt->hidpi_scale * rt->tile_height;
+	const gsize rowstride = (width * COLOR_BYTES + 3) & ~static_cast<gsize>(3);
+
+	return rowstride * (height - 1) + width * COLOR_BYTES;
+}
+
+/**
+ * @brief Frees the least recently used tiles until space more bytes fit in the cache
+ * @param it A tile that must not be freed
+ *
+ * The cache always has room for the tiles of the view.
+ */
+void rt_tile_free_space(RendererTiles *rt, gsize space, ImageTile *it)
 {
 	PixbufRenderer *pr = rt->pr;
-	GList *work;
-	guint tile_max;
 
-	work = g_list_last(rt->tiles);
+	/* an unaligned view spans one more tile */
+	const gsize visible_tiles = (pr->vis_width / rt->tile_width + 2) * (pr->vis_height / rt->tile_height + 2);
+	const gsize visible_size = visible_tiles * (sizeof(ImageTile) + rt_tile_surface_size(rt) + rt_tile_pixbuf_size(rt));
 
+	gsize tile_max = static_cast<gsize>(rt->tile_cache_max) * 1048576;
 	if (pr->source_tiles_enabled && pr->scale < 1.0)
 		{
-		gint tiles;
-
-		tiles = (pr->vis_width / rt->tile_width + 1) * (pr->vis_height / rt->tile_height + 1);
-		tile_max = std::max<gint>(tiles * rt->tile_width * rt->tile_height * 3,
-		                          rt->tile_cache_max * 1048576.0 * pr->scale);
-		}
-	else
-		{
-		tile_max = rt->tile_cache_max * 1048576;
+		tile_max *= pr->scale;
 		}
+	tile_max = std::max(tile_max, visible_size);
 
-	while (work && rt->tile_cache_size + space > tile_max)
+	ImageTile *needle = rt->tiles->last();
+	while (needle && rt->tile_cache_size + space > tile_max)
 		{
-		ImageTile *needle;
+		ImageTile *prev = needle->lru_prev;
 
-		needle = static_cast<ImageTile *>(work->data);
-		work = work->prev;
-		if (needle != it &&
+		if (needle != it && !needle->locked &&
 		    ((!needle->qd && !needle->qd2) || !rt_tile_is_visible(rt, needle))) rt_tile_remove(rt, needle);
+
+		needle = prev;
 		}
 }
 
 void rt_tile_invalidate_all(RendererTiles *rt)
 {
 	PixbufRenderer *pr = rt->pr;
-	GList *work;
 
-	work = rt->tiles;
-	while (work)
+	for (ImageTile *it = rt->tiles->first(); it; it = it->lru_next)
 		{
-		ImageTile *it;
-
-		it = static_cast<ImageTile *>(work->data);
-		work = work->next;
-
 		it->render_done = TileRender::NONE;
 		it->render_todo = TileRender::ALL;
 		it->blank = FALSE;
@@ -400,22 +487,11 @@ void rt_tile_invalidate_all(RendererTiles *rt)
 
 ImageTile *rt_tile_get(RendererTiles *rt, gint x, gint y, gboolean only_existing)
 {
-	GList *work;
-
-	work = rt->tiles;
-	while (work)
+	ImageTile *it = rt->tiles->find(x, y);
+	if (it)
 		{
-		ImageTile *it;
-
-		it = static_cast<ImageTile *>(work->data);
-		if (it->x == x && it->y == y)
-			{
-			rt->tiles = g_list_delete_link(rt->tiles, work);
-			rt->tiles = g_list_prepend(rt->tiles, it);
-			return it;
-			}
-
-		work = work->next;
+		rt->tiles->touch(it);
+		return it;
 		}
 
 	if (only_existing) return nullptr;
@@ -423,16 +499,11 @@ ImageTile *rt_tile_get(RendererTiles *rt, gint x, gint y, gboolean only_existing
 	return rt_tile_add(rt, x, y);
 }
 
-gint pixmap_calc_size()
-{
-	return options->image.tile_size * options->image.tile_size * 4 / 8;
-}
-
 void rt_tile_prepare(RendererTiles *rt, ImageTile *it)
 {
 	if (!it->surface)
 		{
-		const guint size = pixmap_calc_size() * rt->hidpi_scale * rt->hidpi_scale;
+		const gsize size = rt_tile_surface_size(rt);
 
 		rt_tile_free_space(rt, size, it);
 
@@ -447,10 +518,10 @@ void rt_tile_prepare(RendererTiles *rt, ImageTile *it)
 	if (!it->pixbuf)
 		{
 		GdkPixbuf *pixbuf;
-		guint size;
+		gsize size;
 		pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, rt->hidpi_scale * rt->tile_width, rt->hidpi_scale * rt->tile_height);
 
-		size = gdk_pixbuf_get_rowstride(pixbuf) * rt->tile_height * rt->hidpi_scale;
+		size = gdk_pixbuf_get_byte_length(pixbuf);
 		rt_tile_free_space(rt, size, it);
 
 		it->pixbuf = pixbuf;
@@ -758,289 +829,231 @@ void rt_hierarchy_changed_cb(GtkWidget *, GtkWidget *, gpointer data)
 
 /*
  *-------------------------------------------------------------------
- * drawing
+ * mip levels
  *-------------------------------------------------------------------
  */
 
-GdkPixbuf *rt_get_spare_tile(RendererTiles *rt)
+void mip_levels_build_free(gpointer data)
 {
-	if (!rt->spare_tile) rt->spare_tile = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, rt->tile_width * rt->hidpi_scale, rt->tile_height * rt->hidpi_scale);
-	return rt->spare_tile;
+	auto *build = static_cast<MipLevelsBuild *>(data);
+
+	g_object_unref(build->pixbuf);
+	g_object_unref(build->cancellable);
+	delete build;
 }
 
-void rt_tile_rotate_90_clockwise(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+/**
+ * @brief The number of the largest levels left out, so that the others fit into \a budget
+ * @param[out] count The number of levels of \a pixbuf, including those left out
+ */
+guint mip_levels_first(const GdkPixbuf *pixbuf, gsize budget, guint &count)
 {
-	GdkPixbuf *src = *tile;
-	GdkPixbuf *dest;
-	gint srs;
-	gint drs;
-	guchar *s_pix;
-	guchar *d_pix;
-	guchar *sp;
-	guchar *dp;
-	guchar *ip;
-	guchar *spi;
-	guchar *dpi;
-	gint i;
-	gint j;
-	gint tw = rt->tile_width * rt->hidpi_scale;
-
-	srs = gdk_pixbuf_get_rowstride(src);
-	s_pix = gdk_pixbuf_get_pixels(src);
-	spi = s_pix + (x * COLOR_BYTES);
+	const gsize channels = gdk_pixbuf_get_has_alpha(pixbuf) ? 4 : 3;
+	gint width = gdk_pixbuf_get_width(pixbuf);
+	gint height = gdk_pixbuf_get_height(pixbuf);
+	std::vector<gsize> sizes;
 
-	dest = rt_get_spare_tile(rt);
-	drs = gdk_pixbuf_get_rowstride(dest);
-	d_pix = gdk_pixbuf_get_pixels(dest);
-	dpi = d_pix + ((tw - 1) * COLOR_BYTES);
+	while (sizes.size() < MIP_LEVELS_MAX && width >= 2 * MIP_LEVEL_MIN_SIZE && height >= 2 * MIP_LEVEL_MIN_SIZE)
+		{
+		width = (width + 1) / 2;
+		height = (height + 1) / 2;
+		sizes.push_back(static_cast<gsize>(width) * height * channels);
+		}
 
-	for (i = y; i < y + h; i++)
+	/* keep the smallest levels that fit */
+	gsize total = 0;
+	guint first = sizes.size();
+	count = sizes.size();
+	while (first > 0 && total + sizes[first - 1] <= budget)
 		{
-		sp = spi + (i * srs);
-		ip = dpi - (i * COLOR_BYTES);
-		for (j = x; j < x + w; j++)
-			{
-			dp = ip + (j * drs);
-			memcpy(dp, sp, COLOR_BYTES);
-			sp += COLOR_BYTES;
-			}
+		first--;
+		total += sizes[first];
 		}
 
-	rt->spare_tile = src;
-	*tile = dest;
+	return first;
 }
 
-void rt_tile_rotate_90_counter_clockwise(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+void rt_mip_levels_build_thread(GTask *task, gpointer, gpointer task_data, GCancellable *cancellable)
 {
-	GdkPixbuf *src = *tile;
-	GdkPixbuf *dest;
-	gint srs;
-	gint drs;
-	guchar *s_pix;
-	guchar *d_pix;
-	guchar *sp;
-	guchar *dp;
-	guchar *ip;
-	guchar *spi;
-	guchar *dpi;
-	gint i;
-	gint j;
-	gint th = rt->tile_height * rt->hidpi_scale;
+	auto *build = static_cast<MipLevelsBuild *>(task_data);
+	GPtrArray *levels = g_ptr_array_new_with_free_func(g_object_unref);
+	const GdkPixbuf *level = build->pixbuf;
+	GdkPixbuf *skipped = nullptr;
+	guint count;
 
-	srs = gdk_pixbuf_get_rowstride(src);
-	s_pix = gdk_pixbuf_get_pixels(src);
-	spi = s_pix + (x * COLOR_BYTES);
+	build->first = mip_levels_first(build->pixbuf, build->budget, count);
+	if (build->first == count) count = 0;
 
-	dest = rt_get_spare_tile(rt);
-	drs = gdk_pixbuf_get_rowstride(dest);
-	d_pix = gdk_pixbuf_get_pixels(dest);
-	dpi = d_pix + ((th - 1) * drs);
-
-	for (i = y; i < y + h; i++)
+	for (guint i = 0; i < count && !g_cancellable_is_cancelled(cancellable); i++)
 		{
-		sp = spi + (i * srs);
-		ip = dpi + (i * COLOR_BYTES);
-		for (j = x; j < x + w; j++)
+		GdkPixbuf *half = pixbuf_half_size(level);
+
+		/* a level left out only lives until the next one is made from it */
+		if (skipped) g_object_unref(skipped);
+		skipped = nullptr;
+		if (i < build->first)
 			{
-			dp = ip - (j * drs);
-			memcpy(dp, sp, COLOR_BYTES);
-			sp += COLOR_BYTES;
+			skipped = half;
 			}
+		else
+			{
+			g_ptr_array_add(levels, half);
+			}
+
+		level = half;
 		}
+	if (skipped) g_object_unref(skipped);
 
-	rt->spare_tile = src;
-	*tile = dest;
+	if (g_task_return_error_if_cancelled(task))
+		{
+		g_ptr_array_unref(levels);
+		return;
+		}
+
+	g_task_return_pointer(task, levels, reinterpret_cast<GDestroyNotify>(g_ptr_array_unref));
 }
 
-void rt_tile_mirror_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+void rt_mip_levels_done_cb(GObject *, GAsyncResult *result, gpointer)
 {
-	GdkPixbuf *src = *tile;
-	GdkPixbuf *dest;
-	gint srs;
-	gint drs;
-	guchar *s_pix;
-	guchar *d_pix;
-	guchar *sp;
-	guchar *dp;
-	guchar *spi;
-	guchar *dpi;
-	gint i;
-	gint j;
+	GTask *task = G_TASK(result);
+	auto *build = static_cast<MipLevelsBuild *>(g_task_get_task_data(task));
+	auto *levels = static_cast<GPtrArray *>(g_task_propagate_pointer(task, nullptr));
 
-	gint tw = rt->tile_width * rt->hidpi_scale;
+	RendererTiles *rt = build->rt;
+	if (!rt)
+		{
+		if (levels) g_ptr_array_unref(levels);
+		return;
+		}
 
-	srs = gdk_pixbuf_get_rowstride(src);
-	s_pix = gdk_pixbuf_get_pixels(src);
-	spi = s_pix + (x * COLOR_BYTES);
+	DEBUG_1("mip levels: %u, %u left out", levels ? levels->len : 0, build->first);
 
-	dest = rt_get_spare_tile(rt);
-	drs = gdk_pixbuf_get_rowstride(dest);
-	d_pix = gdk_pixbuf_get_pixels(dest);
-	dpi =  d_pix + ((tw - x - 1) * COLOR_BYTES);
+	build->rt = nullptr;
+	rt->mip_build = nullptr;
+	rt->mip_levels = levels;
+	rt->mip_first = build->first;
+}
 
-	for (i = y; i < y + h; i++)
+void rt_mip_levels_clear(RendererTiles *rt)
+{
+	if (rt->mip_build)
 		{
-		sp = spi + (i * srs);
-		dp = dpi + (i * drs);
-		for (j = 0; j < w; j++)
-			{
-			memcpy(dp, sp, COLOR_BYTES);
-			sp += COLOR_BYTES;
-			dp -= COLOR_BYTES;
-			}
+		rt->mip_build->rt = nullptr;
+		g_cancellable_cancel(rt->mip_build->cancellable);
+		rt->mip_build = nullptr;
 		}
 
-	rt->spare_tile = src;
-	*tile = dest;
+	g_clear_pointer(&rt->mip_levels, g_ptr_array_unref);
+	g_clear_object(&rt->mip_pixbuf);
+	rt->mip_first = 0;
 }
 
-void rt_tile_mirror_and_flip(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+/**
+ * @brief Starts building the mip levels of the image in the background, unless done already
+ *
+ * The levels are only built for a complete image, and dropped when it changes.
+ * Together they use at most the size of the decoded image cache, the largest
+ * levels are left out when they do not fit.
+ */
+void rt_mip_levels_request(RendererTiles *rt)
 {
-	GdkPixbuf *src = *tile;
-	GdkPixbuf *dest;
-	gint srs;
-	gint drs;
-	guchar *s_pix;
-	guchar *d_pix;
-	guchar *sp;
-	guchar *dp;
-	guchar *dpi;
-	gint i;
-	gint j;
-	gint tw = rt->tile_width * rt->hidpi_scale;
-	gint th = rt->tile_height * rt->hidpi_scale;
+	PixbufRenderer *pr = rt->pr;
 
-	srs = gdk_pixbuf_get_rowstride(src);
-	s_pix = gdk_pixbuf_get_pixels(src);
+	if (pr->loading || !pr->pixbuf || rt->mip_pixbuf == pr->pixbuf) return;
 
-	dest = rt_get_spare_tile(rt);
-	drs = gdk_pixbuf_get_rowstride(dest);
-	d_pix = gdk_pixbuf_get_pixels(dest);
-	dpi = d_pix + ((th - 1) * drs) + ((tw - 1) * COLOR_BYTES);
+	rt_mip_levels_clear(rt);
 
-	for (i = y; i < y + h; i++)
-		{
-		sp = s_pix + (i * srs) + (x * COLOR_BYTES);
-		dp = dpi - (i * drs) - (x * COLOR_BYTES);
-		for (j = 0; j < w; j++)
-			{
-			memcpy(dp, sp, COLOR_BYTES);
-			sp += COLOR_BYTES;
-			dp -= COLOR_BYTES;
-			}
-		}
+	rt->mip_pixbuf = static_cast<GdkPixbuf *>(g_object_ref(pr->pixbuf));
+	rt->mip_build = new MipLevelsBuild{rt, static_cast<GdkPixbuf *>(g_object_ref(pr->pixbuf)), g_cancellable_new(),
+	                                   static_cast<gsize>(std::max(options->image.image_cache_max, 0)) * 1048576, 0};
 
-	rt->spare_tile = src;
-	*tile = dest;
+	GTask *task = g_task_new(nullptr, rt->mip_build->cancellable, rt_mip_levels_done_cb, nullptr);
+	g_task_set_task_data(task, rt->mip_build, mip_levels_build_free);
+	g_task_run_in_thread(task, rt_mip_levels_build_thread);
+	g_object_unref(task);
 }
 
-void rt_tile_flip_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+/**
+ * @brief The smallest mip level of the image with the detail for a scale
+ * @param[in,out] scale_x,scale_y The scale from pr->pixbuf, changed to the scale from the level
+ * @returns The level, or pr->pixbuf if there is none
+ *
+ * Scaling from the level gives the same size as scaling from pr->pixbuf. The
+ * scale changes by the exact power of 2 of the level: a level of an odd size
+ * ends half a pixel beyond the image, which is never sampled, and the scaler
+ * clamps at the edges.
+ */
+const GdkPixbuf *rt_mip_level_get(const RendererTiles *rt, gdouble &scale_x, gdouble &scale_y)
 {
-	GdkPixbuf *src = *tile;
-	GdkPixbuf *dest;
-	gint srs;
-	gint drs;
-	guchar *s_pix;
-	guchar *d_pix;
-	guchar *sp;
-	guchar *dp;
-	guchar *spi;
-	guchar *dpi;
-	gint i;
-	gint th = rt->tile_height * rt->hidpi_scale;
+	const PixbufRenderer *pr = rt->pr;
 
-	srs = gdk_pixbuf_get_rowstride(src);
-	s_pix = gdk_pixbuf_get_pixels(src);
-	spi = s_pix + (x * COLOR_BYTES);
+	if (!rt->mip_levels || rt->mip_pixbuf != pr->pixbuf) return pr->pixbuf;
 
-	dest = rt_get_spare_tile(rt);
-	drs = gdk_pixbuf_get_rowstride(dest);
-	d_pix = gdk_pixbuf_get_pixels(dest);
-	dpi = d_pix + ((th - 1) * drs) + (x * COLOR_BYTES);
+	const gdouble scale = std::max(scale_x, scale_y);
+	const GdkPixbuf *level = pr->pixbuf;
+	gdouble factor = 1.0;
 
-	for (i = y; i < y + h; i++)
+	/* halving i is at 1 / 2^(i + 1), the first mip_first are left out */
+	for (guint i = 0; i < rt->mip_first + rt->mip_levels->len && scale * (2 << i) <= 1.0; i++)
 		{
-		sp = spi + (i * srs);
-		dp = dpi - (i * drs);
-		memcpy(dp, sp, w * COLOR_BYTES);
+		if (i < rt->mip_first) continue;
+
+		level = static_cast<const GdkPixbuf *>(g_ptr_array_index(rt->mip_levels, i - rt->mip_first));
+		factor = 2 << i;
 		}
 
-	rt->spare_tile = src;
-	*tile = dest;
+	scale_x *= factor;
+	scale_y *= factor;
+
+	return level;
 }
 
-void rt_tile_apply_orientation(RendererTiles *rt, gint orientation, GdkPixbuf **pixbuf, gint x, gint y, gint w, gint h)
+/*
+ *-------------------------------------------------------------------
+ * drawing
+ *-------------------------------------------------------------------
+ */
+
+GdkPixbuf *rt_spare_tile_get(RendererTiles *rt, gboolean has_alpha)
 {
-	switch (orientation)
+	for (GList *work = rt->spare_tiles; work; work = work->next)
 		{
-		case EXIF_ORIENTATION_TOP_LEFT:
-			/* normal -- nothing to do */
-			break;
-		case EXIF_ORIENTATION_TOP_RIGHT:
-			/* mirrored */
-			{
-				rt_tile_mirror_only(rt, pixbuf, x, y, w, h);
-			}
-			break;
-		case EXIF_ORIENTATION_BOTTOM_RIGHT:
-			/* upside down */
-			{
-				rt_tile_mirror_and_flip(rt, pixbuf, x, y, w, h);
-			}
-			break;
-		case EXIF_ORIENTATION_BOTTOM_LEFT:
-			/* flipped */
-			{
-				rt_tile_flip_only(rt, pixbuf, x, y, w, h);
-			}
-			break;
-		case EXIF_ORIENTATION_LEFT_TOP:
-			{
-				rt_tile_flip_only(rt, pixbuf, x, y, w, h);
-				rt_tile_rotate_90_clockwise(rt, pixbuf, x, rt->tile_height - y - h, w, h);
-			}
-			break;
-		case EXIF_ORIENTATION_RIGHT_TOP:
-			/* rotated -90 (270) */
-			{
-				rt_tile_rotate_90_clockwise(rt, pixbuf, x, y, w, h);
-			}
-			break;
-		case EXIF_ORIENTATION_RIGHT_BOTTOM:
-			{
-				rt_tile_flip_only(rt, pixbuf, x, y, w, h);
-				rt_tile_rotate_90_counter_clockwise(rt, pixbuf, x, rt->tile_height - y - h, w, h);
-			}
-			break;
-		case EXIF_ORIENTATION_LEFT_BOTTOM:
-			/* rotated 90 */
-			{
-				rt_tile_rotate_90_counter_clockwise(rt, pixbuf, x, y, w, h);
-			}
-			break;
-		default:
-			/* The other values are out of range */
-			break;
+		auto *pixbuf = static_cast<GdkPixbuf *>(work->data);
+
+		if (gdk_pixbuf_get_has_alpha(pixbuf) != has_alpha) continue;
+
+		rt->spare_tiles = g_list_delete_link(rt->spare_tiles, work);
+		return pixbuf;
 		}
+
+	return gdk_pixbuf_new(GDK_COLORSPACE_RGB, has_alpha, 8, rt->tile_width * rt->hidpi_scale, rt->tile_height * rt->hidpi_scale);
+}
+
+void rt_spare_tile_put(RendererTiles *rt, GdkPixbuf *pixbuf)
+{
+	rt->spare_tiles = g_list_prepend(rt->spare_tiles, pixbuf);
 }
 
 /**
- * @brief Renders the contents of the specified region of the specified ImageTile, using
+ * @brief Sets up the rendering of the specified region of the specified ImageTile, using
  *        SourceTiles that the RendererTiles knows how to create/access.
  * @param rt The RendererTiles object.
- * @param it The ImageTile to render.
- * @param x,y,w,h The sub-region of the ImageTile to render.
- * @retval TRUE We rendered something that needs to be drawn.
- * @retval FALSE We didn't render anything that needs to be drawn.
+ * @param job The ImageTile and its sub-region to render.
+ *
+ * This runs on the main thread, as it may create SourceTiles.  The scaling
+ * itself is left to rt_source_tile_render_scale(), which only uses the
+ * references of the SourceTile pixbufs added to job.source_tiles.
  */
-gboolean rt_source_tile_render(RendererTiles *rt, ImageTile *it,
-                               gint x, gint y, gint w, gint h,
-                               gboolean, gboolean)
+void rt_source_tile_render_prepare(RendererTiles *rt, TileRenderJob &job)
 {
 	PixbufRenderer *pr = rt->pr;
-	gboolean draw = FALSE;
+	ImageTile *it = job.it;
+	const gint x = job.area.x;
+	const gint y = job.area.y;
+	const gint w = job.area.width;
+	const gint h = job.area.height;
 
-	if (pr->image_width == 0 || pr->image_height == 0) return FALSE;
+	if (pr->image_width == 0 || pr->image_height == 0) return;
 
 	// This is the scale due to zooming.  So if the user is zoomed in 2x (we're
 	// rendering twice as large), these numbers will be 2.  Note that these values
@@ -1058,7 +1071,7 @@ gboolean rt_source_tile_render(RendererTiles *rt, ImageTile *it,
 	 * small sizes for anything but GDK_INTERP_NEAREST
 	 */
 	const gboolean force_nearest = pr->width < PR_MIN_SCALE_SIZE || pr->height < PR_MIN_SCALE_SIZE;
-	GdkInterpType interp_type = force_nearest ? GDK_INTERP_NEAREST : pr->zoom_quality;
+	const GdkInterpType interp_type = force_nearest ? GDK_INTERP_NEAREST : pr->zoom_quality;
 
 #if 0
 	// Draws red over draw region, to check for leaks (regions not filled)
@@ -1140,19 +1153,41 @@ gboolean rt_source_tile_render(RendererTiles *rt, ImageTile *it,
 				// coordinates are not necessarily aligned, an offset will be negative if this
 				// SourceTile starts left of or above the ImageTile, positive if it starts in
 				// the middle of the ImageTile, or zero if the left or top edges are aligned.
-				gdk_pixbuf_scale(st->pixbuf, it->pixbuf,
-				                 r.x - it->x, r.y - it->y, rt->hidpi_scale * r.width, rt->hidpi_scale * r.height,
-				                 offset_x, offset_y,
-				                 rt->hidpi_scale * scale_x, rt->hidpi_scale * scale_y,
-				                 interp_type);
-				draw = TRUE;
+				//
+				// The SourceTile may be freed by the setup of another ImageTile before
+				// the scaling is done, so its pixbuf is referenced until then.
+				job.source_tiles.push_back({static_cast<GdkPixbuf *>(g_object_ref(st->pixbuf)),
+				                            {r.x - it->x, r.y - it->y, rt->hidpi_scale * r.width, rt->hidpi_scale * r.height},
+				                            offset_x, offset_y,
+				                            rt->hidpi_scale * scale_x, rt->hidpi_scale * scale_y,
+				                            interp_type});
+				job.scale = TRUE;
 				}
 			}
 		}
 
 	g_list_free(list);
+}
+
+/**
+ * @brief Scales the SourceTiles set up by rt_source_tile_render_prepare() into the ImageTile
+ * @retval TRUE We rendered something that needs to be drawn.
+ * @retval FALSE We didn't render anything that needs to be drawn.
+ *
+ * This may run in any thread.
+ */
+gboolean rt_source_tile_render_scale(const TileRenderJob &job)
+{
+	for (const SourceTileScale &sts : job.source_tiles)
+		{
+		pixbuf_scale(sts.pixbuf, job.it->pixbuf,
+		             sts.dest.x, sts.dest.y, sts.dest.width, sts.dest.height,
+		             sts.offset_x, sts.offset_y,
+		             sts.scale_x, sts.scale_y,
+		             sts.interp_type);
+		}
 
-	return draw;
+	return !job.source_tiles.empty();
 }
 
 /**
@@ -1161,6 +1196,7 @@ gboolean rt_source_tile_render(RendererTiles *rt, ImageTile *it,
  * @param ignore_alpha
  * @param src
  * @param dest
+ * @param alpha A buffer the size of dest with alpha, for has_alpha
  * @param pb_rect
  * @param offset_x
  * @param offset_y
@@ -1172,17 +1208,20 @@ gboolean rt_source_tile_render(RendererTiles *rt, ImageTile *it,
  * @param wide_image Used as a work-around for a GdkPixbuf problem. Set when image width is > 32767.
  *        Problem exhibited with gdk_pixbuf_copy_area() and GDK_INTERP_NEAREST.
  *        See https://github.com/BestImageViewer/geeqie/issues/772
+ * @param orientation Applied by the scaler, see pixbuf_scale()
  */
 void rt_tile_get_region(gboolean has_alpha, gboolean ignore_alpha,
-                        const GdkPixbuf *src, GdkPixbuf *dest,
+                        const GdkPixbuf *src, GdkPixbuf *dest, GdkPixbuf *alpha,
                         GdkRectangle pb_rect,
                         double offset_x, double offset_y, double scale_x, double scale_y,
                         GdkInterpType interp_type,
-                        int check_x, int check_y, gboolean wide_image)
+                        int check_x, int check_y, gboolean wide_image, gint orientation)
 {
+	if (scale_x == 1.0 && scale_y == 1.0) interp_type = GDK_INTERP_NEAREST;
+
 	if (!has_alpha)
 		{
-		if (scale_x == 1.0 && scale_y == 1.0)
+		if (scale_x == 1.0 && scale_y == 1.0 && orientation == EXIF_ORIENTATION_TOP_LEFT)
 			{
 			if (wide_image)
 				{
@@ -1215,11 +1254,11 @@ void rt_tile_get_region(gboolean has_alpha, gboolean ignore_alpha,
 			}
 		else
 			{
-			gdk_pixbuf_scale(src, dest,
-			                 pb_rect.x, pb_rect.y, pb_rect.width, pb_rect.height,
-			                 offset_x, offset_y,
-			                 scale_x, scale_y,
-			                 (wide_image && interp_type == GDK_INTERP_NEAREST) ? GDK_INTERP_TILES : interp_type);
+			pixbuf_scale(src, dest,
+			             pb_rect.x, pb_rect.y, pb_rect.width, pb_rect.height,
+			             offset_x, offset_y,
+			             scale_x, scale_y,
+			             interp_type, orientation);
 			}
 		}
 	else
@@ -1232,8 +1271,6 @@ void rt_tile_get_region(gboolean has_alpha, gboolean ignore_alpha,
 			return red + green + blue;
 		};
 
-		if (scale_x == 1.0 && scale_y == 1.0) interp_type = GDK_INTERP_NEAREST;
-
 		g_autoptr(GdkPixbuf) tmppixbuf = nullptr;
 
 		if (ignore_alpha)
@@ -1244,11 +1281,17 @@ void rt_tile_get_region(gboolean has_alpha, gboolean ignore_alpha,
 			src = tmppixbuf;
 			}
 
-		gdk_pixbuf_composite_color(src, dest,
+		/* scale and orient as the image without alpha, then composite the area 1:1 */
+		pixbuf_scale(src, alpha,
+		             pb_rect.x, pb_rect.y, pb_rect.width, pb_rect.height,
+		             offset_x, offset_y,
+		             scale_x, scale_y,
+		             interp_type, orientation);
+
+		gdk_pixbuf_composite_color(alpha, dest,
 		                           pb_rect.x, pb_rect.y, pb_rect.width, pb_rect.height,
-		                           offset_x, offset_y,
-		                           scale_x, scale_y,
-		                           (wide_image && interp_type == GDK_INTERP_NEAREST) ? GDK_INTERP_TILES : interp_type,
+		                           0.0, 0.0, 1.0, 1.0,
+		                           GDK_INTERP_NEAREST,
 		                           255, check_x, check_y,
 		                           PR_ALPHA_CHECK_SIZE,
 		                           convert_alpha_color(options->image.alpha_color_1),
@@ -1256,7 +1299,6 @@ void rt_tile_get_region(gboolean has_alpha, gboolean ignore_alpha,
 		}
 }
 
-
 gint rt_get_orientation(RendererTiles *rt)
 {
 	PixbufRenderer *pr = rt->pr;
@@ -1271,38 +1313,35 @@ gint rt_get_orientation(RendererTiles *rt)
 }
 
 
-void rt_tile_render(RendererTiles *rt, ImageTile *it,
-                    gint x, gint y, gint w, gint h,
-                    gboolean new_data, gboolean fast)
+/**
+ * @brief Sets up the rendering of an area of a tile, on the main thread
+ *
+ * Decides what is left to render of the tile and prepares its buffers.
+ * The scaling is left to rt_tile_render_scale() if job.scale is set.
+ */
+void rt_tile_render_prepare(RendererTiles *rt, TileRenderJob &job)
 {
 	PixbufRenderer *pr = rt->pr;
-	gboolean has_alpha;
-	gboolean draw = FALSE;
-	gint orientation = rt_get_orientation(rt);
-	gboolean wide_image = FALSE;
+	ImageTile *it = job.it;
 
-	if (it->render_todo == TileRender::NONE && it->surface && !new_data) return;
+	if (it->render_todo == TileRender::NONE && it->surface && !job.new_data) return;
 
 	if (it->render_done != TileRender::ALL)
 		{
-		x = 0;
-		y = 0;
-		w = it->w;
-		h = it->h;
-		if (!fast) it->render_done = TileRender::ALL;
+		job.area = {0, 0, it->w, it->h};
+		if (!job.fast) it->render_done = TileRender::ALL;
 		}
 	else if (it->render_todo != TileRender::AREA)
 		{
-		if (!fast) it->render_todo = TileRender::NONE;
+		if (!job.fast) it->render_todo = TileRender::NONE;
 		return;
 		}
 
-	if (!fast) it->render_todo = TileRender::NONE;
+	if (!job.fast) it->render_todo = TileRender::NONE;
 
-	if (new_data) it->blank = FALSE;
+	if (job.new_data) it->blank = FALSE;
 
 	rt_tile_prepare(rt, it);
-	has_alpha = (pr->pixbuf && gdk_pixbuf_get_has_alpha(pr->pixbuf));
 
 	/** @FIXME checker colors for alpha should be configurable,
 	 * also should be drawn for blank = TRUE
@@ -1320,84 +1359,125 @@ void rt_tile_render(RendererTiles *rt, ImageTile *it,
 		}
 	else if (pr->source_tiles_enabled)
 		{
-		draw = rt_source_tile_render(rt, it, x, y, w, h, new_data, fast);
+		rt_source_tile_render_prepare(rt, job);
 		}
 	else
 		{
-		gdouble scale_x;
-		gdouble scale_y;
-		gdouble src_x;
-		gdouble src_y;
-
 		if (pr->image_width == 0 || pr->image_height == 0) return;
 
-		scale_x = rt->hidpi_scale * static_cast<gdouble>(pr->width) / pr->image_width;
-		scale_y = rt->hidpi_scale * static_cast<gdouble>(pr->height) / pr->image_height;
+		/* HACK: The pixbuf scalers get kinda buggy(crash) with extremely
+		 * small sizes for anything but GDK_INTERP_NEAREST
+		 */
+		if (pr->width < PR_MIN_SCALE_SIZE || pr->height < PR_MIN_SCALE_SIZE) job.fast = TRUE;
 
-		pr_tile_coords_map_orientation(orientation, it->x, it->y,
-		                               pr->width, pr->height,
-		                               rt->tile_width, rt->tile_height,
-		                               src_x, src_y);
-		GdkRectangle pb_rect = pr_tile_region_map_orientation(orientation,
-		                                                      {x, y, w, h},
-		                                                      rt->tile_width,
-		                                                      rt->tile_height);
+		if (rt->hidpi_scale * pr->scale < 0.5) rt_mip_levels_request(rt);
 
-		src_x *= rt->hidpi_scale;
-		src_y *= rt->hidpi_scale;
-		pr_scale_region(pb_rect, rt->hidpi_scale);
+		if (rt->stereo_mode & PR_STEREO_ANAGLYPH) job.spare = rt_spare_tile_get(rt, FALSE);
+		if (pr->pixbuf && gdk_pixbuf_get_has_alpha(pr->pixbuf)) job.alpha = rt_spare_tile_get(rt, TRUE);
+		job.scale = TRUE;
+		}
+}
 
-		switch (orientation)
-			{
-			case EXIF_ORIENTATION_LEFT_TOP:
-			case EXIF_ORIENTATION_RIGHT_TOP:
-			case EXIF_ORIENTATION_RIGHT_BOTTOM:
-			case EXIF_ORIENTATION_LEFT_BOTTOM:
-				std::swap(scale_x, scale_y);
-				break;
-			default:
-				/* nothing to do */
-				break;
-			}
+/**
+ * @brief Scales the image into the pixbuf of a tile, set up by rt_tile_render_prepare()
+ *
+ * This may run in any thread, it only writes to the job and its tile pixbuf.
+ */
+void rt_tile_render_scale(RendererTiles *rt, TileRenderJob &job)
+{
+	PixbufRenderer *pr = rt->pr;
+	ImageTile *it = job.it;
 
-		/* HACK: The pixbuf scalers get kinda buggy(crash) with extremely
-		 * small sizes for anything but GDK_INTERP_NEAREST
-		 */
-		if (pr->width < PR_MIN_SCALE_SIZE || pr->height < PR_MIN_SCALE_SIZE) fast = TRUE;
-		if (pr->image_width > 32767) wide_image = TRUE;
+	if (pr->source_tiles_enabled)
+		{
+		job.draw = rt_source_tile_render_scale(job);
+		return;
+		}
+
+	/* whether the x and y axes of the screen run backwards through the image */
+	static const gboolean reverse_x[] = {FALSE,   FALSE, TRUE, TRUE, FALSE, FALSE, TRUE, TRUE, FALSE};
+	static const gboolean reverse_y[] = {FALSE,   FALSE, FALSE, TRUE, TRUE, FALSE, FALSE, TRUE, TRUE};
+
+	const gboolean has_alpha = (pr->pixbuf && gdk_pixbuf_get_has_alpha(pr->pixbuf));
+	const gint orientation = rt_get_orientation(rt);
+	const gboolean transposed = (orientation > EXIF_ORIENTATION_BOTTOM_LEFT);
+	gdouble scale_x;
+	gdouble scale_y;
+
+	/* the scale of the axes of the image, which the orientation may swap on the screen */
+	scale_x = rt->hidpi_scale * static_cast<gdouble>(pr->width) / pr->image_width;
+	scale_y = rt->hidpi_scale * static_cast<gdouble>(pr->height) / pr->image_height;
+	if (transposed) std::swap(scale_x, scale_y);
+
+	/* the stereo offsets are in pixels of pr->pixbuf */
+	const gdouble offset_scale = scale_x;
+	const GdkPixbuf *src = rt_mip_level_get(rt, scale_x, scale_y);
+	const gboolean wide_image = gdk_pixbuf_get_width(src) > 32767;
+
+	GdkRectangle pb_rect = job.area;
+	pr_scale_region(pb_rect, rt->hidpi_scale);
+
+	const gdouble tile_x = rt->hidpi_scale * it->x;
+	const gdouble tile_y = rt->hidpi_scale * it->y;
+	const gdouble width = rt->hidpi_scale * pr->width;
+	const gdouble height = rt->hidpi_scale * pr->height;
+
+	/* the scaler orients the image, a reversed axis starts at the far edge of the image */
+	const auto get_region = [&](GdkPixbuf *dest, gint stereo_offset)
+	{
+		gdouble shift_x = 0.0;
+		gdouble shift_y = 0.0;
+
+		/* the stereo offset moves along the x axis of the image */
+		(transposed ? shift_y : shift_x) = stereo_offset * offset_scale;
 
 		rt_tile_get_region(has_alpha, pr->ignore_alpha,
-		                   pr->pixbuf, it->pixbuf, pb_rect,
-		                   static_cast<gdouble>(0.0) - src_x - (get_right_pixbuf_offset(rt) * scale_x),
-		                   static_cast<gdouble>(0.0) - src_y,
+		                   src, dest, job.alpha, pb_rect,
+		                   reverse_x[orientation] ? width - tile_x + shift_x : -tile_x - shift_x,
+		                   reverse_y[orientation] ? height - tile_y + shift_y : -tile_y - shift_y,
 		                   scale_x, scale_y,
-		                   (fast) ? GDK_INTERP_NEAREST : pr->zoom_quality,
-		                   it->x + pb_rect.x, it->y + pb_rect.y, wide_image);
-		if (rt->stereo_mode & PR_STEREO_ANAGLYPH &&
-		    (pr->stereo_pixbuf_offset_right > 0 || pr->stereo_pixbuf_offset_left > 0))
-			{
-			GdkPixbuf *right_pb = rt_get_spare_tile(rt);
-			rt_tile_get_region(has_alpha, pr->ignore_alpha,
-			                   pr->pixbuf, right_pb, pb_rect,
-			                   static_cast<gdouble>(0.0) - src_x - (get_left_pixbuf_offset(rt) * scale_x),
-			                   static_cast<gdouble>(0.0) - src_y,
-			                   scale_x, scale_y,
-			                   (fast) ? GDK_INTERP_NEAREST : pr->zoom_quality,
-			                   it->x + pb_rect.x, it->y + pb_rect.y, wide_image);
-			pr_create_anaglyph(rt->stereo_mode, it->pixbuf, right_pb, pb_rect.x, pb_rect.y, pb_rect.width, pb_rect.height);
-			/* do not care about freeing spare_tile, it will be reused */
-			}
-		rt_tile_apply_orientation(rt, orientation, &it->pixbuf, pb_rect.x, pb_rect.y, pb_rect.width, pb_rect.height);
-		draw = TRUE;
+		                   (job.fast) ? GDK_INTERP_NEAREST : pr->zoom_quality,
+		                   it->x + pb_rect.x, it->y + pb_rect.y, wide_image, orientation);
+	};
+
+	get_region(it->pixbuf, get_right_pixbuf_offset(rt));
+	if (rt->stereo_mode & PR_STEREO_ANAGLYPH &&
+	    (pr->stereo_pixbuf_offset_right > 0 || pr->stereo_pixbuf_offset_left > 0))
+		{
+		get_region(job.spare, get_left_pixbuf_offset(rt));
+		pr_create_anaglyph(rt->stereo_mode, it->pixbuf, job.spare, pb_rect.x, pb_rect.y, pb_rect.width, pb_rect.height);
+		}
+	job.draw = TRUE;
+}
+
+/**
+ * @brief Copies the rendered area of a tile to its surface, on the main thread
+ */
+void rt_tile_render_commit(RendererTiles *rt, TileRenderJob &job)
+{
+	PixbufRenderer *pr = rt->pr;
+	ImageTile *it = job.it;
+
+	if (job.spare) rt_spare_tile_put(rt, job.spare);
+	if (job.alpha) rt_spare_tile_put(rt, job.alpha);
+	job.spare = nullptr;
+	job.alpha = nullptr;
+
+	for (SourceTileScale &sts : job.source_tiles)
+		{
+		g_object_unref(sts.pixbuf);
 		}
+	job.source_tiles.clear();
 
-	if (draw && it->pixbuf && !it->blank)
+	if (job.draw && it->pixbuf && !it->blank)
 		{
-		if (pr->func_post_process && (!pr->post_process_slow || !fast))
-			pr->func_post_process(pr, &it->pixbuf, x, y, w, h);
+		const GdkRectangle &area = job.area;
+
+		if (pr->func_post_process && (!pr->post_process_slow || !job.fast))
+			pr->func_post_process(pr, &it->pixbuf, area.x, area.y, area.width, area.height);
 
 		cairo_t *cr = cairo_create(it->surface);
-		cairo_rectangle (cr, x, y, w, h);
+		cairo_rectangle (cr, area.x, area.y, area.width, area.height);
 
 		cairo_surface_t *surface = gdk_cairo_surface_create_from_pixbuf(it->pixbuf, rt->hidpi_scale, nullptr);
 		cairo_set_source_surface(cr, surface, 0, 0);
@@ -1409,12 +1489,18 @@ void rt_tile_render(RendererTiles *rt, ImageTile *it,
 }
 
 
-void rt_tile_expose(RendererTiles *rt, ImageTile *it,
-                    gint x, gint y, gint w, gint h,
-                    gboolean new_data, gboolean fast)
+/**
+ * @brief Clamps the area of a visible tile to the screen, as the area to copy there
+ * @returns FALSE if nothing of the area is visible
+ */
+gboolean rt_tile_expose_prepare(RendererTiles *rt, TileRenderJob &job)
 {
 	PixbufRenderer *pr = rt->pr;
-	cairo_t *cr;
+	ImageTile *it = job.it;
+	gint x = job.area.x;
+	gint y = job.area.y;
+	gint w = job.area.width;
+	gint h = job.area.height;
 
 	/* clamp to visible */
 	if (it->x + x < rt->x_scroll)
@@ -1426,7 +1512,7 @@ void rt_tile_expose(RendererTiles *rt, ImageTile *it,
 		{
 		w = rt->x_scroll + pr->vis_width - it->x - x;
 		}
-	if (w < 1) return;
+	if (w < 1) return FALSE;
 	if (it->y + y < rt->y_scroll)
 		{
 		h -= rt->y_scroll - it->y - y;
@@ -1436,9 +1522,23 @@ void rt_tile_expose(RendererTiles *rt, ImageTile *it,
 		{
 		h = rt->y_scroll + pr->vis_height - it->y - y;
 		}
-	if (h < 1) return;
+	if (h < 1) return FALSE;
+
+	job.area = {x, y, w, h};
+	job.expose = job.area;
+
+	return TRUE;
+}
 
-	rt_tile_render(rt, it, x, y, w, h, new_data, fast);
+void rt_tile_expose_commit(RendererTiles *rt, const TileRenderJob &job)
+{
+	PixbufRenderer *pr = rt->pr;
+	ImageTile *it = job.it;
+	const gint x = job.expose.x;
+	const gint y = job.expose.y;
+	const gint w = job.expose.width;
+	const gint h = job.expose.height;
+	cairo_t *cr;
 
 	cr = cairo_create(rt->surface);
 	cairo_set_source_surface(cr, it->surface, pr->x_offset + (it->x - rt->x_scroll) + rt->stereo_off_x, pr->y_offset + (it->y - rt->y_scroll) + rt->stereo_off_y);
@@ -1548,12 +1648,106 @@ void queue_data_merge(QueueData *parent, const QueueData *qd)
 	parent->new_data |= qd->new_data;
 }
 
+/**
+ * @brief Takes the next areas to render from a draw queue, visible tiles first
+ * @param max The most areas to take
+ *
+ * The tiles of the areas are locked until rt_queue_draw_idle_cb() is done
+ * with them, so that setting up another one does not free them.
+ */
+std::vector<QueueData *> rt_queue_get_batch(RendererTiles *rt, GList *queue, gint max)
+{
+	std::vector<QueueData *> batch;
+	std::vector<QueueData *> hidden;
+
+	for (GList *work = queue; work && static_cast<gint>(batch.size()) < max; work = work->next)
+		{
+		auto *qd = static_cast<QueueData *>(work->data);
+
+		if (rt_tile_is_visible(rt, qd->it))
+			{
+			batch.push_back(qd);
+			}
+		else if (static_cast<gint>(hidden.size()) < max)
+			{
+			hidden.push_back(qd);
+			}
+		}
+
+	for (QueueData *qd : hidden)
+		{
+		if (static_cast<gint>(batch.size()) >= max) break;
+		batch.push_back(qd);
+		}
+
+	for (QueueData *qd : batch)
+		{
+		qd->it->locked = TRUE;
+		}
+
+	return batch;
+}
+
+/**
+ * @brief Renders a batch of queued areas
+ *
+ * The tiles are set up one after the other, then scaled in parallel and
+ * finally committed to their surfaces and to the screen in the order of
+ * the batch. Each tile is in a draw queue once, so the scaling threads
+ * never share one.
+ */
+void rt_queue_render_batch(RendererTiles *rt, const std::vector<QueueData *> &batch, gboolean fast, gint thread_count)
+{
+	std::vector<TileRenderJob> jobs(batch.size());
+	std::vector<TileRenderJob *> scale_jobs;
+
+	for (gsize i = 0; i < batch.size(); i++)
+		{
+		QueueData *qd = batch[i];
+		TileRenderJob &job = jobs[i];
+
+		job.it = qd->it;
+		job.area = {qd->x, qd->y, qd->w, qd->h};
+		job.new_data = qd->new_data;
+		job.fast = fast;
+
+		if (rt_tile_is_visible(rt, qd->it))
+			{
+			if (!rt_tile_expose_prepare(rt, job)) continue;
+			}
+		else if (qd->new_data)
+			{
+			/* if new pixel data, and we already have a pixmap, update the tile */
+			qd->it->blank = FALSE;
+			if (!qd->it->surface || qd->it->render_done != TileRender::ALL) continue;
+			}
+		else
+			{
+			continue;
+			}
+
+		rt_tile_render_prepare(rt, job);
+		if (job.scale) scale_jobs.push_back(&job);
+		}
+
+	image_loader_parallel_run(0, static_cast<guint32>(scale_jobs.size()), thread_count, [rt, &scale_jobs](guint32 value, gint)
+	{
+		rt_tile_render_scale(rt, *scale_jobs[value]);
+	});
+
+	for (TileRenderJob &job : jobs)
+		{
+		rt_tile_render_commit(rt, job);
+		if (job.expose.width > 0) rt_tile_expose_commit(rt, job);
+		}
+}
+
 gboolean rt_queue_draw_idle_cb(gpointer data)
 {
 	auto rt = static_cast<RendererTiles *>(data);
 	PixbufRenderer *pr = rt->pr;
-	QueueData *qd;
 	gboolean fast;
+	gboolean pass_2;
 
 	if ((!pr->pixbuf && !pr->source_tiles_enabled) ||
 	    (!rt->draw_queue && !rt->draw_queue_2pass) ||
@@ -1567,8 +1761,8 @@ gboolean rt_queue_draw_idle_cb(gpointer data)
 
 	if (rt->draw_queue)
 		{
-		qd = static_cast<QueueData *>(rt->draw_queue->data);
 		fast = (pr->zoom_2pass && ((pr->zoom_quality != GDK_INTERP_NEAREST && pr->scale != 1.0) || pr->post_process_slow));
+		pass_2 = FALSE;
 		}
 	else
 		{
@@ -1579,55 +1773,52 @@ gboolean rt_queue_draw_idle_cb(gpointer data)
 			return rt_queue_schedule_next_draw(rt, FALSE);
 			}
 
-		qd = static_cast<QueueData *>(rt->draw_queue_2pass->data);
 		fast = FALSE;
+		pass_2 = TRUE;
 		}
 
+	/* as many tiles as can be scaled at once */
+	const gint thread_count = image_loader_get_decode_thread_count();
+	const std::vector<QueueData *> batch = rt_queue_get_batch(rt, pass_2 ? rt->draw_queue_2pass : rt->draw_queue, thread_count);
+
 	if (gtk_widget_get_realized(GTK_WIDGET(pr)))
 		{
-		if (rt_tile_is_visible(rt, qd->it))
-			{
-			rt_tile_expose(rt, qd->it, qd->x, qd->y, qd->w, qd->h, qd->new_data, fast);
-			}
-		else if (qd->new_data)
-			{
-			/* if new pixel data, and we already have a pixmap, update the tile */
-			qd->it->blank = FALSE;
-			if (qd->it->surface && qd->it->render_done == TileRender::ALL)
-				{
-				rt_tile_render(rt, qd->it, qd->x, qd->y, qd->w, qd->h, qd->new_data, fast);
-				}
-			}
+		rt_queue_render_batch(rt, batch, fast, thread_count);
 		}
 
-	if (rt->draw_queue)
+	for (QueueData *qd : batch)
 		{
-		qd->it->qd = nullptr;
-		rt->draw_queue = g_list_remove(rt->draw_queue, qd);
-		if (fast)
+		qd->it->locked = FALSE;
+
+		if (!pass_2)
 			{
-			if (qd->it->qd2)
+			qd->it->qd = nullptr;
+			rt->draw_queue = g_list_remove(rt->draw_queue, qd);
+			if (fast)
 				{
-				queue_data_merge(qd->it->qd2, qd);
-				g_free(qd);
+				if (qd->it->qd2)
+					{
+					queue_data_merge(qd->it->qd2, qd);
+					g_free(qd);
+					}
+				else
+					{
+					qd->it->qd2 = qd;
+					rt->draw_queue_2pass = g_list_append(rt->draw_queue_2pass, qd);
+					}
 				}
 			else
 				{
-				qd->it->qd2 = qd;
-				rt->draw_queue_2pass = g_list_append(rt->draw_queue_2pass, qd);
+				g_free(qd);
 				}
 			}
 		else
 			{
+			qd->it->qd2 = nullptr;
+			rt->draw_queue_2pass = g_list_remove(rt->draw_queue_2pass, qd);
 			g_free(qd);
 			}
 		}
-	else
-		{
-		qd->it->qd2 = nullptr;
-		rt->draw_queue_2pass = g_list_remove(rt->draw_queue_2pass, qd);
-		g_free(qd);
-		}
 
 	if (!rt->draw_queue && !rt->draw_queue_2pass)
 		{
@@ -1847,6 +2038,9 @@ void renderer_area_changed(void *renderer, GdkRectangle src)
 	gint x2;
 	gint y2;
 
+	/* the image changed, the levels are out of date */
+	rt_mip_levels_clear(rt);
+
 	gint orientation = rt_get_orientation(rt);
 	src.x -= get_right_pixbuf_offset(rt);
 	GdkRectangle rect = pr_coords_map_orientation_reverse(orientation, src,
@@ -1888,7 +2082,10 @@ void rt_redraw(RendererTiles *rt, GdkRectangle rect,
 
 void renderer_update_pixbuf(void *renderer, gboolean)
 {
-	rt_queue_clear(static_cast<RendererTiles *>(renderer));
+	auto rt = static_cast<RendererTiles *>(renderer);
+
+	rt_queue_clear(rt);
+	rt_mip_levels_clear(rt);
 }
 
 void renderer_update_zoom(void *renderer, gboolean lazy)
@@ -1914,10 +2111,8 @@ void renderer_invalidate_region(void *renderer, GdkRectangle region)
 	const gint y1 = ROUND_DOWN(region.y, rt->tile_height);
 	const gint y2 = ROUND_UP(region.y + region.height, rt->tile_height);
 
-	for (GList *work = rt->tiles; work; work = work->next)
+	for (ImageTile *it = rt->tiles->first(); it; it = it->lru_next)
 		{
-		auto *it = static_cast<ImageTile *>(work->data);
-
 		if (it->x < x2 && it->x + it->w > x1 &&
 		    it->y < y2 && it->y + it->h > y1)
 			{
@@ -1976,7 +2171,9 @@ void renderer_free(void *renderer)
 	auto rt = static_cast<RendererTiles *>(renderer);
 	rt_queue_clear(rt);
 	rt_tile_free_all(rt);
-	if (rt->spare_tile) g_object_unref(rt->spare_tile);
+	delete rt->tiles;
+	rt_mip_levels_clear(rt);
+	g_list_free_full(rt->spare_tiles, g_object_unref);
 	g_list_free_full(rt->overlay_list, reinterpret_cast<GDestroyNotify>(overlay_data_free));
 	g_clear_pointer(&rt->overlay_buffer, cairo_surface_destroy);
 	/* disconnect "hierarchy-changed" */
@@ -2101,7 +2298,7 @@ RendererFuncs *renderer_tiles_new(PixbufRenderer *pr)
 	rt->tile_width = options->image.tile_size;
 	rt->tile_height = options->image.tile_size;
 
-	rt->tiles = nullptr;
+	rt->tiles = new TileGrid<ImageTile>();
 	rt->tile_cache_size = 0;
 
 	rt->tile_cache_max = PR_CACHE_SIZE_DEFAULT;
@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "similar-index.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <utility>
+
+#include "similar.h"
+
+namespace
+{
+
+/* Ranges of up to this many items are scanned linearly */
+constexpr gint SIMILARITY_INDEX_LEAF_SIZE = 16;
+
+constexpr gdouble SIMILARITY_MAX_DISTANCE = 255.0 * 1024.0 * 3.0;
+
+/**
+ * @brief Largest L1 distance which can still give a score >= \a min
+ *
+ * Rounded up by one, so that floating point rounding in
+ * image_sim_compare_fast() can never lose a match.
+ */
+guint similarity_radius(gdouble min)
+{
+	if (min <= 0.0) return std::numeric_limits<guint>::max();
+
+	return static_cast<guint>((1.0 - min) * SIMILARITY_MAX_DISTANCE) + 1;
+}
+
+} // namespace
+
+ImageSimilarityIndex::ImageSimilarityIndex(const std::vector<const ImageSimilarityData *> &items)
+	: data(items)
+{
+	order.reserve(items.size());
+	for (gsize i = 0; i < items.size(); i++)
+		{
+		if (image_sim_filled(items[i])) order.push_back(i);
+		}
+
+	nodes.reserve((2 * order.size() / SIMILARITY_INDEX_LEAF_SIZE) + 1);
+	root = build(0, order.size());
+}
+
+guint ImageSimilarityIndex::distance(const ImageSimilarityData *a, const ImageSimilarityData *b)
+{
+	guint sim = 0;
+
+	for (gsize i = 0; i < std::tuple_size_v<ImageSimilarityData::Avg>; i++)
+		{
+		sim += abs(a->avg_r[i] - b->avg_r[i]);
+		sim += abs(a->avg_g[i] - b->avg_g[i]);
+		sim += abs(a->avg_b[i] - b->avg_b[i]);
+		}
+
+	return sim;
+}
+
+gint ImageSimilarityIndex::build(gint begin, gint end)
+{
+	if (begin >= end) return -1;
+
+	const gint node = nodes.size();
+	nodes.push_back({begin, end, 0, -1, -1});
+
+	if (end - begin <= SIMILARITY_INDEX_LEAF_SIZE) return node;
+
+	/* Use the middle item as vantage point, the order of the input is usually by name or date */
+	std::swap(order[begin], order[begin + ((end - begin) / 2)]);
+	const ImageSimilarityData *vantage = data[order[begin]];
+
+	std::vector<std::pair<guint, gint>> ranked;
+	ranked.reserve(end - begin - 1);
+	for (gint i = begin + 1; i < end; i++)
+		{
+		ranked.emplace_back(distance(vantage, data[order[i]]), order[i]);
+		}
+
+	const auto median = ranked.begin() + (ranked.size() / 2);
+	std::nth_element(ranked.begin(), median, ranked.end());
+
+	for (gsize i = 0; i < ranked.size(); i++)
+		{
+		order[begin + 1 + i] = ranked[i].second;
+		}
+
+	const gint split = begin + 1 + (median - ranked.begin());
+	const guint threshold = median->first;
+
+	/* nodes may be reallocated by the recursion, so do not hold a reference */
+	const gint inside = build(begin + 1, split);
+	const gint outside = build(split, end);
+
+	nodes[node].threshold = threshold;
+	nodes[node].inside = inside;
+	nodes[node].outside = outside;
+
+	return node;
+}
+
+void ImageSimilarityIndex::search(gint node, const ImageSimilarityData *needle, guint radius, std::vector<gint> &result) const
+{
+	while (node >= 0)
+		{
+		const Node &n = nodes[node];
+
+		if (n.inside < 0 && n.outside < 0)
+			{
+			for (gint i = n.begin; i < n.end; i++)
+				{
+				if (distance(needle, data[order[i]]) <= radius) result.push_back(order[i]);
+				}
+			return;
+			}
+
+		const guint d = distance(needle, data[order[n.begin]]);
+		if (d <= radius) result.push_back(order[n.begin]);
+
+		/* Triangle inequality: an item x within radius of the needle has
+		 * d - radius <= distance(vantage, x) <= d + radius
+		 */
+		const gboolean need_inside = (d <= n.threshold || d - n.threshold <= radius);
+		const gboolean need_outside = (d >= n.threshold || n.threshold - d <= radius);
+
+		if (need_inside && need_outside)
+			{
+			search(n.inside, needle, radius, result);
+			node = n.outside;
+			}
+		else
+			{
+			node = need_inside ? n.inside : n.outside;
+			}
+		}
+}
+
+std::vector<gint> ImageSimilarityIndex::find(const ImageSimilarityData *needle, gdouble min, gint transforms) const
+{
+	std::vector<gint> result;
+
+	if (!image_sim_filled(needle)) return result;
+
+	const guint radius = similarity_radius(min);
+
+	for (gint t = 0; t < transforms; t++)
+		{
+		if (t == 0)
+			{
+			search(root, needle, radius, result);
+			}
+		else
+			{
+			const ImageSimilarityData transformed = image_sim_transform(*needle, t);
+			search(root, &transformed, radius, result);
+			}
+		}
+
+	std::sort(result.begin(), result.end());
+	result.erase(std::unique(result.begin(), result.end()), result.end());
+
+	return result;
+}
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef SIMILAR_INDEX_H
+#define SIMILAR_INDEX_H
+
+#include <vector>
+
+#include <glib.h>
+
+struct ImageSimilarityData;
+
+/**
+ * @brief Vantage-point tree over #ImageSimilarityData vectors
+ *
+ * The default similarity score is derived from the L1 distance between two
+ * 32 x 32 x 3 vectors, which is a metric. The tree uses the triangle
+ * inequality to skip every item that cannot reach a given score, so only
+ * the remaining candidates have to be passed to image_sim_compare_fast().
+ *
+ * The index does not own the data, which must outlive it and must not
+ * be modified while the index exists. Lookups may be run concurrently.
+ */
+class ImageSimilarityIndex
+{
+public:
+	/**
+	 * @param items Data to index. Unfilled or null entries are skipped,
+	 * the others are reported by their position in this vector.
+	 */
+	explicit ImageSimilarityIndex(const std::vector<const ImageSimilarityData *> &items);
+
+	/**
+	 * @brief Find all items which may score at least \a min against \a needle
+	 * @param needle
+	 * @param min Similarity threshold as used by image_sim_compare_fast()
+	 * @param transforms 1, or 8 to include all rotated and mirrored versions of \a needle
+	 * @returns Sorted positions of the candidates
+	 *
+	 * The result is a superset of the matches, never a subset.
+	 */
+	std::vector<gint> find(const ImageSimilarityData *needle, gdouble min, gint transforms) const;
+
+	gsize size() const { return order.size(); }
+
+	static guint distance(const ImageSimilarityData *a, const ImageSimilarityData *b);
+
+private:
+	struct Node
+	{
+		gint begin;	/**< range in \a order, the vantage point is at \a begin */
+		gint end;
+		guint threshold;	/**< median distance from the vantage point */
+		gint inside;	/**< child node with distances <= \a threshold, or -1 */
+		gint outside;	/**< child node with distances >= \a threshold, or -1 */
+	};
+
+	gint build(gint begin, gint end);
+	void search(gint node, const ImageSimilarityData *needle, guint radius, std::vector<gint> &result) const;
+
+	std::vector<const ImageSimilarityData *> data;
+	std::vector<gint> order;
+	std::vector<Node> nodes;
+	gint root = -1;
+};
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
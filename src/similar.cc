@@ -24,9 +24,12 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdlib>
-#include <functional>
 #include <vector>
 
+#if defined(__x86_64__) || defined(__i386__)
+#  include <immintrin.h>
+#endif
+
 #include "options.h"
 
 /**
@@ -58,8 +61,6 @@
 namespace
 {
 
-using ImageSimilarityCheckAbort = std::function<bool(gdouble)>;
-
 void image_sim_channel_equal(ImageSimilarityData::Avg &pix)
 {
 	struct IndexedPix
@@ -86,51 +87,140 @@ void image_sim_channel_equal(ImageSimilarityData::Avg &pix)
 		}
 }
 
-/*
- * 4 rotations (0, 90, 180, 270) combined with two mirrors (0, H)
- * generate all possible isometric transformations
- * = 8 tests
- * = change dir of x, change dir of y, exchange x and y = 2^3 = 8
+constexpr gdouble SIMILARITY_MAX_DISTANCE = 255.0 * 1024.0 * 3.0;
+
+constexpr gsize SIMILARITY_CHANNEL_SIZE = std::tuple_size_v<ImageSimilarityData::Avg>;
+constexpr gsize SIMILARITY_LAYOUT_SIZE = 3 * SIMILARITY_CHANNEL_SIZE;
+
+/**
+ * @brief Computes the L1 distance of \a a to each of the \a transforms layouts
+ * @returns The smallest distance, or G_MAXUINT if all distances exceed \a min
+ *
+ * The data is processed one row (32 cells) at a time, for all layouts
+ * together, and the abort test is done after each row.
  */
-gdouble image_sim_data_compare_transfo(const ImageSimilarityData *a, const ImageSimilarityData *b, gchar transfo, const ImageSimilarityCheckAbort &check_abort)
+using ImageSimilarityKernel = guint (*)(const ImageSimilarityData *a, const guint8 *layouts, gint transforms, gdouble min);
+
+guint image_sim_kernel_scalar(const ImageSimilarityData *a, const guint8 *layouts, gint transforms, gdouble min)
 {
-	if (!image_sim_filled(a) || !image_sim_filled(b)) return 0.0;
+	std::array<guint, 8> sums{};
+
+	for (gsize offset = 0; offset < SIMILARITY_CHANNEL_SIZE; offset += 32)
+		{
+		guint best = G_MAXUINT;
+
+		for (gint t = 0; t < transforms; t++)
+			{
+			const guint8 *b = layouts + (t * SIMILARITY_LAYOUT_SIZE) + offset;
+			guint sim = 0;
+
+			for (gsize i = 0; i < 32; i++)
+				{
+				sim += abs(a->avg_r[offset + i] - b[i]);
+				sim += abs(a->avg_g[offset + i] - b[SIMILARITY_CHANNEL_SIZE + i]);
+				sim += abs(a->avg_b[offset + i] - b[(2 * SIMILARITY_CHANNEL_SIZE) + i]);
+				}
 
-	gint sim = 0.0;
-	gint i2;
-	gint *i;
-	gint j2;
-	gint *j;
+			sums[t] += sim;
+			best = std::min(best, sums[t]);
+			}
+
+		if (static_cast<gdouble>(best) / SIMILARITY_MAX_DISTANCE > min) return G_MAXUINT;
+		}
+
+	return *std::min_element(sums.cbegin(), sums.cbegin() + transforms);
+}
 
-	if (transfo & 1) { i = &j2; j = &i2; } else { i = &i2; j = &j2; }
-	for (gint j1 = 0; j1 < 32; j1++)
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse2")))
+guint image_sim_kernel_sse2(const ImageSimilarityData *a, const guint8 *layouts, gint transforms, gdouble min)
+{
+	std::array<guint, 8> sums{};
+
+	for (gsize offset = 0; offset < SIMILARITY_CHANNEL_SIZE; offset += 32)
 		{
-		if (transfo & 2) *j = 31-j1; else *j = j1;
-		for (gint i1 = 0; i1 < 32; i1++)
+		__m128i row[6];
+		for (gsize c = 0; c < 3; c++)
+			{
+			const guint8 *channel = (c == 0 ? a->avg_r : (c == 1 ? a->avg_g : a->avg_b)).data() + offset;
+
+			row[2 * c] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(channel));
+			row[(2 * c) + 1] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(channel + 16));
+			}
+
+		guint best = G_MAXUINT;
+
+		for (gint t = 0; t < transforms; t++)
 			{
-			if (transfo & 4) *i = 31-i1; else *i = i1;
-			sim += abs(a->avg_r[(i1*32)+j1] - b->avg_r[(i2*32)+j2]);
-			sim += abs(a->avg_g[(i1*32)+j1] - b->avg_g[(i2*32)+j2]);
-			sim += abs(a->avg_b[(i1*32)+j1] - b->avg_b[(i2*32)+j2]);
-			/* check for abort, if so return 0.0 */
-			if (check_abort(sim)) return 0.0;
+			const guint8 *b = layouts + (t * SIMILARITY_LAYOUT_SIZE) + offset;
+			__m128i sad = _mm_setzero_si128();
+
+			for (gsize c = 0; c < 3; c++)
+				{
+				const guint8 *channel = b + (c * SIMILARITY_CHANNEL_SIZE);
+
+				sad = _mm_add_epi64(sad, _mm_sad_epu8(row[2 * c], _mm_loadu_si128(reinterpret_cast<const __m128i *>(channel))));
+				sad = _mm_add_epi64(sad, _mm_sad_epu8(row[(2 * c) + 1], _mm_loadu_si128(reinterpret_cast<const __m128i *>(channel + 16))));
+				}
+
+			sums[t] += _mm_cvtsi128_si32(sad) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(sad, sad));
+			best = std::min(best, sums[t]);
 			}
+
+		if (static_cast<gdouble>(best) / SIMILARITY_MAX_DISTANCE > min) return G_MAXUINT;
 		}
 
-	return 1.0 - (static_cast<gdouble>(sim) / (255.0 * 1024.0 * 3.0));
+	return *std::min_element(sums.cbegin(), sums.cbegin() + transforms);
 }
 
-gdouble image_sim_data_compare(const ImageSimilarityData *a, const ImageSimilarityData *b, const ImageSimilarityCheckAbort &check_abort)
+__attribute__((target("avx2")))
+guint image_sim_kernel_avx2(const ImageSimilarityData *a, const guint8 *layouts, gint transforms, gdouble min)
 {
-	gchar max_t = (options->rot_invariant_sim ? 8 : 1);
-	gdouble max_score = 0;
+	std::array<guint, 8> sums{};
 
-	for (gchar t = 0; t < max_t; t++)
-	{
-		max_score = std::max(image_sim_data_compare_transfo(a, b, t, check_abort), max_score);
-	}
+	for (gsize offset = 0; offset < SIMILARITY_CHANNEL_SIZE; offset += 32)
+		{
+		const __m256i row_r = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a->avg_r.data() + offset));
+		const __m256i row_g = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a->avg_g.data() + offset));
+		const __m256i row_b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a->avg_b.data() + offset));
+		guint best = G_MAXUINT;
 
-	return max_score;
+		for (gint t = 0; t < transforms; t++)
+			{
+			const guint8 *b = layouts + (t * SIMILARITY_LAYOUT_SIZE) + offset;
+
+			__m256i sad = _mm256_sad_epu8(row_r, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b)));
+			sad = _mm256_add_epi64(sad, _mm256_sad_epu8(row_g, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + SIMILARITY_CHANNEL_SIZE))));
+			sad = _mm256_add_epi64(sad, _mm256_sad_epu8(row_b, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + (2 * SIMILARITY_CHANNEL_SIZE)))));
+
+			const __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sad), _mm256_extracti128_si256(sad, 1));
+			sums[t] += _mm_cvtsi128_si32(half) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(half, half));
+			best = std::min(best, sums[t]);
+			}
+
+		if (static_cast<gdouble>(best) / SIMILARITY_MAX_DISTANCE > min) return G_MAXUINT;
+		}
+
+	return *std::min_element(sums.cbegin(), sums.cbegin() + transforms);
+}
+#endif
+
+/**
+ * @brief Selects the fastest kernel supported by the CPU, once
+ */
+ImageSimilarityKernel image_sim_kernel()
+{
+	static const ImageSimilarityKernel kernel = []() -> ImageSimilarityKernel
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) return image_sim_kernel_avx2;
+		if (__builtin_cpu_supports("sse2")) return image_sim_kernel_sse2;
+#endif
+		return image_sim_kernel_scalar;
+	}();
+
+	return kernel;
 }
 
 } // namespace
@@ -367,7 +457,7 @@ static gdouble alternate_image_sim_compare_fast(const ImageSimilarityData *a, co
 
 gdouble image_sim_compare(ImageSimilarityData *a, ImageSimilarityData *b)
 {
-	return image_sim_data_compare(a, b, [](gdouble){ return false; });
+	return ImageSimilarityReference(b, image_sim_transform_count()).compare(a);
 }
 
 /* this uses a cutoff point so that it can abort early when it gets to
@@ -375,18 +465,225 @@ gdouble image_sim_compare(ImageSimilarityData *a, ImageSimilarityData *b)
  */
 gdouble image_sim_compare_fast(ImageSimilarityData *a, ImageSimilarityData *b, gdouble min)
 {
-	min = 1.0 - min;
-
 	if (options->alternate_similarity_algorithm.enabled)
 		{
-		return alternate_image_sim_compare_fast(a, b, min);
+		return alternate_image_sim_compare_fast(a, b, 1.0 - min);
 		}
 
-	return image_sim_data_compare(a, b, [min](gdouble sim){ return (sim / (255.0 * 1024.0 * 3.0)) > min; });
+	return ImageSimilarityReference(b, image_sim_transform_count()).compare_fast(a, min);
+}
+
+/**
+ * @brief Number of isometric transformations tried by the standard algorithm
+ * @returns 8 if rotations and mirrors are ignored, otherwise 1
+ */
+gint image_sim_transform_count()
+{
+	return options->rot_invariant_sim ? 8 : 1;
 }
 
 bool image_sim_filled(const ImageSimilarityData *sd)
 {
 	return sd && sd->filled;
 }
+
+/**
+ * @brief Returns a copy of \a sd with one of the isometric transformations applied
+ * @param sd
+ * @param transfo 0 to 7, bit 0 exchanges x and y, bits 1 and 2 change their directions
+ *
+ * The L1 distance between \a a and image_sim_transform(\a b, t) is the
+ * difference the similarity of \a a and \a b under transformation t is based on.
+ */
+ImageSimilarityData image_sim_transform(const ImageSimilarityData &sd, gint transfo)
+{
+	ImageSimilarityData t;
+
+	for (gint i1 = 0; i1 < 32; i1++)
+		{
+		const gint i = (transfo & 4) ? 31 - i1 : i1;
+
+		for (gint j1 = 0; j1 < 32; j1++)
+			{
+			const gint j = (transfo & 2) ? 31 - j1 : j1;
+			const gint n = (transfo & 1) ? (j * 32) + i : (i * 32) + j;
+
+			t.avg_r[(i1 * 32) + j1] = sd.avg_r[n];
+			t.avg_g[(i1 * 32) + j1] = sd.avg_g[n];
+			t.avg_b[(i1 * 32) + j1] = sd.avg_b[n];
+			}
+		}
+
+	t.filled = sd.filled;
+
+	return t;
+}
+
+/**
+ * @brief Adds an unfilled item
+ * @returns The index of the item, or -1 if the arena is full
+ */
+gint ImageSimilarityArena::add()
+{
+	if (!free_slots.empty())
+		{
+		const gint index = free_slots.back();
+		free_slots.pop_back();
+
+		at(index).filled = false;
+
+		return index;
+		}
+
+	if (count == MAX_CHUNKS * CHUNK_SIZE) return -1;
+
+	if (!chunks) chunks = std::make_unique<std::unique_ptr<Slot[]>[]>(MAX_CHUNKS);
+
+	const gsize chunk = count / CHUNK_SIZE;
+	if (chunk == chunk_count)
+		{
+		chunks[chunk] = std::make_unique<Slot[]>(CHUNK_SIZE);
+		chunk_count++;
+		}
+
+	at(count).filled = false;
+
+	return count++;
+}
+
+/**
+ * @brief Frees the slot of the item at \a index for reuse by add()
+ * @param index Index returned by add(), ignored if negative
+ */
+void ImageSimilarityArena::remove(gint index)
+{
+	if (index < 0) return;
+
+	free_slots.push_back(index);
+}
+
+/**
+ * @brief Returns the item at \a index, which must have been returned by add()
+ */
+ImageSimilarityData *ImageSimilarityArena::get(gint index) const
+{
+	if (index < 0) return nullptr;
+
+	return &at(index);
+}
+
+/**
+ * @brief Moves the items into the order of \a indices and frees all other slots
+ * @param[in,out] indices Index of each item to keep, replaced by its new index
+ *
+ * The item of indices[i] moves to slot i. Negative entries are kept as they are
+ * and take no slot. Chunks no longer needed are freed.
+ *
+ * Must not be called while other threads access items.
+ */
+void ImageSimilarityArena::compact(std::vector<gint> &indices)
+{
+	/* Target slot of every slot, the dropped ones go after the kept items */
+	std::vector<gint> target(count, -1);
+	gint kept = 0;
+
+	for (gint &index : indices)
+		{
+		if (index < 0) continue;
+
+		target[index] = kept;
+		index = kept++;
+		}
+
+	gint dropped = kept;
+	for (gint &t : target)
+		{
+		if (t < 0) t = dropped++;
+		}
+
+	/* Apply the permutation cycle by cycle, a slot is done once it targets itself */
+	for (gint start = 0; start < static_cast<gint>(count); start++)
+		{
+		if (target[start] == start) continue;
+
+		ImageSimilarityData moving = at(start);
+		gint slot = start;
+		while (target[slot] != start)
+			{
+			const gint next = target[slot];
+
+			std::swap(moving, at(next));
+			target[slot] = slot;
+			slot = next;
+			}
+		at(start) = moving;
+		target[slot] = slot;
+		}
+
+	count = kept;
+	std::vector<gint>().swap(free_slots);
+
+	const gsize needed = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	while (chunk_count > needed)
+		{
+		chunk_count--;
+		chunks[chunk_count].reset();
+		}
+}
+
+/**
+ * @brief Removes all items, the memory is kept for reuse
+ *
+ * Must not be called while other threads access items.
+ */
+void ImageSimilarityArena::clear()
+{
+	count = 0;
+	free_slots.clear();
+}
+
+gsize ImageSimilarityArena::memory_size() const
+{
+	return chunk_count * CHUNK_SIZE * sizeof(Slot);
+}
+
+/*
+ * 4 rotations (0, 90, 180, 270) combined with two mirrors (0, H)
+ * generate all possible isometric transformations
+ * = 8 tests
+ * = change dir of x, change dir of y, exchange x and y = 2^3 = 8
+ *
+ * The transformed layouts of the reference are computed once, so that
+ * comparisons only stream through memory.
+ */
+ImageSimilarityReference::ImageSimilarityReference(const ImageSimilarityData *sd, gint transforms)
+	: transforms(image_sim_filled(sd) ? std::clamp(transforms, 1, 8) : 0)
+{
+	layouts.resize(this->transforms * SIMILARITY_LAYOUT_SIZE);
+
+	for (gint t = 0; t < this->transforms; t++)
+		{
+		const ImageSimilarityData transformed = image_sim_transform(*sd, t);
+		guint8 *layout = layouts.data() + (t * SIMILARITY_LAYOUT_SIZE);
+
+		std::copy(transformed.avg_r.cbegin(), transformed.avg_r.cend(), layout);
+		std::copy(transformed.avg_g.cbegin(), transformed.avg_g.cend(), layout + SIMILARITY_CHANNEL_SIZE);
+		std::copy(transformed.avg_b.cbegin(), transformed.avg_b.cend(), layout + (2 * SIMILARITY_CHANNEL_SIZE));
+		}
+}
+
+gdouble ImageSimilarityReference::compare(const ImageSimilarityData *a) const
+{
+	return compare_fast(a, 0.0);
+}
+
+gdouble ImageSimilarityReference::compare_fast(const ImageSimilarityData *a, gdouble min) const
+{
+	if (transforms == 0 || !image_sim_filled(a)) return 0.0;
+
+	const guint sim = image_sim_kernel()(a, layouts.data(), transforms, 1.0 - min);
+	if (sim == G_MAXUINT) return 0.0;
+
+	return 1.0 - (static_cast<gdouble>(sim) / SIMILARITY_MAX_DISTANCE);
+}
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
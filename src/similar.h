@@ -23,6 +23,8 @@
 #define SIMILAR_H
 
 #include <array>
+#include <memory>
+#include <vector>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <glib.h>
@@ -49,11 +51,83 @@ struct ImageSimilarityData
 };
 
 
+/**
+ * @brief Contiguous storage for the similarity data of many images
+ *
+ * Items are addressed by index. They are stored in 64-byte aligned chunks,
+ * so adjacent indices are adjacent in memory. compact() moves the items into
+ * the order they are compared in, so that comparisons stream through them
+ * linearly instead of chasing one heap allocation per image.
+ *
+ * The slots of removed items are reused by add(). Items are only moved and
+ * chunks only freed by compact(), so get() may be called from other threads
+ * for existing items while add() or remove() is called.
+ */
+class ImageSimilarityArena
+{
+public:
+	ImageSimilarityArena() = default;
+	~ImageSimilarityArena() = default;
+
+	// Not copyable.
+	ImageSimilarityArena(const ImageSimilarityArena &) = delete;
+	ImageSimilarityArena &operator=(const ImageSimilarityArena &) = delete;
+
+	gint add();
+	void remove(gint index);
+	ImageSimilarityData *get(gint index) const;
+	void compact(std::vector<gint> &indices);
+	void clear();
+
+	gsize size() const { return count - free_slots.size(); }
+	gsize memory_size() const;
+
+private:
+	struct alignas(64) Slot
+	{
+		ImageSimilarityData data;
+	};
+
+	static constexpr gsize CHUNK_SIZE = 256; /**< items per chunk */
+	static constexpr gsize MAX_CHUNKS = 65536;
+
+	ImageSimilarityData &at(gsize index) const { return chunks[index / CHUNK_SIZE][index % CHUNK_SIZE].data; }
+
+	std::unique_ptr<std::unique_ptr<Slot[]>[]> chunks; /**< fixed size table, never reallocated */
+	gsize chunk_count = 0;
+	gsize count = 0; /**< slots handed out, including the free ones */
+	std::vector<gint> free_slots; /**< removed items below \a count */
+};
+
+/**
+ * @brief Similarity data prepared for comparisons with many other images
+ *
+ * Scores all \a transforms isometric transformations in a single pass,
+ * using SSE2 or AVX2 when the CPU supports it.
+ * Only for the standard algorithm, the alternate algorithm is not supported.
+ */
+class ImageSimilarityReference
+{
+public:
+	ImageSimilarityReference(const ImageSimilarityData *sd, gint transforms);
+
+	gdouble compare(const ImageSimilarityData *a) const;
+	gdouble compare_fast(const ImageSimilarityData *a, gdouble min) const;
+
+private:
+	gint transforms;
+	std::vector<guint8> layouts; /**< transformed copies of the data, r, g and b channels of each */
+};
+
+
 gdouble image_sim_compare(ImageSimilarityData *a, ImageSimilarityData *b);
 gdouble image_sim_compare_fast(ImageSimilarityData *a, ImageSimilarityData *b, gdouble min);
 
 bool image_sim_filled(const ImageSimilarityData *sd);
 
+ImageSimilarityData image_sim_transform(const ImageSimilarityData &sd, gint transfo);
+gint image_sim_transform_count();
+
 
 #endif
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
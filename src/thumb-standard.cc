@@ -40,6 +40,7 @@
 #include "image-load.h"
 #include "metadata.h"
 #include "options.h"
+#include "pixbuf-scale.h"
 #include "pixbuf-util.h"
 #include "ui-fileops.h"
 
@@ -455,8 +456,8 @@ static GdkPixbuf *thumb_loader_std_finish(ThumbLoaderStd *tl, GdkPixbuf *pixbuf,
 				if (pixbuf_scale_aspect(cache_w, cache_h, sw, sh,
 				                        thumb_w, thumb_h))
 					{
-					pixbuf_thumb = gdk_pixbuf_scale_simple(pixbuf, thumb_w, thumb_h,
-					                                       options->thumbnails.quality);
+					pixbuf_thumb = pixbuf_scale_simple(pixbuf, thumb_w, thumb_h,
+					                                   options->thumbnails.quality);
 					}
 				else
 					{
@@ -508,8 +509,8 @@ static GdkPixbuf *thumb_loader_std_finish(ThumbLoaderStd *tl, GdkPixbuf *pixbuf,
 		if (pixbuf_scale_aspect(tl->requested_width, tl->requested_height, sw, sh,
 		                        thumb_w, thumb_h))
 			{
-			result = gdk_pixbuf_scale_simple(pixbuf, thumb_w, thumb_h,
-			                                 options->thumbnails.quality);
+			result = pixbuf_scale_simple(pixbuf, thumb_w, thumb_h,
+			                             options->thumbnails.quality);
 			}
 		else
 			{
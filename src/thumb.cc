@@ -33,6 +33,7 @@
 #include "intl.h"
 #include "metadata.h"
 #include "options.h"
+#include "pixbuf-scale.h"
 #include "pixbuf-util.h"
 #include "thumb-standard.h"
 #include "ui-fileops.h"
@@ -191,7 +192,7 @@ static void thumb_loader_done_cb(ImageLoader *il, gpointer data)
 			pixbuf_scale_aspect(tl->max_w, tl->max_h, pw, ph, w, h);
 
 			if (tl->fd->thumb_pixbuf) g_object_unref(tl->fd->thumb_pixbuf);
-			tl->fd->thumb_pixbuf = gdk_pixbuf_scale_simple(pixbuf, w, h, options->thumbnails.quality);
+			tl->fd->thumb_pixbuf = pixbuf_scale_simple(pixbuf, w, h, options->thumbnails.quality);
 			}
 		save = TRUE;
 		}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef TILE_GRID_H
+#define TILE_GRID_H
+
+#include <unordered_map>
+
+#include <glib.h>
+
+/**
+ * @brief The tiles of an image, found by their position and kept in least recently used order
+ *
+ * The grid does not own the tiles. T must have the members
+ * - gint x, y: the position of the tile, which must not change while it is in the grid
+ * - T *lru_prev, *lru_next: the links of the list from the most to the least recently used tile
+ */
+template<typename T>
+class TileGrid
+{
+public:
+	/** @returns The tile at x, y, or nullptr */
+	T *find(gint x, gint y) const
+	{
+		const auto it = tiles_.find(key(x, y));
+		return it != tiles_.end() ? it->second : nullptr;
+	}
+
+	/** Adds a tile as the most recently used, the grid must not have one at its position */
+	void insert(T *tile)
+	{
+		tiles_.emplace(key(tile->x, tile->y), tile);
+		link_first(tile);
+	}
+
+	void remove(T *tile)
+	{
+		tiles_.erase(key(tile->x, tile->y));
+		unlink(tile);
+	}
+
+	/** Makes a tile the most recently used */
+	void touch(T *tile)
+	{
+		if (tile == first_) return;
+
+		unlink(tile);
+		link_first(tile);
+	}
+
+	T *first() const { return first_; } /**< the most recently used tile */
+	T *last() const { return last_; }   /**< the least recently used tile */
+	gsize size() const { return tiles_.size(); }
+
+private:
+	static guint64 key(gint x, gint y)
+	{
+		return (static_cast<guint64>(static_cast<guint32>(x)) << 32) | static_cast<guint32>(y);
+	}
+
+	void link_first(T *tile)
+	{
+		tile->lru_prev = nullptr;
+		tile->lru_next = first_;
+		if (first_) first_->lru_prev = tile;
+		first_ = tile;
+		if (!last_) last_ = tile;
+	}
+
+	void unlink(T *tile)
+	{
+		if (tile->lru_prev) tile->lru_prev->lru_next = tile->lru_next;
+		else first_ = tile->lru_next;
+
+		if (tile->lru_next) tile->lru_next->lru_prev = tile->lru_prev;
+		else last_ = tile->lru_prev;
+
+		tile->lru_prev = nullptr;
+		tile->lru_next = nullptr;
+	}
+
+	std::unordered_map<guint64, T *> tiles_;
+	T *first_ = nullptr;
+	T *last_ = nullptr;
+};
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
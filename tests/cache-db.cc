@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for cache-db.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#include <glib.h>
+
+#include "cache-db.h"
+#include "cache.h"
+#include "similar.h"
+
+namespace {
+
+// For convenience.
+namespace t = ::testing;
+
+class CacheDatabaseTest : public t::Test
+{
+    protected:
+	void SetUp() override
+	{
+		g_autofree gchar *tmp = g_dir_make_tmp("geeqie-cache-db-XXXXXX", nullptr);
+		ASSERT_NE(nullptr, tmp);
+
+		dir = tmp;
+		path = dir + "/" GQ_CACHE_SIM_DB;
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove_all(dir);
+	}
+
+	static CacheData make_data(guint8 seed)
+	{
+		CacheData cd;
+		cd.set_dimensions({640 + seed, 480});
+		cd.date = 1700000000 + seed;
+
+		Md5Digest digest;
+		digest.fill(seed);
+		cd.set_md5sum(digest);
+
+		ImageSimilarityData sd;
+		for (gsize i = 0; i < sd.avg_r.size(); i++)
+			{
+			sd.avg_r[i] = i + seed;
+			sd.avg_g[i] = i * 3;
+			sd.avg_b[i] = 255 - seed;
+			}
+		sd.filled = true;
+		cd.set_similarity(sd);
+
+		return cd;
+	}
+
+	static void expect_equal(const CacheData &expected, const CacheData &actual)
+	{
+		ASSERT_TRUE(actual.dimensions);
+		EXPECT_EQ(*expected.dimensions, *actual.dimensions);
+		EXPECT_EQ(expected.date, actual.date);
+		EXPECT_EQ(expected.md5sum, actual.md5sum);
+		ASSERT_TRUE(actual.similarity);
+		EXPECT_EQ(expected.similarity->avg_r, actual.similarity->avg_r);
+		EXPECT_EQ(expected.similarity->avg_g, actual.similarity->avg_g);
+		EXPECT_EQ(expected.similarity->avg_b, actual.similarity->avg_b);
+	}
+
+	std::string dir;
+	std::string path;
+};
+
+} // anonymous namespace
+
+TEST_F(CacheDatabaseTest, RoundTrip)
+{
+	const CacheData cd = make_data(1);
+	{
+	CacheDatabase db(path.c_str());
+	ASSERT_TRUE(db.save("a.jpg", 100, 2000, cd));
+	}
+
+	CacheDatabase db(path.c_str());
+	CacheData loaded;
+	ASSERT_TRUE(db.load("a.jpg", 100, 2000, loaded));
+	expect_equal(cd, loaded);
+	EXPECT_EQ(1U, db.size());
+}
+
+TEST_F(CacheDatabaseTest, PartialDataRoundTrip)
+{
+	CacheData cd;
+	Md5Digest digest;
+	digest.fill(7);
+	cd.set_md5sum(digest);
+
+	CacheDatabase db(path.c_str());
+	ASSERT_TRUE(db.save("a.jpg", 100, 2000, cd));
+
+	CacheData loaded;
+	ASSERT_TRUE(db.load("a.jpg", 100, 2000, loaded));
+	EXPECT_EQ(cd.md5sum, loaded.md5sum);
+	EXPECT_FALSE(loaded.dimensions);
+	EXPECT_FALSE(loaded.date);
+	EXPECT_FALSE(loaded.similarity);
+}
+
+TEST_F(CacheDatabaseTest, ChangedImageIsNotLoaded)
+{
+	CacheDatabase db(path.c_str());
+	ASSERT_TRUE(db.save("a.jpg", 100, 2000, make_data(1)));
+
+	CacheData loaded;
+	EXPECT_FALSE(db.load("a.jpg", 101, 2000, loaded));
+	EXPECT_FALSE(db.load("a.jpg", 100, 2001, loaded));
+	EXPECT_FALSE(db.load("b.jpg", 100, 2000, loaded));
+}
+
+TEST_F(CacheDatabaseTest, LatestRecordWins)
+{
+	CacheDatabase db(path.c_str());
+	ASSERT_TRUE(db.save("a.jpg", 100, 2000, make_data(1)));
+	ASSERT_TRUE(db.save("a.jpg", 200, 2000, make_data(2)));
+
+	CacheData loaded;
+	ASSERT_TRUE(db.load("a.jpg", 200, 2000, loaded));
+	expect_equal(make_data(2), loaded);
+	EXPECT_EQ(1U, db.superseded_count());
+}
+
+TEST_F(CacheDatabaseTest, StaleRecordIsDropped)
+{
+	CacheDatabase db(path.c_str());
+	ASSERT_TRUE(db.save("a.jpg", 100, 2000, make_data(1)));
+	ASSERT_TRUE(db.save("b.jpg", 100, 2000, make_data(2)));
+
+	CacheData loaded;
+	EXPECT_FALSE(db.load("a.jpg", 101, 2000, loaded));
+	EXPECT_EQ(1U, db.size());
+
+	CacheDatabase reopened(path.c_str());
+	EXPECT_FALSE(reopened.load("a.jpg", 100, 2000, loaded));
+	EXPECT_TRUE(reopened.load("b.jpg", 100, 2000, loaded));
+}
+
+TEST_F(CacheDatabaseTest, SeesRecordsOfOtherWriters)
+{
+	CacheDatabase reader(path.c_str());
+	CacheDatabase writer(path.c_str());
+	ASSERT_TRUE(writer.save("a.jpg", 100, 2000, make_data(1)));
+
+	CacheData loaded;
+	ASSERT_TRUE(reader.load("a.jpg", 100, 2000, loaded));
+	expect_equal(make_data(1), loaded);
+}
+
+TEST_F(CacheDatabaseTest, RecordCutShortIsIgnored)
+{
+	{
+	CacheDatabase db(path.c_str());
+	ASSERT_TRUE(db.save("a.jpg", 100, 2000, make_data(1)));
+	ASSERT_TRUE(db.save("b.jpg", 100, 2000, make_data(2)));
+	}
+
+	struct stat st;
+	ASSERT_EQ(0, stat(path.c_str(), &st));
+	ASSERT_EQ(0, truncate(path.c_str(), st.st_size - 100));
+
+	CacheDatabase db(path.c_str());
+	CacheData loaded;
+	EXPECT_TRUE(db.load("a.jpg", 100, 2000, loaded));
+	EXPECT_FALSE(db.load("b.jpg", 100, 2000, loaded));
+
+	/* The next save must not append after the broken record */
+	ASSERT_TRUE(db.save("c.jpg", 100, 2000, make_data(3)));
+
+	CacheDatabase reopened(path.c_str());
+	EXPECT_TRUE(reopened.load("a.jpg", 100, 2000, loaded));
+	EXPECT_TRUE(reopened.load("c.jpg", 100, 2000, loaded));
+}
+
+TEST_F(CacheDatabaseTest, ForeignFileIsReplaced)
+{
+	FILE *f = fopen(path.c_str(), "w");
+	ASSERT_NE(nullptr, f);
+	fputs("SIMcache\nnot a database\n", f);
+	fclose(f);
+
+	CacheDatabase db(path.c_str());
+	CacheData loaded;
+	EXPECT_FALSE(db.load("a.jpg", 100, 2000, loaded));
+	ASSERT_TRUE(db.save("a.jpg", 100, 2000, make_data(1)));
+
+	CacheDatabase reopened(path.c_str());
+	EXPECT_TRUE(reopened.load("a.jpg", 100, 2000, loaded));
+}
+
+TEST_F(CacheDatabaseTest, CompactKeepsLatestRecords)
+{
+	CacheDatabase db(path.c_str());
+	for (guint8 i = 0; i < 10; i++)
+		{
+		ASSERT_TRUE(db.save("a.jpg", 100 + i, 2000, make_data(i)));
+		ASSERT_TRUE(db.save("b.jpg", 100, 2000 + i, make_data(i)));
+		}
+	EXPECT_EQ(18U, db.superseded_count());
+
+	struct stat before;
+	ASSERT_EQ(0, stat(path.c_str(), &before));
+
+	ASSERT_TRUE(db.compact());
+	EXPECT_EQ(0U, db.superseded_count());
+
+	struct stat after;
+	ASSERT_EQ(0, stat(path.c_str(), &after));
+	EXPECT_LT(after.st_size, before.st_size / 5);
+
+	CacheDatabase reopened(path.c_str());
+	CacheData loaded;
+	ASSERT_TRUE(reopened.load("a.jpg", 109, 2000, loaded));
+	expect_equal(make_data(9), loaded);
+	EXPECT_TRUE(reopened.load("b.jpg", 100, 2009, loaded));
+}
+
+TEST_F(CacheDatabaseTest, SupersededRecordsAreCompactedOnSave)
+{
+	CacheDatabase db(path.c_str());
+	for (gint i = 0; i < 200; i++)
+		{
+		ASSERT_TRUE(db.save("a.jpg", 100 + i, 2000, make_data(1)));
+		}
+
+	EXPECT_LE(db.superseded_count(), 65U);
+}
+
+TEST_F(CacheDatabaseTest, RemovedRecordIsDropped)
+{
+	{
+	CacheDatabase db(path.c_str());
+	ASSERT_TRUE(db.save("a.jpg", 100, 2000, make_data(1)));
+	ASSERT_TRUE(db.save("b.jpg", 100, 2000, make_data(2)));
+	ASSERT_TRUE(db.remove("a.jpg"));
+	ASSERT_TRUE(db.remove("c.jpg"));
+	EXPECT_EQ(1U, db.size());
+	}
+
+	CacheDatabase db(path.c_str());
+	CacheData loaded;
+	EXPECT_FALSE(db.load("a.jpg", 100, 2000, loaded));
+	EXPECT_TRUE(db.load("b.jpg", 100, 2000, loaded));
+	EXPECT_EQ(2U, db.superseded_count());
+
+	/* A new image of the same name gets a record again */
+	ASSERT_TRUE(db.save("a.jpg", 300, 2000, make_data(3)));
+	ASSERT_TRUE(db.load("a.jpg", 300, 2000, loaded));
+	expect_equal(make_data(3), loaded);
+}
+
+TEST_F(CacheDatabaseTest, PruneDropsMissingImages)
+{
+	const std::string source_dir = dir + "/images";
+	ASSERT_TRUE(std::filesystem::create_directory(source_dir));
+	FILE *f = fopen((source_dir + "/a.jpg").c_str(), "w");
+	ASSERT_NE(nullptr, f);
+	fclose(f);
+
+	CacheDatabase db(path.c_str());
+	ASSERT_TRUE(db.save("a.jpg", 100, 2000, make_data(1)));
+	ASSERT_TRUE(db.save("a.jpg", 200, 2000, make_data(2)));
+	ASSERT_TRUE(db.save("b.jpg", 100, 2000, make_data(3)));
+
+	ASSERT_TRUE(db.prune(source_dir.c_str()));
+	EXPECT_EQ(1U, db.size());
+	EXPECT_EQ(0U, db.superseded_count());
+
+	CacheDatabase reopened(path.c_str());
+	CacheData loaded;
+	EXPECT_TRUE(reopened.load("a.jpg", 200, 2000, loaded));
+	EXPECT_FALSE(reopened.load("b.jpg", 100, 2000, loaded));
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
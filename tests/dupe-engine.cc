@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for dupe-engine.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib.h>
+
+#include "dupe-engine.h"
+#include "filedata.h"
+#include "filefilter.h"
+#include "options.h"
+
+namespace {
+
+// For convenience.
+namespace t = ::testing;
+
+/* Parent first, then the children sorted by path */
+using Group = std::vector<std::pair<std::string, gdouble>>;
+
+class DupeEngineTest : public t::Test
+{
+    protected:
+	void SetUp() override
+	{
+		if (!options)
+			{
+			options = init_options(nullptr);
+			filter_add_defaults();
+			filter_rebuild();
+			}
+
+		saved_incremental = options->duplicates_incremental;
+		saved_caching = options->thumbnails.enable_caching;
+		options->duplicates_incremental = TRUE;
+		options->thumbnails.enable_caching = FALSE;
+
+		g_autofree gchar *tmp = g_dir_make_tmp("geeqie-dupe-engine-XXXXXX", nullptr);
+		ASSERT_NE(nullptr, tmp);
+
+		dir = tmp;
+		loop = g_main_loop_new(nullptr, FALSE);
+
+		de = dupe_engine_new(DUPE_MATCH_SIM_LOW);
+		de->done_func = [this](DupeEngine *) { g_main_loop_quit(loop); };
+	}
+
+	void TearDown() override
+	{
+		if (de) dupe_engine_free(de);
+		g_main_loop_unref(loop);
+
+		std::filesystem::remove_all(dir);
+
+		options->duplicates_incremental = saved_incremental;
+		options->thumbnails.enable_caching = saved_caching;
+	}
+
+	/**
+	 * @brief Writes a 32x32 image of \a base with \a offset added to all values
+	 */
+	std::string write_image(const std::vector<guint8> &base, gint offset, const std::string &name)
+	{
+		GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, size, size);
+		const gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+		guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+
+		for (gint y = 0; y < size; y++)
+			{
+			for (gint x = 0; x < size * 3; x++)
+				{
+				pixels[(y * rowstride) + x] = base[(y * size * 3) + x] + offset;
+				}
+			}
+
+		const std::string path = dir + "/" + name + ".png";
+		const gboolean saved = gdk_pixbuf_save(pixbuf, path.c_str(), "png", nullptr, nullptr);
+		g_object_unref(pixbuf);
+		EXPECT_TRUE(saved);
+
+		return path;
+	}
+
+	static std::vector<guint8> random_base(guint seed)
+	{
+		std::mt19937 gen(seed);
+		std::uniform_int_distribution<gint> dist(0, 160);
+
+		std::vector<guint8> base(size * size * 3);
+		std::generate(base.begin(), base.end(), [&]() { return dist(gen); });
+
+		return base;
+	}
+
+	/**
+	 * @brief Adds the files of \a paths and waits for the check to finish
+	 */
+	void add_and_check(const std::vector<std::string> &paths)
+	{
+		GList *list = nullptr;
+		for (const auto &path : paths)
+			{
+			list = g_list_append(list, file_data_new_simple(path.c_str()));
+			}
+
+		dupe_engine_add_files(de, list, FALSE);
+		file_data_list_free(list);
+
+		g_main_loop_run(loop);
+	}
+
+	void recompare()
+	{
+		dupe_engine_recompare(de);
+		g_main_loop_run(loop);
+	}
+
+	std::vector<Group> groups() const
+	{
+		std::vector<Group> result;
+
+		for (GList *work = de->dupes; work; work = work->next)
+			{
+			auto *parent = static_cast<DupeItem *>(work->data);
+			Group group;
+
+			for (GList *g = parent->group; g; g = g->next)
+				{
+				auto *dm = static_cast<DupeMatch *>(g->data);
+				group.emplace_back(dm->di->fd->path, dm->rank);
+				}
+			std::sort(group.begin(), group.end());
+			group.emplace(group.begin(), parent->fd->path, parent->group_rank);
+
+			result.push_back(group);
+			}
+		std::sort(result.begin(), result.end());
+
+		return result;
+	}
+
+	static constexpr gint size = 32;
+
+	std::string dir;
+	GMainLoop *loop = nullptr;
+	DupeEngine *de = nullptr;
+	gboolean saved_incremental = FALSE;
+	gboolean saved_caching = FALSE;
+};
+
+} // anonymous namespace
+
+TEST_F(DupeEngineTest, IncrementalCheckMatchesFullCheck)
+{
+	/* Each image is similar to the ones up to 36 levels brighter or darker,
+	 * so the groups overlap and depend on which matches are trimmed. */
+	const std::vector<guint8> chain = random_base(1);
+	const std::vector<guint8> other = random_base(2);
+
+	std::vector<std::string> first;
+	std::vector<std::string> second;
+	for (gint step = 0; step < 6; step++)
+		{
+		const std::string path = write_image(chain, step * 12, "chain-" + std::to_string(step));
+		(step % 2 == 0 ? first : second).push_back(path);
+		}
+	first.push_back(write_image(other, 0, "other-0"));
+	second.push_back(write_image(other, 6, "other-1"));
+
+	add_and_check(first);
+	add_and_check(second);
+	const std::vector<Group> incremental = groups();
+	ASSERT_FALSE(incremental.empty());
+
+	recompare();
+	EXPECT_EQ(groups(), incremental);
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for dupe-session.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#include <glib.h>
+
+#include "dupe-session.h"
+
+namespace {
+
+// For convenience.
+namespace t = ::testing;
+
+class DupeSessionTest : public t::Test
+{
+    protected:
+	void SetUp() override
+	{
+		g_autofree gchar *tmp = g_dir_make_tmp("geeqie-dupe-session-XXXXXX", nullptr);
+		ASSERT_NE(nullptr, tmp);
+
+		dir = tmp;
+		path = dir + "/session";
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove_all(dir);
+	}
+
+	static DupeSession make_session()
+	{
+		DupeSession session;
+		session.settings = {1 << 7, 99, TRUE, FALSE};
+		session.second_set = TRUE;
+
+		session.items.push_back({"/photos/a.jpg", FALSE, 1000, 1700000000, std::string("0123456789abcdef0123456789abcdef"), {640, 480}, TRUE});
+		session.items.push_back({"/photos/with space\tand tab\n.jpg", FALSE, 2000, 1700000001, std::nullopt, {0, 0}, TRUE});
+		session.items.push_back({"/second/ä.jpg", TRUE, 3000, 1700000002, std::nullopt, {1, 2}, FALSE});
+
+		session.links.push_back({0, 1, 97.25});
+		session.links.push_back({0, 2, 0.0});
+
+		return session;
+	}
+
+	std::string dir;
+	std::string path;
+};
+
+} // anonymous namespace
+
+TEST_F(DupeSessionTest, RoundTrip)
+{
+	const DupeSession saved = make_session();
+	ASSERT_TRUE(saved.save(path.c_str()));
+
+	DupeSession loaded;
+	ASSERT_TRUE(loaded.load(path.c_str()));
+
+	EXPECT_TRUE(saved.settings == loaded.settings);
+	EXPECT_EQ(saved.second_set, loaded.second_set);
+
+	ASSERT_EQ(saved.items.size(), loaded.items.size());
+	for (gsize i = 0; i < saved.items.size(); i++)
+		{
+		EXPECT_EQ(saved.items[i].path, loaded.items[i].path);
+		EXPECT_EQ(saved.items[i].second, loaded.items[i].second);
+		EXPECT_EQ(saved.items[i].size, loaded.items[i].size);
+		EXPECT_EQ(saved.items[i].date, loaded.items[i].date);
+		EXPECT_EQ(saved.items[i].md5sum, loaded.items[i].md5sum);
+		EXPECT_EQ(saved.items[i].dimensions, loaded.items[i].dimensions);
+		EXPECT_EQ(saved.items[i].compared, loaded.items[i].compared);
+		}
+
+	ASSERT_EQ(saved.links.size(), loaded.links.size());
+	for (gsize i = 0; i < saved.links.size(); i++)
+		{
+		EXPECT_EQ(saved.links[i].a, loaded.links[i].a);
+		EXPECT_EQ(saved.links[i].b, loaded.links[i].b);
+		EXPECT_DOUBLE_EQ(saved.links[i].rank, loaded.links[i].rank);
+		}
+}
+
+TEST_F(DupeSessionTest, MissingFile)
+{
+	DupeSession session;
+	EXPECT_FALSE(session.load(path.c_str()));
+}
+
+TEST_F(DupeSessionTest, ForeignFileIsRejected)
+{
+	ASSERT_TRUE(g_file_set_contents(path.c_str(), "#Geeqie collection\n\"/photos/a.jpg\"\n", -1, nullptr));
+
+	DupeSession session;
+	EXPECT_FALSE(session.load(path.c_str()));
+}
+
+TEST_F(DupeSessionTest, InvalidLinksAreDropped)
+{
+	const DupeSession saved = make_session();
+	ASSERT_TRUE(saved.save(path.c_str()));
+
+	FILE *f = fopen(path.c_str(), "a");
+	ASSERT_NE(nullptr, f);
+	fputs("link 0 3 50\nlink 1 1 50\nlink -1 0 50\nlink 0 1\n", f);
+	fclose(f);
+
+	DupeSession loaded;
+	ASSERT_TRUE(loaded.load(path.c_str()));
+	EXPECT_EQ(saved.links.size(), loaded.links.size());
+}
+
+TEST_F(DupeSessionTest, InvalidSettingsMatchNothing)
+{
+	ASSERT_TRUE(g_file_set_contents(path.c_str(), "#Geeqie duplicates session 1\nsettings 128 x 1 0\n", -1, nullptr));
+
+	DupeSession loaded;
+	ASSERT_TRUE(loaded.load(path.c_str()));
+	EXPECT_EQ(0U, loaded.settings.match_mask);
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
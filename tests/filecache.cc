@@ -24,6 +24,13 @@
 
 #include "gtest/gtest.h"
 
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
 #include <glib.h>
 
 #include "filecache.h"
@@ -37,12 +44,22 @@ namespace t = ::testing;
 class FileCacheTest : public t::Test
 {
     protected:
+	void SetUp() override
+	{
+		g_autofree gchar *tmp = g_dir_make_tmp("geeqie-filecache-XXXXXX", nullptr);
+		ASSERT_NE(nullptr, tmp);
+
+		dir = tmp;
+	}
+
 	void TearDown() override
 	{
 		// Free Refs before cleaning up fd_funcs
 		fd.reset(nullptr);
 		fd2.reset(nullptr);
 
+		std::filesystem::remove_all(dir);
+
 		// We have to clean this up by hand since the notify funcs are stored in a global.
 		for (const auto notify_func_pair : unregister_fd_funcs_at_teardown)
 			{
@@ -61,6 +78,17 @@ class FileCacheTest : public t::Test
 		std::cerr << "released " << static_cast<void *>(fd) << " (" << fd->path << ")\n";
 	}
 
+	static void cache_release_quiet(FileData *) {}
+
+	/* A FileData for a file that exists, so that it stays in the cache */
+	FileDataRef new_existing(const std::string &name)
+	{
+		const std::string path = dir + "/" + name;
+		EXPECT_TRUE(g_file_set_contents(path.c_str(), name.c_str(), -1, nullptr));
+		return FileData::new_simple(path.c_str(), &context);
+	}
+
+	std::string dir;
 	FileDataContext context;  // Needs to be constructed before Refs.
 	FileDataRef fd{nullptr};
 	FileDataRef fd2{nullptr};
@@ -174,6 +202,186 @@ TEST_F(FileCacheTest, ReentrantNotifyPutGet)
 	ASSERT_EQ(1, cache_and_fds.trigger_count);
 }
 
+TEST_F(FileCacheTest, CountsHitsAndMisses)
+{
+	fd = new_existing("a.jpg");
+	fd2 = new_existing("b.jpg");
+	FileCache fc(&FileCacheTest::cache_release, /*max_size=*/5);
+
+	EXPECT_FALSE(fc.get(fd));
+	fc.put(fd, /*size=*/2);
+	EXPECT_TRUE(fc.get(fd));
+	EXPECT_TRUE(fc.get(fd));
+	EXPECT_FALSE(fc.get(fd2));
+
+	// A put of an entry that is already cached changes nothing.
+	fc.put(fd, /*size=*/2);
+
+	EXPECT_EQ(2U, fc.get_stats().hits);
+	EXPECT_EQ(2U, fc.get_stats().misses);
+	EXPECT_EQ(0U, fc.get_stats().evictions);
+	EXPECT_EQ(1U, fc.get_count());
+	EXPECT_EQ(2U, fc.get_size());
+}
+
+TEST_F(FileCacheTest, ContainsDoesNotTouchEntries)
+{
+	fd = new_existing("a.jpg");
+	fd2 = new_existing("b.jpg");
+	FileDataRef fd3 = new_existing("c.jpg");
+	FileCache fc(&FileCacheTest::cache_release, /*max_size=*/5);
+
+	fc.put(fd, /*size=*/2);
+	fc.put(fd2, /*size=*/2);
+
+	// Leaves fd the least recently used entry.
+	EXPECT_TRUE(fc.contains(fd));
+	EXPECT_FALSE(fc.contains(fd3));
+	EXPECT_EQ(0U, fc.get_stats().hits);
+	EXPECT_EQ(0U, fc.get_stats().misses);
+
+	fc.put(fd3, /*size=*/2);
+	EXPECT_FALSE(fc.contains(fd));
+	EXPECT_TRUE(fc.contains(fd2));
+	EXPECT_TRUE(fc.contains(fd3));
+}
+
+TEST_F(FileCacheTest, EvictsLeastRecentlyUsed)
+{
+	fd = new_existing("a.jpg");
+	fd2 = new_existing("b.jpg");
+	FileDataRef fd3 = new_existing("c.jpg");
+	FileCache fc(&FileCacheTest::cache_release, /*max_size=*/5);
+
+	fc.put(fd, /*size=*/2);
+	fc.put(fd2, /*size=*/2);
+
+	// Makes fd2 the least recently used entry.
+	EXPECT_TRUE(fc.get(fd));
+
+	fc.put(fd3, /*size=*/2);
+	EXPECT_EQ(1U, fc.get_stats().evictions);
+	EXPECT_EQ(2U, fc.get_count());
+	EXPECT_EQ(4U, fc.get_size());
+
+	EXPECT_TRUE(fc.get(fd));
+	EXPECT_FALSE(fc.get(fd2));
+	EXPECT_TRUE(fc.get(fd3));
+}
+
+TEST_F(FileCacheTest, SetMaxSizeEvicts)
+{
+	fd = new_existing("a.jpg");
+	fd2 = new_existing("b.jpg");
+	FileCache fc(&FileCacheTest::cache_release, /*max_size=*/10);
+
+	fc.put(fd, /*size=*/3);
+	fc.put(fd2, /*size=*/4);
+	EXPECT_EQ(7U, fc.get_size());
+
+	// Only the older entry has to go.
+	fc.set_max_size(5);
+	EXPECT_EQ(4U, fc.get_size());
+	EXPECT_FALSE(fc.get(fd));
+	EXPECT_TRUE(fc.get(fd2));
+
+	fc.set_max_size(0);
+	EXPECT_EQ(0U, fc.get_size());
+	EXPECT_EQ(0U, fc.get_count());
+	EXPECT_EQ(2U, fc.get_stats().evictions);
+}
+
+TEST_F(FileCacheTest, NotifyChangeRemovesEntry)
+{
+	fd = new_existing("a.jpg");
+	FileCache fc(&FileCacheTest::cache_release, /*max_size=*/5);
+
+	fc.put(fd, /*size=*/1);
+	file_data_send_notification(fd, NOTIFY_CHANGE);
+
+	EXPECT_EQ(0U, fc.get_count());
+	EXPECT_EQ(0U, fc.get_size());
+	EXPECT_EQ(0U, fc.get_stats().evictions);
+	EXPECT_FALSE(fc.get(fd));
+}
+
+TEST_F(FileCacheTest, RemoveReleasesEntry)
+{
+	fd = new_existing("a.jpg");
+	fd2 = new_existing("b.jpg");
+	FileCache fc(&FileCacheTest::cache_release, /*max_size=*/5);
+
+	fc.put(fd, /*size=*/1);
+	fc.put(fd2, /*size=*/2);
+
+	fc.remove(fd);
+	EXPECT_EQ(1U, fc.get_count());
+	EXPECT_EQ(2U, fc.get_size());
+	EXPECT_EQ(0U, fc.get_stats().evictions);
+	EXPECT_FALSE(fc.get(fd));
+	EXPECT_TRUE(fc.get(fd2));
+
+	// Not in the cache.
+	fc.remove(fd);
+	EXPECT_EQ(1U, fc.get_count());
+
+	// Can be put again, with another size.
+	fc.put(fd, /*size=*/3);
+	EXPECT_EQ(5U, fc.get_size());
+}
+
+/**
+ * Times lookups and evictions with many entries.  Not part of the unit tests, run by:
+ * meson test --benchmark
+ **/
+TEST_F(FileCacheTest, DISABLED_Benchmark)
+{
+	constexpr size_t entry_count = 20000;
+	constexpr size_t lookup_count = 200000;
+
+	std::vector<FileDataRef> fds;
+	fds.reserve(entry_count);
+	for (size_t i = 0; i < entry_count; i++)
+		{
+		fds.push_back(new_existing("image-" + std::to_string(i) + ".jpg"));
+		}
+
+	FileCache fc(&FileCacheTest::cache_release_quiet, entry_count);
+	std::mt19937 rng(entry_count);
+	std::uniform_int_distribution<size_t> pick(0, entry_count - 1);
+
+	auto start = std::chrono::steady_clock::now();
+	for (const auto &entry_fd : fds)
+		{
+		fc.put(entry_fd, /*size=*/1);
+		}
+	const std::chrono::duration<double, std::micro> put_time = std::chrono::steady_clock::now() - start;
+
+	start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < lookup_count; i++)
+		{
+		fc.get(fds[pick(rng)]);
+		}
+	const std::chrono::duration<double, std::micro> get_time = std::chrono::steady_clock::now() - start;
+
+	// Half the size, so that every put of a missing entry evicts one.
+	fc.set_max_size(entry_count / 2);
+	start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < lookup_count; i++)
+		{
+		const auto &entry_fd = fds[pick(rng)];
+		if (!fc.get(entry_fd)) fc.put(entry_fd, /*size=*/1);
+		}
+	const std::chrono::duration<double, std::micro> churn_time = std::chrono::steady_clock::now() - start;
+
+	EXPECT_EQ(2 * lookup_count, fc.get_stats().hits + fc.get_stats().misses);
+
+	std::cout << "put: " << put_time.count() / entry_count << " us, "
+	          << "get: " << get_time.count() / lookup_count << " us, "
+	          << "get or put: " << churn_time.count() / lookup_count << " us, "
+	          << fc.get_stats().evictions << " evictions\n";
+}
+
 }  // anonymous namespace
 
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for hash-util.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <glib.h>
+
+#include "hash-util.h"
+
+namespace {
+
+// For convenience.
+namespace t = ::testing;
+
+class HashTest : public t::Test
+{
+    protected:
+	void SetUp() override
+	{
+		g_autofree gchar *tmp = g_dir_make_tmp("geeqie-hash-XXXXXX", nullptr);
+		ASSERT_NE(nullptr, tmp);
+
+		dir = tmp;
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove_all(dir);
+	}
+
+	std::string write_file(const gchar *name, const std::vector<guchar> &data)
+	{
+		std::string path = dir + "/" + name;
+		EXPECT_TRUE(g_file_set_contents(path.c_str(), reinterpret_cast<const gchar *>(data.data()), data.size(), nullptr));
+		return path;
+	}
+
+	static std::vector<guchar> make_data(gsize size, guchar seed)
+	{
+		std::vector<guchar> data(size);
+		for (gsize i = 0; i < size; i++)
+			{
+			data[i] = (i * 31 + seed) & 0xff;
+			}
+		return data;
+	}
+
+	std::string dir;
+};
+
+} // anonymous namespace
+
+TEST_F(HashTest, Md5MatchesGlib)
+{
+	/* Larger than the read buffer */
+	const std::vector<guchar> data = make_data(3 * 1024 * 1024 + 17, 1);
+	const std::string path = write_file("a", data);
+
+	g_autofree gchar *expected = g_compute_checksum_for_data(G_CHECKSUM_MD5, data.data(), data.size());
+	EXPECT_EQ(expected, hash_get_string_from_file(HashType::MD5, path.c_str()));
+}
+
+TEST_F(HashTest, FastHashOfFileMatchesData)
+{
+	const std::vector<guchar> data = make_data(100000, 2);
+	const std::string path = write_file("a", data);
+
+	Hash hash(HashType::FAST);
+	hash.update(data.data(), data.size());
+	EXPECT_EQ(hash.get_string(), hash_get_string_from_file(HashType::FAST, path.c_str()));
+}
+
+TEST_F(HashTest, MissingFileHasNoHash)
+{
+	const std::string path = dir + "/missing";
+
+	EXPECT_TRUE(hash_get_string_from_file(HashType::MD5, path.c_str()).empty());
+	EXPECT_TRUE(hash_get_string_from_file_ends(HashType::FAST, path.c_str(), 1024).empty());
+}
+
+TEST_F(HashTest, EndsIgnoreTheMiddle)
+{
+	std::vector<guchar> data = make_data(10000, 3);
+	const std::string a = write_file("a", data);
+
+	data[5000] ^= 0xff;
+	const std::string b = write_file("b", data);
+
+	EXPECT_EQ(hash_get_string_from_file_ends(HashType::FAST, a.c_str(), 1024),
+	          hash_get_string_from_file_ends(HashType::FAST, b.c_str(), 1024));
+	EXPECT_NE(hash_get_string_from_file(HashType::FAST, a.c_str()),
+	          hash_get_string_from_file(HashType::FAST, b.c_str()));
+
+	data[9999] ^= 0xff;
+	const std::string c = write_file("c", data);
+
+	EXPECT_NE(hash_get_string_from_file_ends(HashType::FAST, a.c_str(), 1024),
+	          hash_get_string_from_file_ends(HashType::FAST, c.c_str(), 1024));
+}
+
+TEST_F(HashTest, DigestOfMd5)
+{
+	const std::vector<guchar> data = make_data(1000, 4);
+
+	Hash hash(HashType::MD5);
+	hash.update(data.data(), data.size());
+
+	guint8 digest[16];
+	gsize length = sizeof(digest);
+	ASSERT_TRUE(hash.get_digest(digest, length));
+	EXPECT_EQ(16U, length);
+
+	g_autoptr(GChecksum) checksum = g_checksum_new(G_CHECKSUM_MD5);
+	g_checksum_update(checksum, data.data(), data.size());
+	guint8 expected[16];
+	gsize expected_length = sizeof(expected);
+	g_checksum_get_digest(checksum, expected, &expected_length);
+
+	EXPECT_EQ(0, memcmp(expected, digest, sizeof(digest)));
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for image-load-formats.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <string_view>
+#include <vector>
+
+#include <config.h>
+#include <glib.h>
+
+#include "image-load-formats.h"
+
+namespace {
+
+// For convenience.
+namespace t = ::testing;
+
+/* The file contents, padded with zero bytes to size */
+std::vector<guchar> make_data(std::string_view start, gsize size = 64)
+{
+	std::vector<guchar> data(start.begin(), start.end());
+	data.resize(std::max(size, start.size()));
+	return data;
+}
+
+const gchar *find_name(const std::vector<guchar> &data, const gchar *path = "/photos/image")
+{
+	const ImageLoaderFormat *format = image_loader_format_find(data.data(), data.size(), path);
+	return format ? format->name : nullptr;
+}
+
+} // anonymous namespace
+
+using namespace std::literals::string_view_literals;
+
+TEST(ImageLoadFormatsTest, FindsByMagic)
+{
+	EXPECT_STREQ("dds", find_name(make_data("DDS |"sv)));
+	EXPECT_STREQ("psd", find_name(make_data("8BPS\0\x01"sv)));
+#if HAVE_JPEG
+	EXPECT_STREQ("jpeg", find_name(make_data("\xFF\xD8\xFF\xE0"sv)));
+#endif
+#if HAVE_TIFF
+	EXPECT_STREQ("tiff", find_name(make_data("II*\0"sv)));
+	EXPECT_STREQ("tiff", find_name(make_data("MM\0*"sv)));
+#endif
+#if HAVE_HEIF
+	EXPECT_STREQ("heif", find_name(make_data("\0\0\0\x18" "ftypavif"sv)));
+#endif
+#if HAVE_WEBP
+	EXPECT_STREQ("webp", find_name(make_data("RIFF\0\0\0\0WEBPVP8 "sv)));
+	EXPECT_EQ(nullptr, find_name(make_data("RIFF\0\0\0\0WAVEfmt "sv)));
+#endif
+}
+
+TEST(ImageLoadFormatsTest, DefaultLoaderForOtherFormats)
+{
+	EXPECT_EQ(nullptr, find_name(make_data("\x89PNG\r\n\x1A\n"sv)));
+	EXPECT_EQ(nullptr, find_name(make_data("GIF89a"sv)));
+	EXPECT_EQ(nullptr, find_name({}));
+}
+
+TEST(ImageLoadFormatsTest, MagicMustFit)
+{
+	EXPECT_STREQ("psd", find_name(make_data("8BPS\0\x01"sv, 6)));
+	EXPECT_EQ(nullptr, find_name(make_data("8BPS\0"sv, 5)));
+}
+
+TEST(ImageLoadFormatsTest, FindsByExtension)
+{
+	const std::vector<guchar> screen = make_data("\x01\x02"sv, 6912);
+
+	EXPECT_STREQ("zxscr", find_name(screen, "/speccy/game.SCR"));
+	EXPECT_EQ(nullptr, find_name(screen, "/speccy/game.bin"));
+	EXPECT_EQ(nullptr, find_name(screen, nullptr));
+
+	/* a screen dump has a fixed size */
+	EXPECT_EQ(nullptr, find_name(make_data("\x01\x02"sv, 6000), "/speccy/game.scr"));
+
+	EXPECT_STREQ("svgz", find_name(make_data("\x1F\x8B"sv), "/drawings/logo.svgz"));
+}
+
+TEST(ImageLoadFormatsTest, MagicBeforeExtension)
+{
+	EXPECT_STREQ("dds", find_name(make_data("DDS |"sv, 6912), "/speccy/game.scr"));
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for jpeg-parser.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include <glib.h>
+
+#include "jpeg-parser.h"
+
+namespace {
+
+// For convenience.
+namespace t = ::testing;
+
+/* 64x64, 4:2:0, so 4x4 MCUs of 16x16 pixels */
+constexpr guint IMAGE_SIZE = 64;
+constexpr guint MCU_ROWS = 4;
+constexpr guint MCUS_PER_ROW = 4;
+
+/* Headers and fake entropy-coded data, with a restart marker every restart_interval MCUs */
+std::vector<guchar> make_jpeg(guint restart_interval, guint marker_count)
+{
+	std::vector<guchar> data{
+		0xff, 0xd8,
+		0xff, 0xdd, 0x00, 0x04, 0x00, static_cast<guchar>(restart_interval),
+		0xff, 0xc0, 0x00, 0x11, 0x08, 0x00, IMAGE_SIZE, 0x00, IMAGE_SIZE, 0x03,
+		0x01, 0x22, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11, 0x01,
+		0xff, 0xda, 0x00, 0x0c, 0x03, 0x01, 0x00, 0x02, 0x11, 0x03, 0x11, 0x00, 0x3f, 0x00
+	};
+
+	for (guint i = 0; i <= marker_count; i++)
+		{
+		if (i > 0)
+			{
+			data.push_back(0xff);
+			data.push_back(JPEG_MARKER_RST0 + ((i - 1) & 7));
+			}
+
+		/* interval data, with a stuffed 0xff byte */
+		data.push_back(0x10 + i);
+		data.push_back(0xff);
+		data.push_back(0x00);
+		}
+
+	data.push_back(0xff);
+	data.push_back(0xd9);
+
+	return data;
+}
+
+/* The restart markers of a band, in order */
+std::vector<guchar> band_restart_markers(const JpegRestartBand &band)
+{
+	std::vector<guchar> markers;
+
+	for (gsize i = 0; i + 1 < band.data.size(); i++)
+		{
+		if (band.data[i] == 0xff && band.data[i + 1] >= JPEG_MARKER_RST0 && band.data[i + 1] <= JPEG_MARKER_RST7)
+			{
+			markers.push_back(band.data[i + 1]);
+			}
+		}
+
+	return markers;
+}
+
+} // anonymous namespace
+
+TEST(JpegParserTest, SplitsAtRowRestartMarkers)
+{
+	const std::vector<guchar> data = make_jpeg(MCUS_PER_ROW, MCU_ROWS - 1);
+
+	const std::vector<JpegRestartBand> bands = jpeg_split_restart_bands(data.data(), data.size(), 2);
+	ASSERT_EQ(2U, bands.size());
+
+	EXPECT_EQ(0U, bands[0].row);
+	EXPECT_EQ(32U, bands[0].height);
+	EXPECT_EQ(32U, bands[1].row);
+	EXPECT_EQ(32U, bands[1].height);
+
+	for (const JpegRestartBand &band : bands)
+		{
+		/* image height in the frame header */
+		EXPECT_EQ(band.height, (static_cast<guint>(band.data[13]) << 8) + band.data[14]);
+
+		EXPECT_EQ(0xff, band.data[band.data.size() - 2]);
+		EXPECT_EQ(0xd9, band.data[band.data.size() - 1]);
+
+		/* two rows, one restart marker between them, numbered from 0 */
+		EXPECT_EQ(std::vector<guchar>{JPEG_MARKER_RST0}, band_restart_markers(band));
+		}
+
+	/* the second band starts with the data of the third interval */
+	EXPECT_EQ(0x12, bands[1].data[41]);
+}
+
+TEST(JpegParserTest, SplitsOnlyAtRowStarts)
+{
+	/* with a restart marker every 3 MCUs, only MCU 12 starts a row */
+	const std::vector<guchar> data = make_jpeg(3, 5);
+
+	const std::vector<JpegRestartBand> bands = jpeg_split_restart_bands(data.data(), data.size(), 4);
+	ASSERT_EQ(2U, bands.size());
+
+	EXPECT_EQ(0U, bands[0].row);
+	EXPECT_EQ(48U, bands[0].height);
+	EXPECT_EQ(48U, bands[1].row);
+	EXPECT_EQ(16U, bands[1].height);
+
+	EXPECT_EQ((std::vector<guchar>{0xd0, 0xd1, 0xd2}), band_restart_markers(bands[0]));
+	EXPECT_EQ(std::vector<guchar>{0xd0}, band_restart_markers(bands[1]));
+}
+
+TEST(JpegParserTest, SplitsWithMargin)
+{
+	const std::vector<guchar> data = make_jpeg(MCUS_PER_ROW, MCU_ROWS - 1);
+
+	const std::vector<JpegRestartBand> bands = jpeg_split_restart_bands(data.data(), data.size(), 2, 1);
+	ASSERT_EQ(2U, bands.size());
+
+	/* each band holds one MCU row of the other one */
+	EXPECT_EQ(0U, bands[0].row);
+	EXPECT_EQ(48U, bands[0].height);
+	EXPECT_EQ(0U, bands[0].keep_row);
+	EXPECT_EQ(32U, bands[0].keep_height);
+
+	EXPECT_EQ(16U, bands[1].row);
+	EXPECT_EQ(48U, bands[1].height);
+	EXPECT_EQ(32U, bands[1].keep_row);
+	EXPECT_EQ(32U, bands[1].keep_height);
+
+	for (const JpegRestartBand &band : bands)
+		{
+		EXPECT_EQ(band.height, (static_cast<guint>(band.data[13]) << 8) + band.data[14]);
+		EXPECT_EQ((std::vector<guchar>{JPEG_MARKER_RST0, JPEG_MARKER_RST0 + 1}), band_restart_markers(band));
+		}
+
+	/* the second band starts with the data of the second interval */
+	EXPECT_EQ(0x11, bands[1].data[41]);
+}
+
+TEST(JpegParserTest, MarginWidensToRowStarts)
+{
+	/* with a restart marker every 3 MCUs, only MCU 12 starts a row */
+	const std::vector<guchar> data = make_jpeg(3, 5);
+
+	const std::vector<JpegRestartBand> bands = jpeg_split_restart_bands(data.data(), data.size(), 4, 1);
+	ASSERT_EQ(2U, bands.size());
+
+	EXPECT_EQ(0U, bands[0].row);
+	EXPECT_EQ(64U, bands[0].height);
+	EXPECT_EQ(48U, bands[0].keep_height);
+
+	EXPECT_EQ(0U, bands[1].row);
+	EXPECT_EQ(64U, bands[1].height);
+	EXPECT_EQ(48U, bands[1].keep_row);
+	EXPECT_EQ(16U, bands[1].keep_height);
+}
+
+TEST(JpegParserTest, NoSplitWithoutRestartMarkers)
+{
+	std::vector<guchar> data = make_jpeg(MCUS_PER_ROW, 0);
+
+	EXPECT_TRUE(jpeg_split_restart_bands(data.data(), data.size(), 2).empty());
+
+	/* no restart interval */
+	data[7] = 0;
+	EXPECT_TRUE(jpeg_split_restart_bands(data.data(), data.size(), 2).empty());
+}
+
+TEST(JpegParserTest, NoSplitIntoOneBand)
+{
+	const std::vector<guchar> data = make_jpeg(MCUS_PER_ROW, MCU_ROWS - 1);
+
+	EXPECT_TRUE(jpeg_split_restart_bands(data.data(), data.size(), 1).empty());
+}
+
+TEST(JpegParserTest, CopiesBandOfMiddleRows)
+{
+	const std::vector<guchar> data = make_jpeg(MCUS_PER_ROW, MCU_ROWS - 1);
+
+	JpegRestartIndex index;
+	ASSERT_TRUE(jpeg_get_restart_index(data.data(), data.size(), index));
+	EXPECT_EQ(16U, index.mcu_height);
+	EXPECT_EQ(MCU_ROWS, index.mcu_rows);
+	EXPECT_EQ(MCU_ROWS - 1, index.restart_markers.size());
+
+	const JpegRestartBand band = jpeg_get_restart_band(data.data(), index, 1, 3);
+
+	EXPECT_EQ(16U, band.row);
+	EXPECT_EQ(32U, band.height);
+	EXPECT_EQ(band.height, (static_cast<guint>(band.data[13]) << 8) + band.data[14]);
+
+	/* the data of the second and third interval, renumbered from 0 */
+	EXPECT_EQ(0x11, band.data[41]);
+	EXPECT_EQ(std::vector<guchar>{JPEG_MARKER_RST0}, band_restart_markers(band));
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,430 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for pixbuf-scale.cc
+ *
+ * The benchmark against gdk-pixbuf is disabled by default, run it with:
+ * meson test --benchmark
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "exif.h"
+#include "pixbuf-scale.h"
+
+namespace {
+
+// For convenience.
+namespace t = ::testing;
+
+constexpr GdkInterpType interp_types[] = {GDK_INTERP_NEAREST, GDK_INTERP_TILES, GDK_INTERP_BILINEAR, GDK_INTERP_HYPER};
+
+/* A pixbuf of the given pixels, row after row */
+GdkPixbuf *make_pixbuf(gint width, gint height, gboolean has_alpha, const std::vector<guchar> &pixels)
+{
+	const gint channels = has_alpha ? 4 : 3;
+	GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, has_alpha, 8, width, height);
+
+	for (gint y = 0; y < height; y++)
+		{
+		std::copy_n(pixels.begin() + (y * width * channels), width * channels,
+		            gdk_pixbuf_get_pixels(pixbuf) + (y * gdk_pixbuf_get_rowstride(pixbuf)));
+		}
+
+	return pixbuf;
+}
+
+GdkPixbuf *make_random_pixbuf(gint width, gint height, gboolean has_alpha)
+{
+	std::mt19937 rng(width * height);
+	std::uniform_int_distribution<gint> value(0, 255);
+	std::vector<guchar> pixels(width * height * (has_alpha ? 4 : 3));
+
+	std::generate(pixels.begin(), pixels.end(), [&]() { return value(rng); });
+
+	return make_pixbuf(width, height, has_alpha, pixels);
+}
+
+/* The pixels of an area, row after row */
+std::vector<guchar> area_pixels(const GdkPixbuf *pixbuf, gint x, gint y, gint width, gint height)
+{
+	const gint channels = gdk_pixbuf_get_n_channels(pixbuf);
+	std::vector<guchar> pixels;
+
+	for (gint row = y; row < y + height; row++)
+		{
+		const guchar *p = gdk_pixbuf_read_pixels(pixbuf) + (row * gdk_pixbuf_get_rowstride(pixbuf)) + (x * channels);
+		pixels.insert(pixels.end(), p, p + (width * channels));
+		}
+
+	return pixels;
+}
+
+std::vector<guchar> all_pixels(const GdkPixbuf *pixbuf)
+{
+	return area_pixels(pixbuf, 0, 0, gdk_pixbuf_get_width(pixbuf), gdk_pixbuf_get_height(pixbuf));
+}
+
+/* A copy of pixbuf as shown with an EXIF orientation, pixel by pixel */
+GdkPixbuf *make_oriented_pixbuf(const GdkPixbuf *pixbuf, gint orientation)
+{
+	const gint width = gdk_pixbuf_get_width(pixbuf);
+	const gint height = gdk_pixbuf_get_height(pixbuf);
+	const gint channels = gdk_pixbuf_get_n_channels(pixbuf);
+	const bool transposed = orientation >= EXIF_ORIENTATION_LEFT_TOP;
+	const gint oriented_width = transposed ? height : width;
+	const gint oriented_height = transposed ? width : height;
+	GdkPixbuf *oriented = gdk_pixbuf_new(GDK_COLORSPACE_RGB, gdk_pixbuf_get_has_alpha(pixbuf), 8,
+	                                     oriented_width, oriented_height);
+
+	for (gint j = 0; j < oriented_height; j++)
+		{
+		for (gint i = 0; i < oriented_width; i++)
+			{
+			gint x = i;
+			gint y = j;
+
+			switch (orientation)
+				{
+				case EXIF_ORIENTATION_TOP_RIGHT: x = width - 1 - i; break;
+				case EXIF_ORIENTATION_BOTTOM_RIGHT: x = width - 1 - i; y = height - 1 - j; break;
+				case EXIF_ORIENTATION_BOTTOM_LEFT: y = height - 1 - j; break;
+				case EXIF_ORIENTATION_LEFT_TOP: x = j; y = i; break;
+				case EXIF_ORIENTATION_RIGHT_TOP: x = j; y = height - 1 - i; break;
+				case EXIF_ORIENTATION_RIGHT_BOTTOM: x = width - 1 - j; y = height - 1 - i; break;
+				case EXIF_ORIENTATION_LEFT_BOTTOM: x = width - 1 - j; y = i; break;
+				default: break;
+				}
+
+			std::copy_n(gdk_pixbuf_read_pixels(pixbuf) + (y * gdk_pixbuf_get_rowstride(pixbuf)) + (x * channels), channels,
+			            gdk_pixbuf_get_pixels(oriented) + (j * gdk_pixbuf_get_rowstride(oriented)) + (i * channels));
+			}
+		}
+
+	return oriented;
+}
+
+/* Whether an orientation runs the x or the y axis of the shown image backwards */
+bool orientation_reverses_x(gint orientation)
+{
+	return orientation == EXIF_ORIENTATION_TOP_RIGHT || orientation == EXIF_ORIENTATION_BOTTOM_RIGHT ||
+	       orientation == EXIF_ORIENTATION_RIGHT_TOP || orientation == EXIF_ORIENTATION_RIGHT_BOTTOM;
+}
+
+bool orientation_reverses_y(gint orientation)
+{
+	return orientation == EXIF_ORIENTATION_BOTTOM_RIGHT || orientation == EXIF_ORIENTATION_BOTTOM_LEFT ||
+	       orientation == EXIF_ORIENTATION_RIGHT_BOTTOM || orientation == EXIF_ORIENTATION_LEFT_BOTTOM;
+}
+
+} // anonymous namespace
+
+TEST(PixbufScaleTest, CopiesAtScaleOne)
+{
+	for (gboolean has_alpha : {FALSE, TRUE})
+		{
+		g_autoptr(GdkPixbuf) src = make_random_pixbuf(37, 23, has_alpha);
+
+		for (GdkInterpType interp_type : interp_types)
+			{
+			g_autoptr(GdkPixbuf) dest = pixbuf_scale_simple(src, 37, 23, interp_type);
+
+			if (has_alpha)
+				{
+				/* the colors of transparent pixels are lost */
+				const std::vector<guchar> expected = all_pixels(src);
+				const std::vector<guchar> pixels = all_pixels(dest);
+
+				for (gsize i = 0; i < pixels.size(); i += 4)
+					{
+					EXPECT_EQ(expected[i + 3], pixels[i + 3]);
+					if (expected[i + 3] == 255)
+						{
+						EXPECT_EQ(expected[i], pixels[i]);
+						}
+					}
+				}
+			else
+				{
+				EXPECT_EQ(all_pixels(src), all_pixels(dest)) << "interp " << interp_type;
+				}
+			}
+		}
+}
+
+TEST(PixbufScaleTest, KeepsUniformColor)
+{
+	g_autoptr(GdkPixbuf) rgb = make_pixbuf(19, 11, FALSE, std::vector<guchar>(19 * 11 * 3, 200));
+	std::vector<guchar> rgba_pixels(19 * 11 * 4, 200);
+	for (gsize i = 3; i < rgba_pixels.size(); i += 4) rgba_pixels[i] = 128;
+	g_autoptr(GdkPixbuf) rgba = make_pixbuf(19, 11, TRUE, rgba_pixels);
+
+	for (gdouble scale : {0.3, 0.5, 1.7, 3.0})
+		{
+		for (GdkInterpType interp_type : interp_types)
+			{
+			const gint width = std::max(1, static_cast<gint>(19 * scale));
+			const gint height = std::max(1, static_cast<gint>(11 * scale));
+
+			g_autoptr(GdkPixbuf) dest = pixbuf_scale_simple(rgb, width, height, interp_type);
+			for (guchar value : all_pixels(dest))
+				{
+				ASSERT_EQ(200, value) << "scale " << scale << " interp " << interp_type;
+				}
+
+			g_autoptr(GdkPixbuf) dest_alpha = pixbuf_scale_simple(rgba, width, height, interp_type);
+			const std::vector<guchar> pixels = all_pixels(dest_alpha);
+			for (gsize i = 0; i < pixels.size(); i += 4)
+				{
+				/* premultiplied alpha rounds the colors */
+				ASSERT_NEAR(200, pixels[i], 1) << "scale " << scale << " interp " << interp_type;
+				ASSERT_EQ(128, pixels[i + 3]) << "scale " << scale << " interp " << interp_type;
+				}
+			}
+		}
+}
+
+TEST(PixbufScaleTest, NearestRepeatsPixels)
+{
+	g_autoptr(GdkPixbuf) src = make_pixbuf(2, 1, FALSE, {10, 20, 30,  40, 50, 60});
+
+	g_autoptr(GdkPixbuf) dest = pixbuf_scale_simple(src, 4, 1, GDK_INTERP_NEAREST);
+
+	EXPECT_EQ((std::vector<guchar>{10, 20, 30,  10, 20, 30,  40, 50, 60,  40, 50, 60}), all_pixels(dest));
+}
+
+TEST(PixbufScaleTest, TilesAverageAreas)
+{
+	g_autoptr(GdkPixbuf) src = make_pixbuf(4, 2, FALSE, {
+		0, 0, 0,      100, 100, 100,  10, 20, 30,   10, 20, 30,
+		200, 0, 0,    0, 200, 2,      10, 20, 30,   10, 20, 31});
+
+	g_autoptr(GdkPixbuf) dest = pixbuf_scale_simple(src, 2, 1, GDK_INTERP_TILES);
+
+	EXPECT_EQ((std::vector<guchar>{75, 75, 26,  10, 20, 30}), all_pixels(dest));
+}
+
+TEST(PixbufScaleTest, WeightsColorsByAlpha)
+{
+	g_autoptr(GdkPixbuf) src = make_pixbuf(2, 1, TRUE, {255, 0, 0, 255,  0, 0, 255, 0});
+
+	g_autoptr(GdkPixbuf) dest = pixbuf_scale_simple(src, 1, 1, GDK_INTERP_TILES);
+
+	EXPECT_EQ((std::vector<guchar>{255, 0, 0, 128}), all_pixels(dest));
+}
+
+TEST(PixbufScaleTest, TilesMatchWholeImage)
+{
+	constexpr gint tile_size = 16;
+
+	for (gboolean has_alpha : {FALSE, TRUE})
+		{
+		g_autoptr(GdkPixbuf) src = make_random_pixbuf(50, 40, has_alpha);
+
+		for (GdkInterpType interp_type : interp_types)
+			{
+			for (gdouble scale : {0.4, 1.6})
+				{
+				const gint width = 50 * scale;
+				const gint height = 40 * scale;
+				g_autoptr(GdkPixbuf) whole = pixbuf_scale_simple(src, width, height, interp_type);
+				g_autoptr(GdkPixbuf) tile = gdk_pixbuf_new(GDK_COLORSPACE_RGB, has_alpha, 8, tile_size, tile_size);
+
+				for (gint y = 0; y < height; y += tile_size)
+					{
+					for (gint x = 0; x < width; x += tile_size)
+						{
+						const gint w = std::min(tile_size, width - x);
+						const gint h = std::min(tile_size, height - y);
+
+						pixbuf_scale(src, tile, 0, 0, w, h, -x, -y,
+						             static_cast<gdouble>(width) / 50, static_cast<gdouble>(height) / 40,
+						             interp_type);
+
+						ASSERT_EQ(area_pixels(whole, x, y, w, h), area_pixels(tile, 0, 0, w, h))
+						        << "tile " << x << "," << y << " interp " << interp_type << " scale " << scale;
+						}
+					}
+				}
+			}
+		}
+}
+
+TEST(PixbufScaleTest, OrientsPixels)
+{
+	for (gboolean has_alpha : {FALSE, TRUE})
+		{
+		std::vector<guchar> pixels(7 * 5 * (has_alpha ? 4 : 3));
+		for (gsize i = 0; i < pixels.size(); i++) pixels[i] = i;
+		if (has_alpha)
+			{
+			/* opaque, the colors of transparent pixels are lost */
+			for (gsize i = 3; i < pixels.size(); i += 4) pixels[i] = 255;
+			}
+		g_autoptr(GdkPixbuf) src = make_pixbuf(7, 5, has_alpha, pixels);
+
+		for (gint orientation = EXIF_ORIENTATION_TOP_LEFT; orientation <= EXIF_ORIENTATION_LEFT_BOTTOM; orientation++)
+			{
+			g_autoptr(GdkPixbuf) expected = make_oriented_pixbuf(src, orientation);
+			const gint width = gdk_pixbuf_get_width(expected);
+			const gint height = gdk_pixbuf_get_height(expected);
+
+			for (GdkInterpType interp_type : interp_types)
+				{
+				g_autoptr(GdkPixbuf) dest = gdk_pixbuf_new(GDK_COLORSPACE_RGB, has_alpha, 8, width, height);
+
+				pixbuf_scale(src, dest, 0, 0, width, height,
+				             orientation_reverses_x(orientation) ? width : 0,
+				             orientation_reverses_y(orientation) ? height : 0,
+				             1.0, 1.0, interp_type, orientation);
+
+				EXPECT_EQ(all_pixels(expected), all_pixels(dest))
+				        << "orientation " << orientation << " interp " << interp_type;
+				}
+			}
+		}
+}
+
+TEST(PixbufScaleTest, OrientedTilesMatchOrientedImage)
+{
+	constexpr gint tile_size = 16;
+
+	for (gboolean has_alpha : {FALSE, TRUE})
+		{
+		g_autoptr(GdkPixbuf) src = make_random_pixbuf(50, 40, has_alpha);
+
+		for (GdkInterpType interp_type : interp_types)
+			{
+			for (gdouble scale : {0.4, 1.6})
+				{
+				g_autoptr(GdkPixbuf) whole = pixbuf_scale_simple(src, 50 * scale, 40 * scale, interp_type);
+				g_autoptr(GdkPixbuf) tile = gdk_pixbuf_new(GDK_COLORSPACE_RGB, has_alpha, 8, tile_size, tile_size);
+
+				for (gint orientation = EXIF_ORIENTATION_TOP_RIGHT; orientation <= EXIF_ORIENTATION_LEFT_BOTTOM; orientation++)
+					{
+					g_autoptr(GdkPixbuf) expected = make_oriented_pixbuf(whole, orientation);
+					const gint width = gdk_pixbuf_get_width(expected);
+					const gint height = gdk_pixbuf_get_height(expected);
+
+					for (gint y = 0; y < height; y += tile_size)
+						{
+						for (gint x = 0; x < width; x += tile_size)
+							{
+							const gint w = std::min(tile_size, width - x);
+							const gint h = std::min(tile_size, height - y);
+
+							pixbuf_scale(src, tile, 0, 0, w, h,
+							             orientation_reverses_x(orientation) ? width - x : -x,
+							             orientation_reverses_y(orientation) ? height - y : -y,
+							             scale, scale, interp_type, orientation);
+
+							ASSERT_EQ(area_pixels(expected, x, y, w, h), area_pixels(tile, 0, 0, w, h))
+							        << "tile " << x << "," << y << " orientation " << orientation
+							        << " interp " << interp_type << " scale " << scale;
+							}
+						}
+					}
+				}
+			}
+		}
+}
+
+/**
+ * Compares the throughput and the results with gdk-pixbuf, scaling a photo
+ * sized image in tiles as the renderer does.  Not part of the unit tests, run by:
+ * meson test --benchmark
+ **/
+TEST(PixbufScaleTest, DISABLED_Benchmark)
+{
+	constexpr gint src_width = 3000;
+	constexpr gint src_height = 2000;
+	constexpr gint tile_size = 256;
+	constexpr gint dest_max = 2048;
+
+	/* smooth gradients with some noise, like a photo */
+	std::mt19937 rng(src_width);
+	std::uniform_int_distribution<gint> noise(-8, 8);
+	std::vector<guchar> pixels(src_width * src_height * 3);
+	for (gint y = 0; y < src_height; y++)
+		{
+		for (gint x = 0; x < src_width; x++)
+			{
+			guchar *p = pixels.data() + (((y * src_width) + x) * 3);
+			p[0] = std::clamp(static_cast<gint>(127.5 + 100 * std::sin(x / 37.0)) + noise(rng), 0, 255);
+			p[1] = std::clamp(static_cast<gint>(127.5 + 100 * std::cos(y / 23.0)) + noise(rng), 0, 255);
+			p[2] = std::clamp(((x ^ y) & 0xFF) + noise(rng), 0, 255);
+			}
+		}
+	g_autoptr(GdkPixbuf) src = make_pixbuf(src_width, src_height, FALSE, pixels);
+
+	for (GdkInterpType interp_type : {GDK_INTERP_BILINEAR, GDK_INTERP_HYPER})
+		{
+		for (gdouble scale : {0.125, 0.25, 0.5, 0.75, 1.5, 2.0, 4.0})
+			{
+			const gint width = std::min(dest_max, static_cast<gint>(src_width * scale));
+			const gint height = std::min(dest_max, static_cast<gint>(src_height * scale));
+			g_autoptr(GdkPixbuf) expected = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, width, height);
+			g_autoptr(GdkPixbuf) result = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, width, height);
+
+			const auto scale_tiles = [&](auto func, GdkPixbuf *dest)
+			{
+				const auto start = std::chrono::steady_clock::now();
+				for (gint y = 0; y < height; y += tile_size)
+					{
+					for (gint x = 0; x < width; x += tile_size)
+						{
+						func(src, dest, x, y, std::min(tile_size, width - x), std::min(tile_size, height - y),
+						     0.0, 0.0, scale, scale, interp_type);
+						}
+					}
+				const std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+				return static_cast<gdouble>(width) * height / time.count() / 1e6;
+			};
+
+			const gdouble gdk_rate = scale_tiles(gdk_pixbuf_scale, expected);
+			const gdouble rate = scale_tiles([](auto... args) { pixbuf_scale(args...); }, result);
+
+			const std::vector<guchar> a = all_pixels(expected);
+			const std::vector<guchar> b = all_pixels(result);
+			gdouble error = 0.0;
+			for (gsize i = 0; i < a.size(); i++)
+				{
+				error += (a[i] - b[i]) * (a[i] - b[i]);
+				}
+			error /= a.size();
+			const gdouble psnr = (error > 0.0) ? 10.0 * std::log10(255.0 * 255.0 / error) : INFINITY;
+
+			std::cout << (interp_type == GDK_INTERP_HYPER ? "hyper" : "bilinear") << " x" << scale << ": "
+			          << "gdk-pixbuf " << gdk_rate << " Mpixel/s, "
+			          << "pixbuf_scale " << rate << " Mpixel/s (" << rate / gdk_rate << "x), "
+			          << "PSNR " << psnr << " dB\n";
+			}
+		}
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
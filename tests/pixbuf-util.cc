@@ -24,10 +24,82 @@
 
 #include "gtest/gtest.h"
 
+#include <algorithm>
+#include <vector>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
 #include "pixbuf-util.h"
 
 namespace {
 
+// For convenience.
+namespace t = ::testing;
+
+/* A pixbuf of the given pixels, row after row */
+GdkPixbuf *make_pixbuf(gint width, gint height, gboolean has_alpha, const std::vector<guchar> &pixels)
+{
+	const gint channels = has_alpha ? 4 : 3;
+	GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, has_alpha, 8, width, height);
+
+	for (gint y = 0; y < height; y++)
+		{
+		std::copy_n(pixels.begin() + (y * width * channels), width * channels,
+		            gdk_pixbuf_get_pixels(pixbuf) + (y * gdk_pixbuf_get_rowstride(pixbuf)));
+		}
+
+	return pixbuf;
+}
+
+std::vector<guchar> pixel_at(const GdkPixbuf *pixbuf, gint x, gint y)
+{
+	const gint channels = gdk_pixbuf_get_n_channels(pixbuf);
+	const guchar *p = gdk_pixbuf_read_pixels(pixbuf) + (y * gdk_pixbuf_get_rowstride(pixbuf)) + (x * channels);
+
+	return {p, p + channels};
+}
+
 }  // anonymous namespace
 
+TEST(PixbufUtilTest, HalfSizeAveragesBlocks)
+{
+	g_autoptr(GdkPixbuf) pixbuf = make_pixbuf(4, 2, FALSE, {
+		0, 0, 0,      100, 100, 100,  10, 20, 30,   10, 20, 30,
+		200, 0, 0,    0, 200, 2,      10, 20, 30,   10, 20, 31});
+
+	g_autoptr(GdkPixbuf) half = pixbuf_half_size(pixbuf);
+
+	ASSERT_EQ(2, gdk_pixbuf_get_width(half));
+	ASSERT_EQ(1, gdk_pixbuf_get_height(half));
+	EXPECT_EQ((std::vector<guchar>{75, 75, 26}), pixel_at(half, 0, 0));
+	EXPECT_EQ((std::vector<guchar>{10, 20, 30}), pixel_at(half, 1, 0));
+}
+
+TEST(PixbufUtilTest, HalfSizeRoundsUp)
+{
+	g_autoptr(GdkPixbuf) pixbuf = make_pixbuf(3, 3, FALSE, {
+		0, 0, 0,   0, 0, 0,   40, 0, 0,
+		0, 0, 0,   0, 0, 0,   80, 0, 0,
+		0, 8, 0,   0, 16, 0,  0, 0, 100});
+
+	g_autoptr(GdkPixbuf) half = pixbuf_half_size(pixbuf);
+
+	ASSERT_EQ(2, gdk_pixbuf_get_width(half));
+	ASSERT_EQ(2, gdk_pixbuf_get_height(half));
+	EXPECT_EQ((std::vector<guchar>{60, 0, 0}), pixel_at(half, 1, 0));
+	EXPECT_EQ((std::vector<guchar>{0, 12, 0}), pixel_at(half, 0, 1));
+	EXPECT_EQ((std::vector<guchar>{0, 0, 100}), pixel_at(half, 1, 1));
+}
+
+TEST(PixbufUtilTest, HalfSizeWeightsColorsByAlpha)
+{
+	g_autoptr(GdkPixbuf) pixbuf = make_pixbuf(2, 2, TRUE, {
+		255, 0, 0, 255,   0, 255, 0, 0,
+		255, 0, 0, 255,   0, 0, 255, 0});
+
+	g_autoptr(GdkPixbuf) half = pixbuf_half_size(pixbuf);
+
+	EXPECT_EQ((std::vector<guchar>{255, 0, 0, 128}), pixel_at(half, 0, 0));
+}
+
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
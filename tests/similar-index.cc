@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for similar-index.cc
+ *
+ * The benchmark is disabled by default, run it with:
+ * geeqie --run-unit-tests --gtest_also_run_disabled_tests --gtest_filter='*SimilarityIndex*'
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <glib.h>
+
+#include "similar-index.h"
+#include "similar.h"
+
+namespace {
+
+constexpr gdouble MAX_DISTANCE = 255.0 * 1024.0 * 3.0;
+
+/**
+ * Generates smooth images (base color, gradient and one blob per channel),
+ * which like real similarity data have a low intrinsic dimension.
+ * Every tenth item is a slightly noisy, transformed copy of an earlier one.
+ */
+std::vector<std::unique_ptr<ImageSimilarityData>> synthetic_set(gint count)
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<gdouble> unit(0.0, 1.0);
+	std::uniform_int_distribution<gint> noise(-3, 3);
+	std::vector<std::unique_ptr<ImageSimilarityData>> set;
+
+	for (gint n = 0; n < count; n++)
+		{
+		auto sd = std::make_unique<ImageSimilarityData>();
+
+		if (n % 10 == 9)
+			{
+			*sd = image_sim_transform(*set[rng() % n], rng() % 8);
+			for (gint i = 0; i < 1024; i++)
+				{
+				sd->avg_r[i] = std::clamp(sd->avg_r[i] + noise(rng), 0, 255);
+				sd->avg_g[i] = std::clamp(sd->avg_g[i] + noise(rng), 0, 255);
+				sd->avg_b[i] = std::clamp(sd->avg_b[i] + noise(rng), 0, 255);
+				}
+			}
+		else
+			{
+			for (ImageSimilarityData::Avg *avg : {&sd->avg_r, &sd->avg_g, &sd->avg_b})
+				{
+				const gdouble base = 255.0 * unit(rng);
+				const gdouble dx = 8.0 * (unit(rng) - 0.5);
+				const gdouble dy = 8.0 * (unit(rng) - 0.5);
+				const gdouble cx = 32.0 * unit(rng);
+				const gdouble cy = 32.0 * unit(rng);
+				const gdouble amplitude = 255.0 * (unit(rng) - 0.5);
+
+				for (gint y = 0; y < 32; y++)
+					{
+					for (gint x = 0; x < 32; x++)
+						{
+						const gdouble blob = amplitude * exp(-(((x - cx) * (x - cx)) + ((y - cy) * (y - cy))) / 50.0);
+						(*avg)[(y * 32) + x] = std::clamp(static_cast<gint>(base + (dx * x) + (dy * y) + blob), 0, 255);
+						}
+					}
+				}
+			}
+
+		sd->filled = true;
+		set.push_back(std::move(sd));
+		}
+
+	return set;
+}
+
+std::vector<const ImageSimilarityData *> pointers(const std::vector<std::unique_ptr<ImageSimilarityData>> &set)
+{
+	std::vector<const ImageSimilarityData *> result;
+
+	for (const auto &sd : set) result.push_back(sd.get());
+
+	return result;
+}
+
+/* Same test as image_sim_compare_fast() for the standard algorithm */
+std::vector<gint> brute_force(const std::vector<const ImageSimilarityData *> &items, const ImageSimilarityData *needle, gdouble min, gint transforms)
+{
+	std::vector<ImageSimilarityData> transformed;
+	std::vector<gint> result;
+
+	for (gint t = 0; t < transforms; t++) transformed.push_back(image_sim_transform(*needle, t));
+
+	for (gsize i = 0; i < items.size(); i++)
+		{
+		for (const ImageSimilarityData &sd : transformed)
+			{
+			const gdouble score = 1.0 - (ImageSimilarityIndex::distance(items[i], &sd) / MAX_DISTANCE);
+			if (score >= min)
+				{
+				result.push_back(i);
+				break;
+				}
+			}
+		}
+
+	return result;
+}
+
+} // anonymous namespace
+
+TEST(SimilarityIndexTest, TransformsHaveDihedralPeriod)
+{
+	const auto set = synthetic_set(1);
+	const ImageSimilarityData &sd = *set[0];
+
+	for (gint t = 0; t < 8; t++)
+		{
+		const ImageSimilarityData once = image_sim_transform(sd, t);
+		gint period = 1;
+		ImageSimilarityData repeated = once;
+
+		while (ImageSimilarityIndex::distance(&repeated, &sd) != 0 && period < 4)
+			{
+			repeated = image_sim_transform(repeated, t);
+			period++;
+			}
+
+		EXPECT_EQ(0U, ImageSimilarityIndex::distance(&repeated, &sd)) << "transform " << t;
+		}
+}
+
+TEST(SimilarityIndexTest, SkipsUnfilledData)
+{
+	auto set = synthetic_set(40);
+	set[3]->filled = false;
+
+	std::vector<const ImageSimilarityData *> items = pointers(set);
+	items.push_back(nullptr);
+
+	const ImageSimilarityIndex index(items);
+	EXPECT_EQ(39U, index.size());
+
+	const std::vector<gint> found = index.find(set[4].get(), 0.0, 1);
+	EXPECT_EQ(39U, found.size());
+	EXPECT_EQ(found.end(), std::find(found.begin(), found.end(), 3));
+}
+
+TEST(SimilarityIndexTest, FindsAllBruteForceMatches)
+{
+	const auto set = synthetic_set(200);
+	const std::vector<const ImageSimilarityData *> items = pointers(set);
+	const ImageSimilarityIndex index(items);
+
+	for (const gdouble min : {0.95, 0.85})
+		{
+		for (const gint transforms : {1, 8})
+			{
+			for (const ImageSimilarityData *needle : items)
+				{
+				const std::vector<gint> expected = brute_force(items, needle, min, transforms);
+				const std::vector<gint> found = index.find(needle, min, transforms);
+
+				EXPECT_TRUE(std::includes(found.begin(), found.end(), expected.begin(), expected.end()))
+					<< "min " << min << " transforms " << transforms;
+				}
+			}
+		}
+}
+
+TEST(SimilarityIndexTest, DISABLED_Benchmark100k)
+{
+	constexpr gint count = 100000;
+	constexpr gint needles = 200;
+
+	const auto set = synthetic_set(count);
+	const std::vector<const ImageSimilarityData *> items = pointers(set);
+
+	const auto start = std::chrono::steady_clock::now();
+	const ImageSimilarityIndex index(items);
+	const auto built = std::chrono::steady_clock::now();
+
+	std::cout << "Index of " << count << " items built in " << std::chrono::duration<gdouble>(built - start).count() << " s\n";
+
+	for (const gdouble min : {0.95, 0.85})
+		{
+		for (const gint transforms : {1, 8})
+			{
+			gsize brute_matches = 0;
+			gsize candidates = 0;
+
+			const auto brute_start = std::chrono::steady_clock::now();
+			for (gint n = 0; n < needles; n++)
+				{
+				brute_matches += brute_force(items, items[n * (count / needles)], min, transforms).size();
+				}
+			const auto index_start = std::chrono::steady_clock::now();
+			for (gint n = 0; n < needles; n++)
+				{
+				candidates += index.find(items[n * (count / needles)], min, transforms).size();
+				}
+			const auto end = std::chrono::steady_clock::now();
+
+			const gdouble brute_time = std::chrono::duration<gdouble>(index_start - brute_start).count() / needles;
+			const gdouble index_time = std::chrono::duration<gdouble>(end - index_start).count() / needles;
+
+			std::cout << "min " << min << " transforms " << transforms << ": "
+			          << "brute force " << 1000.0 * brute_time << " ms/needle (" << brute_matches << " matches), "
+			          << "index " << 1000.0 * index_time << " ms/needle (" << candidates << " candidates), "
+			          << brute_time / index_time << "x\n";
+
+			EXPECT_GE(candidates, brute_matches);
+			}
+		}
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for similar.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <glib.h>
+
+#include "similar.h"
+
+namespace {
+
+ImageSimilarityData random_similarity_data(std::mt19937 &rng)
+{
+	ImageSimilarityData sd;
+
+	for (gsize i = 0; i < 1024; i++)
+		{
+		sd.avg_r[i] = rng() % 256;
+		sd.avg_g[i] = rng() % 256;
+		sd.avg_b[i] = rng() % 256;
+		}
+	sd.filled = true;
+
+	return sd;
+}
+
+ImageSimilarityData noisy_copy(const ImageSimilarityData &sd, gint noise, std::mt19937 &rng)
+{
+	ImageSimilarityData copy = sd;
+
+	for (gsize i = 0; i < 1024; i++)
+		{
+		copy.avg_r[i] = std::clamp(copy.avg_r[i] + static_cast<gint>(rng() % (2 * noise + 1)) - noise, 0, 255);
+		copy.avg_g[i] = std::clamp(copy.avg_g[i] + static_cast<gint>(rng() % (2 * noise + 1)) - noise, 0, 255);
+		copy.avg_b[i] = std::clamp(copy.avg_b[i] + static_cast<gint>(rng() % (2 * noise + 1)) - noise, 0, 255);
+		}
+
+	return copy;
+}
+
+/* The per-transformation, per-cell algorithm the engine replaces */
+gdouble original_compare(const ImageSimilarityData *a, const ImageSimilarityData *b, gint transforms, gdouble min)
+{
+	gdouble max_score = 0;
+
+	for (gint transfo = 0; transfo < transforms; transfo++)
+		{
+		gint sim = 0;
+		gint i2;
+		gint *i;
+		gint j2;
+		gint *j;
+		gboolean aborted = FALSE;
+
+		if (transfo & 1) { i = &j2; j = &i2; } else { i = &i2; j = &j2; }
+		for (gint j1 = 0; j1 < 32 && !aborted; j1++)
+			{
+			if (transfo & 2) *j = 31-j1; else *j = j1;
+			for (gint i1 = 0; i1 < 32 && !aborted; i1++)
+				{
+				if (transfo & 4) *i = 31-i1; else *i = i1;
+				sim += abs(a->avg_r[(i1*32)+j1] - b->avg_r[(i2*32)+j2]);
+				sim += abs(a->avg_g[(i1*32)+j1] - b->avg_g[(i2*32)+j2]);
+				sim += abs(a->avg_b[(i1*32)+j1] - b->avg_b[(i2*32)+j2]);
+				aborted = (sim / (255.0 * 1024.0 * 3.0)) > 1.0 - min;
+				}
+			}
+
+		if (!aborted) max_score = std::max(max_score, 1.0 - (static_cast<gdouble>(sim) / (255.0 * 1024.0 * 3.0)));
+		}
+
+	return max_score;
+}
+
+} // anonymous namespace
+
+TEST(ImageSimilarityReferenceTest, MatchesOriginalAlgorithm)
+{
+	std::mt19937 rng(42);
+
+	for (gint n = 0; n < 50; n++)
+		{
+		const ImageSimilarityData a = random_similarity_data(rng);
+		const ImageSimilarityData b = image_sim_transform(noisy_copy(a, n % 40, rng), n % 8);
+
+		for (const gint transforms : {1, 8})
+			{
+			const ImageSimilarityReference reference(&b, transforms);
+
+			EXPECT_DOUBLE_EQ(original_compare(&a, &b, transforms, 0.0), reference.compare(&a));
+
+			for (const gdouble min : {0.99, 0.95, 0.90, 0.85, 0.5})
+				{
+				EXPECT_DOUBLE_EQ(original_compare(&a, &b, transforms, min), reference.compare_fast(&a, min))
+					<< "transforms " << transforms << " min " << min;
+				}
+			}
+		}
+}
+
+TEST(ImageSimilarityReferenceTest, FindsTransformedCopy)
+{
+	std::mt19937 rng(7);
+	const ImageSimilarityData a = random_similarity_data(rng);
+
+	for (gint t = 0; t < 8; t++)
+		{
+		const ImageSimilarityData b = image_sim_transform(a, t);
+
+		EXPECT_DOUBLE_EQ(1.0, ImageSimilarityReference(&b, 8).compare(&a)) << "transform " << t;
+		}
+}
+
+TEST(ImageSimilarityReferenceTest, UnfilledDataDoesNotMatch)
+{
+	std::mt19937 rng(3);
+	const ImageSimilarityData a = random_similarity_data(rng);
+	ImageSimilarityData b = a;
+	b.filled = false;
+
+	EXPECT_EQ(0.0, ImageSimilarityReference(&b, 8).compare(&a));
+	EXPECT_EQ(0.0, ImageSimilarityReference(&a, 8).compare(&b));
+	EXPECT_EQ(0.0, ImageSimilarityReference(&a, 8).compare(nullptr));
+	EXPECT_EQ(0.0, ImageSimilarityReference(nullptr, 8).compare(&a));
+}
+
+TEST(ImageSimilarityArenaTest, RemovedSlotsAreReused)
+{
+	ImageSimilarityArena arena;
+
+	const gint a = arena.add();
+	const gint b = arena.add();
+	arena.remove(a);
+	EXPECT_EQ(1U, arena.size());
+
+	EXPECT_EQ(a, arena.add());
+	EXPECT_NE(b, a);
+	EXPECT_EQ(2U, arena.size());
+	EXPECT_FALSE(arena.get(a)->filled);
+}
+
+TEST(ImageSimilarityArenaTest, CompactKeepsDataInGivenOrder)
+{
+	std::mt19937 rng(11);
+	ImageSimilarityArena arena;
+	std::vector<ImageSimilarityData> data;
+	std::vector<gint> indices;
+
+	for (gint i = 0; i < 600; i++)
+		{
+		data.push_back(random_similarity_data(rng));
+		indices.push_back(arena.add());
+		*arena.get(indices.back()) = data.back();
+		}
+
+	/* Drop every third item and reverse the others */
+	std::vector<gint> kept;
+	std::vector<const ImageSimilarityData *> expected;
+	for (gint i = static_cast<gint>(data.size()) - 1; i >= 0; i--)
+		{
+		if (i % 3 == 0)
+			{
+			arena.remove(indices[i]);
+			continue;
+			}
+		kept.push_back(indices[i]);
+		expected.push_back(&data[i]);
+		}
+	kept.push_back(-1);
+
+	arena.compact(kept);
+
+	EXPECT_EQ(expected.size(), arena.size());
+	EXPECT_EQ(-1, kept.back());
+	for (gsize i = 0; i < expected.size(); i++)
+		{
+		ASSERT_EQ(static_cast<gint>(i), kept[i]);
+		EXPECT_EQ(expected[i]->avg_r, arena.get(kept[i])->avg_r);
+		EXPECT_EQ(expected[i]->avg_b, arena.get(kept[i])->avg_b);
+		}
+
+	EXPECT_EQ(static_cast<gint>(expected.size()), arena.add());
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
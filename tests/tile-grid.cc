@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for tile-grid.h
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include <glib.h>
+
+#include "tile-grid.h"
+
+namespace {
+
+// For convenience.
+namespace t = ::testing;
+
+struct TestTile
+{
+	gint x;
+	gint y;
+	TestTile *lru_prev;
+	TestTile *lru_next;
+};
+
+/* The positions of the tiles, from the most to the least recently used */
+std::vector<gint> lru_order(const TileGrid<TestTile> &grid)
+{
+	std::vector<gint> order;
+
+	for (const TestTile *tile = grid.first(); tile; tile = tile->lru_next)
+		{
+		order.push_back(tile->x);
+		}
+
+	return order;
+}
+
+} // anonymous namespace
+
+TEST(TileGridTest, FindsByPosition)
+{
+	TileGrid<TestTile> grid;
+	TestTile a{0, 256, nullptr, nullptr};
+	TestTile b{256, 0, nullptr, nullptr};
+
+	grid.insert(&a);
+	grid.insert(&b);
+
+	EXPECT_EQ(2U, grid.size());
+	EXPECT_EQ(&a, grid.find(0, 256));
+	EXPECT_EQ(&b, grid.find(256, 0));
+	EXPECT_EQ(nullptr, grid.find(0, 0));
+	EXPECT_EQ(nullptr, grid.find(256, 256));
+
+	grid.remove(&a);
+
+	EXPECT_EQ(1U, grid.size());
+	EXPECT_EQ(nullptr, grid.find(0, 256));
+	EXPECT_EQ(&b, grid.find(256, 0));
+}
+
+TEST(TileGridTest, KeepsRecentlyUsedOrder)
+{
+	TileGrid<TestTile> grid;
+	std::vector<TestTile> tiles{{1, 0, nullptr, nullptr}, {2, 0, nullptr, nullptr}, {3, 0, nullptr, nullptr}};
+
+	for (TestTile &tile : tiles)
+		{
+		grid.insert(&tile);
+		}
+
+	EXPECT_EQ((std::vector<gint>{3, 2, 1}), lru_order(grid));
+	EXPECT_EQ(&tiles[0], grid.last());
+
+	grid.touch(&tiles[0]);
+	EXPECT_EQ((std::vector<gint>{1, 3, 2}), lru_order(grid));
+	EXPECT_EQ(&tiles[1], grid.last());
+
+	grid.touch(&tiles[0]);
+	EXPECT_EQ((std::vector<gint>{1, 3, 2}), lru_order(grid));
+
+	grid.remove(&tiles[2]);
+	EXPECT_EQ((std::vector<gint>{1, 2}), lru_order(grid));
+
+	grid.remove(&tiles[1]);
+	grid.remove(&tiles[0]);
+	EXPECT_EQ(nullptr, grid.first());
+	EXPECT_EQ(nullptr, grid.last());
+	EXPECT_EQ(0U, grid.size());
+}
+
+TEST(TileGridTest, ReinsertsMovedTile)
+{
+	TileGrid<TestTile> grid;
+	TestTile tile{0, 0, nullptr, nullptr};
+
+	grid.insert(&tile);
+	grid.remove(&tile);
+
+	tile.x = 512;
+	tile.y = -256;
+	grid.insert(&tile);
+
+	EXPECT_EQ(nullptr, grid.find(0, 0));
+	EXPECT_EQ(&tile, grid.find(512, -256));
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */